@@ -5,6 +5,8 @@
 #include "src/buttons.hpp"
 #include "src/logger.hpp"
 #include "src/constants.hpp"
+#include "src/avr_bench.hpp"
+#include "src/esp32_tasks.hpp"
 
 /*
    _____         _____ _____ _____ _____
@@ -27,6 +29,10 @@ void setup()
 {
   Serial.begin(115200);
 
+#ifdef AVR_CYCLE_BENCH
+  AvrBench::run(); // does not return
+#endif
+
   // Dieser Hinweis darf nicht entfernt werden
   LOG(init_log, s_error, F("\n _____         _____ _____ _____ _____"));
   LOG(init_log, s_error, F("|_   _|___ ___|  |  |     |   | |     |"));
@@ -52,6 +58,9 @@ void setup()
 #ifdef ALLinONE_Plus
   LOG(init_log, s_error, F("A+ "), lf_no);
 #endif
+#ifdef TonUINO_ESP32
+  LOG(init_log, s_error, F("ESP "), lf_no);
+#endif
 
 #ifdef FIVEBUTTONS
   LOG(init_log, s_error, F("5"));
@@ -63,9 +72,16 @@ void setup()
 
 
   Tonuino::getTonuino().setup();
+#ifdef TonUINO_ESP32
+  Esp32Tasks::begin();
+#endif
 }
 
 void loop()
 {
+#ifdef TonUINO_ESP32
+  vTaskDelete(nullptr); // the cycle runs in the tasks of Esp32Tasks
+#else
   Tonuino::getTonuino().loop();
+#endif
 }
@@ -0,0 +1,118 @@
+#include "adc_sampler.hpp"
+
+#include "constants.hpp"
+
+#ifdef ADC_BACKGROUND
+#include "logger.hpp"
+
+#if not defined(UNIT_TESTS) and not defined(ALLinONE)
+#define ADC_SAMPLER_USES_ISR
+#endif
+
+namespace {
+// the first conversions after switching the channel are not exact (the bandgap needs much longer to settle)
+constexpr uint8_t discardConversions        = 1;
+constexpr uint8_t discardConversionsBandgap = 8;
+}
+
+AdcSampler::channel_t AdcSampler::channels[adcSamplerMaxChannels] {};
+uint8_t               AdcSampler::numChannels                     {};
+volatile uint8_t      AdcSampler::current                         {};
+volatile uint8_t      AdcSampler::discard                         {};
+bool                  AdcSampler::running                         {};
+
+uint8_t AdcSampler::add(uint8_t pin, uint8_t filterShift) {
+  if (numChannels >= adcSamplerMaxChannels) {
+    LOG(init_log, s_error, F("AdcSampler: too many channels"));
+    return 0;
+  }
+  channels[numChannels] = channel_t{ pin, filterShift, 0 };
+  return numChannels++;
+}
+
+void AdcSampler::start() {
+#ifdef ADC_SAMPLER_USES_ISR
+  if (running || numChannels == 0)
+    return;
+  // initialize the filters with a blocking read
+  for (uint8_t i = 0; i < numChannels; ++i)
+    channels[i].acc = readBlocking(channels[i].pin) << channels[i].filterShift;
+  running = true;
+  current = 0;
+#if defined(ADC0)
+  ADC0.INTCTRL = ADC_RESRDY_bm;
+#else
+  ADCSRA |= _BV(ADIE);
+#endif
+  startConversion();
+#endif // ADC_SAMPLER_USES_ISR
+}
+
+uint16_t AdcSampler::get(uint8_t channel) {
+  channel_t& c = channels[channel];
+  if (not running)
+    return readBlocking(c.pin);
+  noInterrupts();
+  const uint16_t acc = c.acc;
+  interrupts();
+  return acc >> c.filterShift;
+}
+
+void AdcSampler::conversionDone(uint16_t raw) {
+  if (discard > 0) {
+    --discard;
+  }
+  else {
+    channel_t& c = channels[current];
+    c.acc = c.acc - (c.acc >> c.filterShift) + raw;
+    if (++current >= numChannels)
+      current = 0;
+  }
+  startConversion();
+}
+
+void AdcSampler::startConversion() {
+#ifdef ADC_SAMPLER_USES_ISR
+  const uint8_t pin = channels[current].pin;
+  if (discard == 0)
+    discard = (pin == bandgap) ? discardConversionsBandgap : discardConversions;
+#if defined(ADC0)
+  ADC0.MUXPOS  = digitalPinToAnalogInput(pin);
+  ADC0.COMMAND = ADC_STCONV_bm;
+#else
+  ADMUX  = _BV(REFS0) | ((pin == bandgap) ? (_BV(MUX3) | _BV(MUX2) | _BV(MUX1)) : ((pin >= A0 ? pin - A0 : pin) & 0x07));
+  ADCSRA |= _BV(ADSC);
+#endif
+#endif // ADC_SAMPLER_USES_ISR
+}
+
+uint16_t AdcSampler::readBlocking(uint8_t pin) {
+#if defined(TonUINO_Classic) and not defined(UNIT_TESTS)
+  if (pin == bandgap) {
+    // Read 1.1V reference against AVcc
+    ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+    delay(2); // Wait for Vref to settle
+    ADCSRA |= _BV(ADSC); // Convert
+    while (bit_is_set(ADCSRA,ADSC));
+    uint16_t result = ADCL;
+    result |= ADCH<<8;
+    return result;
+  }
+#endif
+  return analogRead(pin);
+}
+
+#ifdef ADC_SAMPLER_USES_ISR
+#if defined(ADC0)
+ISR(ADC0_RESRDY_vect) {
+  AdcSampler::conversionDone(ADC0.RES);
+}
+#else
+ISR(ADC_vect) {
+  const uint16_t low = ADCL; // ADCL must be read first
+  AdcSampler::conversionDone(low | (ADCH << 8));
+}
+#endif
+#endif // ADC_SAMPLER_USES_ISR
+
+#endif // ADC_BACKGROUND
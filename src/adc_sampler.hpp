@@ -0,0 +1,42 @@
+#ifndef SRC_ADC_SAMPLER_HPP_
+#define SRC_ADC_SAMPLER_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+// converts all registered analog pins round robin in the background (ADC interrupt) and
+// keeps the last (optional filtered) value per channel. Until start() is called and on boards
+// without the interrupt driven conversion (AiO, unit tests) get() reads the pin blocking.
+class AdcSampler {
+public:
+  static constexpr uint8_t bandgap = 0xff; // pseudo pin: 1.1V reference against AVcc (Classic only)
+
+#ifdef ADC_BACKGROUND
+  // returns the channel for get(), filterShift n: exponential average with weight 1/2^n
+  static uint8_t  add(uint8_t pin, uint8_t filterShift = 0);
+  static void     start();
+  static uint16_t get(uint8_t channel);
+
+  static void     conversionDone(uint16_t raw); // called from the ISR
+
+private:
+  struct channel_t {
+    uint8_t  pin;
+    uint8_t  filterShift;
+    uint16_t acc; // value << filterShift
+  };
+
+  static void startConversion();
+
+  static channel_t        channels[adcSamplerMaxChannels];
+  static uint8_t          numChannels;
+  static volatile uint8_t current;
+  static volatile uint8_t discard;
+  static bool             running;
+
+  static uint16_t readBlocking(uint8_t pin);
+#endif // ADC_BACKGROUND
+};
+
+#endif /* SRC_ADC_SAMPLER_HPP_ */
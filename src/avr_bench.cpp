@@ -0,0 +1,201 @@
+#include "avr_bench.hpp"
+
+#ifdef AVR_CYCLE_BENCH
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+#include "queue.hpp"
+#include "commands.hpp"
+#include "settings.hpp"
+#include "linearAnalogKeypad.h"
+#include "tonuino.hpp"
+#include "loop_profiler.hpp"
+
+#ifdef USE_TIMER1
+static_assert(false, "AVR_CYCLE_BENCH needs TIMER1, disable the features that use it (e.g. ROTARY_ENCODER on the Classic)");
+#endif
+
+extern uint8_t  __heap_start;
+extern uint8_t* __brkval;
+
+namespace {
+
+constexpr uint8_t runs         = 8;
+constexpr uint8_t stackPattern = 0x5a;
+constexpr uint8_t latencyPin   = 2; // INT0, like an encoder pin with attachInterrupt() (DfPlayer RX, not used yet)
+
+// ---------------------------------------------------------------------------
+// cycle counter: TIMER1 without prescaler, the overflows extend it to 32 bit
+
+volatile uint16_t overflows{};
+
+uint32_t cycles() {
+  const uint8_t sreg = SREG;
+  cli();
+  uint16_t high = overflows;
+  const uint16_t low = TCNT1;
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000) // overflow not yet handled
+    ++high;
+  SREG = sreg;
+  return (static_cast<uint32_t>(high) << 16) | low;
+}
+
+// ---------------------------------------------------------------------------
+// interrupt latency: the cycles from the event until the handler runs
+
+volatile uint16_t timerLatency{};
+volatile uint32_t pinEvent    {};
+volatile uint32_t pinLatency  {};
+
+void onLatencyPin() {
+  pinLatency = cycles() - pinEvent;
+}
+
+// ---------------------------------------------------------------------------
+// stack: paint the free RAM below the stack pointer, then find the lowest overwritten byte
+
+uint8_t* paintStack() {
+  uint8_t* low = __brkval ? __brkval : &__heap_start;
+  uint8_t* sp  = reinterpret_cast<uint8_t*>(SP) - 8; // keep the frame of this function
+  for (uint8_t* p = low; p < sp; ++p)
+    *p = stackPattern;
+  return sp;
+}
+
+uint16_t usedStack(uint8_t* sp) {
+  uint8_t* p = __brkval ? __brkval : &__heap_start;
+  while (p < sp && *p == stackPattern)
+    ++p;
+  return sp - p;
+}
+
+// ---------------------------------------------------------------------------
+
+template<typename F>
+void measure(const __FlashStringHelper* name, F f) {
+  uint32_t minCycles = 0xffffffff;
+  uint32_t maxCycles = 0;
+  uint8_t* sp = paintStack();
+  for (uint8_t i = 0; i < runs; ++i) {
+    const uint32_t start = cycles();
+    f();
+    const uint32_t c = cycles() - start;
+    if (c < minCycles) minCycles = c;
+    if (c > maxCycles) maxCycles = c;
+  }
+  const uint16_t stack = usedStack(sp);
+  Serial.print(name);
+  Serial.print(F(": cycles min "));
+  Serial.print(minCycles);
+  Serial.print(F(" max "));
+  Serial.print(maxCycles);
+  Serial.print(F(" stack "));
+  Serial.println(stack);
+  Serial.flush();
+}
+
+void measureLatency() {
+  uint16_t maxTimer = 0;
+  uint32_t maxPin   = 0;
+  queue<uint8_t, 64> q{};
+  for (uint8_t i = 0; i < 64; ++i)
+    q.push(i);
+  for (uint8_t i = 0; i < runs; ++i) {
+    // the event fires while the main loop shuffles (interrupts are blocked by cli() sections of the code)
+    OCR1B  = TCNT1 + 500;
+    TIFR1  = _BV(OCF1B);
+    TIMSK1 |= _BV(OCIE1B);
+    q.shuffle();
+    TIMSK1 &= ~_BV(OCIE1B);
+    if (timerLatency > maxTimer) maxTimer = timerLatency;
+
+    pinEvent = cycles();
+    digitalWrite(latencyPin, not digitalRead(latencyPin)); // an output pin triggers INT0 too
+    q.shuffle();
+    if (pinLatency > maxPin) maxPin = pinLatency;
+  }
+  Serial.print(F("latency TIMER1 ISR: "));
+  Serial.print(maxTimer);
+  Serial.print(F(" cycles, INT0 (attachInterrupt): "));
+  Serial.print(maxPin);
+  Serial.println(F(" cycles"));
+}
+
+} // anonymous namespace
+
+ISR(TIMER1_OVF_vect) {
+  ++overflows;
+}
+
+ISR(TIMER1_COMPB_vect) {
+  timerLatency = TCNT1 - OCR1B;
+}
+
+void AvrBench::run() {
+  cli();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10); // F_CPU
+  TCNT1  = 0;
+  TIMSK1 = _BV(TOIE1);
+  sei();
+
+  Serial.print(F("AVR cycle bench, F_CPU "));
+  Serial.println(F_CPU);
+
+  {
+    queue<uint8_t, 255> q{};
+    for (uint8_t i = 1; i < 255; ++i)
+      q.push(i);
+    measure(F("queue shuffle (254)"), [&q]() { q.shuffle(); });
+    uint8_t sum = 0;
+    measure(F("queue get (254)"), [&]() { for (uint8_t i = 0; i < q.size(); ++i) sum += q.get(i); });
+  }
+  {
+    permutation_queue<255> q{};
+    for (uint8_t i = 1; i < 255; ++i)
+      q.push(i);
+    q.shuffle(0x1234);
+    uint8_t sum = 0;
+    measure(F("permutation get (254)"), [&]() { for (uint8_t i = 0; i < q.size(); ++i) sum += q.get(i); });
+  }
+  {
+    bitfield<128> b{};
+    measure(F("bitfield set/get (128)"), [&b]() { for (uint8_t i = 0; i < 128; ++i) { b.setBit(i); b.getBit(127-i); } });
+  }
+  {
+    Settings settings{};
+    settings.resetSettings();
+    Commands commands{settings, nullptr};
+    volatile command c{};
+    measure(F("getCommand (all raw)"), [&]() {
+      for (uint8_t raw = 0; raw < static_cast<uint8_t>(commandRaw::menu_jump); ++raw)
+        c = commands.getCommand(static_cast<commandRaw>(raw), state_for_command::play);
+    });
+  }
+  {
+    linearAnalogKeypad keypad{A3, 9, 1023, 1000};
+    volatile unsigned char key{};
+    measure(F("keypad getKey (32)"), [&]() { for (int16_t v = 0; v < 1024; v += 32) key = keypad.getKey(v); });
+  }
+  pinMode(latencyPin, OUTPUT);
+  attachInterrupt(digitalPinToInterrupt(latencyPin), onLatencyPin, CHANGE);
+  measureLatency();
+  detachInterrupt(digitalPinToInterrupt(latencyPin));
+  pinMode(latencyPin, INPUT);
+
+  // the whole loop with unconnected peripherals (no card, no answer of the DfPlayer),
+  // the cycle without the delay is in the section "cycle" of the loop profile (us)
+  Tonuino::getTonuino().setup();
+  for (uint8_t i = 0; i < 20; ++i)
+    Tonuino::getTonuino().loop();
+  LoopProfiler::printSummary();
+  Serial.flush();
+
+  cli();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+  while (true) {}
+}
+
+#endif // AVR_CYCLE_BENCH
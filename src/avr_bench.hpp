@@ -0,0 +1,19 @@
+#ifndef SRC_AVR_BENCH_HPP_
+#define SRC_AVR_BENCH_HPP_
+
+#include "constants.hpp"
+
+#ifdef AVR_CYCLE_BENCH
+// runs the hot paths instead of the firmware and prints the AVR cycles of each
+// (min/max over the runs), the stack used by it and the latency of the TIMER1 and
+// the external (encoder) interrupt. TIMER1 runs with F_CPU, so it counts the cycles.
+// Made to run in the cycle accurate simulator simavr:
+//   pio run -e bench_avr_classic -t simavr
+// simavr quits at the end (sleep with disabled interrupts).
+class AvrBench {
+public:
+  [[noreturn]] static void run();
+};
+#endif // AVR_CYCLE_BENCH
+
+#endif /* SRC_AVR_BENCH_HPP_ */
@@ -5,6 +5,8 @@
 #ifdef BAT_VOLTAGE_MEASUREMENT
 #include "logger.hpp"
 #include "mp3.hpp"
+#include "adc_sampler.hpp"
+#include "energy_monitor.hpp"
 
 namespace {
 
@@ -17,7 +19,7 @@ inline constexpr int16_t voltageMeasurementEmptyLevel  = batVoltageEmpty/voltage
 inline constexpr unsigned long batLowMessageIntervall  = 30*1000; // 30 seconds
 inline constexpr unsigned long batEmptyTimer           = 10*1000; // 10 seconds
 
-#ifdef TonUINO_Classic
+#if defined(TonUINO_Classic) and not defined(ADC_BACKGROUND)
 long readVcc() {
   long result;
   // Read 1.1V reference against AVcc
@@ -38,13 +40,26 @@ BatVoltage::BatVoltage(Mp3& mp3)
 {
   pinMode(voltageMeasurementPin, INPUT);
   logTimer.start(2000);
+#ifdef ADC_BACKGROUND
+  adcChannel    = AdcSampler::add(voltageMeasurementPin, 2);
+#ifdef TonUINO_Classic
+  adcChannelVcc = AdcSampler::add(AdcSampler::bandgap  , 2);
+#endif
+#endif
 }
 
 bool BatVoltage::check() {
+#ifdef ADC_BACKGROUND
+#ifdef TonUINO_Classic
+  const uint16_t voltageMeasurementRefVoltage = 1125300L / AdcSampler::get(adcChannelVcc); // Back-calculate AVcc in mV
+#endif
+  const int16_t value = AdcSampler::get(adcChannel)*static_cast<long>(voltageMeasurementRefVoltage)/1000;
+#else
 #ifdef TonUINO_Classic
   const uint16_t voltageMeasurementRefVoltage = readVcc();
 #endif
   const int16_t value = analogRead(voltageMeasurementPin)*static_cast<long>(voltageMeasurementRefVoltage)/1000;
+#endif
 
   LOG_CODE(batvol_log, s_debug, {                                                                               \
   if (logTimer.isExpired()) {                                                                                   \
@@ -52,6 +67,7 @@ bool BatVoltage::check() {
     LOG(batvol_log, s_debug, F("BatVoltage: "), value*voltageMeasurementCorrection/voltageMeasurementMaxLevel); \
   }                                                                                                             \
                                 } );
+  EnergyMonitor::voltage(value*voltageMeasurementCorrection*1000/voltageMeasurementMaxLevel);
 
   if (value < voltageMeasurementEmptyLevel) {
     if (emptyTimer.isActive()) {
@@ -84,6 +100,13 @@ bool BatVoltage::check() {
 }
 
 void BatVoltage::lowMessage() {
+#ifdef ENERGY_MONITOR_ANNOUNCE
+  const long remaining = EnergyMonitor::remainingMinutes();
+  if (remaining > 0) {
+    mp3.playAdvertisement(min(remaining, 255L), false /*olnyIfIsPlaying*/);
+    return;
+  }
+#endif
   mp3.playAdvertisement(advertTracks::t_262_pling, false /*olnyIfIsPlaying*/);
 }
 
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 
+#include "constants.hpp"
 #include "timer.hpp"
 
 class Mp3;
@@ -20,6 +21,12 @@ private:
   Timer lowTimer{};
   Timer emptyTimer{};
   Mp3&  mp3;
+#ifdef ADC_BACKGROUND
+  uint8_t adcChannel{};
+#ifdef TonUINO_Classic
+  uint8_t adcChannelVcc{};
+#endif
+#endif
 };
 
 #endif /* SRC_BATVOLTAGE_HPP_ */
@@ -2,11 +2,86 @@
 
 #include "constants.hpp"
 #include "logger.hpp"
+#include "queue.hpp"
+#include "pin_change.hpp"
 
 namespace {
 constexpr bool buttonPinIsActiveLow = (buttonPinType == levelType::activeLow);
+
+#ifdef BUTTONS_EDGE_BUFFER
+struct buttonEdge {
+  unsigned long time;
+  uint8_t       pressed; // bit mask of the pressed buttons after the edge
+};
+ring_buffer<buttonEdge, buttonEdgeBufferSize> edges{};
+volatile uint8_t lastPressed{};
+#ifdef PIN_CHANGE_IRQ
+void sampleOnChange(bool) { Buttons::sample(); } // the debounce is done with the time stamps
+#endif
+#endif
+}
+
+#ifdef BUTTONS_EDGE_BUFFER
+Buttons* Buttons::instance = nullptr;
+
+void EdgeButton::begin() {
+  pinMode(pin, puEnable ? INPUT_PULLUP : INPUT);
+  state      = readPin();
+  time       = millis();
+  lastChange = time;
+  changed    = false;
+}
+
+bool EdgeButton::update(bool pressed, unsigned long t) {
+  if (t < time) // edge recorded before the last sample
+    t = time;
+  if (t - lastChange < dbTime) {
+    changed = false;
+  }
+  else {
+    changed = (state != pressed);
+    state   = pressed;
+    if (changed)
+      lastChange = t;
+  }
+  time = t;
+  return changed;
+}
+
+uint8_t Buttons::readPressed() const {
+  return (buttonPause.readPin() ? 0x01 : 0)
+       | (buttonUp   .readPin() ? 0x02 : 0)
+       | (buttonDown .readPin() ? 0x04 : 0)
+#ifdef FIVEBUTTONS
+       | (buttonFour .readPin() ? 0x08 : 0)
+       | (buttonFive .readPin() ? 0x10 : 0)
+#endif
+       ;
 }
 
+void Buttons::sample() {
+  if (instance == nullptr)
+    return;
+  const uint8_t pressed = instance->readPressed();
+  if (pressed == lastPressed)
+    return;
+  if (edges.push(buttonEdge{ millis(), pressed }))
+    lastPressed = pressed;
+}
+
+bool Buttons::update(uint8_t pressed, unsigned long t) {
+  bool changed = false;
+  changed |= buttonPause.update(pressed & 0x01, t);
+  changed |= buttonUp   .update(pressed & 0x02, t);
+  changed |= buttonDown .update(pressed & 0x04, t);
+#ifdef FIVEBUTTONS
+  changed |= buttonFour .update(pressed & 0x08, t);
+  changed |= buttonFive .update(pressed & 0x10, t);
+#endif
+  return changed;
+}
+#endif // BUTTONS_EDGE_BUFFER
+
 Buttons::Buttons()
 : CommandSource()
 //            pin             dbTime        puEnable              invert
@@ -25,6 +100,27 @@ Buttons::Buttons()
   buttonFour .begin();
   buttonFive .begin();
 #endif
+#ifdef BUTTONS_EDGE_BUFFER
+  instance    = this;
+  lastPressed = readPressed();
+#if defined(PIN_CHANGE_IRQ)
+  PinChange::subscribe(buttonPausePin, 0, sampleOnChange);
+  PinChange::subscribe(buttonUpPin   , 0, sampleOnChange);
+  PinChange::subscribe(buttonDownPin , 0, sampleOnChange);
+#ifdef FIVEBUTTONS
+  PinChange::subscribe(buttonFourPin , 0, sampleOnChange);
+  PinChange::subscribe(buttonFivePin , 0, sampleOnChange);
+#endif
+#elif not defined(BUTTONS_EDGE_BUFFER_USES_TIMER1) and not defined(UNIT_TESTS)
+  attachInterrupt(digitalPinToInterrupt(buttonPausePin), Buttons::sample, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(buttonUpPin   ), Buttons::sample, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(buttonDownPin ), Buttons::sample, CHANGE);
+#ifdef FIVEBUTTONS
+  attachInterrupt(digitalPinToInterrupt(buttonFourPin ), Buttons::sample, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(buttonFivePin ), Buttons::sample, CHANGE);
+#endif
+#endif
+#endif // BUTTONS_EDGE_BUFFER
 }
 
 commandRaw Buttons::getCommandRaw() {
@@ -173,6 +269,23 @@ bool Buttons::isReset() {
 }
 
 void Buttons::readButtons() {
+#ifdef BUTTONS_EDGE_BUFFER
+#ifdef PIN_CHANGE_IRQ
+  PinChange::loop();
+#else
+  // sample also here, the interrupt is only for the edges during blocking calls
+  noInterrupts();
+  sample();
+  interrupts();
+#endif
+  // apply the recorded edges until one changes a button (like one read() per cycle)
+  buttonEdge edge;
+  while (edges.pop(edge)) {
+    if (update(edge.pressed, edge.time))
+      return;
+  }
+  update(lastPressed, millis());
+#else
   buttonPause.read();
   buttonUp   .read();
   buttonDown .read();
@@ -180,4 +293,5 @@ void Buttons::readButtons() {
   buttonFour .read();
   buttonFive .read();
 #endif
+#endif // BUTTONS_EDGE_BUFFER
 }
@@ -7,6 +7,40 @@
 #include "commands.hpp"
 #include "constants.hpp"
 
+#ifdef BUTTONS_EDGE_BUFFER
+#if not defined(ALLinONE_Plus) and not defined(TonUINO_Every) and not defined(TonUINO_Every_4808) and not defined(TonUINO_ESP32) and not defined(UNIT_TESTS) \
+    and not defined(PIN_CHANGE_IRQ)
+#define USE_TIMER1
+#define BUTTONS_EDGE_BUFFER_USES_TIMER1
+#endif
+
+// same interface like JC_Button, but the samples (with the time stamp) are given by update()
+class EdgeButton {
+public:
+  EdgeButton(uint8_t pin, uint32_t dbTime, uint8_t puEnable, uint8_t invert)
+  : pin(pin), dbTime(dbTime), puEnable(puEnable), invert(invert) {}
+
+  void begin();
+  // returns true if the debounced state has changed
+  bool update(bool pressed, unsigned long t);
+
+  bool isPressed  () const { return state; }
+  bool wasReleased() const { return not state && changed; }
+  bool pressedFor(uint32_t ms) const { return state && time - lastChange >= ms; }
+  bool readPin    () const { return (digitalRead(pin) == HIGH) != invert; }
+
+private:
+  uint8_t       pin;
+  uint32_t      dbTime;
+  bool          puEnable;
+  bool          invert;
+  bool          state     {};
+  bool          changed   {};
+  unsigned long time      {};
+  unsigned long lastChange{};
+};
+#endif // BUTTONS_EDGE_BUFFER
+
 class Buttons: public CommandSource {
 public:
   Buttons();
@@ -15,16 +49,30 @@ public:
   bool isNoButton();
   bool isReset();
 
+#ifdef BUTTONS_EDGE_BUFFER
+  // records the actual state of all buttons in the edge buffer (if changed), called from the ISR
+  static void sample();
+#endif
+
 private:
 
   void readButtons();
 
-  Button buttonPause;
-  Button buttonUp   ;
-  Button buttonDown ;
+#ifdef BUTTONS_EDGE_BUFFER
+  using button_t = EdgeButton;
+  uint8_t readPressed() const;
+  bool update(uint8_t pressed, unsigned long t);
+  static Buttons* instance;
+#else
+  using button_t = Button;
+#endif
+
+  button_t buttonPause;
+  button_t buttonUp   ;
+  button_t buttonDown ;
 #ifdef FIVEBUTTONS
-  Button  buttonFour;
-  Button  buttonFive;
+  button_t buttonFour;
+  button_t buttonFive;
 #endif
   bool ignoreRelease     = false;
   bool ignoreAll         = false;
@@ -2,6 +2,7 @@
 
 #include "constants.hpp"
 #include "logger.hpp"
+#include "adc_sampler.hpp"
 
 #ifdef BUTTONS3X3
 //#define CALIBRATE3X3
@@ -9,6 +10,9 @@
 Buttons3x3::Buttons3x3()
 : CommandSource()
 , buttons(button3x3Pin, numLevels, maxLevel, buttonLongPress)
+#ifdef ADC_BACKGROUND
+, adcChannel(AdcSampler::add(button3x3Pin))
+#endif
 {
 }
 
@@ -18,9 +22,18 @@ commandRaw Buttons3x3::getCommandRaw() {
 #ifdef CALIBRATE3X3
   static uint8_t t = 0;
   if (t % 50 == 0)
+#ifdef ADC_BACKGROUND
+    // the ADC interrupt converts all the time, a direct analogRead() would disturb it
+    LOG(button_log, s_info, F("Button3x3 analog value: "), static_cast<int>(AdcSampler::get(adcChannel)));
+#else
     LOG(button_log, s_info, F("Button3x3 analog value: "), static_cast<int>(analogRead(button3x3Pin)));
+#endif
+#else
+#ifdef ADC_BACKGROUND
+  const uint8_t button = buttons.getKey(AdcSampler::get(adcChannel));
 #else
   const uint8_t button = buttons.getKey();
+#endif
 
   if (button >= 1 && button <= buttonExtSC_buttons) {
     ret = static_cast<commandRaw>(static_cast<uint8_t>(commandRaw::ext_begin) + button - 1);
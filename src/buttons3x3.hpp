@@ -6,6 +6,7 @@
 
 
 #include "commands.hpp"
+#include "constants.hpp"
 
 class Buttons3x3: public CommandSource {
 public:
@@ -31,6 +32,9 @@ public:
 
 private:
   linearAnalogKeypad buttons;
+#ifdef ADC_BACKGROUND
+  uint8_t            adcChannel;
+#endif
 };
 
 #endif /* SRC_BUTTONS3X3_HPP_ */
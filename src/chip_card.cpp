@@ -6,6 +6,15 @@
 #include "mp3.hpp"
 #include "constants.hpp"
 #include "logger.hpp"
+#include "latency_trace.hpp"
+#include "loop_profiler.hpp"
+#include "telemetry.hpp"
+#ifdef MEMORY_UID_MATCH
+#include "settings.hpp"
+#endif
+#ifdef TonUINO_ESP32
+#include "esp32_tasks.hpp"
+#endif
 
 // select whether StatusCode and PiccType are printed as names
 // that uses about 690 bytes or 2.2% of flash
@@ -21,6 +30,12 @@ const __FlashStringHelper *str_failed      () { return F(" failed: "    ); }
 const __FlashStringHelper *str_MIFARE_Read () { return F("MIFARE_Read " ); }
 const __FlashStringHelper *str_MIFARE_Write() { return F("MIFARE_Write "); }
 
+#ifdef CARD_READ_RETRY
+// receiver gain per retry step, the first one is the default of the MFRC522
+constexpr byte    cardRetryGains[]  = { MFRC522::RxGain_33dB, MFRC522::RxGain_38dB, MFRC522::RxGain_43dB, MFRC522::RxGain_48dB };
+constexpr uint8_t cardRetryGainSteps = sizeof(cardRetryGains);
+#endif
+
 /**
   Helper routine to dump a byte array as hex values to Serial.
 */
@@ -70,11 +85,17 @@ const byte trailerBlock = 7;
 Chip_card::Chip_card(Mp3 &mp3)
 : mfrc522(mfrc522_SSPin, mfrc522_RSTPin)
 , mp3(mp3)
+#ifdef CARD_PRESENCE_CHECK
+, cardRemovedSwitch(cardRemoveTime)
+#else
 , cardRemovedSwitch(cardRemoveDelay)
+#endif
 {}
 
 bool Chip_card::auth(MFRC522::PICC_Type piccType) {
+  LoopProfiler::Section profile{LoopProfiler::card_auth};
   MFRC522::StatusCode status = MFRC522::STATUS_ERROR;
+  ++rfTransactions;
 
   // Authenticate using key A
   if ((piccType == MFRC522::PICC_TYPE_MIFARE_MINI) ||
@@ -101,51 +122,172 @@ bool Chip_card::auth(MFRC522::PICC_Type piccType) {
 }
 
 Chip_card::readCardEvent Chip_card::readCard(folderSettings &nfcTag) {
+#ifdef SERIAL_REMOTE
+  if (simulated) {
+    simulated = false;
+    nfcTag    = simulatedCard;
+    return readCardEvent::known;
+  }
+#endif
+#ifdef TonUINO_ESP32
+  // the card task has read it already (pollCard())
+  if (not hasDelivered)
+    return readCardEvent::none;
+  hasDelivered = false;
+  nfcTag       = delivered.tag;
+  return delivered.read;
+#else
+  return readCardFromReader(nfcTag);
+#endif
+}
+
+#ifdef TonUINO_ESP32
+Chip_card::cardRead Chip_card::pollCard() {
+  cardRead ret{ getCardEvent(), readCardEvent::none, {} };
+  // still selected from the detection, the next poll would move it to IDLE
+  if (ret.event == cardEvent::inserted)
+    ret.read = readCardFromReader(ret.tag);
+  return ret;
+}
+#endif
+
+Chip_card::readCardEvent Chip_card::readCardFromReader(folderSettings &nfcTag) {
+#ifdef CARD_CACHE
+  if (getFromCache(nfcTag)) {
+    LOG(card_log, s_info, F("Card cached: "), dump_byte_array(mfrc522.uid.uidByte, mfrc522.uid.size));
+    LatencyTrace::mark(LatencyTrace::card_read);
+    validatePending = true;
+    return readCardEvent::known;
+  }
+#endif
+  const readCardEvent ret = readCardFromChip(nfcTag);
+#ifdef CARD_CACHE
+  if (ret == readCardEvent::known)
+    putToCache(nfcTag);
+#endif
+#ifdef MEMORY_UID_MATCH
+  if (ret == readCardEvent::known)
+    putMemoryPair(nfcTag);
+#endif
+  return ret;
+}
+
+#ifdef CARD_READ_RETRY
+uint16_t Chip_card::uidHash() {
+  uint16_t hash = 0;
+  for (uint8_t i = 0; i < mfrc522.uid.size; ++i)
+    hash = hash * 31 + mfrc522.uid.uidByte[i];
+  return hash;
+}
+#endif
+
+#ifdef MEMORY_UID_MATCH
+uint32_t Chip_card::uidKey() {
+  uint8_t key[4]{};
+  for (uint8_t i = 0; i < mfrc522.uid.size; ++i)
+    key[i % 4] ^= mfrc522.uid.uidByte[i];
+  return key[0] | (key[1] << 8) | (static_cast<uint32_t>(key[2]) << 16) | (static_cast<uint32_t>(key[3]) << 24);
+}
+
+uint8_t Chip_card::getMemoryPair() {
+  const uint8_t pair = Settings::readMemoryUidFromFlash(uidKey());
+  if (pair != 0)
+    LOG(card_log, s_info, F("Memory card: "), pair);
+  return pair;
+}
+
+// the EEPROM is only written if the pair changes or a memory game card is rewritten
+void Chip_card::putMemoryPair(const folderSettings &nfcTag) {
+  const bool isMemoryCard = nfcTag.mode == pmode_t::memory_game && nfcTag.folder == 0;
+  Settings::writeMemoryUidToFlash(uidKey(), isMemoryCard ? nfcTag.special : 0);
+}
+#endif // MEMORY_UID_MATCH
+
+#ifdef CARD_CACHE
+int8_t Chip_card::findInCache() {
+  if (mfrc522.uid.size == 0 || mfrc522.uid.size > cacheEntry::maxUidSize)
+    return -1;
+  for (uint8_t i = 0; i < cardCacheSize; ++i)
+    if (cardCache[i].uidSize == mfrc522.uid.size && memcmp(cardCache[i].uid, mfrc522.uid.uidByte, mfrc522.uid.size) == 0)
+      return i;
+  return -1;
+}
+
+bool Chip_card::getFromCache(folderSettings &nfcTag) {
+  const int8_t pos = findInCache();
+  if (pos < 0)
+    return false;
+  nfcTag = cardCache[pos].value;
+  return true;
+}
+
+// moves the card to the front, the least recently used card drops out at the end
+void Chip_card::putToCache(const folderSettings &nfcTag) {
+  if (mfrc522.uid.size == 0 || mfrc522.uid.size > cacheEntry::maxUidSize)
+    return;
+  int8_t pos = findInCache();
+  if (pos < 0)
+    pos = cardCacheSize-1;
+  for (; pos > 0; --pos)
+    cardCache[pos] = cardCache[pos-1];
+  cardCache[0].uidSize = mfrc522.uid.size;
+  memcpy(cardCache[0].uid, mfrc522.uid.uidByte, mfrc522.uid.size);
+  cardCache[0].value   = nfcTag;
+}
+
+void Chip_card::removeFromCache() {
+  int8_t pos = findInCache();
+  if (pos < 0)
+    return;
+  for (; pos < cardCacheSize-1; ++pos)
+    cardCache[pos] = cardCache[pos+1];
+  cardCache[cardCacheSize-1].uidSize = 0;
+}
+
+// reads the card after a cache hit, returns true if the content has changed
+bool Chip_card::validateCache() {
+  validatePending = false;
+  folderSettings cached;
+  if (not getFromCache(cached))
+    return false;
+  folderSettings nfcTag;
+  switch (readCardFromChip(nfcTag)) {
+  case readCardEvent::none : return false; // read error, keep the cache
+  case readCardEvent::empty: removeFromCache(); break;
+  case readCardEvent::known:
+    if (nfcTag == cached)
+      return false;
+    putToCache(nfcTag);
+    break;
+  }
+  LOG(card_log, s_info, F("Card changed"));
+  return true;
+}
+#endif // CARD_CACHE
+
+Chip_card::readCardEvent Chip_card::readCardFromChip(folderSettings &nfcTag) {
   // Show some details of the PICC (that is: the tag/card)
   LOG(card_log, s_debug, F("Card UID: "), dump_byte_array(mfrc522.uid.uidByte, mfrc522.uid.size));
   const MFRC522::PICC_Type piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
   LOG(card_log, s_debug, F("PICC type: "), printPiccType(mfrc522, piccType));
 
-  byte buffer[buffferSizeRead];
-  MFRC522::StatusCode status = MFRC522::STATUS_ERROR;
-
-  if (not auth(piccType))
+#ifdef CARD_PRESENCE_CHECK
+  if (not selectCard())
     return readCardEvent::none;
+#endif
+  byte buffer[buffferSizeRead];
+  rfTransactions = 0;
+  Telemetry::count(Telemetry::card_reads);
 
-  // Show the whole sector as it currently is
-  // LOG(card_log, s_info, F("Current data in sector:"));
-  // mfrc522.PICC_DumpMifareClassicSectorToSerial(&(mfrc522.uid), &key, sector);
-  // Serial.println();
-
-  // Read data from the block
-  if ((piccType == MFRC522::PICC_TYPE_MIFARE_MINI) ||
-      (piccType == MFRC522::PICC_TYPE_MIFARE_1K  ) ||
-      (piccType == MFRC522::PICC_TYPE_MIFARE_4K  ) )
-  {
-    byte size = sizeof(buffer);
-    status = static_cast<MFRC522::StatusCode>(mfrc522.MIFARE_Read(4, buffer, &size));
-    if (status != MFRC522::STATUS_OK)
-      LOG(card_log, s_debug, str_MIFARE_Read(), F("4"), str_failed(), printStatusCode(mfrc522, status));
-  }
-  else if (piccType == MFRC522::PICC_TYPE_MIFARE_UL ) {
-    byte buffer2[buffferSizeRead];
-
-    for (byte block = 8, bufpos = 0; block <= 11; ++block, bufpos += 4) {
-      byte size2 = sizeof(buffer2);
-      status = static_cast<MFRC522::StatusCode>(mfrc522.MIFARE_Read(block, buffer2, &size2));
-      if (status != MFRC522::STATUS_OK) {
-        LOG(card_log, s_debug, str_MIFARE_Read(), block, str_failed(), printStatusCode(mfrc522, status));
-        break;
-      }
-      memcpy(buffer+bufpos, buffer2, 4);
-    }
-  }
-  stopCrypto1();
+#ifdef CARD_READ_RETRY
+  const MFRC522::StatusCode status = readWithRetry(piccType, buffer, sizeof(buffer));
+#else
+  const MFRC522::StatusCode status = authAndRead  (piccType, buffer, sizeof(buffer));
+#endif
+  LOG(card_log, s_debug, F("RF transactions: "), rfTransactions);
 
-  if (status != MFRC522::STATUS_OK) {
-    LOG(card_log, s_error, str_MIFARE_Read(), str_failed(), printStatusCode(mfrc522, status));
+  if (status != MFRC522::STATUS_OK)
     return readCardEvent::none;
-  }
 
   LOG(card_log, s_info, F("CardData: "), dump_byte_array(buffer, 9));
 
@@ -165,6 +307,7 @@ Chip_card::readCardEvent Chip_card::readCard(folderSettings &nfcTag) {
     nfcTag.mode     = static_cast<pmode_t>(buffer[6]);
     nfcTag.special  = buffer[7];
     nfcTag.special2 = buffer[8];
+    LatencyTrace::mark(LatencyTrace::card_read);
   }
   else {
     LOG(card_log, s_warning, F("bad ver "), version);
@@ -176,6 +319,9 @@ Chip_card::readCardEvent Chip_card::readCard(folderSettings &nfcTag) {
 }
 
 bool Chip_card::writeCard(const folderSettings &nfcTag) {
+#ifdef TonUINO_ESP32
+  Esp32Tasks::CardLock card{};
+#endif
 
   constexpr byte coockie_4 = (cardCookie & 0x000000ff) >>  0;
   constexpr byte coockie_3 = (cardCookie & 0x0000ff00) >>  8;
@@ -191,43 +337,158 @@ bool Chip_card::writeCard(const folderSettings &nfcTag) {
                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
                                   };
 
+#ifdef CARD_PRESENCE_CHECK
+  if (not selectCard())
+    return false;
+#endif
   const MFRC522::PICC_Type mifareType = mfrc522.PICC_GetType(mfrc522.uid.sak);
+  rfTransactions = 0;
 
   if (not auth(mifareType))
     return false;
 
-  MFRC522::StatusCode status = MFRC522::STATUS_ERROR;
-
   // Write data to the block
   LOG(card_log, s_info, F("Writing: "), dump_byte_array(buffer, 9));
 
-  if ((mifareType == MFRC522::PICC_TYPE_MIFARE_MINI) ||
-      (mifareType == MFRC522::PICC_TYPE_MIFARE_1K  ) ||
-      (mifareType == MFRC522::PICC_TYPE_MIFARE_4K  ) ) {
-    status = (MFRC522::StatusCode)mfrc522.MIFARE_Write(4, buffer, sizeof(buffer));
+  const MFRC522::StatusCode status = writePayload(mifareType, buffer);
+  stopCrypto1();
+  LOG(card_log, s_debug, F("RF transactions: "), rfTransactions);
+
+  if (status != MFRC522::STATUS_OK) {
+    LOG(card_log, s_error, str_MIFARE_Write(), str_failed(), printStatusCode(mfrc522, status));
+    return false;
+  }
+#ifdef CARD_CACHE
+  putToCache(nfcTag);
+#endif
+#ifdef MEMORY_UID_MATCH
+  putMemoryPair(nfcTag);
+#endif
+  return true;
+}
+
+MFRC522::StatusCode Chip_card::authAndRead(MFRC522::PICC_Type piccType, byte *buffer, byte size) {
+  if (not auth(piccType)) {
+    Telemetry::count(Telemetry::card_auth_errors);
+    return MFRC522::STATUS_ERROR;
+  }
+
+  // Show the whole sector as it currently is
+  // LOG(card_log, s_info, F("Current data in sector:"));
+  // mfrc522.PICC_DumpMifareClassicSectorToSerial(&(mfrc522.uid), &key, sector);
+  // Serial.println();
+
+  // Read data from the block
+  const MFRC522::StatusCode status = readPayload(piccType, buffer, size);
+  stopCrypto1();
+
+  if (status != MFRC522::STATUS_OK) {
+    LOG(card_log, s_error, str_MIFARE_Read(), str_failed(), printStatusCode(mfrc522, status));
+    Telemetry::count(Telemetry::card_read_errors);
+  }
+  return status;
+}
+
+#ifdef CARD_READ_RETRY
+Chip_card::retryStat &Chip_card::getRetryStat() {
+  const uint16_t hash = uidHash();
+  for (retryStat &stat: retryStats)
+    if (stat.reads != 0 && stat.uidHash == hash)
+      return stat;
+  retryStat &stat = retryStats[retryStatNext];
+  retryStatNext = (retryStatNext+1) % cardRetryStats;
+  stat = { hash, 0, 0, 0 };
+  return stat;
+}
+
+// A failed try selects the card again and retries with the next higher receiver gain. The card starts with the gain
+// that worked the last time, after a first try that worked the next read starts one step lower. Afterwards the
+// reader returns to the base gain for the detection.
+MFRC522::StatusCode Chip_card::readWithRetry(MFRC522::PICC_Type piccType, byte *buffer, byte size) {
+  retryStat &stat = getRetryStat();
+  uint8_t step = stat.gainStep;
+  MFRC522::StatusCode status;
+  uint8_t retry = 0;
+  for (;;) {
+    mfrc522.PCD_SetAntennaGain(cardRetryGains[step]);
+    status = authAndRead(piccType, buffer, size);
+    if (status == MFRC522::STATUS_OK || retry == cardReadRetries)
+      break;
+    ++retry;
+    if (step+1 < cardRetryGainSteps)
+      ++step;
+    LOG(card_log, s_info, F("Retry "), retry, F(", gain: "), step);
+    if (checkPresence() != MFRC522::STATUS_OK)
+      break;
+  }
+  if (stat.reads < 0xff) {
+    ++stat.reads;
+    if (retry == 0 && status == MFRC522::STATUS_OK)
+      ++stat.firstOk;
+  }
+  if (status == MFRC522::STATUS_OK)
+    stat.gainStep = (retry == 0 && step > 0) ? step-1 : step;
+  if (step > 0)
+    mfrc522.PCD_SetAntennaGain(cardRetryGains[0]);
+  LOG(card_log, s_debug, F("first try ok: "), stat.firstOk, F("/"), stat.reads);
+  return status;
+}
+#endif // CARD_READ_RETRY
+
+MFRC522::StatusCode Chip_card::readPayload(MFRC522::PICC_Type piccType, byte *buffer, byte size) {
+  LoopProfiler::Section profile{LoopProfiler::card_payload};
+  MFRC522::StatusCode status = MFRC522::STATUS_ERROR;
+
+  if ((piccType == MFRC522::PICC_TYPE_MIFARE_MINI) ||
+      (piccType == MFRC522::PICC_TYPE_MIFARE_1K  ) ||
+      (piccType == MFRC522::PICC_TYPE_MIFARE_4K  ) )
+  {
+    ++rfTransactions;
+    status = static_cast<MFRC522::StatusCode>(mfrc522.MIFARE_Read(4, buffer, &size));
     if (status != MFRC522::STATUS_OK)
-      LOG(card_log, s_debug, str_MIFARE_Write(), F("4"), str_failed(), printStatusCode(mfrc522, status));
+      LOG(card_log, s_debug, str_MIFARE_Read(), F("4"), str_failed(), printStatusCode(mfrc522, status));
+  }
+  else if (piccType == MFRC522::PICC_TYPE_MIFARE_UL ) {
+    // the READ command returns 4 pages (16 byte) at once
+    ++rfTransactions;
+    status = static_cast<MFRC522::StatusCode>(mfrc522.MIFARE_Read(ulFirstPage, buffer, &size));
+    if (status != MFRC522::STATUS_OK)
+      LOG(card_log, s_debug, str_MIFARE_Read(), ulFirstPage, str_failed(), printStatusCode(mfrc522, status));
   }
-  else if (mifareType == MFRC522::PICC_TYPE_MIFARE_UL ) {
-    byte buffer2[buffferSizeWrite];
-    memset(buffer2, 0, sizeof(buffer2));
+  return status;
+}
+
+MFRC522::StatusCode Chip_card::writePayload(MFRC522::PICC_Type piccType, byte *buffer) {
+  LoopProfiler::Section profile{LoopProfiler::card_payload};
+  MFRC522::StatusCode status = MFRC522::STATUS_ERROR;
 
-    for (byte block = 8, bufpos = 0; block <= 11; ++block, bufpos += 4) {
-      memcpy(buffer2, buffer+bufpos, 4);
-      status = static_cast<MFRC522::StatusCode>(mfrc522.MIFARE_Write(block, buffer2, sizeof(buffer2)));
+  if ((piccType == MFRC522::PICC_TYPE_MIFARE_MINI) ||
+      (piccType == MFRC522::PICC_TYPE_MIFARE_1K  ) ||
+      (piccType == MFRC522::PICC_TYPE_MIFARE_4K  ) ) {
+    ++rfTransactions;
+    status = static_cast<MFRC522::StatusCode>(mfrc522.MIFARE_Write(4, buffer, buffferSizeWrite));
+    if (status != MFRC522::STATUS_OK)
+      LOG(card_log, s_debug, str_MIFARE_Write(), F("4"), str_failed(), printStatusCode(mfrc522, status));
+  }
+  else if (piccType == MFRC522::PICC_TYPE_MIFARE_UL ) {
+    // read the current content (one transaction) and write only the changed pages
+    byte current[buffferSizeRead];
+    const bool currentValid = readPayload(piccType, current, sizeof(current)) == MFRC522::STATUS_OK;
+
+    status = MFRC522::STATUS_OK;
+    for (byte page = 0; page < ulPages; ++page) {
+      byte *data = buffer + 4*page;
+      if (currentValid && memcmp(current + 4*page, data, 4) == 0)
+        continue;
+      ++rfTransactions;
+      status = static_cast<MFRC522::StatusCode>(mfrc522.MIFARE_Ultralight_Write(ulFirstPage + page, data, 4));
       if (status != MFRC522::STATUS_OK) {
-        LOG(card_log, s_debug, str_MIFARE_Write(), block, str_failed(), printStatusCode(mfrc522, status));
+        LOG(card_log, s_debug, str_MIFARE_Write(), ulFirstPage + page, str_failed(), printStatusCode(mfrc522, status));
         break;
       }
     }
   }
-  stopCrypto1();
-
-  if (status != MFRC522::STATUS_OK) {
-    LOG(card_log, s_error, str_MIFARE_Write(), str_failed(), printStatusCode(mfrc522, status));
-    return false;
-  }
-  return true;
+  return status;
 }
 
 void Chip_card::sleepCard() {
@@ -235,6 +496,69 @@ void Chip_card::sleepCard() {
   mfrc522.PCD_SoftPowerDown();
 }
 
+#ifdef LIGHT_SLEEP
+bool Chip_card::pollCardInSleep() {
+  mfrc522.PCD_SoftPowerUp();
+  mfrc522.PCD_AntennaOn  ();
+  byte bufferATQA[2];
+  byte bufferSize = sizeof(bufferATQA);
+  const bool present = mfrc522.PICC_RequestA(bufferATQA, &bufferSize) == MFRC522::STATUS_OK;
+  sleepCard();
+
+  if (not present) {
+    // the removal is not reported, the next card is reported as inserted after the wake up
+    cardRemoved = true;
+#ifdef CARD_CACHE
+    validatePending = false;
+#endif
+    return false;
+  }
+  // a card that was already there before the sleep does not wake up
+  return cardRemoved;
+}
+
+void Chip_card::wakeCard() {
+  mfrc522.PCD_SoftPowerUp();
+#ifdef CARD_LOW_POWER_DETECT
+  if (not cardRemoved)
+#endif
+    mfrc522.PCD_AntennaOn();
+}
+#endif // LIGHT_SLEEP
+
+#if defined(CARD_PRESENCE_CHECK) or defined(CARD_READ_RETRY)
+// also selects the card again after a failed try
+MFRC522::StatusCode Chip_card::checkPresence() {
+  // a selected card does not answer the WUPA (back to IDLE), it answers the second one.
+  // A halted card (see haltCard()) answers the first one.
+  byte bufferATQA[2];
+  byte bufferSize = sizeof(bufferATQA);
+  if (mfrc522.PICC_WakeupA(bufferATQA, &bufferSize) != MFRC522::STATUS_OK) {
+    bufferSize = sizeof(bufferATQA);
+    if (mfrc522.PICC_WakeupA(bufferATQA, &bufferSize) != MFRC522::STATUS_OK)
+      return MFRC522::STATUS_TIMEOUT;
+  }
+#ifdef CARD_PRESENCE_CHECK
+  halted = false;
+#endif
+  // select the known UID without anticollision, another card does not answer
+  return mfrc522.PICC_Select(&mfrc522.uid, mfrc522.uid.size * 8);
+}
+#endif // CARD_PRESENCE_CHECK or CARD_READ_RETRY
+
+#ifdef CARD_PRESENCE_CHECK
+// after a check the card is halted, so the next check needs only one WUPA
+void Chip_card::haltCard() {
+  stopCard();
+  halted = true;
+}
+
+// a halted card is selected again before it is read or written
+bool Chip_card::selectCard() {
+  return not halted || checkPresence() == MFRC522::STATUS_OK;
+}
+#endif // CARD_PRESENCE_CHECK
+
 void Chip_card::initCard() {
   SPI.begin();                                                    // Init SPI bus
   mfrc522.PCD_Init();                                             // Init MFRC522
@@ -247,6 +571,12 @@ void Chip_card::initCard() {
   //      146: v2.0
   //       18: counterfeit chip
   //     else: unknown
+#ifdef CARD_READ_RETRY
+  mfrc522.PCD_SetAntennaGain(cardRetryGains[0]);
+#endif
+#ifdef ADAPTIVE_CARD_POLL
+  pollFast();
+#endif
 }
 
 void Chip_card::stopCard() {
@@ -257,15 +587,81 @@ void Chip_card::stopCrypto1() {
   mfrc522.PCD_StopCrypto1();
 }
 
+#ifdef ADAPTIVE_CARD_POLL
+void Chip_card::setPollInterval(uint16_t interval) {
+  if (interval == pollIntervalMs)
+    return;
+  pollIntervalMs = interval;
+  LOG(card_log, s_debug, F("card poll "), pollIntervalMs);
+  LoopProfiler::setCardPollInterval(pollIntervalMs);
+}
+
+void Chip_card::pollFast() {
+  lastPollStep = millis();
+  setPollInterval(0);
+}
+
+bool Chip_card::pollDue() {
+  const unsigned long now = millis();
+  // back off step by step: every cycle, 2, 4, ... cycles up to cardPollSlowTime
+  if (pollIntervalMs < cardPollSlowTime && now - lastPollStep >= cardPollBackoffTime) {
+    lastPollStep = now;
+    const unsigned long next = pollIntervalMs == 0 ? 2 * cycleTime : 2ul * pollIntervalMs;
+    setPollInterval(min(next, cardPollSlowTime));
+  }
+  if (pollIntervalMs != 0 && now - lastPoll < pollIntervalMs)
+    return false;
+  lastPoll = now;
+  return true;
+}
+#endif
+
 cardEvent Chip_card::getCardEvent() {
-  byte bufferATQA[2];
-  byte bufferSize = sizeof(bufferATQA);
-  MFRC522::StatusCode result = mfrc522.PICC_RequestA(bufferATQA, &bufferSize);
+#ifdef ADAPTIVE_CARD_POLL
+  if (not pollDue()) {
+    // the card was seen at the last poll, only failed polls in a row count for the removal
+    if (not cardRemoved)
+      cardRemovedSwitch.reset();
+    return cardEvent::none;
+  }
+#endif
+#ifdef CARD_LOW_POWER_DETECT
+  // no card present: switch on the field only for a short REQA every cardPollCycles.
+  // A card that is not powered up fast enough is detected with the next poll.
+  if (cardRemoved) {
+    if (++pollCounter < cardPollCycles)
+      return cardEvent::none;
+    pollCounter = 0;
+    mfrc522.PCD_AntennaOn();
+  }
+#endif
+
+  MFRC522::StatusCode result;
+#ifdef CARD_PRESENCE_CHECK
+  if (not cardRemoved)
+    result = checkPresence();
+  else
+#endif
+  {
+    byte bufferATQA[2];
+    byte bufferSize = sizeof(bufferATQA);
+    result = mfrc522.PICC_RequestA(bufferATQA, &bufferSize);
+    if (result == mfrc522.STATUS_OK)
+      mfrc522.PICC_ReadCardSerial();
+  }
 
   if(result != mfrc522.STATUS_OK) {
+#ifdef ADAPTIVE_CARD_POLL
+    // the card may be taken away: check the removal in every cycle
+    if (not cardRemoved)
+      pollFast();
+#endif
     ++cardRemovedSwitch;
+#ifdef CARD_LOW_POWER_DETECT
+    if (cardRemoved)
+      mfrc522.PCD_AntennaOff();
+#endif
   } else {
-    mfrc522.PICC_ReadCardSerial();
     cardRemovedSwitch.reset();
   }
 
@@ -273,16 +669,38 @@ cardEvent Chip_card::getCardEvent() {
     if (not cardRemoved) {
       LOG(card_log, s_info, F("Card Removed"));
       cardRemoved = true;
+#ifdef ADAPTIVE_CARD_POLL
+      pollFast();
+#endif
+#ifdef CARD_CACHE
+      validatePending = false;
+#endif
       stopCard();
+#ifdef CARD_LOW_POWER_DETECT
+      mfrc522.PCD_AntennaOff();
+#endif
       return cardEvent::removed;
     }
   }
   else {
     if (cardRemoved) {
       LOG(card_log, s_info, F("Card Inserted"));
+      LatencyTrace::mark(LatencyTrace::card_detected);
       cardRemoved = false;
+#ifdef ADAPTIVE_CARD_POLL
+      pollFast();
+#endif
       return cardEvent::inserted;
     }
+#ifdef CARD_CACHE
+    // the card was rewritten since it was cached --> insert it again with the new content
+    if (validatePending && result == mfrc522.STATUS_OK && validateCache())
+      return cardEvent::inserted;
+#endif
+#ifdef CARD_PRESENCE_CHECK
+    if (result == mfrc522.STATUS_OK)
+      haltCard();
+#endif
   }
   return cardEvent::none;
 }
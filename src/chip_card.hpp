@@ -78,6 +78,24 @@ private:
   uint8_t       counter;
 };
 
+#ifdef CARD_PRESENCE_CHECK
+// like delayedSwitchOn, but the delay is a time in ms and not a number of calls
+class delayedSwitchOnMs {
+public:
+  delayedSwitchOnMs(unsigned long delay)
+  : delayTime(delay)
+  {}
+  delayedSwitchOnMs& operator++() { if (not isOn && millis() - resetTime >= delayTime) isOn = true; return *this; }
+  void reset() { resetTime = millis(); isOn = false; }
+  bool on   () { return isOn; }
+
+private:
+  const unsigned long delayTime;
+  unsigned long       resetTime{};
+  bool                isOn{true};
+};
+#endif
+
 class Chip_card {
 public:
   Chip_card(Mp3 &mp3);
@@ -91,23 +109,139 @@ public:
   readCardEvent readCard (      folderSettings &nfcTag);
   bool writeCard         (const folderSettings &nfcTag);
   void sleepCard         ();
+#ifdef LIGHT_SLEEP
+  // field on for one REQA, true if a card was put on since the last call. Called between sleepCard() and wakeCard()
+  bool pollCardInSleep   ();
+  void wakeCard          ();
+#endif
   void initCard          ();
   cardEvent getCardEvent ();
   bool isCardRemoved     () { return cardRemoved; }
+#ifdef MEMORY_UID_MATCH
+  // pair of the memory game card that is present now (by UID) from the EEPROM, 0 if unknown
+  uint8_t getMemoryPair  ();
+#endif
+#ifdef ADAPTIVE_CARD_POLL
+  // activity (button, admin menu, game): poll in every cycle again, the rate backs off without activity
+  void pollFast          ();
+  uint16_t pollInterval  () const { return pollIntervalMs; }
+#endif
+#ifdef SERIAL_REMOTE
+  // the next readCard() returns this content instead of reading the chip
+  void simulateCard      (const folderSettings &nfcTag) { simulatedCard = nfcTag; simulated = true; }
+  void endSimulation     ()                             { simulated = false; }
+#endif
+#ifdef TonUINO_ESP32
+  // the card task reads an inserted card right after it is detected, the content goes with the event to the ui task
+  struct cardRead {
+    cardEvent      event;
+    readCardEvent  read;
+    folderSettings tag;
+  };
+  cardRead pollCard      ();
+  // ui task: the next readCard() returns the content read by the card task
+  void deliverCard       (const cardRead &r)            { delivered = r; hasDelivered = true; }
+#endif
 
 private:
   friend class tonuino_fixture;
   friend class chip_card_test_fixture;
+  friend class simulator;
 
   void stopCrypto1();
   void stopCard   ();
   bool auth       (MFRC522::PICC_Type piccType);
+#if defined(CARD_PRESENCE_CHECK) or defined(CARD_READ_RETRY)
+  MFRC522::StatusCode checkPresence();
+#endif
+#ifdef CARD_PRESENCE_CHECK
+  void haltCard  ();
+  bool selectCard();
+  bool                halted{};
+#endif
+  // the cache or the chip
+  readCardEvent readCardFromReader(folderSettings &nfcTag);
+  readCardEvent readCardFromChip(folderSettings &nfcTag);
+  MFRC522::StatusCode authAndRead(MFRC522::PICC_Type piccType, byte *buffer, byte size);
+
+  // transport of the 16 byte payload with the minimum number of RF transactions per card type
+  static constexpr uint8_t ulFirstPage = 8;
+  static constexpr uint8_t ulPages     = 4;
+  MFRC522::StatusCode readPayload (MFRC522::PICC_Type piccType, byte *buffer, byte size);
+  MFRC522::StatusCode writePayload(MFRC522::PICC_Type piccType, byte *buffer);
+  uint8_t             rfTransactions{};
+
+#ifdef CARD_CACHE
+  struct cacheEntry {
+    static constexpr uint8_t maxUidSize = 7;
+    uint8_t        uidSize{};
+    byte           uid[maxUidSize]{};
+    folderSettings value{};
+  };
+  int8_t findInCache  ();
+  bool   getFromCache (folderSettings &nfcTag);
+  void   putToCache   (const folderSettings &nfcTag);
+  void   removeFromCache();
+  bool   validateCache();
+
+  cacheEntry          cardCache[cardCacheSize]{}; // most recently used first
+  bool                validatePending{};
+#endif
+
+#ifdef CARD_READ_RETRY
+  uint16_t uidHash      ();
+#endif
+#ifdef MEMORY_UID_MATCH
+  // the UID folded into 4 byte, a 4 byte UID is kept as it is
+  uint32_t uidKey       ();
+  // stores the pair of a memory game card, removes other cards
+  void     putMemoryPair(const folderSettings &nfcTag);
+#endif
+
+#ifdef CARD_READ_RETRY
+  // per card (UID): the gain that worked the last time and how often the first try was successful
+  struct retryStat {
+    uint16_t uidHash;
+    uint8_t  gainStep; // 0: base gain
+    uint8_t  reads;
+    uint8_t  firstOk;
+  };
+  retryStat          &getRetryStat ();
+  MFRC522::StatusCode readWithRetry(MFRC522::PICC_Type piccType, byte *buffer, byte size);
+
+  retryStat           retryStats[cardRetryStats]{};
+  uint8_t             retryStatNext{};
+#endif
+
+#ifdef ADAPTIVE_CARD_POLL
+  bool     pollDue      ();
+  void     setPollInterval(uint16_t interval);
+
+  uint16_t            pollIntervalMs{}; // 0: every cycle
+  unsigned long       lastPoll{};
+  unsigned long       lastPollStep{};
+#endif
 
   MFRC522             mfrc522;
   Mp3                 &mp3;
 
+#ifdef CARD_PRESENCE_CHECK
+  delayedSwitchOnMs   cardRemovedSwitch;
+#else
   delayedSwitchOn     cardRemovedSwitch;
+#endif
   bool                cardRemoved = true;
+#ifdef CARD_LOW_POWER_DETECT
+  uint8_t             pollCounter{};
+#endif
+#ifdef SERIAL_REMOTE
+  folderSettings      simulatedCard{};
+  bool                simulated{};
+#endif
+#ifdef TonUINO_ESP32
+  cardRead            delivered{};
+  bool                hasDelivered{};
+#endif
 };
 
 #endif /* SRC_CHIP_CARD_HPP_ */
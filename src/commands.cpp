@@ -47,6 +47,9 @@ Commands::Commands(const Settings& settings, CommandSource* source1, CommandSour
   sources[0] = source1;
   sources[1] = source2;
   sources[2] = source3;
+#ifdef KEYMAP
+  memcpy_P(keymap, cmd_table, sizeof keymap);
+#endif
 }
 
 commandRaw Commands::getCommandRaw() {
@@ -74,7 +77,11 @@ command Commands::getCommand(commandRaw b, state_for_command s) {
 #endif
 
   if (b < commandRaw::cmd_end) {
+#ifdef KEYMAP
+    ret = keymap[static_cast<uint8_t>(b)][static_cast<uint8_t>(s)];
+#else
     PROGMEM_read(&cmd_table[static_cast<int>(b)][static_cast<int>(s)], ret);
+#endif
   }
 
   if (ret != command::none) {
@@ -98,3 +105,61 @@ bool Commands::isExtButton(command c) {
 }
 #endif
 
+
+#ifdef KEYMAP
+static_assert(sizeof cmd_table == static_cast<uint8_t>(commandRaw::cmd_end) * 4 * sizeof(command), "cmd_table does not match commandRaw");
+
+command Commands::defaultCommand(uint8_t raw, uint8_t state) {
+  command ret;
+  PROGMEM_read(&cmd_table[raw][state], ret);
+  return ret;
+}
+
+// the ext buttons (BUTTONS3X3) and menu_jump are not in the keymap
+bool Commands::isValid(const Settings::keymap_entry_t& entry) {
+  return entry.raw   != static_cast<uint8_t>(commandRaw::none) && entry.raw < keymapRaws
+      && entry.state <  keymapStates
+      && entry.cmd   <  static_cast<uint8_t>(command::adm_end);
+}
+
+void Commands::loadKeymap() {
+  memcpy_P(keymap, cmd_table, sizeof keymap);
+  uint8_t custom = 0;
+  for (uint8_t i = 0; i < keymapEntries; ++i) {
+    Settings::keymap_entry_t entry;
+    Settings::readKeymapEntryFromFlash(i, entry);
+    if (isValid(entry)) {
+      keymap[entry.raw][entry.state] = static_cast<command>(entry.cmd);
+      ++custom;
+    }
+  }
+  LOG(button_log, s_info, F("Keymap: "), custom);
+}
+
+bool Commands::setKeymap(commandRaw b, state_for_command s, command c) {
+  const Settings::keymap_entry_t value{ static_cast<uint8_t>(b), static_cast<uint8_t>(s), static_cast<uint8_t>(c) };
+  if (not isValid(value))
+    return false;
+  const bool isDefault = (c == defaultCommand(value.raw, value.state));
+
+  // the entry of b and s if there is one, otherwise the first free entry
+  uint8_t slot = keymapEntries;
+  for (uint8_t i = 0; i < keymapEntries; ++i) {
+    Settings::keymap_entry_t entry;
+    Settings::readKeymapEntryFromFlash(i, entry);
+    if (isValid(entry) && entry.raw == value.raw && entry.state == value.state) {
+      slot = i;
+      break;
+    }
+    if (not isValid(entry) && slot == keymapEntries)
+      slot = i;
+  }
+  if (slot == keymapEntries)
+    return isDefault;
+
+  Settings::writeKeymapEntryToFlash(slot, isDefault ? Settings::keymap_entry_t{ 0, 0, 0 } : value);
+  keymap[value.raw][value.state] = c;
+  LOG(button_log, s_debug, F("Keymap "), value.raw, F(" "), value.state, F(": "), value.cmd);
+  return true;
+}
+#endif // KEYMAP
@@ -144,9 +144,25 @@ public:
   static bool isExtButton(command c);
 #endif
 
+#ifdef KEYMAP
+  // copies cmd_table to the RAM and applies the custom mappings from the EEPROM
+  void loadKeymap();
+  // maps b in state s to c and stores it in the EEPROM (the default of cmd_table removes the custom mapping),
+  // false if an argument is out of range or all entries are in use
+  bool setKeymap(commandRaw b, state_for_command s, command c);
+#endif
+
 private:
   const Settings&           settings;
   array<CommandSource*, 3>  sources;
+#ifdef KEYMAP
+  static constexpr uint8_t  keymapRaws   = static_cast<uint8_t>(commandRaw::cmd_end);
+  static constexpr uint8_t  keymapStates = static_cast<uint8_t>(state_for_command::play_invert) + 1;
+  static command            defaultCommand(uint8_t raw, uint8_t state);
+  static bool               isValid(const Settings::keymap_entry_t& entry);
+
+  command                   keymap[keymapRaws][keymapStates];
+#endif
 };
 
 #endif /* SRC_COMMANDS_HPP_ */
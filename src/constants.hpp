@@ -64,6 +64,22 @@
  * #########################################################################
  */
 
+/* ### ESP32 (esp32dev) ############################################################################
+ *                         |  2|  4|  5| 13| 14| 15| 16| 17| 18| 19| 21| 22| 23| 25| 26| 27| 33| 35|
+ * ------------------------+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
+ * Com to DF Player        |   |   |   |   |   |   | RX| TX|   |   |   |   |   |   |   |   |   |   |
+ * DF Player busy          |   | x |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |
+ * MFRC522 (S,C,M,R,O)     |   |   | S |   |   |   |   |   | C | M |   | R | O |   |   |   |   |   |
+ * 3 Button                |   |   |   |   |   |   |   |   |   |   |   |   |   | P | U | D |   |   |
+ * 5 Button                |   |   |   |   | V+| V-|   |   |   |   |   |   |   | P | U | D |   |   |
+ * Open pin for random     |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   | x |
+ * Neo Ring/LED animat.    |   |   |   | x |   |   |   |   |   |   |   |   |   |   |   |   |   |   |
+ * Shutdown                |   |   |   |   |   |   |   |   |   |   | x |   |   |   |   |   |   |   |
+ * Speaker off             | x |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |
+ * headphone jack detection|   |   |   |   |   |   |   |   |   |   |   |   |   |   |   |   | x |   |
+ * #################################################################################################
+ */
+
 // ######################################################################
 // ####### variant and feature configuration ############################
 // ######################################################################
@@ -76,6 +92,7 @@
 //#define TonUINO_Every_4808
 //#define ALLinONE
 //#define ALLinONE_Plus
+//#define TonUINO_ESP32
 
 // ######################################################################
 
@@ -88,6 +105,15 @@
 //#define FIVEBUTTONS
 //#define BUTTONS3X3
 
+/* uncomment the below line to record the button edges in an interrupt (pin change on Every/AiO+, otherwise sampled
+ * with 200 Hz by timer 1) so that presses during a blocking call are not lost
+ * um die Flanken der Tasten in einem Interrupt aufzuzeichnen (Pin Change bei Every/AiO+, sonst mit 200 Hz über
+ * den Timer 1 abgetastet), in der nächste Zeile den Kommentar entfernen. Dann gehen während blockierender Aufrufe
+ * keine Tastendrücke verloren
+ */
+//#define BUTTONS_EDGE_BUFFER
+inline constexpr uint8_t buttonEdgeBufferSize = 16; // must be a power of 2
+
 // ######################################################################
 
 /* If using Nano Every with connected DfPlayer Rx/Tx to D0/D1 uncomment the following lines
@@ -99,13 +125,95 @@
 
 /* uncomment the below line to enable serial input as additional command source
  * um den Serial Monitor als zusätzliche Kommandoquelle zu haben bitte in der nächste Zeile den Kommentar entfernen
- * -7:             -8: up         -9: upLong
+ * -7: statistics  -8: up         -9: upLong     -10: memory   -11: loop profile  -12: energy
  * -4: allLong     -5: pause      -6: pauseLong
  * -1: up/downLong -2: down       -3: downLong
  * number n > 0: Springe im Voice Menü zum n-ten Eintrag und selektiere ihn
  */
 #define SerialInputAsCommand
 
+/* uncomment the below line to measure the latency from card detection to the start of the audio
+ * (print the summary with -7 via the serial input)
+ * um die Zeit von der Erkennung der Karte bis zum Start der Wiedergabe zu messen, in der nächste
+ * Zeile den Kommentar entfernen (die Zusammenfassung wird mit -7 über den Serial Monitor ausgegeben)
+ */
+//#define LATENCY_TRACE
+inline constexpr uint8_t latencyTraceHistory = 8; // number of traced plays for min/avg/max
+
+/* uncomment the below line to report the RAM usage (.data, .bss, free RAM and the stack high water mark)
+ * (print the report with -10 via the serial input and every memoryMonitorLogInterval ms if > 0)
+ * um die RAM Belegung (.data, .bss, freier RAM und maximale Stack Größe) auszugeben, in der nächste Zeile
+ * den Kommentar entfernen (Ausgabe mit -10 über den Serial Monitor und alle memoryMonitorLogInterval ms, wenn > 0)
+ */
+//#define MEMORY_MONITOR
+inline constexpr unsigned long memoryMonitorLogInterval = 0; // 0: only on request via the serial input
+
+/* uncomment the below line to measure the run time of the parts of the main loop in histograms
+ * (print and reset the histograms with -11 via the serial input)
+ * um die Laufzeit der Teile der Hauptschleife in Histogrammen zu messen, in der nächste Zeile den
+ * Kommentar entfernen (Ausgabe und Zurücksetzen mit -11 über den Serial Monitor)
+ */
+//#define LOOP_PROFILER
+inline constexpr uint8_t loopProfilerFirstBucket =  6; // bucket 0: < 64 us
+inline constexpr uint8_t loopProfilerBuckets     = 10; // last bucket: >= 16 ms
+
+/* uncomment the below line (needs EEPROM_JOURNAL, only TonUINO_Classic) to count the usage and the errors of the box
+ * over its life time (plays per mode and folder, card reads and errors, DfPlayer errors, missing OnPlayFinished,
+ * watchdog resets, EEPROM writes). The counters are written through the journal every telemetryFlushTime and before
+ * the power off (print the report with -13 via the serial input).
+ * um die Nutzung und die Fehler der Box über ihre Lebenszeit zu zählen (Wiedergaben pro Modus und Ordner, gelesene
+ * Karten und Fehler, DfPlayer Fehler, fehlendes OnPlayFinished, Watchdog Resets, EEPROM Schreibzugriffe), in der
+ * nächste Zeile den Kommentar entfernen (benötigt EEPROM_JOURNAL, nur TonUINO_Classic). Die Zähler werden alle
+ * telemetryFlushTime und vor dem Ausschalten über das Journal geschrieben (Ausgabe mit -13 über den Serial Monitor).
+ */
+//#define TELEMETRY
+inline constexpr uint8_t       telemetryFolders   = 16;                  // plays of the folders 1..16, the others together
+inline constexpr unsigned long telemetryFlushTime = 4 * 60 * 60 * 1000ul;
+
+/* uncomment the below line to run the benchmark of the hot paths (AVR cycles, stack, interrupt latency) instead of
+ * the firmware. It is made for the simulator simavr, see the env bench_avr_classic in platformio.ini. Needs LOOP_PROFILER.
+ * um statt der Firmware den Benchmark der zeitkritischen Teile (AVR Takte, Stack, Interrupt Latenz) laufen zu lassen,
+ * in der nächste Zeile den Kommentar entfernen. Gedacht für den Simulator simavr (env bench_avr_classic in platformio.ini).
+ */
+//#define AVR_CYCLE_BENCH
+
+/* uncomment the below line to control the box with a framed binary protocol via the serial input (needs
+ * SerialInputAsCommand). A frame has a batch of commands (button command, card in/out, status), every frame is
+ * acknowledged (see serial_remote.hpp)
+ * um die Box mit einem binären Protokoll über den Serial Monitor fernzusteuern (SerialInputAsCommand wird benötigt),
+ * in der nächste Zeile den Kommentar entfernen. Ein Frame enthält mehrere Kommandos (Tasten, Karte auflegen/entfernen,
+ * Status), jeder Frame wird bestätigt (siehe serial_remote.hpp)
+ */
+//#define SERIAL_REMOTE
+inline constexpr uint8_t serialRemoteMaxPayload = 32;
+inline constexpr unsigned long serialRemoteByteTimeout = 100; // ms, then an incomplete frame is dropped
+
+/* uncomment the below line to remap the buttons without a new firmware (only TonUINO_Classic and ALLinONE). The custom
+ * mappings (button, state, command) are stored in the EEPROM and are set with SERIAL_REMOTE. At boot the command table
+ * is copied to the RAM and the custom mappings are applied (about 80 byte RAM).
+ * um die Tasten ohne neue Firmware umzubelegen, in der nächste Zeile den Kommentar entfernen (nur TonUINO_Classic und
+ * ALLinONE). Die eigenen Belegungen (Taste, Zustand, Kommando) werden im EEPROM gespeichert und mit SERIAL_REMOTE gesetzt.
+ */
+//#define KEYMAP
+inline constexpr uint8_t keymapEntries = 16; // 3 byte EEPROM each
+
+// ######################################################################
+
+/* uncomment the below line to send the log in a compact binary format (decode it with tools/decode_binary_log.py)
+ * um das Log in einem kompakten Binärformat zu senden, in der nächste Zeile den Kommentar entfernen
+ * (mit tools/decode_binary_log.py wieder lesbar machen)
+ */
+//#define BINARY_LOGGER
+
+/* uncomment the below line to write the log to a buffer in RAM that is sent in the idle time of the cycle. A log
+ * call does not wait for the serial TX any more. If the buffer is full, the record is dropped and counted.
+ * um das Log in einen Puffer im RAM zu schreiben, der in der freien Zeit des Zyklus gesendet wird, in der nächste
+ * Zeile den Kommentar entfernen. Ein Log Aufruf wartet nicht mehr auf die serielle Schnittstelle. Ist der Puffer
+ * voll, wird der Eintrag verworfen und gezählt.
+ */
+//#define BUFFERED_LOG
+inline constexpr uint8_t logBufferSize = 128; // must be a power of 2, max 128
+
 // ######################################################################
 
 /* uncomment one of the below lines to support a special chip on the DfMiniMp3 player
@@ -126,6 +234,21 @@
 //#define DFMiniMp3_T_CHIP_MH2024K24SS_MP3_TF_16P_V3_0
 #define DFMiniMp3_T_CHIP_Mp3ChipIncongruousNoAck
 
+/* time from a play command until the busy pin signals playing (calibration per chip, used by TonUINO Classic).
+ * It can be measured with the 'track gap' log of DFPLAYER_BUSY_IRQ.
+ */
+#if   defined(DFMiniMp3_T_CHIP_MH2024K24SS_MP3_TF_16P_V3_0)
+inline constexpr unsigned long dfPlayer_chipTimeUntilStarts = 2500;
+#elif defined(DFMiniMp3_T_CHIP_GD3200B)
+inline constexpr unsigned long dfPlayer_chipTimeUntilStarts = 1500;
+#elif defined(DFMiniMp3_T_CHIP_LISP3)
+inline constexpr unsigned long dfPlayer_chipTimeUntilStarts = 1200;
+#elif defined(DFMiniMp3_T_CHIP_MH2024K16SS)
+inline constexpr unsigned long dfPlayer_chipTimeUntilStarts = 1200;
+#else
+inline constexpr unsigned long dfPlayer_chipTimeUntilStarts = 1200;
+#endif
+
 // ######################################################################
 
 /* uncomment the below line to disable shutdown via button (long press play/pause)
@@ -135,6 +258,376 @@
 
 // ######################################################################
 
+/* uncomment the below line to use a scheduler instead of a fixed delay at the end of each cycle.
+ * The buttons and the DfPlayer are handled every tickTimeCommands/tickTimeMp3 ms and the MCU sleeps
+ * (SLEEP_MODE_IDLE) in between
+ * um einen Scheduler anstelle einer festen Wartezeit am Ende jedes Zyklus zu verwenden, in der nächste
+ * Zeile den Kommentar entfernen. Die Tasten und der DfPlayer werden alle tickTimeCommands/tickTimeMp3 ms
+ * bearbeitet, dazwischen schläft die MCU (SLEEP_MODE_IDLE)
+ */
+//#define TICK_SCHEDULER
+inline constexpr unsigned long tickTimeCommands   =  10;
+inline constexpr unsigned long tickTimeMp3        =  10;
+inline constexpr unsigned long tickTimeBatVoltage = 500;
+
+/* uncomment the below line to queue the events for the state machine: a card event is dispatched before the
+ * button command of the same cycle
+ * um die Ereignisse für die Zustandsmaschine in einer Warteschlange zu sammeln, in der nächste Zeile den Kommentar
+ * entfernen. Ein Karten Ereignis wird vor der Taste des gleichen Durchlaufs bearbeitet
+ */
+//#define EVENT_QUEUE
+inline constexpr uint8_t       eventQueueSize = 2; // one button command and one card event per cycle
+
+// ######################################################################
+
+/* uncomment the below line to cache the number of tracks per folder in RAM (the DfPlayer is only asked once per folder)
+ * uncomment also TRACK_COUNT_CACHE_EEPROM to keep the cache in EEPROM over power off (only TonUINO_Classic and ALLinONE).
+ * The cache is cleared if the SD card is inserted or removed and when entering the admin menu. So enter the admin menu
+ * once after changing the content of the SD card.
+ * um die Anzahl der Tracks pro Ordner im RAM zu speichern (der DfPlayer wird nur einmal je Ordner gefragt), in der nächste
+ * Zeile den Kommentar entfernen. Um den Speicher auch nach dem Ausschalten im EEPROM zu behalten, auch den Kommentar bei
+ * TRACK_COUNT_CACHE_EEPROM entfernen (nur TonUINO_Classic und ALLinONE). Der Speicher wird beim Einstecken oder Entfernen
+ * der SD Karte und beim Aufruf des Admin Menüs gelöscht. Also nach einer Änderung der SD Karte einmal das Admin Menü aufrufen.
+ */
+//#define TRACK_COUNT_CACHE
+//#define TRACK_COUNT_CACHE_EEPROM
+inline constexpr uint8_t trackCountCacheSize = 8; // number of folders in RAM
+
+// ######################################################################
+
+/* uncomment the below line to save about 250 byte RAM: the order of the tracks (also in party mode)
+ * is computed on the fly and not stored in the track queue
+ * um ca. 250 Byte RAM zu sparen, in der nächste Zeile den Kommentar entfernen: die Reihenfolge der
+ * Tracks (auch im Party Modus) wird berechnet und nicht in der Track Queue gespeichert
+ */
+//#define TRACK_QUEUE_PERMUTATION
+
+// ######################################################################
+
+/* uncomment the below line to avoid repetitions in random play: the party modes shuffle the queue again after each
+ * round and the last shuffleRepeatDistance tracks of the round before are not played at the start of the next one.
+ * The random episode (hoerspiel) plays all tracks of the folder once before a track repeats.
+ * um Wiederholungen bei der zufälligen Wiedergabe zu vermeiden, in der nächste Zeile den Kommentar entfernen: die
+ * Party Modi mischen die Queue nach jeder Runde neu und die letzten shuffleRepeatDistance Tracks der Runde davor
+ * kommen nicht am Anfang der nächsten. Der Hörspiel Modus spielt erst alle Tracks des Ordners bevor sich einer
+ * wiederholt.
+ */
+//#define SHUFFLE_NO_REPEAT
+inline constexpr uint8_t shuffleRepeatDistance = 4;
+inline constexpr uint8_t shuffleRetries        = 8; // with TRACK_QUEUE_PERMUTATION/LARGE_FOLDERS: the order is computed
+
+// ######################################################################
+
+/* uncomment the below line to play folders with more than 255 tracks (max. 3000, only the folders 01 - 10).
+ * The tracks in these folders need 4 digit file names (0001.mp3 ... 3000.mp3), they are played with the
+ * large folder command of the DfPlayer. The order of the tracks is computed like with TRACK_QUEUE_PERMUTATION.
+ * um Ordner mit mehr als 255 Tracks abzuspielen (max. 3000, nur die Ordner 01 - 10), in der nächste Zeile den
+ * Kommentar entfernen. Die Tracks in diesen Ordnern brauchen 4-stellige Dateinamen (0001.mp3 ... 3000.mp3).
+ */
+//#define LARGE_FOLDERS
+inline constexpr uint8_t  largeFolderLast        =   10; // the EEPROM has room for the progress of 10 large folders
+inline constexpr uint16_t maxTracksInLargeFolder = 3000;
+
+// ######################################################################
+
+/* uncomment the below line to store the audiobook progress in a compact key-value store instead of one byte per folder.
+ * Only the folders in use get a slot (with 16 bit track and CRC), the free EEPROM bytes are left for other features.
+ * If all slots are in use, the progress in the home slot of the folder (folder % folderProgressSlots) is overwritten.
+ * um den Hörbuch Fortschritt in einem kompakten Key-Value Speicher statt mit einem Byte pro Ordner zu speichern, in der
+ * nächste Zeile den Kommentar entfernen. Nur die benutzten Ordner belegen einen Platz (mit 16 Bit Track und CRC).
+ * Sind alle Plätze belegt, wird der Fortschritt auf dem Heimatplatz des Ordners (Ordner % folderProgressSlots) überschrieben.
+ */
+//#define FOLDER_PROGRESS_KV
+#if defined(TonUINO_Every) or defined(TonUINO_Every_4808) or defined(ALLinONE_Plus)
+inline constexpr uint8_t  folderProgressSlots    =   12; // 48 byte, 256 byte EEPROM
+#else
+inline constexpr uint8_t  folderProgressSlots    =   25; // 100 byte
+#endif
+
+// ######################################################################
+
+/* uncomment the below line to store the extra shortcuts (BUTTONS3X3, STORE_LAST_CARD) packed with variable length
+ * (2 byte, 3 byte with special, 4 byte with special2) instead of 4 byte each. The same EEPROM space holds then up
+ * to 50 shortcuts (see lastSortCut), empty shortcuts at the end need no space. A shortcut without space is not
+ * stored (the admin menu plays the error). The former layout is converted once at startup.
+ * um die extra Shortcuts (BUTTONS3X3, STORE_LAST_CARD) gepackt mit variabler Länge (2 Byte, 3 Byte mit special,
+ * 4 Byte mit special2) statt mit je 4 Byte zu speichern, in der nächste Zeile den Kommentar entfernen. Der gleiche
+ * EEPROM Bereich hat dann Platz für bis zu 50 Shortcuts, leere Shortcuts am Ende brauchen keinen Platz. Ein
+ * Shortcut ohne Platz wird nicht gespeichert (das Admin Menü spielt den Fehler). Das alte Format wird einmalig beim
+ * Start umgewandelt.
+ */
+//#define PACKED_SHORTCUTS
+
+// ######################################################################
+
+/* uncomment the below line to reduce the EEPROM writes for the audiobook progress and the last card (STORE_LAST_CARD).
+ * The values are kept in RAM and written on pause, stop, card removal, shutdown or latest after eepromLazyWriteTime.
+ * On TonUINO_Classic and ALLinONE the values are written to a wear levelled journal in the EEPROM.
+ * um die EEPROM Schreibzugriffe für den Hörbuch Fortschritt und die letzte Karte (STORE_LAST_CARD) zu reduzieren,
+ * in der nächste Zeile den Kommentar entfernen. Die Werte werden im RAM gehalten und bei Pause, Stop, Entfernen der
+ * Karte, Ausschalten oder spätestens nach eepromLazyWriteTime geschrieben. Beim TonUINO_Classic und ALLinONE werden
+ * die Werte in ein Journal im EEPROM geschrieben, das die Schreibzugriffe gleichmäßig verteilt.
+ */
+//#define EEPROM_JOURNAL
+inline constexpr unsigned long eepromLazyWriteTime = 5 * 60 * 1000ul;
+
+// ######################################################################
+
+/* uncomment the below line to protect the admin settings in the EEPROM with a CRC-8 (in the unused byte dummy)
+ * in addition to the cookie. Settings with a wrong CRC are reset to the defaults, settings without CRC (former
+ * format) get it on the first start.
+ * um die Admin Einstellungen im EEPROM zusätzlich zum Cookie mit einer CRC-8 (im unbenutzten Byte dummy) zu
+ * schützen, in der nächste Zeile den Kommentar entfernen. Einstellungen mit falscher CRC werden auf die
+ * Standardwerte zurückgesetzt, Einstellungen ohne CRC (altes Format) bekommen sie beim ersten Start.
+ */
+//#define SETTINGS_CRC
+
+// ######################################################################
+
+/* uncomment the below line to save power while no card is present: the RF field of the MFRC522 is switched
+ * on only every cardPollCycles cycle for a short REQA. A full read is done only if a card answers.
+ * um Strom zu sparen, solange keine Karte aufliegt, in der nächste Zeile den Kommentar entfernen: das RF Feld
+ * des MFRC522 wird nur alle cardPollCycles Zyklen für eine kurze Abfrage (REQA) eingeschaltet. Nur wenn eine Karte
+ * antwortet, wird sie komplett gelesen.
+ */
+//#define CARD_LOW_POWER_DETECT
+inline constexpr uint8_t cardPollCycles = 1; // higher values save more power but detect the card later
+
+// ######################################################################
+
+/* uncomment the below line to check a card that is already on the reader with a short WUPA and a select of the
+ * known UID instead of the full detection with anticollision in every cycle. The card is removed if it did not
+ * answer for cardRemoveTime (in ms instead of cardRemoveDelay cycles).
+ * um eine bereits aufgelegte Karte mit einem kurzen WUPA und der Auswahl der bekannten UID statt der kompletten
+ * Erkennung mit Antikollision in jedem Zyklus zu prüfen, in der nächste Zeile den Kommentar entfernen. Die Karte gilt
+ * als entfernt, wenn sie für cardRemoveTime (in ms statt cardRemoveDelay Zyklen) nicht geantwortet hat.
+ */
+//#define CARD_PRESENCE_CHECK
+inline constexpr unsigned long cardRemoveTime = 120; // 3 checks at cycleTime, with a margin for the jitter of the check in the cycle
+
+/* uncomment the below line to retry a failed authentication or read of a card up to cardReadRetries times in the same
+ * cycle, every retry with the next higher receiver gain (33 dB up to 48 dB). A card that needed more gain starts with
+ * it next time, afterwards the reader returns to the default gain.
+ * um das fehlgeschlagene Authentifizieren oder Lesen einer Karte bis zu cardReadRetries mal im gleichen Zyklus zu
+ * wiederholen, in der nächste Zeile den Kommentar entfernen. Jede Wiederholung nutzt die nächst höhere Empfangs-
+ * verstärkung (33 dB bis 48 dB). Eine Karte, die mehr Verstärkung brauchte, startet das nächste Mal damit, danach
+ * kehrt der Leser zur Standardverstärkung zurück.
+ */
+//#define CARD_READ_RETRY
+inline constexpr uint8_t cardReadRetries = 3; // retries in the same cycle
+inline constexpr uint8_t cardRetryStats  = 4; // number of cards with their gain (5 byte RAM each)
+
+// ######################################################################
+
+/* uncomment the below line to poll the card reader less often without activity. After a button press, a card event,
+ * in the admin menu and in the games the reader is polled in every cycle. Without activity the interval doubles every
+ * cardPollBackoffTime up to cardPollSlowTime (set per board below). A failed poll of a present card switches back to
+ * every cycle, so the removal is detected as before.
+ * um den Kartenleser ohne Aktivität seltener abzufragen, in der nächste Zeile den Kommentar entfernen. Nach einem
+ * Tastendruck, einem Karten Ereignis, im Admin Menü und in den Spielen wird er in jedem Zyklus abgefragt. Ohne
+ * Aktivität verdoppelt sich der Abstand alle cardPollBackoffTime bis auf cardPollSlowTime (unten für jedes Board).
+ */
+//#define ADAPTIVE_CARD_POLL
+inline constexpr unsigned long cardPollBackoffTime = 10000; // ms without activity for each step
+
+// ######################################################################
+
+/* uncomment the below line to go to a light sleep instead of the shutdown if the standby timer expires. The box
+ * wakes up if a new card is put on or the play/pause button is pressed and continues in Idle or Pause without
+ * the restart. The shutdown follows after lightSleepTime without wake up. The DfPlayer is not powered down, the wake
+ * up from its sleep needs a reset with the scan of the SD card. The watchdog timer wakes up the TonUINO_Classic
+ * every lightSleepPollTime to look for a card, the other boards only wait.
+ * um bei Ablauf des Standby Timers in einen leichten Schlaf statt des Ausschaltens zu gehen, in der nächste Zeile den
+ * Kommentar entfernen. Mit einer neuen Karte oder der Play/Pause Taste wacht die Box auf und macht ohne Neustart in Idle
+ * oder Pause weiter. Nach lightSleepTime ohne Aufwachen wird ausgeschaltet. Der DfPlayer bleibt an, das Aufwachen aus
+ * seinem Schlaf braucht einen Reset mit dem Einlesen der SD Karte. Der TonUINO_Classic wird vom Watchdog Timer alle
+ * lightSleepPollTime geweckt, um nach einer Karte zu schauen, die anderen Boards warten nur.
+ */
+//#define LIGHT_SLEEP
+inline constexpr unsigned long lightSleepTime     = 60 * 60 * 1000ul; // light sleep until the shutdown
+inline constexpr unsigned long lightSleepPollTime = 250;              // card poll (watchdog period on TonUINO_Classic)
+
+// ######################################################################
+
+/* uncomment the below line to reset the box by the hardware watchdog if the main loop stalls for 8 s (only
+ * TonUINO_Classic with the optiboot bootloader, not together with LIGHT_SLEEP). The DfPlayer, the card reader, the
+ * buttons and the state machine have to check in every cycle. The stalled part and the program address are kept
+ * over the reset and logged at the next start, which continues in Idle without the start shortcut and the 2 s wait.
+ * um die Box mit dem Hardware Watchdog neu zu starten, wenn die Hauptschleife 8 s hängt, in der nächste Zeile den
+ * Kommentar entfernen (nur TonUINO_Classic mit dem Optiboot Bootloader, nicht zusammen mit LIGHT_SLEEP). DfPlayer,
+ * Kartenleser, Tasten und Zustandsmaschine müssen sich in jedem Zyklus melden. Der hängende Teil und die Programm
+ * Adresse werden beim nächsten Start ausgegeben, der ohne Start Shortcut und 2 s Wartezeit in Idle weitermacht.
+ */
+//#define WATCHDOG
+
+// ######################################################################
+
+/* uncomment the below line to cache the content of the last cards in RAM (by UID). A known card starts to play
+ * without authentication and read. The card is read afterwards and if it was rewritten, the new content is played.
+ * um den Inhalt der letzten Karten im RAM zu speichern (über die UID), in der nächste Zeile den Kommentar entfernen.
+ * Eine bekannte Karte startet ohne Authentifizierung und Lesen. Die Karte wird danach gelesen und falls sie neu
+ * beschrieben wurde, wird der neue Inhalt gespielt.
+ */
+//#define CARD_CACHE
+inline constexpr uint8_t cardCacheSize = 8; // number of cards in RAM
+
+/* uncomment the below line to fetch the track count of the folder of a new card while the pling is playing (needs
+ * TRACK_COUNT_CACHE). After the pling only the play command is left.
+ * um die Anzahl der Tracks des Ordners einer neuen Karte während des Signaltons abzufragen, in der nächste Zeile den
+ * Kommentar entfernen (TRACK_COUNT_CACHE wird benötigt). Nach dem Signalton ist nur noch der Play Befehl übrig.
+ */
+//#define CARD_PIPELINED_START
+
+// ######################################################################
+
+/* uncomment the below line to queue the commands to the DfPlayer. They are sent in the background by the
+ * loop (max. dfPlayerCmdsPerLoop per loop) and repeated on a timeout. Consecutive volume changes are collapsed.
+ * This moves the sending out of the state machine, but it still blocks: each sent (or repeated) command waits
+ * for the ack of the DfPlayer and the queries (e.g. the number of tracks) stay synchronous.
+ * um die Kommandos an den DfPlayer in eine Warteschlange zu stellen, in der nächste Zeile den Kommentar entfernen.
+ * Sie werden im Hintergrund gesendet (max. dfPlayerCmdsPerLoop pro Durchlauf) und bei einem Timeout wiederholt.
+ * Aufeinanderfolgende Lautstärkeänderungen werden zusammengefasst. Das Senden blockiert trotzdem: jedes gesendete
+ * (oder wiederholte) Kommando wartet auf die Bestätigung des DfPlayers und die Abfragen (z.B. die Anzahl der Tracks)
+ * bleiben synchron.
+ */
+//#define DFPLAYER_CMD_QUEUE
+inline constexpr uint8_t dfPlayerCmdQueueSize = 4;
+inline constexpr uint8_t dfPlayerCmdsPerLoop  = 2;
+inline constexpr uint8_t dfPlayerCmdRetries   = 2;
+
+// ######################################################################
+
+/* uncomment the below line to queue up to promptQueueSize voice prompts instead of two. A prompt starts when the one
+ * before has finished, prompts can have a priority (e.g. the admin menu queues "continue" behind the confirmation).
+ * The pending prompts with low priority are cancelled when the state is left.
+ * um bis zu promptQueueSize Ansagen statt zwei in eine Warteschlange zu stellen, in der nächste Zeile den Kommentar
+ * entfernen. Eine Ansage startet, wenn die vorherige beendet ist. Ansagen können eine Priorität haben (z.B. stellt
+ * das Admin Menü "weiter" hinter die Bestätigung). Die wartenden Ansagen mit niedriger Priorität werden beim
+ * Verlassen des Zustands abgebrochen.
+ */
+//#define PROMPT_QUEUE
+inline constexpr uint8_t promptQueueSize = 8;
+
+// ######################################################################
+
+/* uncomment the below line to set the volume of the DfPlayer at startup and on headphone jack switch without
+ * blocking: it is sent and verified in the background (every dfPlayerVolumeVerifyTime, max. dfPlayerVolumeRetries times)
+ * um die Lautstärke beim Start und beim Umschalten auf Kopfhörer ohne Blockieren einzustellen, in der nächste Zeile den
+ * Kommentar entfernen: sie wird im Hintergrund gesendet und überprüft
+ */
+//#define DFPLAYER_VOLUME_SYNC
+inline constexpr unsigned long dfPlayerVolumeVerifyTime = 200;
+inline constexpr uint8_t       dfPlayerVolumeRetries    =  20;
+
+// ######################################################################
+
+/* uncomment the below line to record the edges of the busy pin in an interrupt (pin change on Every/AiO+, otherwise
+ * sampled with 200 Hz by timer 1). The next track starts at the end of the busy signal without waiting for
+ * OnPlayFinished, the silence between the tracks is logged.
+ * um die Flanken des Busy Pins in einem Interrupt aufzuzeichnen (Pin Change bei Every/AiO+, sonst mit 200 Hz über
+ * den Timer 1 abgetastet), in der nächste Zeile den Kommentar entfernen. Der nächste Track startet am Ende des Busy
+ * Signals ohne auf OnPlayFinished zu warten, die Pause zwischen den Tracks wird geloggt.
+ */
+//#define DFPLAYER_BUSY_IRQ
+
+// ######################################################################
+
+/* uncomment the below line to connect the DfPlayer with a software UART on timer 1 instead of SoftwareSerial (only
+ * TonUINO_Classic). SoftwareSerial blocks the interrupts for about 1 ms per byte and cannot receive while sending, with
+ * the timer the edges are captured/generated by the hardware. The DfPlayer has to be connected to D8 (DfPlayer TX)
+ * and D9 (DfPlayer RX), the RST of the MFRC522 moves from D9 to D3. The 200 Hz samplers of timer 1 run then with 244 Hz.
+ * um den DfPlayer mit einem Software UART über den Timer 1 statt SoftwareSerial anzuschließen, in der nächste Zeile den
+ * Kommentar entfernen (nur TonUINO_Classic). Der DfPlayer muss an D8 (DfPlayer TX) und D9 (DfPlayer RX) angeschlossen
+ * werden, RST des MFRC522 wechselt von D9 auf D3.
+ */
+//#define DFPLAYER_TIMER_SERIAL
+inline constexpr uint8_t timerSerialRxBuffer = 32; // power of 2
+inline constexpr uint8_t timerSerialTxBuffer = 16; // power of 2
+
+// ######################################################################
+
+/* uncomment the below line to get the edges of the busy pin (with DFPLAYER_BUSY_IRQ), of the headphone jack detection
+ * (with HPJACKDETECT) and of the buttons (with BUTTONS_EDGE_BUFFER) by interrupt instead of reading the pins in every
+ * cycle (pin change interrupt on TonUINO_Classic, pin interrupt on Every/AiO+). Not with SoftwareSerial, it has
+ * all pin change interrupts, on the TonUINO_Classic use DFPLAYER_TIMER_SERIAL (not on ALLinONE).
+ * um die Flanken des Busy Pins (mit DFPLAYER_BUSY_IRQ), der Kopfhörer Erkennung (mit HPJACKDETECT) und der Tasten (mit
+ * BUTTONS_EDGE_BUFFER) per Interrupt zu bekommen, statt die Pins in jedem Zyklus zu lesen, in der nächste Zeile den
+ * Kommentar entfernen. Nicht mit SoftwareSerial, beim TonUINO_Classic DFPLAYER_TIMER_SERIAL verwenden (nicht beim
+ * ALLinONE).
+ */
+//#define PIN_CHANGE_IRQ
+inline constexpr uint8_t pinChangeSubscribers = 8;
+inline constexpr uint8_t hpJackDebounceTime   = 50; // ms
+
+// ######################################################################
+
+/* uncomment the below line to remember the last volume, EQ and play source sent to/received from the DfPlayer.
+ * A volume or EQ equal to the known one is not sent again, without a play source the track count is not requested
+ * (the counts of the folders are cached with TRACK_COUNT_CACHE). After an error the values are unknown, after
+ * OnPlaySourceOnline (restart of the DfPlayer) volume and EQ are sent again.
+ * um die letzte Lautstärke, EQ und Quelle des DfPlayers zu merken, in der nächste Zeile den Kommentar entfernen.
+ * Eine Lautstärke oder EQ gleich dem bekannten Wert wird nicht nochmal gesendet, ohne Quelle wird die Anzahl der
+ * Tracks nicht abgefragt.
+ */
+//#define DFPLAYER_SHADOW
+
+// ######################################################################
+
+/* uncomment the below line to start the next track in the modes album and hoerbuch directly in OnPlayFinished.
+ * The next track of the queue is known before, the bookkeeping (e.g. the progress in the EEPROM) follows after the
+ * play command.
+ * um den nächsten Track in den Modi Album und Hörbuch direkt in OnPlayFinished zu starten, in der nächste Zeile den
+ * Kommentar entfernen. Der nächste Track der Queue ist vorher bekannt, der Rest (z.B. der Fortschritt im EEPROM)
+ * folgt nach dem Kommando.
+ */
+//#define TRACK_PRE_ARM
+
+// ######################################################################
+
+/* uncomment the below line to convert the analog inputs (Buttons3x3, Poti, BatVoltage) in the background
+ * with the ADC interrupt (not for AiO). The consumers read the last value without waiting for the conversion.
+ * um die analogen Eingänge (Buttons3x3, Poti, BatVoltage) im Hintergrund mit dem ADC Interrupt zu wandeln
+ * (nicht für AiO), in der nächste Zeile den Kommentar entfernen. Es wird nicht mehr auf die Wandlung gewartet.
+ */
+//#define ADC_BACKGROUND
+inline constexpr uint8_t adcSamplerMaxChannels = 4;
+
+// ######################################################################
+
+/* uncomment the below line to boot faster: wait only until the DfPlayer is online (instead of 2 s), initialize
+ * the NFC reader meanwhile and generate the random seed from a boot counter in the EEPROM and a short noise sample
+ * um schneller zu starten, in der nächste Zeile den Kommentar entfernen: es wird nur gewartet, bis der DfPlayer
+ * bereit ist (statt 2 s), der NFC Leser wird in der Zeit initialisiert und der Zufallsstartwert wird aus einem Zähler
+ * im EEPROM und kurzem Rauschen erzeugt
+ */
+//#define FAST_BOOT
+inline constexpr unsigned long dfPlayerReadyQueryTime = 500; // ask the DfPlayer every 500 ms (if no online notification)
+
+// ######################################################################
+
+/* uncomment the below line to navigate faster in the voice menus: the preview of the selected folder/track is only
+ * started if the selection did not change for voiceMenuPreviewDelay. A new selection cancels the playing prompt
+ * or preview immediately.
+ * um schneller in den Sprachmenüs zu navigieren, in der nächste Zeile den Kommentar entfernen: die Vorschau des
+ * Ordners/Titels startet erst, wenn die Auswahl für voiceMenuPreviewDelay unverändert bleibt. Eine neue Auswahl
+ * bricht die laufende Ansage oder Vorschau sofort ab.
+ */
+//#define VOICE_MENU_BARGE_IN
+inline constexpr unsigned long voiceMenuPreviewDelay = 1000;
+
+// ######################################################################
+
+/* uncomment the below line to write the cards in Admin_CardsForFolder and Admin_MemoryGameCards faster: the next
+ * card is written as soon as it is placed (without waiting for the prompts), a written card is confirmed with a
+ * short pling and the number of cards per minute is logged
+ * um die Karten in Admin_CardsForFolder und Admin_MemoryGameCards schneller zu schreiben, in der nächste Zeile den
+ * Kommentar entfernen: die nächste Karte wird geschrieben, sobald sie aufgelegt wird (ohne auf die Ansagen zu
+ * warten), eine geschriebene Karte wird mit einem kurzen Pling bestätigt
+ */
+//#define BATCH_CARD_WRITE
+
+// ######################################################################
+
 /* uncomment the below line to enable the rotary encoder for volume setting
  * um den Drehgeber zu unterstützen bitte in der nächste Zeile den Kommentar entfernen
  */
@@ -143,6 +636,18 @@
  * um den Drehgeber auch für vor und zurück zu unterstützen bitte in der nächste Zeile den Kommentar entfernen
  */
 //#define ROTARY_ENCODER_LONGPRESS
+/* uncomment the below line to decode all transitions of both channels with a Gray code table (pin change on
+ * Every/AiO+, otherwise sampled with 200 Hz by timer 1) and to accelerate the volume steps on fast turns
+ * (not with ROTARY_ENCODER_LONGPRESS)
+ * um alle Flanken beider Kanäle mit einer Gray Code Tabelle auszuwerten (Pin Change bei Every/AiO+, sonst mit 200 Hz
+ * über den Timer 1 abgetastet) und die Lautstärke beim schnellen Drehen in größeren Schritten zu ändern (nicht mit
+ * ROTARY_ENCODER_LONGPRESS), in der nächste Zeile den Kommentar entfernen
+ */
+//#define ROTARY_ENCODER_QUADRATURE
+inline constexpr uint8_t       rotaryEncoderTransitionsPerDetent = 4;   // 4 for one full Gray code cycle per click
+inline constexpr unsigned long rotaryEncoderAccelTime            = 100; // ms, a click faster than this after the last one ...
+inline constexpr uint8_t       rotaryEncoderAccelFactor          = 3;   // ... gives this number of volume steps
+inline constexpr int8_t        rotaryEncoderMaxPendingSteps      = 30;
 
 #ifdef ALLinONE_Plus
 // if using Rotary Encoder Buchse
@@ -168,6 +673,15 @@ inline constexpr uint8_t   potiPin    = A14; // AiO+ PF4
 #else
 inline constexpr uint8_t   potiPin    = A3 ; // AiO/Classic A3
 #endif // ALLinONE_Plus
+/* uncomment the below line to filter the poti (exponential average, hysteresis at the step boundaries). The volume
+ * is only sent to the DfPlayer if it changed, max. once in potiMinInterval.
+ * um den Poti zu filtern (exponentieller Mittelwert, Hysterese an den Stufengrenzen), in der nächste Zeile den
+ * Kommentar entfernen. Die Lautstärke wird nur bei einer Änderung gesendet, max. einmal in potiMinInterval.
+ */
+//#define POTI_FILTER
+inline constexpr uint8_t       potiFilterShift = 3;   // weight of a new sample: 1/2^potiFilterShift
+inline constexpr int16_t       potiHysteresis  = 8;   // ADC counts beyond the step boundary
+inline constexpr unsigned long potiMinInterval = 200; // ms
 
 // ######################################################################
 
@@ -180,12 +694,26 @@ inline constexpr uint8_t   potiPin    = A3 ; // AiO/Classic A3
 //#define NEO_RING_EXT
 //#define NEO_RING_2
 
-#ifdef ALLinONE_Plus
+/* uncomment the below line to send the frames of the neo ring with the USART0 in SPI mode (only TonUINO_Every, the ring
+ * must be connected to D2, so the DfPlayer needs DFPlayerUsesHardwareSerial). Adafruit_NeoPixel blocks the interrupts for
+ * about 0.75 ms per frame, with it the interrupts stay enabled (e.g. for the rotary encoder).
+ * um die Frames des Neo Rings mit dem USART0 im SPI Modus zu senden, in der nächste Zeile den Kommentar entfernen (nur
+ * TonUINO_Every, der Ring muss an D2 angeschlossen sein, der DfPlayer braucht dann DFPlayerUsesHardwareSerial). Dann
+ * bleiben die Interrupts eingeschaltet.
+ */
+//#define NEO_RING_USART
+
+#ifdef NEO_RING_USART
+inline constexpr uint8_t neoPixelRingPin =  2; // D2 = PA0 = TXD of USART0 on Every
+#elif defined(ALLinONE_Plus)
 inline constexpr uint8_t neoPixelRingPin = 10; // PB2 on AiOplus (Erweiterungsleiste (Female))
+#elif defined(TonUINO_ESP32)
+inline constexpr uint8_t neoPixelRingPin = 13; // GPIO13 on ESP32
 #else
 inline constexpr uint8_t neoPixelRingPin =  5; // D5 on AiO/Classic
 #endif // ALLinONE_Plus
 inline constexpr uint8_t neoPixelNumber  = 24; // Total Number of Pixels
+inline constexpr uint8_t neoPixelFrameTime = 50; // min. time between two frames in ms (show() blocks the interrupts)
 #ifdef NEO_RING_2
 #ifdef ALLinONE_Plus
 inline constexpr uint8_t neoPixelRingPin2= 14; // PC0 on AiOplus (Erweiterungsleiste (Female))
@@ -204,7 +732,7 @@ inline constexpr uint8_t neoPixelNumber2 = 24; // Total Number of Pixels
  * (automatisch eingeschaltet für AiO und AiOplus)
  */
 //#define SPKONOFF
-#if not defined(ALLinONE_Plus) and not defined(ALLinONE)
+#if not defined(ALLinONE_Plus) and not defined(ALLinONE) and not defined(TonUINO_ESP32) // D6 is the flash on the ESP32
 inline constexpr uint8_t       ampEnablePin     = 6;
 inline constexpr levelType     ampEnablePinType = levelType::activeHigh;
 #endif
@@ -216,7 +744,7 @@ inline constexpr levelType     ampEnablePinType = levelType::activeHigh;
  * (automatisch eingeschaltet für AiOplus)
  */
 //#define HPJACKDETECT
-#ifndef ALLinONE_Plus
+#if not defined(ALLinONE_Plus) and not defined(TonUINO_ESP32) // D8 is the flash on the ESP32
 inline constexpr uint8_t       dfPlayer_noHeadphoneJackDetect     = 8;
 inline constexpr levelType     dfPlayer_noHeadphoneJackDetectType = levelType::activeLow;
 #endif
@@ -251,6 +779,41 @@ inline constexpr levelType     dfPlayer_noHeadphoneJackDetectType = levelType::a
 //#define QUIZ_GAME
 //#define MEMORY_GAME
 
+/* uncomment the below line (needs MEMORY_GAME) to match the memory game cards by the UID. The pair of a card is stored
+ * in the EEPROM when the card is written or read the first time, in the game the card is not read again then (only
+ * TonUINO_Classic and ALLinONE).
+ * um die Karten des Memory Spiels an der UID zu erkennen, in der nächste Zeile den Kommentar entfernen (benötigt
+ * MEMORY_GAME). Das Paar einer Karte wird im EEPROM gespeichert, wenn die Karte geschrieben oder das erste Mal
+ * gelesen wird, im Spiel wird die Karte dann nicht mehr gelesen (nur TonUINO_Classic und ALLinONE).
+ */
+//#define MEMORY_UID_MATCH
+#ifdef ALLinONE
+inline constexpr uint8_t memoryUidEntries = 8;  // number of cards (5 byte EEPROM each)
+#else
+inline constexpr uint8_t memoryUidEntries = 32; // number of cards (5 byte EEPROM each)
+#endif
+
+// ######################################################################
+
+/* uncomment the below line(s) to remove modifiers that are not used (saves program code and RAM).
+ * A modifier card of a removed modifier is ignored.
+ * um nicht benutzte Modifier zu entfernen (spart Programmspeicher und RAM), in der nächste Zeile(n)
+ * den Kommentar entfernen. Eine Modifier Karte eines entfernten Modifiers wird ignoriert.
+ */
+//#define DISABLE_SLEEP_TIMER
+//#define DISABLE_DANCE_GAME
+//#define DISABLE_TODDLER_MODE
+//#define DISABLE_KINDERGARDEN_MODE
+//#define DISABLE_REPEAT_SINGLE
+
+/* number of cards the kindergarden mode queues (power of 2), a card that is already queued is ignored.
+ * Uncomment the below line to announce the position of a queued card (advert/0001.mp3 ...)
+ * Anzahl Karten, die der KiTa Modus aufhebt (Potenz von 2), eine schon wartende Karte wird ignoriert.
+ * Um die Position einer wartenden Karte anzusagen (advert/0001.mp3 ...), in der nächste Zeile den Kommentar entfernen
+ */
+inline constexpr uint8_t kindergardenQueueSize = 4;
+//#define KINDERGARDEN_QUEUE_ANNOUNCE
+
 // ######################################################################
 
 /* uncomment the below line to store the last played card in EEPROM
@@ -260,6 +823,18 @@ inline constexpr levelType     dfPlayer_noHeadphoneJackDetectType = levelType::a
 
 // ######################################################################
 
+/* uncomment the below line (needs STORE_LAST_CARD and EEPROM_JOURNAL) to save a snapshot of the playback (position in
+ * the queue, order of the party mode, volume) on pause, standby and shutdown. The next playback of the last card after
+ * the power on continues at this position with the same order. Only TonUINO_Classic and ALLinONE.
+ * um eine Momentaufnahme der Wiedergabe (Position in der Queue, Reihenfolge im Party Modus, Lautstärke) bei Pause,
+ * Standby und Ausschalten zu speichern, in der nächste Zeile den Kommentar entfernen (braucht STORE_LAST_CARD und
+ * EEPROM_JOURNAL). Die nächste Wiedergabe der letzten Karte nach dem Einschalten macht an dieser Position mit der
+ * gleichen Reihenfolge weiter. Nur TonUINO_Classic und ALLinONE.
+ */
+//#define RESUME_SNAPSHOT
+
+// ######################################################################
+
 /* uncomment the below line to enable special shortcut on startup via GPIO
  * um den spezial Shortcut beim Start via GPIO zu aktivieren, in der nächste Zeile den Kommentar entfernen
  */
@@ -312,6 +887,24 @@ inline constexpr float   voltageMeasurementCorrection  = 2.007; // Spannungsteil
 inline constexpr float   batVoltageLow                 = 2.95;
 inline constexpr float   batVoltageEmpty               = 2.90;
 
+/* uncomment the below line to account the time per power state (playing per volume band, idle, light sleep, amplifier,
+ * NeoPixel ring) and to estimate the remaining runtime from the voltage drop (needs BAT_VOLTAGE_MEASUREMENT for the
+ * estimation). Print the report with -12 via the serial input. Uncomment also ENERGY_MONITOR_ANNOUNCE to announce the
+ * remaining minutes (advert/0001.mp3 ...) instead of the pling of the low battery message.
+ * um die Zeit pro Betriebszustand (Wiedergabe pro Lautstärkebereich, Idle, leichter Schlaf, Verstärker, NeoPixel Ring)
+ * aufzuzeichnen und die Restlaufzeit aus dem Spannungsabfall abzuschätzen, in der nächste Zeile den Kommentar entfernen
+ * (die Abschätzung braucht BAT_VOLTAGE_MEASUREMENT). Ausgabe mit -12 über den Serial Monitor. Mit ENERGY_MONITOR_ANNOUNCE
+ * werden statt des Warntons bei schwacher Batterie die restlichen Minuten angesagt (advert/0001.mp3 ...).
+ */
+//#define ENERGY_MONITOR
+//#define ENERGY_MONITOR_ANNOUNCE
+// estimated current of the box in mA
+inline constexpr uint16_t energyCurrentPlay[] = { 90, 120, 180 }; // volume band low, mid, high
+inline constexpr uint16_t energyCurrentIdle   = 50;               // DfPlayer on, card reader polling
+inline constexpr uint16_t energyCurrentSleep  = 15;               // LIGHT_SLEEP
+inline constexpr uint16_t energyCurrentAmp    = 20;               // SPKONOFF: amplifier on
+inline constexpr uint16_t energyCurrentRing[] = { 20, 60 };       // NEO_RING: brightness low, high
+
 // ######################################################################
 
 /* uncomment the below line if you use Pololu Powerswitch for shutdown
@@ -325,9 +918,163 @@ inline constexpr float   batVoltageEmpty               = 2.90;
  * #################################################################################################
  */
 
+// ####### rules for track count cache #################
+
+#ifdef TRACK_COUNT_CACHE_EEPROM
+#ifndef TRACK_COUNT_CACHE
+static_assert(false, "TRACK_COUNT_CACHE_EEPROM needs TRACK_COUNT_CACHE");
+#endif
+#if not defined(TonUINO_Classic) and not defined(ALLinONE)
+static_assert(false, "TRACK_COUNT_CACHE_EEPROM needs more than 256 byte EEPROM (TonUINO_Classic or ALLinONE)");
+#endif
+#endif // TRACK_COUNT_CACHE_EEPROM
+
+// ####### rules for the AVR cycle bench ###############
+
+#ifdef AVR_CYCLE_BENCH
+#ifndef LOOP_PROFILER
+static_assert(false, "AVR_CYCLE_BENCH needs LOOP_PROFILER");
+#endif
+#ifndef TonUINO_Classic
+static_assert(false, "AVR_CYCLE_BENCH needs TonUINO_Classic (simavr does not simulate the ATmega4809)");
+#endif
+#endif // AVR_CYCLE_BENCH
+
+// ####### rules for the energy monitor ################
+
+#ifdef ENERGY_MONITOR_ANNOUNCE
+#ifndef ENERGY_MONITOR
+static_assert(false, "ENERGY_MONITOR_ANNOUNCE needs ENERGY_MONITOR");
+#endif
+#ifndef BAT_VOLTAGE_MEASUREMENT
+static_assert(false, "ENERGY_MONITOR_ANNOUNCE needs BAT_VOLTAGE_MEASUREMENT");
+#endif
+#endif // ENERGY_MONITOR_ANNOUNCE
+
+// ####### rules for the card pipelined start #########
+
+#ifdef CARD_PIPELINED_START
+#ifndef TRACK_COUNT_CACHE
+static_assert(false, "CARD_PIPELINED_START needs TRACK_COUNT_CACHE");
+#endif
+#ifdef DFMiniMp3_T_CHIP_GD3200B
+static_assert(false, "CARD_PIPELINED_START does not work with the GD3200B (getFolderTrackCount() plays a track)");
+#endif
+#endif // CARD_PIPELINED_START
+
+// ####### rules for the timer serial ##################
+
+#ifdef DFPLAYER_TIMER_SERIAL
+#ifndef TonUINO_Classic
+static_assert(false, "DFPLAYER_TIMER_SERIAL needs TonUINO_Classic (timer 1 of the ATmega328P)");
+#endif
+#ifdef AVR_CYCLE_BENCH
+static_assert(false, "DFPLAYER_TIMER_SERIAL and AVR_CYCLE_BENCH both use timer 1");
+#endif
+#ifdef BT_MODULE
+static_assert(false, "DFPLAYER_TIMER_SERIAL uses D3 (RST of the MFRC522) like BT_MODULE");
+#endif
+#endif // DFPLAYER_TIMER_SERIAL
+
+// ####### rules for the pin change service ###########
+
+#ifdef PIN_CHANGE_IRQ
+#ifdef ALLinONE
+static_assert(false, "PIN_CHANGE_IRQ does not work on ALLinONE (the DfPlayer needs the SoftwareSerial, it has all PCINT vectors)");
+#endif
+#if defined(TonUINO_Classic) and not defined(DFPLAYER_TIMER_SERIAL) and not defined(DFPlayerUsesHardwareSerial)
+static_assert(false, "PIN_CHANGE_IRQ does not work with SoftwareSerial (it has all PCINT vectors), use DFPLAYER_TIMER_SERIAL");
+#endif
+#endif // PIN_CHANGE_IRQ
+
+// ####### rules for the telemetry #####################
+
+#ifdef TELEMETRY
+#ifndef EEPROM_JOURNAL
+static_assert(false, "TELEMETRY needs EEPROM_JOURNAL");
+#endif
+#ifndef TonUINO_Classic
+static_assert(false, "TELEMETRY needs the EEPROM of the TonUINO_Classic");
+#endif
+#endif // TELEMETRY
+
+// ####### rules for the memory game ###################
+
+#ifdef MEMORY_UID_MATCH
+#ifndef MEMORY_GAME
+static_assert(false, "MEMORY_UID_MATCH needs MEMORY_GAME");
+#endif
+#if not defined(TonUINO_Classic) and not defined(ALLinONE)
+static_assert(false, "MEMORY_UID_MATCH needs more than 256 byte EEPROM (TonUINO_Classic or ALLinONE)");
+#endif
+#endif // MEMORY_UID_MATCH
+
+// ####### rules for the keymap ########################
+
+#ifdef KEYMAP
+#if not defined(TonUINO_Classic) and not defined(ALLinONE)
+static_assert(false, "KEYMAP needs more than 256 byte EEPROM (TonUINO_Classic or ALLinONE)");
+#endif
+#endif // KEYMAP
+
+// ####### rules for the neo ring ######################
+
+#ifdef NEO_RING_USART
+#ifndef NEO_RING
+static_assert(false, "NEO_RING_USART needs NEO_RING");
+#endif
+#ifndef TonUINO_Every
+static_assert(false, "NEO_RING_USART needs TonUINO_Every (USART0 on D2)");
+#endif
+#ifdef NEO_RING_2
+static_assert(false, "NEO_RING_USART supports only one ring (NEO_RING_2 uses D2)");
+#endif
+#ifdef BT_MODULE
+static_assert(btModuleOnPin != neoPixelRingPin, "NEO_RING_USART and BT_MODULE both use D2 (btModuleOnPin)");
+#endif
+#ifndef DFPlayerUsesHardwareSerial
+static_assert(false, "NEO_RING_USART uses D2, the RX pin of the SoftwareSerial for the DfPlayer: use DFPlayerUsesHardwareSerial");
+#endif
+#endif // NEO_RING_USART
+
+// ####### rules for the watchdog ######################
+
+#ifdef WATCHDOG
+#ifndef TonUINO_Classic
+static_assert(false, "WATCHDOG needs TonUINO_Classic");
+#endif
+#ifdef LIGHT_SLEEP
+static_assert(false, "WATCHDOG and LIGHT_SLEEP both use the watchdog timer");
+#endif
+#endif // WATCHDOG
+
+// ####### rules for the ESP32 #########################
+
+#ifdef TonUINO_ESP32
+#if defined(TICK_SCHEDULER) or defined(EVENT_QUEUE)
+static_assert(false, "TonUINO_ESP32 runs the cycle in FreeRTOS tasks (Esp32Tasks), not with TICK_SCHEDULER or EVENT_QUEUE");
+#endif
+#if defined(LIGHT_SLEEP) or defined(ADAPTIVE_CARD_POLL)
+static_assert(false, "TonUINO_ESP32 polls the card in an own task, not with LIGHT_SLEEP or ADAPTIVE_CARD_POLL");
+#endif
+#if defined(BUTTONS3X3) or defined(POTI) or defined(BAT_VOLTAGE_MEASUREMENT) or defined(ADC_BACKGROUND)
+static_assert(false, "TonUINO_ESP32: the analog inputs are not adapted to the ADC of the ESP32");
+#endif
+#if defined(BT_MODULE) or defined(NEO_RING_2)
+static_assert(false, "TonUINO_ESP32: BT_MODULE and NEO_RING_2 use D2/D3 (GPIO3 is the RX of Serial)");
+#endif
+#if defined(BUFFERED_LOG) or defined(BINARY_LOGGER)
+static_assert(false, "TonUINO_ESP32: BUFFERED_LOG and BINARY_LOGGER are not drained and not locked for the tasks");
+#endif
+#endif // TonUINO_ESP32
+
 // ####### rules for buttons ############################
 
+#ifdef PACKED_SHORTCUTS
+inline constexpr uint8_t lastSortCut         =  49;
+#else
 inline constexpr uint8_t lastSortCut         =  24;
+#endif
 #ifdef BUTTONS3X3
 #ifdef FIVEBUTTONS
 static_assert(false, "The 3x3 Button board doesn't have 5 Buttons");
@@ -370,14 +1117,24 @@ inline constexpr uint32_t  buttonDbTime    = 25; // Debounce time in millisecond
 
 inline constexpr uint32_t cardCookie      = 0x1337b347;
 inline constexpr uint8_t  cardVersion     = 0x02;
+#ifdef DFPLAYER_TIMER_SERIAL
+inline constexpr byte     mfrc522_RSTPin  =  3; // D9 is TX to the DfPlayer
+#else
 inline constexpr byte     mfrc522_RSTPin  =  9;
+#endif
 inline constexpr byte     mfrc522_SSPin   = 10;
 inline constexpr uint8_t  cardRemoveDelay =  3;
+#ifdef ADAPTIVE_CARD_POLL
+inline constexpr unsigned long cardPollSlowTime = 400; // ms between the polls without activity
+#endif
 
 // ####### mp3 #########################################
 
 #ifdef DFPlayerUsesHardwareSerial
 inline constexpr HardwareSerial &dfPlayer_serial         = Serial1; // D0 RX, D1 TX (Every)
+#elif defined(DFPLAYER_TIMER_SERIAL)
+inline constexpr uint8_t       dfPlayer_receivePin      = 8; // ICP1
+inline constexpr uint8_t       dfPlayer_transmitPin     = 9; // OC1A
 #else
 inline constexpr uint8_t       dfPlayer_receivePin      = 2;
 inline constexpr uint8_t       dfPlayer_transmitPin     = 3;
@@ -386,13 +1143,7 @@ inline constexpr uint8_t       dfPlayer_transmitPin     = 3;
 inline constexpr uint8_t       maxTracksInFolder        = 255;
 inline constexpr uint8_t       dfPlayer_busyPin         = 4;
 inline constexpr levelType     dfPlayer_busyPinType     = levelType::activeHigh;
-#if defined(DFMiniMp3_T_CHIP_MH2024K24SS_MP3_TF_16P_V3_0)
-inline constexpr unsigned long dfPlayer_timeUntilStarts = 2500;
-#elif defined(DFMiniMp3_T_CHIP_GD3200B)
-inline constexpr unsigned long dfPlayer_timeUntilStarts = 1500;
-#else
-inline constexpr unsigned long dfPlayer_timeUntilStarts = 1200;
-#endif
+inline constexpr unsigned long dfPlayer_timeUntilStarts = dfPlayer_chipTimeUntilStarts;
 
 // ####### tonuino #####################################
 
@@ -447,6 +1198,9 @@ inline constexpr uint8_t  cardVersion     = 0x02;
 inline constexpr byte     mfrc522_RSTPin  = 11;
 inline constexpr byte     mfrc522_SSPin   =  7;
 inline constexpr uint8_t  cardRemoveDelay =  3;
+#ifdef ADAPTIVE_CARD_POLL
+inline constexpr unsigned long cardPollSlowTime = 500; // ms between the polls without activity (battery board)
+#endif
 
 // ####### mp3 #########################################
 
@@ -513,6 +1267,9 @@ inline constexpr uint8_t  cardVersion     = 0x02;
 inline constexpr byte     mfrc522_RSTPin  =  9;
 inline constexpr byte     mfrc522_SSPin   = 10;
 inline constexpr uint8_t  cardRemoveDelay =  3;
+#ifdef ADAPTIVE_CARD_POLL
+inline constexpr unsigned long cardPollSlowTime = 400; // ms between the polls without activity
+#endif
 
 // ####### mp3 #########################################
 
@@ -536,6 +1293,69 @@ inline constexpr uint8_t       openAnalogPin    = A7;
 inline constexpr unsigned long cycleTime        = 50;
 #endif /* ALLinONE */
 
+/***************************************************************************
+ ** ESP32 ******************************************************************
+ ***************************************************************************/
+
+#ifdef TonUINO_ESP32
+// ####### buttons #####################################
+
+inline constexpr uint8_t   buttonPausePin  = 25;
+inline constexpr uint8_t   buttonUpPin     = 26;
+inline constexpr uint8_t   buttonDownPin   = 27;
+#ifdef FIVEBUTTONS
+inline constexpr uint8_t   buttonFourPin   = 14;
+inline constexpr uint8_t   buttonFivePin   = 15;
+#endif
+
+inline constexpr levelType buttonPinType   = levelType::activeLow;
+inline constexpr uint32_t  buttonDbTime    = 25; // Debounce time in milliseconds (default 25ms)
+
+// ####### chip_card ###################################
+
+inline constexpr uint32_t cardCookie      = 0x1337b347;
+inline constexpr uint8_t  cardVersion     = 0x02;
+inline constexpr byte     mfrc522_RSTPin  = 22;
+inline constexpr byte     mfrc522_SSPin   =  5; // VSPI: SCK 18, MISO 19, MOSI 23
+inline constexpr uint8_t  cardRemoveDelay =  3;
+
+// ####### mp3 #########################################
+
+#define DFPlayerUsesHardwareSerial
+inline constexpr HardwareSerial &dfPlayer_serial         = Serial2; // GPIO16 RX, GPIO17 TX
+
+inline constexpr uint8_t        maxTracksInFolder        = 255;
+inline constexpr uint8_t        dfPlayer_busyPin         = 4;
+inline constexpr levelType      dfPlayer_busyPinType     = levelType::activeHigh;
+inline constexpr unsigned long  dfPlayer_timeUntilStarts = dfPlayer_chipTimeUntilStarts;
+inline constexpr uint8_t        dfPlayer_noHeadphoneJackDetect     = 33;
+inline constexpr levelType      dfPlayer_noHeadphoneJackDetectType = levelType::activeLow;
+
+// ####### tonuino #####################################
+
+inline constexpr uint8_t       shutdownPin      = 21;
+#ifdef USE_POLOLU_SHUTDOWN
+inline constexpr levelType     shutdownPinType  = levelType::activeHigh;
+#else
+inline constexpr levelType     shutdownPinType  = levelType::activeLow;
+#endif
+inline constexpr uint8_t       ampEnablePin     = 2;
+inline constexpr levelType     ampEnablePinType = levelType::activeHigh;
+inline constexpr uint8_t       openAnalogPin    = 35;
+inline constexpr unsigned long cycleTime        = 50;
+inline constexpr uint16_t      eepromSize       = 512; // emulated in the flash
+
+// ####### tasks (see esp32_tasks.hpp) #################
+
+inline constexpr unsigned long cardPollTime     = 20;   // ms between two polls in the card task
+inline constexpr uint8_t       cardEventsSize   = 4;    // card events waiting for the ui task, must be a power of 2
+inline constexpr uint8_t       taskCoreIo       = 0;    // card and mp3 task (with the WiFi/BT stack, both are off)
+inline constexpr uint8_t       taskCoreUi       = 1;    // ui task (like the Arduino loop())
+inline constexpr uint32_t      taskStackCard    = 4096;
+inline constexpr uint32_t      taskStackMp3     = 4096;
+inline constexpr uint32_t      taskStackUi      = 8192;
+#endif /* TonUINO_ESP32 */
+
 // ####### some helper fuctions #####################################
 
 template <typename T> void PROGMEM_read(const T * sce, T& dest)
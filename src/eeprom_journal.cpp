@@ -0,0 +1,96 @@
+#include "eeprom_journal.hpp"
+
+#include "constants.hpp"
+
+#ifdef EEPROM_JOURNAL
+#include "settings.hpp"
+#include "logger.hpp"
+
+uint8_t EepromJournal::seqAt(uint8_t pos) {
+  return EEPROM.read(address(pos));
+}
+
+uint8_t EepromJournal::keyAt(uint8_t pos) {
+  return EEPROM.read(address(pos)+1);
+}
+
+void EepromJournal::valueAt(uint8_t pos, value_t& value) {
+  for (uint8_t i = 0; i < valueSize; ++i)
+    value[i] = EEPROM.read(address(pos)+2+i);
+}
+
+// the head is the first empty record or the first record that does not continue
+// the sequence of the previous one
+void EepromJournal::init() {
+  head = 0;
+  for (uint8_t pos = 0; pos < records; ++pos) {
+    const uint8_t s = seqAt(pos);
+    if (s == emptySeq || (pos > 0 && s != nextSeq(seqAt(pos-1)))) {
+      head = pos;
+      break;
+    }
+  }
+  const uint8_t last = seqAt(prevPos(head));
+  seq = (last == emptySeq) ? 0 : nextSeq(last);
+  initialized = true;
+  LOG(settings_log, s_debug, F("journal head: "), head, F(" seq: "), seq);
+}
+
+void EepromJournal::clear() {
+  LOG(settings_log, s_debug, F("clJournal"));
+  for (uint8_t pos = 0; pos < records; ++pos)
+    EEPROM_update(address(pos), emptySeq);
+  head = 0;
+  seq  = 0;
+  initialized = true;
+}
+
+bool EepromJournal::read(uint8_t key, value_t& value) {
+  if (not initialized)
+    init();
+  uint8_t pos = head;
+  for (uint8_t i = 0; i < records; ++i) {
+    pos = prevPos(pos);
+    if (seqAt(pos) != emptySeq && keyAt(pos) == key) {
+      valueAt(pos, value);
+      return true;
+    }
+  }
+  return false;
+}
+
+// all other records are newer than the one at pos (the oldest one)
+bool EepromJournal::hasNewer(uint8_t pos, uint8_t key) {
+  for (uint8_t p = nextPos(pos); p != pos; p = nextPos(p))
+    if (seqAt(p) != emptySeq && keyAt(p) == key)
+      return true;
+  return false;
+}
+
+void EepromJournal::write(uint8_t key, const value_t& value) {
+  if (not initialized)
+    init();
+
+  // compaction on wrap: keep the value of the overwritten record
+  if (seqAt(head) != emptySeq) {
+    const uint8_t oldKey = keyAt(head);
+    if (oldKey != key && not hasNewer(head, oldKey)) {
+      value_t oldValue;
+      valueAt(head, oldValue);
+      fold(oldKey, oldValue);
+    }
+  }
+
+  // the seq is written last, so an interrupted write leaves an empty record
+  const uint16_t a = address(head);
+  EEPROM_update(a, emptySeq);
+  EEPROM_update(a+1, key);
+  for (uint8_t i = 0; i < valueSize; ++i)
+    EEPROM_update(a+2+i, value[i]);
+  EEPROM_update(a, seq);
+
+  head = nextPos(head);
+  seq  = nextSeq(seq);
+}
+
+#endif // EEPROM_JOURNAL
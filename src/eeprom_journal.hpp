@@ -0,0 +1,58 @@
+#ifndef SRC_EEPROM_JOURNAL_HPP_
+#define SRC_EEPROM_JOURNAL_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+#ifdef EEPROM_JOURNAL
+#include "array.hpp"
+
+// append only journal in a ring of EEPROM records. Every record has a sequence
+// number, a key and a value. A write always goes to the next record of the ring,
+// so the wear is spread over the whole region. Before the oldest record is
+// overwritten (wrap), it is compacted to its home location if it is still the
+// latest record for its key.
+class EepromJournal {
+public:
+  static constexpr uint8_t valueSize  = 4;
+  static constexpr uint8_t recordSize = 2 + valueSize; // seq, key, value
+  typedef array<uint8_t, valueSize> value_t;
+  typedef void (*fold_t)(uint8_t key, const value_t& value);
+
+  EepromJournal(uint16_t startAddress, uint8_t records, fold_t fold)
+  : startAddress{startAddress}
+  , records     {records     }
+  , fold        {fold        }
+  {}
+
+  void init ();
+  void clear();
+  bool read (uint8_t key,       value_t& value);
+  void write(uint8_t key, const value_t& value);
+
+private:
+  static constexpr uint8_t emptySeq = 0xff;
+
+  uint16_t address(uint8_t pos) const { return startAddress + pos * recordSize; }
+  uint8_t  prevPos(uint8_t pos) const { return pos == 0 ? records-1 : pos-1; }
+  uint8_t  nextPos(uint8_t pos) const { return pos+1 == records ? 0 : pos+1; }
+  static uint8_t nextSeq(uint8_t seq) { return seq+1 == emptySeq ? 0 : seq+1; }
+
+  uint8_t  seqAt  (uint8_t pos);
+  uint8_t  keyAt  (uint8_t pos);
+  void     valueAt(uint8_t pos, value_t& value);
+  bool     hasNewer(uint8_t pos, uint8_t key);
+
+  const uint16_t startAddress;
+  const uint8_t  records;
+  const fold_t   fold;
+
+  uint8_t  head       {}; // next record to write
+  uint8_t  seq        {}; // sequence number of the next record
+  bool     initialized{};
+};
+
+#endif // EEPROM_JOURNAL
+
+#endif /* SRC_EEPROM_JOURNAL_HPP_ */
@@ -0,0 +1,85 @@
+#include "eeprom_kv_store.hpp"
+
+#include "constants.hpp"
+
+#ifdef FOLDER_PROGRESS_KV
+#include "settings.hpp"
+#include "logger.hpp"
+
+// CRC-8 (polynomial 0x07), the start value 0xff makes an all zero slot invalid
+uint8_t EepromKvStore::crc8(uint8_t key, uint16_t value) {
+  uint8_t crc = 0xff;
+  for (uint8_t b: { key, static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8) }) {
+    crc ^= b;
+    for (uint8_t i = 0; i < 8; ++i)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+EepromKvStore::slotState EepromKvStore::stateAt(uint8_t pos, uint8_t& key, uint16_t& value) {
+  const uint16_t a = address(pos);
+  key = EEPROM.read(a);
+  if (key == emptyKey)
+    return slotState::empty;
+  value = EEPROM.read(a+1) | (EEPROM.read(a+2) << 8);
+  return EEPROM.read(a+3) == crc8(key, value) ? slotState::used : slotState::invalid;
+}
+
+void EepromKvStore::clear() {
+  LOG(settings_log, s_debug, F("clKvStore"));
+  for (uint8_t pos = 0; pos < slots; ++pos)
+    EEPROM_update(address(pos), emptyKey);
+}
+
+bool EepromKvStore::read(uint8_t key, uint16_t& value) {
+  uint8_t pos = homePos(key);
+  for (uint8_t i = 0; i < slots; ++i, pos = nextPos(pos)) {
+    uint8_t  k;
+    uint16_t v;
+    const slotState s = stateAt(pos, k, v);
+    if (s == slotState::empty)
+      return false;
+    if (s == slotState::used && k == key) {
+      value = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+// the slot with the same key, else the first free or invalid one in the probe
+// sequence. If the store is full, the home slot is overwritten.
+void EepromKvStore::write(uint8_t key, uint16_t value) {
+  uint8_t pos  = homePos(key);
+  uint8_t free = emptyKey;
+  for (uint8_t i = 0; i < slots; ++i, pos = nextPos(pos)) {
+    uint8_t  k;
+    uint16_t v;
+    const slotState s = stateAt(pos, k, v);
+    if (s == slotState::used && k == key) {
+      if (v == value)
+        return;
+      free = pos;
+      break;
+    }
+    if (s != slotState::used && free == emptyKey)
+      free = pos;
+    if (s == slotState::empty)
+      break;
+  }
+  if (free == emptyKey) {
+    LOG(settings_log, s_warning, F("kv store full, overwrite: "), EEPROM.read(address(homePos(key))));
+    free = homePos(key);
+  }
+
+  // the crc is written last, so an interrupted write leaves an invalid slot
+  const uint16_t a = address(free);
+  EEPROM_update(a+3, static_cast<uint8_t>(~crc8(key, value)));
+  EEPROM_update(a  , key);
+  EEPROM_update(a+1, static_cast<uint8_t>(value));
+  EEPROM_update(a+2, static_cast<uint8_t>(value >> 8));
+  EEPROM_update(a+3, crc8(key, value));
+}
+
+#endif // FOLDER_PROGRESS_KV
@@ -0,0 +1,51 @@
+#ifndef SRC_EEPROM_KV_STORE_HPP_
+#define SRC_EEPROM_KV_STORE_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+#ifdef FOLDER_PROGRESS_KV
+
+// fixed size key-value store in the EEPROM with open addressing (linear probing
+// from the home slot key % slots). Every slot holds a key, a 16 bit value and a
+// CRC-8 over both. A slot with a wrong CRC (interrupted write, former layout) is
+// reused like a free slot, but does not end a lookup. Keys 0-99 are the folders,
+// the other keys up to 0xfe are free for other users (e.g. a hash of the card UID).
+class EepromKvStore {
+public:
+  static constexpr uint8_t slotSize = 4; // key, value (2 byte), crc
+  static constexpr uint8_t emptyKey = 0xff;
+
+  EepromKvStore(uint16_t startAddress, uint8_t slots)
+  : startAddress{startAddress}
+  , slots       {slots       }
+  {}
+
+  void clear();
+  bool read (uint8_t key, uint16_t& value);
+  void write(uint8_t key, uint16_t  value);
+
+  uint16_t endAddress() const { return address(slots); }
+
+private:
+  enum class slotState: uint8_t {
+    empty,
+    invalid,
+    used,
+  };
+
+  uint16_t address (uint8_t pos) const { return startAddress + pos * slotSize; }
+  uint8_t  homePos (uint8_t key) const { return key % slots; }
+  uint8_t  nextPos (uint8_t pos) const { return pos+1 == slots ? 0 : pos+1; }
+  static uint8_t crc8(uint8_t key, uint16_t value);
+
+  slotState stateAt(uint8_t pos, uint8_t& key, uint16_t& value);
+
+  const uint16_t startAddress;
+  const uint8_t  slots;
+};
+
+#endif // FOLDER_PROGRESS_KV
+
+#endif /* SRC_EEPROM_KV_STORE_HPP_ */
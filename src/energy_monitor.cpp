@@ -0,0 +1,145 @@
+#include "energy_monitor.hpp"
+
+#include "constants.hpp"
+
+#ifdef ENERGY_MONITOR
+#include "logger.hpp"
+
+namespace {
+
+// the voltage drop must be big enough that the noise does not matter
+constexpr uint16_t minVoltageDrop = 20; // mV
+constexpr uint16_t emptyVoltage   = batVoltageEmpty * 1000 + 0.5; // mV
+
+uint16_t current(EnergyMonitor::counter c) {
+  switch (c) {
+  case EnergyMonitor::play_low : return energyCurrentPlay[0];
+  case EnergyMonitor::play_mid : return energyCurrentPlay[1];
+  case EnergyMonitor::play_high: return energyCurrentPlay[2];
+  case EnergyMonitor::idle     : return energyCurrentIdle;
+  case EnergyMonitor::sleep    : return energyCurrentSleep;
+  case EnergyMonitor::amp_on   : return energyCurrentAmp;
+  case EnergyMonitor::ring_low : return energyCurrentRing[0];
+  case EnergyMonitor::ring_high: return energyCurrentRing[1];
+  default                      : return 0;
+  }
+}
+
+const __FlashStringHelper* counterName(uint8_t c) {
+  switch (c) {
+  case EnergyMonitor::play_low : return F("play low" );
+  case EnergyMonitor::play_mid : return F("play mid" );
+  case EnergyMonitor::play_high: return F("play high");
+  case EnergyMonitor::idle     : return F("idle"     );
+  case EnergyMonitor::sleep    : return F("sleep"    );
+  case EnergyMonitor::amp_on   : return F("amp on"   );
+  case EnergyMonitor::ring_low : return F("ring low" );
+  case EnergyMonitor::ring_high: return F("ring high");
+  default                      : return F("?"        );
+  }
+}
+
+} // anonymous namespace
+
+uint32_t               EnergyMonitor::ms[num_counters]{};
+uint32_t               EnergyMonitor::charge          {};
+uint32_t               EnergyMonitor::chargeRest      {};
+unsigned long          EnergyMonitor::lastTime        {};
+EnergyMonitor::counter EnergyMonitor::lastState       {idle};
+bool                   EnergyMonitor::lastAmpOn       {};
+uint8_t                EnergyMonitor::lastRing        {};
+uint32_t               EnergyMonitor::filtered        {};
+uint16_t               EnergyMonitor::startVoltage    {};
+uint32_t               EnergyMonitor::startCharge     {};
+
+void EnergyMonitor::add(unsigned long duration) {
+  uint32_t mA = current(lastState);
+  ms[lastState] += duration;
+  if (lastAmpOn) {
+    ms[amp_on] += duration;
+    mA += current(amp_on);
+  }
+  if (lastRing != 0) {
+    const counter ring = lastRing == 1 ? ring_low : ring_high;
+    ms[ring] += duration;
+    mA += current(ring);
+  }
+  chargeRest += mA * duration;
+  charge     += chargeRest / 1000;
+  chargeRest %= 1000;
+}
+
+void EnergyMonitor::loop(counter state, bool ampOn, uint8_t ringBrightness) {
+  const unsigned long now = millis();
+  add(now - lastTime);
+  lastTime  = now;
+  lastState = state;
+  lastAmpOn = ampOn;
+  lastRing  = ringBrightness == 0 ? 0 : ringBrightness < 0x80 ? 1 : 2;
+}
+
+void EnergyMonitor::addSleep(unsigned long duration) {
+  const counter state = lastState;
+  lastState = sleep;
+  add(duration);
+  lastState = state;
+  lastTime  = millis();
+}
+
+void EnergyMonitor::voltage(uint16_t mV) {
+  if (startVoltage == 0) {
+    filtered     = static_cast<uint32_t>(mV) * 8;
+    startVoltage = mV;
+    startCharge  = charge;
+  }
+  else
+    filtered = filtered - filtered / 8 + mV; // exponential filter 1/8
+}
+
+unsigned long EnergyMonitor::seconds(counter c) {
+  return ms[c] / 1000;
+}
+
+uint16_t EnergyMonitor::averageCurrent() {
+  uint32_t total = 0;
+  for (uint8_t s = 0; s < num_states; ++s)
+    total += ms[s];
+  return total == 0 ? 0 : static_cast<uint64_t>(charge) * 1000 / total;
+}
+
+uint32_t EnergyMonitor::usedCharge() {
+  return charge;
+}
+
+long EnergyMonitor::remainingMinutes() {
+  const uint16_t v = filtered / 8;
+  if (startVoltage == 0 || startVoltage < v + minVoltageDrop || averageCurrent() == 0)
+    return -1;
+  if (v <= emptyVoltage)
+    return 0;
+  // the voltage falls linear with the used charge
+  const uint64_t remainingCharge = static_cast<uint64_t>(v - emptyVoltage) * (charge - startCharge) / (startVoltage - v);
+  return remainingCharge / averageCurrent() / 60;
+}
+
+void EnergyMonitor::printReport() {
+  LOG(trace_log, s_info, F("energy (s):"), lf_no);
+  for (uint8_t c = 0; c < num_counters; ++c)
+    LOG(trace_log, s_info, F(" "), counterName(c), F(": "), ms[c] / 1000, lf_no);
+  LOG(trace_log, s_info, F(""));
+  LOG(trace_log, s_info, F("avg: "), averageCurrent(), F(" mA, used: "), charge / 3600, F(" mAh, bat: "), filtered / 8,
+                         F(" mV, remaining: "), remainingMinutes(), F(" min"));
+}
+
+void EnergyMonitor::clear() {
+  for (uint8_t c = 0; c < num_counters; ++c)
+    ms[c] = 0;
+  charge       = 0;
+  chargeRest   = 0;
+  lastTime     = millis();
+  filtered     = 0;
+  startVoltage = 0;
+  startCharge  = 0;
+}
+
+#endif // ENERGY_MONITOR
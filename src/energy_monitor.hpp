@@ -0,0 +1,64 @@
+#ifndef SRC_ENERGY_MONITOR_HPP_
+#define SRC_ENERGY_MONITOR_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+// accounts the time per power state (playing per volume band, idle with the card
+// reader on, light sleep) and of the consumers that run in parallel (amplifier,
+// NeoPixel ring per brightness band). The charge is estimated with the currents
+// in constants.hpp. With the filtered battery voltage the voltage drop per charge
+// gives the remaining charge and with the average current the remaining runtime.
+// Without ENERGY_MONITOR the calls compile to nothing.
+class EnergyMonitor {
+public:
+  enum counter: uint8_t {
+    play_low , // volume in the lower third of [minVolume, maxVolume]
+    play_mid ,
+    play_high,
+    idle     , // not playing, card reader polling
+    sleep    , // LIGHT_SLEEP
+    num_states,
+    amp_on    = num_states, // SPKONOFF
+    ring_low , // brightness below the half
+    ring_high,
+    num_counters,
+  };
+
+#ifdef ENERGY_MONITOR
+  // accounts the time since the last call with the state of the last call (ringBrightness 0..255)
+  static void loop(counter state, bool ampOn, uint8_t ringBrightness);
+  // time in power down (millis() may not count)
+  static void addSleep(unsigned long ms);
+  static void voltage(uint16_t mV);
+  static void printReport();
+  static void clear();
+
+  static unsigned long seconds        (counter c);
+  static uint16_t      averageCurrent (); // mA
+  static uint32_t      usedCharge     (); // mAs
+  static long          remainingMinutes(); // -1: unknown (not enough voltage drop yet)
+
+private:
+  static void add(unsigned long ms);
+
+  static uint32_t      ms[num_counters];
+  static uint32_t      charge;          // mAs
+  static uint32_t      chargeRest;      // mA*ms below 1 mAs
+  static unsigned long lastTime;
+  static counter       lastState;
+  static bool          lastAmpOn;
+  static uint8_t       lastRing;        // 0: off, 1: low, 2: high
+  static uint32_t      filtered;        // mV * 8
+  static uint16_t      startVoltage;    // mV, 0: no sample yet
+  static uint32_t      startCharge;     // mAs
+#else
+  static void loop(counter, bool, uint8_t) {}
+  static void addSleep(unsigned long) {}
+  static void voltage(uint16_t) {}
+  static void printReport() {}
+#endif // ENERGY_MONITOR
+};
+
+#endif /* SRC_ENERGY_MONITOR_HPP_ */
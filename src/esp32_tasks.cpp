@@ -0,0 +1,71 @@
+#include "esp32_tasks.hpp"
+
+#include "constants.hpp"
+
+#ifdef TonUINO_ESP32
+#include "logger.hpp"
+#include "tonuino.hpp"
+
+SemaphoreHandle_t                      Esp32Tasks::stateMutex{};
+SemaphoreHandle_t                      Esp32Tasks::cardMutex {};
+ring_buffer<Chip_card::cardRead, cardEventsSize> Esp32Tasks::cardEvents{};
+
+void Esp32Tasks::begin() {
+  stateMutex = xSemaphoreCreateMutex();
+  cardMutex  = xSemaphoreCreateMutex();
+  // the ui task has the lowest priority, the card and the DfPlayer only take a short time per period
+  xTaskCreatePinnedToCore(cardTask, "card", taskStackCard, nullptr, 2, nullptr, taskCoreIo);
+  xTaskCreatePinnedToCore(mp3Task , "mp3" , taskStackMp3 , nullptr, 2, nullptr, taskCoreIo);
+  xTaskCreatePinnedToCore(uiTask  , "ui"  , taskStackUi  , nullptr, 1, nullptr, taskCoreUi);
+  LOG(init_log, s_info, F("tasks started"));
+}
+
+void Esp32Tasks::cardTask(void *) {
+  Chip_card &chip_card = Tonuino::getTonuino().getChipCard();
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    Chip_card::cardRead card_ev;
+    {
+      Lock card{cardMutex};
+      card_ev = chip_card.pollCard();
+    }
+    if (card_ev.event != cardEvent::none && not cardEvents.push(card_ev))
+      LOG(card_log, s_error, F("card events full"));
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(cardPollTime));
+  }
+}
+
+void Esp32Tasks::mp3Task(void *) {
+  Mp3 &mp3 = Tonuino::getTonuino().getMp3();
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    {
+      // the notifications call into the Tonuino (e.g. nextTrack() from OnPlayFinished)
+      Lock state{stateMutex};
+      mp3.loop();
+#ifdef DFPLAYER_CMD_QUEUE
+      mp3.sendCommands();
+#endif
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(tickTimeMp3));
+  }
+}
+
+void Esp32Tasks::uiTask(void *) {
+  Tonuino   &tonuino   = Tonuino::getTonuino();
+  Chip_card &chip_card = tonuino.getChipCard();
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    Chip_card::cardRead card_ev{ cardEvent::none, Chip_card::readCardEvent::none, {} };
+    cardEvents.pop(card_ev);
+    {
+      Lock state{stateMutex};
+      if (card_ev.event == cardEvent::inserted)
+        chip_card.deliverCard(card_ev);
+      tonuino.loopUi(card_ev.event);
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(cycleTime));
+  }
+}
+
+#endif // TonUINO_ESP32
@@ -0,0 +1,58 @@
+#ifndef SRC_ESP32_TASKS_HPP_
+#define SRC_ESP32_TASKS_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+#ifdef TonUINO_ESP32
+#include "chip_card.hpp"
+#include "queue.hpp"
+
+// runs the cycle of the TonUINO in three FreeRTOS tasks on both cores of the ESP32 instead of in loop():
+//  - card (taskCoreIo): polls the card reader every cardPollTime ms, reads an inserted card and sends the card events
+//                       with the content to the ui task
+//  - mp3  (taskCoreIo): receives the messages of the DfPlayer (OnPlayFinished, ...) and sends the queued
+//                       commands every tickTimeMp3 ms
+//  - ui   (taskCoreUi): buttons, state machine with the card events, modifiers, ring and settings every cycleTime ms
+// So the SPI to the card reader does not delay the buttons and the DfPlayer and vice versa. The card events go
+// through a lock-free ring buffer. Tonuino, Mp3 and Chip_card are not thread safe: the ui task and the mp3 task
+// take the state lock, the card task takes the card lock. The ui task takes the card lock only while the state
+// machine writes a card (CardLock in Chip_card). The locks are always taken in this order (state, card).
+// LOG writes directly to Serial (the UART driver of the ESP32 is locked), the lines of two tasks can interleave.
+class Esp32Tasks {
+private:
+  class Lock {
+  public:
+    Lock(SemaphoreHandle_t mutex): mutex{mutex} { xSemaphoreTake(mutex, portMAX_DELAY); }
+    ~Lock() { xSemaphoreGive(mutex); }
+  private:
+    SemaphoreHandle_t mutex;
+  };
+
+public:
+  // creates the tasks, after Tonuino::setup(). Then loop() has nothing to do anymore.
+  static void begin();
+
+  // the card lock for the calls of the ui task into Chip_card (writeCard())
+  class CardLock {
+  public:
+    CardLock(): lock{cardMutex} {}
+  private:
+    Lock lock;
+  };
+
+private:
+
+  static void cardTask(void *);
+  static void mp3Task (void *);
+  static void uiTask  (void *);
+
+  static SemaphoreHandle_t                       stateMutex;
+  static SemaphoreHandle_t                       cardMutex;
+  static ring_buffer<Chip_card::cardRead, cardEventsSize> cardEvents;
+};
+
+#endif // TonUINO_ESP32
+
+#endif /* SRC_ESP32_TASKS_HPP_ */
@@ -0,0 +1,52 @@
+#ifndef SRC_EVENT_QUEUE_HPP_
+#define SRC_EVENT_QUEUE_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+// events for SM_tonuino in front of the dispatch, the highest priority first and
+// in the order of arrival within a priority. The producers are polled in the cycle
+// and the queue is emptied in the same cycle, so it needs one entry per producer.
+template<uint8_t N>
+class event_queue {
+public:
+  enum priority: uint8_t {
+    p_command, // Buttons, Buttons3x3, RotaryEncoder, Poti, SerialInput
+    p_card   , // card inserted/removed
+  };
+  struct event {
+    priority      prio;
+    uint8_t       value; // commandRaw or cardEvent
+  };
+
+  // false if the queue is full
+  bool push(priority prio, uint8_t value) {
+    if (s == N)
+      return false;
+    uint8_t pos = s;
+    while (pos > 0 && e[pos-1].prio < prio) {
+      e[pos] = e[pos-1];
+      --pos;
+    }
+    e[pos] = { prio, value };
+    ++s;
+    return true;
+  }
+  bool pop(event &ev) {
+    if (s == 0)
+      return false;
+    ev = e[0];
+    --s;
+    for (uint8_t i = 0; i < s; ++i)
+      e[i] = e[i+1];
+    return true;
+  }
+  uint8_t  size   () const { return s; }
+
+private:
+  event    e[N]{};
+  uint8_t  s{};
+};
+
+#endif /* SRC_EVENT_QUEUE_HPP_ */
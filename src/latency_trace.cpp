@@ -0,0 +1,78 @@
+#include "latency_trace.hpp"
+
+#include "constants.hpp"
+
+#ifdef LATENCY_TRACE
+#include "logger.hpp"
+
+unsigned long LatencyTrace::startTime                                      {};
+bool          LatencyTrace::active                                         {};
+uint16_t      LatencyTrace::current[num_stages]                            {};
+uint16_t      LatencyTrace::history[latencyTraceHistory][num_stages]       {};
+uint8_t       LatencyTrace::historyPos                                     {};
+uint8_t       LatencyTrace::historyCount                                   {};
+
+void LatencyTrace::mark(stage s) {
+  if (s == card_detected) {
+    startTime = millis();
+    active    = true;
+    for (uint8_t i = 0; i < num_stages; ++i)
+      current[i] = not_reached;
+  }
+  if (not active || current[s] != not_reached)
+    return;
+  // busy pin is only meaningful after the new track was sent to the DfPlayer
+  if (s == busy_active && current[play_current] == not_reached)
+    return;
+
+  current[s] = min(millis() - startTime, static_cast<unsigned long>(not_reached-1));
+  LOG(trace_log, s_debug, stageName(s), F(": "), current[s]);
+
+  if (s == busy_active) {
+    active = false;
+    for (uint8_t i = 0; i < num_stages; ++i)
+      history[historyPos][i] = current[i];
+    historyPos = (historyPos+1) % latencyTraceHistory;
+    if (historyCount < latencyTraceHistory)
+      ++historyCount;
+  }
+}
+
+void LatencyTrace::printSummary() {
+  LOG(trace_log, s_info, F("latency (min/avg/max ms) over "), historyCount, F(" plays"));
+  for (uint8_t s = card_read; s < num_stages; ++s) {
+    uint16_t minV  = not_reached;
+    uint16_t maxV  = 0;
+    uint32_t sum   = 0;
+    uint8_t  count = 0;
+    for (uint8_t h = 0; h < historyCount; ++h) {
+      const uint16_t v = history[h][s];
+      if (v == not_reached)
+        continue;
+      minV = min(minV, v);
+      maxV = max(maxV, v);
+      sum += v;
+      ++count;
+    }
+    if (count == 0) {
+      LOG(trace_log, s_info, stageName(s), F(": -"));
+    }
+    else {
+      LOG(trace_log, s_info, stageName(s), F(": "), minV, F("/"), sum/count, F("/"), maxV);
+    }
+  }
+}
+
+const __FlashStringHelper* LatencyTrace::stageName(uint8_t s) {
+  switch (s) {
+  case card_detected  : return F("card detected");
+  case card_read      : return F("card read"    );
+  case card_dispatched: return F("dispatched"   );
+  case play_folder    : return F("play folder"  );
+  case play_current   : return F("play current" );
+  case busy_active    : return F("busy active"  );
+  }
+  return F("?");
+}
+
+#endif // LATENCY_TRACE
@@ -0,0 +1,44 @@
+#ifndef SRC_LATENCY_TRACE_HPP_
+#define SRC_LATENCY_TRACE_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+// measures the time from detecting a card until the DfPlayer starts to play.
+// All stages are relative to card_detected. Without LATENCY_TRACE the calls
+// compile to nothing.
+class LatencyTrace {
+public:
+  enum stage: uint8_t {
+    card_detected  , // Chip_card::getCardEvent() detected a new card
+    card_read      , // Chip_card::readCard() finished auth and read
+    card_dispatched, // SM_tonuino::dispatch(card_e) returned
+    play_folder    , // Tonuino::playFolder() was called
+    play_current   , // Mp3::playCurrent() sent the track to the DfPlayer
+    busy_active    , // busy pin of the DfPlayer is active
+    num_stages     ,
+  };
+
+#ifdef LATENCY_TRACE
+  static void mark(stage s);
+  static void printSummary();
+
+private:
+  static constexpr uint16_t not_reached = 0xffff;
+
+  static const __FlashStringHelper* stageName(uint8_t s);
+
+  static unsigned long startTime;
+  static bool          active;
+  static uint16_t      current[num_stages];
+  static uint16_t      history[latencyTraceHistory][num_stages];
+  static uint8_t       historyPos;
+  static uint8_t       historyCount;
+#else
+  static void mark(stage) {}
+  static void printSummary() {}
+#endif // LATENCY_TRACE
+};
+
+#endif /* SRC_LATENCY_TRACE_HPP_ */
@@ -9,8 +9,10 @@ linearAnalogKeypad::linearAnalogKeypad(uint8_t pin, uint16_t keyNum, int16_t max
 }
 
 unsigned char linearAnalogKeypad::getKey() {
-	const int16_t analogValue = analogRead(keypadPin);
+	return getKey(analogRead(keypadPin));
+}
 
+unsigned char linearAnalogKeypad::getKey(int16_t analogValue) {
 	uint16_t keyId = static_cast<int32_t>(analogValue+maxLevel/keyNum/2)*keyNum/maxLevel;
 	keyId = min(keyId, keyNum);
 
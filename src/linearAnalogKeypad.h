@@ -23,6 +23,7 @@ class linearAnalogKeypad
 	public:
 		linearAnalogKeypad(uint8_t pin, uint16_t keyNum, int16_t maxLevel, unsigned long longPressTime);
 		unsigned char getKey();
+		unsigned char getKey(int16_t analogValue);
 };
 
 #endif
@@ -3,7 +3,9 @@
 
 #include <Arduino.h>
 
+#include "constants.hpp"
 #include "type_traits.hpp"
+#include "log_buffer.hpp"
 
 #define DEFINE_LOGGER(Logger_, MinSeverity_, Forwarder_)                         \
   struct Logger_ : public logger_base<Logger_, MinSeverity_, Forwarder_>         \
@@ -31,6 +33,15 @@ enum lineFeed: uint8_t {
 
 extern const __FlashStringHelper* getSeverityName(severity sev);
 
+// all log output goes through logOut(), each record ends with logEndRecord()
+#ifdef BUFFERED_LOG
+inline Print&            logOut      () { return LogBuffer::getLogBuffer(); }
+inline void              logEndRecord() { LogBuffer::getLogBuffer().commit(); }
+#else
+inline decltype(Serial)& logOut      () { return Serial; }
+inline void              logEndRecord() {}
+#endif
+
 class logger {
 public:
   constexpr static bool will_log(severity) {
@@ -39,11 +50,12 @@ public:
 
   static void log(lineFeed lf = lf_yes) {
     if (lf == lf_yes)
-      Serial.println();
+      logOut().println();
+    logEndRecord();
   }
   template<typename T, typename ... Types>
   static void log(T t, Types ... types) {
-    Serial.print(t);
+    logOut().print(t);
     log(types...);
   }
 
@@ -60,6 +72,79 @@ public:
 
 };
 
+// sends each log record in a compact binary form instead of text (decode with tools/decode_binary_log.py):
+//   recordStart, severity, token of the logger name, arguments..., t_end_lf or t_end
+// F() strings are sent as token (the 16 bit address of the string in flash), numbers are sent raw
+class binary_logger {
+public:
+  enum tag: uint8_t {
+    t_flash     = 0x01, // + 2 byte token
+    t_string    = 0x02, // + zero terminated string
+    t_char      = 0x03, // + 1 byte
+    t_float     = 0x04, // + 4 byte float
+    t_unsigned  = 0x10, // | size, + size byte little endian
+    t_signed    = 0x20, // | size, + size byte little endian
+    t_end       = 0x7e,
+    t_end_lf    = 0x7f,
+  };
+  static constexpr uint8_t recordStart = 0xa5;
+
+  constexpr static bool will_log(severity) {
+    return true;
+  }
+
+  template<severity Severity, typename ... Types>
+  static void log(const __FlashStringHelper* logname, Types ... types) {
+    logOut().write(recordStart);
+    logOut().write(static_cast<uint8_t>(Severity));
+    writeToken(logname);
+    put(types...);
+  }
+
+private:
+  static void put(lineFeed lf = lf_yes) {
+    logOut().write(lf == lf_yes ? t_end_lf : t_end);
+    logEndRecord();
+  }
+  template<typename T, typename ... Types>
+  static void put(T t, Types ... types) {
+    putArg(t);
+    put(types...);
+  }
+
+  static void writeToken(const __FlashStringHelper* s) {
+    const uint16_t token = static_cast<uint16_t>(reinterpret_cast<uintptr_t>(s));
+    logOut().write(reinterpret_cast<const uint8_t*>(&token), sizeof token);
+  }
+  static void writeRaw(uint8_t t, const void* value, uint8_t size) {
+    logOut().write(t);
+    logOut().write(reinterpret_cast<const uint8_t*>(value), size);
+  }
+
+  static void putArg(const __FlashStringHelper* s) {
+    logOut().write(t_flash);
+    writeToken(s);
+  }
+#ifndef UNIT_TESTS // in the unit tests __FlashStringHelper is char
+  static void putArg(const char* s) {
+    logOut().write(t_string);
+    logOut().write(s);
+    logOut().write(static_cast<uint8_t>(0));
+  }
+  static void putArg(char c) {
+    writeRaw(t_char, &c, 1);
+  }
+#endif
+  static void putArg(double d) {
+    const float f = d;
+    writeRaw(t_float, &f, sizeof f);
+  }
+  template<typename T>
+  static void putArg(T t) {
+    writeRaw(static_cast<uint8_t>((T(-1) < T(0) ? t_signed : t_unsigned) | sizeof t), &t, sizeof t);
+  }
+};
+
 template<typename Derived, severity MinSeverity, class FwdLogger>
 class logger_base {
 public:
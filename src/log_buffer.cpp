@@ -0,0 +1,43 @@
+#include "log_buffer.hpp"
+
+#ifdef BUFFERED_LOG
+#include "logger.hpp"
+
+LogBuffer LogBuffer::logBuffer{};
+
+size_t LogBuffer::write(uint8_t c) {
+  if (not buffered)
+    return Serial.write(c);
+  if (overflow)
+    return 0;
+  if (static_cast<uint8_t>(wr - tail) >= logBufferSize) {
+    overflow = true;
+    return 0;
+  }
+  buffer[wr++ & (logBufferSize-1)] = c;
+  return 1;
+}
+
+void LogBuffer::commit() {
+  if (overflow) {
+    wr       = head;
+    overflow = false;
+    if (droppedRecords != 0xffff)
+      ++droppedRecords;
+  }
+  else
+    head = wr;
+}
+
+bool LogBuffer::drain() {
+  while (tail != head && Serial.availableForWrite() > 0)
+    Serial.write(buffer[tail++ & (logBufferSize-1)]);
+  if (tail == head && droppedRecords != 0) {
+    const uint16_t d = droppedRecords;
+    droppedRecords = 0;
+    LOG(trace_log, s_warning, F("log dropped: "), d);
+  }
+  return tail != head;
+}
+
+#endif // BUFFERED_LOG
@@ -0,0 +1,45 @@
+#ifndef SRC_LOG_BUFFER_HPP_
+#define SRC_LOG_BUFFER_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+#ifdef BUFFERED_LOG
+// sink of the log: the records are written to a ring buffer in RAM and sent by
+// drain() in the idle time of the cycle, so that a log call never waits for the
+// serial TX. A record that does not fit completely into the buffer is dropped
+// and counted, the count is logged as soon as the buffer is empty again. Until
+// setBuffered(true) the bytes are sent directly (e.g. the log of the setup).
+class LogBuffer: public Print {
+public:
+  static LogBuffer& getLogBuffer() { return logBuffer; }
+
+  using Print::write;
+  size_t write(uint8_t c) override;
+
+  // end of a log record: makes it visible to drain() or drops it on overflow
+  void     commit();
+  // sends as much as the TX buffer takes without blocking, true if bytes are left
+  bool     drain();
+  void     setBuffered(bool b) { buffered = b; }
+
+  uint8_t  size   () const { return head - tail; }
+  uint16_t dropped() const { return droppedRecords; }
+
+private:
+  static_assert(logBufferSize > 0 && logBufferSize <= 128 && (logBufferSize & (logBufferSize-1)) == 0,
+                "logBufferSize must be a power of 2 and at most 128");
+  static LogBuffer logBuffer;
+
+  uint8_t  buffer[logBufferSize]{};
+  uint8_t  wr            {}; // next write position of the current record
+  uint8_t  head          {}; // end of the last committed record
+  uint8_t  tail          {}; // next byte to send
+  bool     overflow      {};
+  bool     buffered      {};
+  uint16_t droppedRecords{};
+};
+#endif // BUFFERED_LOG
+
+#endif /* SRC_LOG_BUFFER_HPP_ */
@@ -1,9 +1,14 @@
 #ifndef SRC_LOGGER_HPP_
 #define SRC_LOGGER_HPP_
 
+#include "constants.hpp"
 #include "log.hpp"
 
+#ifdef BINARY_LOGGER
+DEFINE_LOGGER(tonuino_log , s_debug  , binary_logger);
+#else
 DEFINE_LOGGER(tonuino_log , s_debug  , void);
+#endif
 
 DEFINE_LOGGER(init_log    , s_info   , tonuino_log);
 DEFINE_LOGGER(card_log    , s_info   , tonuino_log);
@@ -15,5 +20,6 @@ DEFINE_LOGGER(modifier_log, s_warning, tonuino_log);
 DEFINE_LOGGER(mp3_log     , s_info   , tonuino_log);
 DEFINE_LOGGER(settings_log, s_info   , tonuino_log);
 DEFINE_LOGGER(batvol_log  , s_info   , tonuino_log);
+DEFINE_LOGGER(trace_log   , s_info   , tonuino_log);
 
 #endif /* SRC_LOGGER_HPP_ */
@@ -0,0 +1,65 @@
+#include "loop_profiler.hpp"
+
+#include "constants.hpp"
+
+#ifdef LOOP_PROFILER
+#include "logger.hpp"
+
+uint16_t LoopProfiler::histogram[num_sections][loopProfilerBuckets] {};
+uint16_t LoopProfiler::overrun  [num_sections]                      {};
+uint16_t LoopProfiler::cardPollInterval                             {};
+
+void LoopProfiler::add(section s, unsigned long duration_us) {
+  uint8_t       bucket = 0;
+  unsigned long limit  = 1ul << loopProfilerFirstBucket;
+  while (bucket < loopProfilerBuckets-1 && duration_us >= limit) {
+    ++bucket;
+    limit <<= 1;
+  }
+  // saturate instead of overflow
+  if (histogram[s][bucket] != 0xffff)
+    ++histogram[s][bucket];
+  if (duration_us > cycleTime * 1000ul && overrun[s] != 0xffff)
+    ++overrun[s];
+}
+
+void LoopProfiler::clear() {
+  for (uint8_t s = 0; s < num_sections; ++s) {
+    for (uint8_t b = 0; b < loopProfilerBuckets; ++b)
+      histogram[s][b] = 0;
+    overrun[s] = 0;
+  }
+}
+
+void LoopProfiler::printSummary() {
+  LOG(trace_log, s_info, F("loop profile (us buckets from <"), 1ul << loopProfilerFirstBucket, F(", x2 each)"));
+  for (uint8_t s = 0; s < num_sections; ++s) {
+    LOG(trace_log, s_info, sectionName(s), F(":"), lf_no);
+    for (uint8_t b = 0; b < loopProfilerBuckets; ++b)
+      LOG(trace_log, s_info, F(" "), histogram[s][b], lf_no);
+    LOG(trace_log, s_info, F(" overruns: "), overrun[s]);
+  }
+#ifdef ADAPTIVE_CARD_POLL
+  LOG(trace_log, s_info, F("card poll: "), cardPollInterval, F(" ms"));
+#endif
+  clear();
+}
+
+const __FlashStringHelper* LoopProfiler::sectionName(uint8_t s) {
+  switch (s) {
+  case housekeeping: return F("housekeeping");
+  case bat_voltage : return F("bat voltage" );
+  case mp3         : return F("mp3"         );
+  case modifier    : return F("modifier"    );
+  case commands    : return F("commands"    );
+  case card        : return F("card"        );
+  case ring        : return F("ring"        );
+  case send_mp3    : return F("send mp3"    );
+  case card_auth   : return F("card auth"   );
+  case card_payload: return F("card payload");
+  case cycle       : return F("cycle"       );
+  }
+  return F("?");
+}
+
+#endif // LOOP_PROFILER
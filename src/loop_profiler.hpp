@@ -0,0 +1,68 @@
+#ifndef SRC_LOOP_PROFILER_HPP_
+#define SRC_LOOP_PROFILER_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+// measures the run time of the parts of Tonuino::loop() with micros() and counts
+// it in a log2 histogram per section (bucket 0: < 2^loopProfilerFirstBucket us,
+// every further bucket doubles, the last one counts all longer runs). A run longer
+// than cycleTime is counted as overrun. Without LOOP_PROFILER the sections compile
+// to nothing.
+class LoopProfiler {
+public:
+  enum section: uint8_t {
+    housekeeping,
+    bat_voltage ,
+    mp3         ,
+    modifier    ,
+    commands    ,
+    card        ,
+    ring        ,
+    send_mp3    ,
+    card_auth   , // Chip_card: authentication of a card (part of card)
+    card_payload, // Chip_card: MIFARE read/write of the payload (part of card)
+    cycle       , // the whole loop without the delay
+    num_sections,
+  };
+
+#ifdef LOOP_PROFILER
+  // measures the scope of the object
+  class Section {
+  public:
+    Section(section s): s{s}, start{micros()} {}
+    ~Section() { add(s, micros() - start); }
+  private:
+    const section       s;
+    const unsigned long start;
+  };
+
+  static void add(section s, unsigned long duration_us);
+  static void printSummary();
+  static void clear();
+
+  static uint16_t count   (section s, uint8_t bucket) { return histogram[s][bucket]; }
+  static uint16_t overruns(section s)                 { return overrun[s]; }
+
+  // the current interval of the adaptive card poll in ms (0: every cycle), printed with the summary
+  static void setCardPollInterval(uint16_t interval) { cardPollInterval = interval; }
+
+private:
+  static const __FlashStringHelper* sectionName(uint8_t s);
+
+  static uint16_t histogram[num_sections][loopProfilerBuckets];
+  static uint16_t overrun  [num_sections];
+  static uint16_t cardPollInterval;
+#else
+  class Section {
+  public:
+    Section(section) {}
+  };
+
+  static void printSummary() {}
+  static void setCardPollInterval(uint16_t) {}
+#endif // LOOP_PROFILER
+};
+
+#endif /* SRC_LOOP_PROFILER_HPP_ */
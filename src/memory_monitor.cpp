@@ -0,0 +1,69 @@
+#include "memory_monitor.hpp"
+
+#include "constants.hpp"
+
+#ifdef MEMORY_MONITOR
+#include "logger.hpp"
+#include "timer.hpp"
+
+#ifdef __AVR__
+extern uint8_t  __data_start;
+extern uint8_t  __data_end;
+extern uint8_t  __bss_start;
+extern uint8_t  __bss_end;
+extern uint8_t  __heap_start;
+extern uint8_t* __brkval;
+
+// runs after the stack pointer is set up and before .data/.bss are initialized,
+// so the whole RAM behind .bss is free. No stack is used here (naked).
+void paintRam() __attribute__ ((naked, used, section(".init3")));
+void paintRam() {
+  for (uint8_t* p = &__heap_start; p < reinterpret_cast<uint8_t*>(RAMEND); ++p)
+    *p = MemoryMonitor::paintPattern;
+}
+
+namespace {
+uint8_t* heapEnd() { return __brkval ? __brkval : &__heap_start; }
+// first byte above the heap that is not painted any more (lowest stack address so far)
+uint8_t* stackLow() {
+  uint8_t* p = heapEnd();
+  return p + MemoryMonitor::painted(p, reinterpret_cast<uint8_t*>(RAMEND));
+}
+}
+
+uint16_t MemoryMonitor::dataSize () { return &__data_end - &__data_start; }
+uint16_t MemoryMonitor::bssSize  () { return &__bss_end  - &__bss_start ; }
+uint16_t MemoryMonitor::freeGap  () { uint8_t top; return &top - heapEnd(); }
+uint16_t MemoryMonitor::stackMax () { return reinterpret_cast<uint8_t*>(RAMEND) - stackLow() + 1; }
+uint16_t MemoryMonitor::neverUsed() { return stackLow() - heapEnd(); }
+#else
+uint16_t MemoryMonitor::dataSize () { return 0; }
+uint16_t MemoryMonitor::bssSize  () { return 0; }
+uint16_t MemoryMonitor::freeGap  () { return 0; }
+uint16_t MemoryMonitor::stackMax () { return 0; }
+uint16_t MemoryMonitor::neverUsed() { return 0; }
+#endif // __AVR__
+
+uint16_t MemoryMonitor::painted(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* p = begin;
+  while (p < end && *p == paintPattern)
+    ++p;
+  return p - begin;
+}
+
+void MemoryMonitor::printReport() {
+  LOG(trace_log, s_info, F("RAM data: "), dataSize(), F(" bss: "), bssSize(), F(" free: "), freeGap(),
+                         F(" stack max: "), stackMax(), F(" never used: "), neverUsed());
+}
+
+void MemoryMonitor::loop() {
+  if constexpr (memoryMonitorLogInterval > 0) {
+    static Timer timer{};
+    if (not timer.isActive() || timer.isExpired()) {
+      timer.start(memoryMonitorLogInterval);
+      printReport();
+    }
+  }
+}
+
+#endif // MEMORY_MONITOR
@@ -0,0 +1,34 @@
+#ifndef SRC_MEMORY_MONITOR_HPP_
+#define SRC_MEMORY_MONITOR_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+// reports the RAM usage: size of .data and .bss, the current gap between heap
+// and stack and the high water mark of the stack. The free RAM is painted with a
+// pattern before the constructors run (AVR .init3), the stack high water mark is
+// the lowest address where the pattern was overwritten. On other platforms (unit
+// tests) all values are 0. Without MEMORY_MONITOR the calls compile to nothing.
+class MemoryMonitor {
+public:
+#ifdef MEMORY_MONITOR
+  static void     printReport();
+  static void     loop();
+
+  static uint16_t dataSize ();
+  static uint16_t bssSize  ();
+  static uint16_t freeGap  (); // between the end of the heap and the stack pointer
+  static uint16_t stackMax (); // max. used stack since boot
+  static uint16_t neverUsed(); // bytes between heap and stack that were never touched
+
+  static constexpr uint8_t paintPattern = 0xc5;
+  // number of bytes from begin that still have the paintPattern (the stack grows down to the first other one)
+  static uint16_t painted  (const uint8_t* begin, const uint8_t* end);
+#else
+  static void printReport() {}
+  static void loop() {}
+#endif // MEMORY_MONITOR
+};
+
+#endif /* SRC_MEMORY_MONITOR_HPP_ */
@@ -10,13 +10,22 @@ namespace {
 Tonuino        &tonuino   = Tonuino::getTonuino();
 Mp3            &mp3       = tonuino.getMp3();
 
+#ifndef DISABLE_SLEEP_TIMER
 const __FlashStringHelper* str_SleepTimer          () { return F("SleepTimer")  ; }
+#endif
+#ifndef DISABLE_DANCE_GAME
 const __FlashStringHelper* str_danceGame           () { return F("DanceGame") ; }
+#endif
+#ifndef DISABLE_KINDERGARDEN_MODE
 const __FlashStringHelper* str_KindergardenMode    () { return F("Kita")        ; }
+#endif
+#ifndef DISABLE_REPEAT_SINGLE
 const __FlashStringHelper* str_RepeatSingleModifier() { return F("RepeatSingle"); }
+#endif
 
 } // anonymous namespace
 
+#ifndef DISABLE_SLEEP_TIMER
 void SleepTimer::loop() {
   if (sleepTimer.isActive() && sleepTimer.isExpired()) {
     LOG(modifier_log, s_info, str_SleepTimer(), F(" -> expired"));
@@ -73,8 +82,10 @@ bool SleepTimer::handleRFID(const folderSettings &/*newCard*/) {
   }
   return false;
 }
+#endif // DISABLE_SLEEP_TIMER
 
 
+#ifndef DISABLE_DANCE_GAME
 void DanceGame::init(pmode_t a_mode, uint8_t a_t) {
   LOG(modifier_log, s_info, str_danceGame(), F("t : "), a_t);
   mode = a_mode;
@@ -124,11 +135,13 @@ void DanceGame::setNextStop(bool addAdvTime) {
   LOG(modifier_log, s_info, str_danceGame(), F(" next stop in "), seconds);
   stopTimer.start(seconds * 1000);
 }
+#endif // DISABLE_DANCE_GAME
 
+#ifndef DISABLE_KINDERGARDEN_MODE
 bool KindergardenMode::handleNext() {
-  if (cardQueued) {
+  folderSettings nextCard;
+  if (nextCards.pop(nextCard)) {
     LOG(modifier_log, s_info, str_KindergardenMode(), F(" -> NEXT"));
-    cardQueued = false;
 
     tonuino.setMyFolder(nextCard, true /*myFolderIsCard*/);
     LOG(modifier_log, s_debug, F("Folder: "), nextCard.folder, F(" Mode: "), static_cast<uint8_t>(nextCard.mode));
@@ -142,11 +155,20 @@ bool KindergardenMode::handleRFID(const folderSettings &newCard) {
   if (!mp3.isPlaying())
     return false;
 
-  if (!cardQueued) {
-    LOG(modifier_log, s_info, str_KindergardenMode(), F(" -> queued!"));
-    nextCard = newCard;
-    cardQueued = true;
+  for (uint8_t i = 0; i < nextCards.size(); ++i) {
+    if (nextCards.peek(i) == newCard) {
+      LOG(modifier_log, s_info, str_KindergardenMode(), F(" -> already queued"));
+      return true;
+    }
+  }
+  if (nextCards.push(newCard)) {
+    LOG(modifier_log, s_info, str_KindergardenMode(), F(" -> queued "), nextCards.size());
+#ifdef KINDERGARDEN_QUEUE_ANNOUNCE
+    mp3.playAdvertisement(nextCards.size());
+#endif
   }
+  else
+    LOG(modifier_log, s_info, str_KindergardenMode(), F(" -> queue full"));
   return true;
 }
 
@@ -157,8 +179,9 @@ bool KindergardenMode::handleButton(command cmd) {
   }
   return false;
 }
+#endif // DISABLE_KINDERGARDEN_MODE
 
-
+#ifndef DISABLE_REPEAT_SINGLE
 bool RepeatSingleModifier::handleNext() {
   LOG(modifier_log, s_info, str_RepeatSingleModifier(), F(" -> REPEAT"));
   mp3.loop(); // WA: this will call again Mp3Notify::OnPlayFinished() (error in DFMiniMp3 lib)
@@ -170,3 +193,4 @@ bool RepeatSingleModifier::handleNext() {
 bool RepeatSingleModifier::handlePrevious() {
   return handleNext();
 }
+#endif // DISABLE_REPEAT_SINGLE
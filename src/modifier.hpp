@@ -7,37 +7,39 @@
 #include "logger.hpp"
 #include "timer.hpp"
 #include "commands.hpp"
+#include "queue.hpp"
 
 class Tonuino;
 class Mp3;
 struct folderSettings;
 
+// base of all modifiers with the default behavior. The calls are not virtual, the
+// active modifier is selected by Modifiers (below).
 class Modifier {
 public:
   Modifier() {}
-  //virtual ~Modifier() {}
-  virtual void loop                () {}
-  virtual bool handleNext          () { return false; }
-  virtual bool handlePrevious      () { return false; }
-  virtual bool handleButton(command ) { return false; }
-  virtual bool handleRFID(const folderSettings&)
-                                      { return false; }
-  virtual pmode_t getActive        () { return pmode_t::none; }
-  virtual void init         (pmode_t, uint8_t) {}
+  void loop                () {}
+  bool handleNext          () { return false; }
+  bool handlePrevious      () { return false; }
+  bool handleButton(command ) { return false; }
+  bool handleRFID(const folderSettings&)
+                              { return false; }
+  void init         (pmode_t, uint8_t) {}
 
   Modifier& operator=(const Modifier&) = delete;
 };
 
+#ifndef DISABLE_SLEEP_TIMER
 class SleepTimer: public Modifier {
 public:
   SleepTimer() {}
-  void   loop       () final;
-  bool   handleNext () final;
-  bool handleButton(command cmd                  ) final;
-  bool handleRFID  (const folderSettings &newCard) final;
+  void   loop       ();
+  bool   handleNext ();
+  bool handleButton(command cmd                  );
+  bool handleRFID  (const folderSettings &newCard);
 
-  pmode_t getActive () final { return pmode_t::sleep_timer; }
-  void   init(pmode_t, uint8_t) final;
+  pmode_t getActive () { return pmode_t::sleep_timer; }
+  void   init(pmode_t, uint8_t);
 
 private:
   Timer sleepTimer{};
@@ -45,14 +47,16 @@ private:
   bool  stopAfterTrackFinished_active{};
   bool  fired{};
 };
+#endif // DISABLE_SLEEP_TIMER
 
+#ifndef DISABLE_DANCE_GAME
 class DanceGame: public Modifier {
 public:
   DanceGame() {}
-  void   loop       () final;
+  void   loop       ();
 
-  pmode_t getActive ()        final { return mode; }
-  void   init(pmode_t, uint8_t) final;
+  pmode_t getActive ()        { return mode; }
+  void   init(pmode_t, uint8_t);
 
   static constexpr uint8_t minSecondsBetweenStops[]      = {15, 25, 35};
   static constexpr uint8_t maxSecondsBetweenStops[]      = {30, 40, 50};
@@ -67,36 +71,108 @@ private:
   uint8_t lastFiWaAi{};
   uint8_t t{0};
 };
+#endif // DISABLE_DANCE_GAME
 
+#ifndef DISABLE_TODDLER_MODE
 class ToddlerMode: public Modifier {
 public:
   ToddlerMode() {}
-  bool handleButton(command) final { LOG(modifier_log, s_debug, F("ToddlerMode::Button -> LOCKED!")); return true; }
+  bool handleButton(command) { LOG(modifier_log, s_debug, F("ToddlerMode::Button -> LOCKED!")); return true; }
 
-  pmode_t getActive()        final { return pmode_t::toddler; }
+  pmode_t getActive()        { return pmode_t::toddler; }
 };
+#endif // DISABLE_TODDLER_MODE
 
+#ifndef DISABLE_KINDERGARDEN_MODE
 class KindergardenMode: public Modifier {
 public:
   KindergardenMode() {}
-  bool handleNext  (                           ) final;
-  bool handleButton(command cmd                ) final;
-  bool handleRFID  (const folderSettings &newCard) final;
+  bool handleNext  (                           );
+  bool handleButton(command cmd                );
+  bool handleRFID  (const folderSettings &newCard);
 
-  pmode_t getActive (                          ) final { return pmode_t::kindergarden; }
-  void   init       (pmode_t, uint8_t          ) final { cardQueued = false; }
+  pmode_t getActive (                          ) { return pmode_t::kindergarden; }
+  void   init       (pmode_t, uint8_t          ) { nextCards.clear(); }
 
 private:
-  folderSettings nextCard{};
-  bool cardQueued{false};
+  ring_buffer<folderSettings, kindergardenQueueSize> nextCards{};
 };
+#endif // DISABLE_KINDERGARDEN_MODE
 
+#ifndef DISABLE_REPEAT_SINGLE
 class RepeatSingleModifier: public Modifier {
 public:
   RepeatSingleModifier() {}
-  bool   handleNext    () final;
-  bool   handlePrevious() final;
-  pmode_t getActive    () final { return pmode_t::repeat_single; }
+  bool   handleNext    ();
+  bool   handlePrevious();
+  pmode_t getActive    () { return pmode_t::repeat_single; }
+};
+#endif // DISABLE_REPEAT_SINGLE
+
+// the modifiers that are compiled in (see DISABLE_SLEEP_TIMER ... in constants.hpp).
+// The calls go with a switch on the active mode to the modifier (no vtable, no
+// indirect call), a modifier that is not compiled in needs neither flash nor RAM.
+class Modifiers {
+public:
+  // false if the mode is no modifier or not compiled in, then the active modifier is kept
+  bool    activate(pmode_t mode, uint8_t special) {
+    const pmode_t previous = active;
+    active = mode;
+    if (visit([&](auto &m) { m.init(mode, special); return true; }))
+      return true;
+    active = previous;
+    return false;
+  }
+  void    reset   () { active = pmode_t::none; }
+  pmode_t getActive() const { return active; }
+
+  void loop                       () {        visit([&](auto &m) { m.loop(); return true; }); }
+  bool handleNext                 () { return visit([&](auto &m) { return m.handleNext    (); }); }
+  bool handlePrevious             () { return visit([&](auto &m) { return m.handlePrevious(); }); }
+  bool handleButton(command cmd   ) { return visit([&](auto &m) { return m.handleButton(cmd); }); }
+  bool handleRFID(const folderSettings &newCard)
+                                    { return visit([&](auto &m) { return m.handleRFID(newCard); }); }
+
+private:
+  template<class F>
+  bool visit(F f) {
+    switch (active) {
+#ifndef DISABLE_SLEEP_TIMER
+    case pmode_t::sleep_timer  : return f(sleepTimer          );
+#endif
+#ifndef DISABLE_DANCE_GAME
+    case pmode_t::freeze_dance :
+    case pmode_t::fi_wa_ai     : return f(danceGame           );
+#endif
+#ifndef DISABLE_TODDLER_MODE
+    case pmode_t::toddler      : return f(toddlerMode         );
+#endif
+#ifndef DISABLE_KINDERGARDEN_MODE
+    case pmode_t::kindergarden : return f(kindergardenMode    );
+#endif
+#ifndef DISABLE_REPEAT_SINGLE
+    case pmode_t::repeat_single: return f(repeatSingleModifier);
+#endif
+    default                    : return false;
+    }
+  }
+
+  pmode_t              active              {pmode_t::none};
+#ifndef DISABLE_SLEEP_TIMER
+  SleepTimer           sleepTimer          {};
+#endif
+#ifndef DISABLE_DANCE_GAME
+  DanceGame            danceGame           {};
+#endif
+#ifndef DISABLE_TODDLER_MODE
+  ToddlerMode          toddlerMode         {};
+#endif
+#ifndef DISABLE_KINDERGARDEN_MODE
+  KindergardenMode     kindergardenMode    {};
+#endif
+#ifndef DISABLE_REPEAT_SINGLE
+  RepeatSingleModifier repeatSingleModifier{};
+#endif
 };
 
 #endif /* SRC_MODIFIER_HPP_ */
@@ -2,22 +2,79 @@
 
 #include "tonuino.hpp"
 #include "constants.hpp"
+#include "latency_trace.hpp"
+#include "pin_change.hpp"
+#include "telemetry.hpp"
 
 namespace {
 
 const __FlashStringHelper* str_Space()  { return F(" ") ; }
 
+#ifdef DFPLAYER_BUSY_IRQ
+volatile bool          busyLevel    {};
+volatile bool          busyEnded    {};
+volatile bool          busyStarted  {};
+volatile unsigned long busyEndTime  {};
+volatile unsigned long busyStartTime{};
+#endif
+
+#if defined(PIN_CHANGE_IRQ) and defined(HPJACKDETECT)
+volatile bool          hpJackHigh   {}; // level of dfPlayer_noHeadphoneJackDetect
+#endif
+
 }
 
 uint16_t Mp3Notify::lastTrackFinished = 0;
+#ifdef FAST_BOOT
+bool     Mp3Notify::online            = false;
+uint16_t Mp3Notify::lastError         = 0;
+#endif
 
 void Mp3Notify::OnError(DfMp3&, uint16_t errorCode) {
   // see DfMp3_Error for code meaning
   LOG(mp3_log, s_error, F("DfPlayer Error: "), errorCode);
+  Telemetry::mp3Error(errorCode);
+#ifdef FAST_BOOT
+  lastError = errorCode;
+#endif
+#ifdef DFPLAYER_SHADOW
+  Tonuino::getTonuino().getMp3().invalidateShadow(false/*resync*/);
+#endif
+#ifdef DFPLAYER_CMD_QUEUE
+  Tonuino::getTonuino().getMp3().retryCommand(errorCode);
+#endif
+}
+void Mp3Notify::OnPlaySourceOnline  (DfMp3&, DfMp3_PlaySources source) {
+  PrintlnSourceAction(source, F("online"  ));
+#ifdef FAST_BOOT
+  online = true;
+#endif
+#ifdef DFPLAYER_SHADOW
+  Tonuino::getTonuino().getMp3().setPlaySource(source, true/*available*/);
+  Tonuino::getTonuino().getMp3().invalidateShadow(true/*resync*/);
+#endif
+}
+void Mp3Notify::OnPlaySourceInserted(DfMp3&, DfMp3_PlaySources source) {
+  PrintlnSourceAction(source, F("bereit"  ));
+#ifdef FAST_BOOT
+  online = true;
+#endif
+#ifdef DFPLAYER_SHADOW
+  Tonuino::getTonuino().getMp3().setPlaySource(source, true/*available*/);
+#endif
+#ifdef TRACK_COUNT_CACHE
+  Tonuino::getTonuino().getMp3().clearTrackCountCache();
+#endif
+}
+void Mp3Notify::OnPlaySourceRemoved (DfMp3&, DfMp3_PlaySources source) {
+  PrintlnSourceAction(source, F("entfernt"));
+#ifdef DFPLAYER_SHADOW
+  Tonuino::getTonuino().getMp3().setPlaySource(source, false/*available*/);
+#endif
+#ifdef TRACK_COUNT_CACHE
+  Tonuino::getTonuino().getMp3().clearTrackCountCache();
+#endif
 }
-void Mp3Notify::OnPlaySourceOnline  (DfMp3&, DfMp3_PlaySources source) { PrintlnSourceAction(source, F("online"  )); }
-void Mp3Notify::OnPlaySourceInserted(DfMp3&, DfMp3_PlaySources source) { PrintlnSourceAction(source, F("bereit"  )); }
-void Mp3Notify::OnPlaySourceRemoved (DfMp3&, DfMp3_PlaySources source) { PrintlnSourceAction(source, F("entfernt")); }
 void Mp3Notify::PrintlnSourceAction(DfMp3_PlaySources source, const __FlashStringHelper* action) {
   if (source & DfMp3_PlaySources_Sd   ) LOG(mp3_log, s_debug, F("SD Karte "), action);
   if (source & DfMp3_PlaySources_Usb  ) LOG(mp3_log, s_debug, F("USB "     ), action);
@@ -33,12 +90,24 @@ void Mp3Notify::OnPlayFinished(DfMp3&, DfMp3_PlaySources /*source*/, uint16_t tr
 #ifdef DFMiniMp3_IGNORE_ONPLAYFINISHED_FOR_ADV
   if (Tonuino::getTonuino().getMp3().resetPlayingAdv())
     return;
+#endif
+#ifdef DFPLAYER_BUSY_IRQ
+  if (Tonuino::getTonuino().getMp3().wasTrackEndByBusy())
+    return;
+#endif
+#ifdef TRACK_PRE_ARM
+  Tonuino::getTonuino().getMp3().playPreArmed();
 #endif
   delay(1);
   Tonuino::getTonuino().nextTrack(1/*tracks*/, true/*fromOnPlayFinished*/);
 }
 
-#ifndef DFPlayerUsesHardwareSerial
+#if defined(DFPLAYER_TIMER_SERIAL)
+Mp3::Mp3(Settings& settings)
+: Base{softwareSerial}
+, softwareSerial{}
+, settings{settings}
+#elif not defined(DFPlayerUsesHardwareSerial)
 Mp3::Mp3(Settings& settings)
 : Base{softwareSerial}
 , softwareSerial{dfPlayer_receivePin, dfPlayer_transmitPin}
@@ -59,6 +128,19 @@ Mp3::Mp3(Settings &settings)
 #else
   pinMode(dfPlayer_noHeadphoneJackDetect, INPUT_PULLUP);
 #endif
+#ifdef PIN_CHANGE_IRQ
+  hpJackHigh = digitalRead(dfPlayer_noHeadphoneJackDetect) == HIGH;
+  PinChange::subscribe(dfPlayer_noHeadphoneJackDetect, hpJackDebounceTime, [](bool high) { hpJackHigh = high; });
+#endif
+#endif
+
+#ifdef DFPLAYER_BUSY_IRQ
+  busyLevel = isPlaying();
+#if defined(PIN_CHANGE_IRQ)
+  PinChange::subscribe(dfPlayer_busyPin, 0, [](bool) { Mp3::sampleBusy(); });
+#elif not defined(DFPLAYER_BUSY_IRQ_USES_TIMER1) and not defined(UNIT_TESTS)
+  attachInterrupt(digitalPinToInterrupt(dfPlayer_busyPin), Mp3::sampleBusy, CHANGE);
+#endif
 #endif
 }
 
@@ -93,25 +175,58 @@ void Mp3::playAdvertisement(uint16_t track, bool olnyIfIsPlaying) {
 #endif
   if (isPlaying()) {
     LOG(mp3_log, s_debug, F("playAdvertisement: "), track);
-    Base::playAdvertisement(track);
+    dfPlayAdvertisement(track);
+#ifdef DFPLAYER_BUSY_IRQ
+    busyAdvPending = true;
+#endif
   }
   else if (not olnyIfIsPlaying) {
+    // the DfPlayer plays an advertisement only on top of a track, so start one and
+    // let advLoop() play the advertisement and pause again (without blocking)
     if (isPause) {
-      start();
+      isPause = false;
+      dfStart();
     }
     else {
-      Base::playFolderTrack(1, 1);
-      delay(dfPlayer_timeUntilStarts);
+      dfPlayFolderTrack(1, 1);
     }
-    waitForTrackToStart();
-    LOG(mp3_log, s_debug, F("playAdvertisement: "), track);
-    Base::playAdvertisement(track);
-    delay(dfPlayer_timeUntilStarts);
-    waitForTrackToFinish(); // finish adv
-    waitForTrackToStart();  // start folder track
-    delay(10);
-    pause();
-    loop();
+    advTrack = track;
+    advState = adv_waitTrackStarted;
+    advTimer.start(dfPlayer_timeUntilStarts);
+  }
+}
+
+void Mp3::advLoop() {
+  switch (advState) {
+  case adv_waitTrackStarted:
+    if (isPlaying() || advTimer.isExpired()) {
+      LOG(mp3_log, s_debug, F("playAdvertisement: "), advTrack);
+      dfPlayAdvertisement(advTrack);
+      // the busy pin also drops when the DfPlayer switches to the advertisement, so the end is
+      // taken at the earliest after the start time (the busy pin dropped in it or after it)
+      advTimer.start(dfPlayer_timeUntilStarts);
+      advGap   = false;
+      advState = adv_waitAdvFinished;
+    }
+    break;
+  case adv_waitAdvFinished:
+    if (not isPlaying())
+      advGap = true;
+    if (advGap && advTimer.isExpired()) {
+      advTimer.start(dfPlayer_timeUntilStarts);
+      advState = adv_waitTrackRestarted;
+    }
+    break;
+  case adv_waitTrackRestarted:
+    if (isPlaying() || advTimer.isExpired()) {
+      LOG(mp3_log, s_debug, F("playAdvertisement End"));
+      isPause = true;
+      dfPause();
+      advState = adv_none;
+    }
+    break;
+  default:
+    break;
   }
 }
 
@@ -125,14 +240,25 @@ void Mp3::clearFolderQueue() {
   current_track  = 0;
   current_folder = 0;
   q.clear();
+#ifdef SHUFFLE_NO_REPEAT
+  shuffled       = false;
+#endif
+#ifdef TRACK_PRE_ARM
+  preArmedTrack  = 0;
+  preArmSent     = false;
+#endif
 }
 void Mp3::clearMp3Queue() {
   LOG(mp3_log, s_debug, F("clear mp3"));
   if (playing == play_mp3) playing = play_none;
+#ifdef PROMPT_QUEUE
+  promptCount    = 0;
+#else
   mp3_track      = 0;
   mp3_track_next = 0;
+#endif
 }
-void Mp3::enqueueTrack(uint8_t folder, uint8_t firstTrack, uint8_t lastTrack, uint8_t currentTrack) {
+void Mp3::enqueueTrack(uint8_t folder, track_t firstTrack, track_t lastTrack, track_t currentTrack) {
 #ifdef HPJACKDETECT
   if (tempSpkOn > 0)
     --tempSpkOn;
@@ -141,62 +267,182 @@ void Mp3::enqueueTrack(uint8_t folder, uint8_t firstTrack, uint8_t lastTrack, ui
   current_folder = folder;
   endless = false;
   LOG(mp3_log, s_info, F("enqueue "), folder, F("-"), lf_no);
-  for (uint8_t i = firstTrack; i<=lastTrack; ++i) {
+  for (track_t i = firstTrack; i<=lastTrack; ++i) {
     LOG(mp3_log, s_info, i, str_Space(), lf_no);
     q.push(i);
-    if (i == 0xffu)
+    if (i == lastTrack) // no overflow for lastTrack = 0xff
       break;
   }
   LOG(mp3_log, s_info, str_Space());
   current_track = currentTrack;
 }
-void Mp3::enqueueTrack(uint8_t folder, uint8_t track) {
+void Mp3::enqueueTrack(uint8_t folder, track_t track) {
   enqueueTrack(folder, track, track);
 }
 void Mp3::shuffleQueue() {
+#ifdef RESUME_SNAPSHOT
+  shuffleQueue(random(0, 0x10000));
+}
+void Mp3::shuffleQueue(uint16_t seed) {
+  shuffleSeed = seed;
+  q.shuffle(seed);
+#else
   q.shuffle();
+#endif
+#ifdef SHUFFLE_NO_REPEAT
+  shuffled = true;
+#endif
   LOG(mp3_log, s_info, F("shuffled "), lf_no);
-  for (uint8_t i = 0; i<q.size(); ++i)
+  for (track_t i = 0; i<q.size(); ++i)
     LOG(mp3_log, s_info, q.get(i), str_Space(), lf_no);
   LOG(mp3_log, s_info, str_Space());
 }
+#ifdef SHUFFLE_NO_REPEAT
+void Mp3::reshuffleQueue() {
+  const track_t size     = q.size();
+  const uint8_t distance = min(static_cast<track_t>(shuffleRepeatDistance), static_cast<track_t>(size/2));
+  // the last tracks of the round before (the bit of the track number modulo 256)
+  bitfield<255> recent{};
+  for (track_t i = size-distance; i < size; ++i)
+    recent.setBit(static_cast<uint8_t>(q.get(i)));
+#if defined(LARGE_FOLDERS) or defined(TRACK_QUEUE_PERMUTATION)
+  // the order is computed from the seed, try until the start is free of them
+  for (uint8_t tries = 0; tries < shuffleRetries; ++tries) {
+    shuffleQueue();
+    bool repeated = false;
+    for (track_t i = 0; i < distance; ++i)
+      repeated |= recent.getBit(static_cast<uint8_t>(q.get(i)));
+    if (not repeated)
+      break;
+  }
+#else
+  shuffleQueue();
+  // move them behind the start, there is always a track to swap with because distance <= size/2
+  for (track_t i = 0; i < distance; ++i) {
+    if (not recent.getBit(q.get(i)))
+      continue;
+    track_t j;
+    do {
+      j = random(distance, size);
+    } while (recent.getBit(q.get(j)));
+    swap(q.get(i), q.get(j));
+  }
+#endif
+}
+#endif // SHUFFLE_NO_REPEAT
+
 void Mp3::enqueueMp3FolderTrack(uint16_t track, bool playAfter) {
   LOG(mp3_log, s_info, F("enqueue mp3 "), track, str_Space(), playAfter);
   clearFolderQueue();
   if (not playAfter)
     clearMp3Queue();
+#ifdef PROMPT_QUEUE
+  pushPrompt(track, prompt_prio::normal);
+#else
   if (mp3_track != 0)
     mp3_track_next = track;
   else
     mp3_track = track;
+#endif
 }
 void Mp3::enqueueMp3FolderTrack(mp3Tracks track, bool playAfter) {
   enqueueMp3FolderTrack(static_cast<uint16_t>(track), playAfter);
 }
 
+#ifdef PROMPT_QUEUE
+void Mp3::enqueuePrompt(uint16_t track, prompt_prio prio) {
+  LOG(mp3_log, s_info, F("enqueue prompt "), track, str_Space(), static_cast<uint8_t>(prio));
+  clearFolderQueue();
+  pushPrompt(track, prio);
+}
+void Mp3::enqueuePrompt(mp3Tracks track, prompt_prio prio) {
+  enqueuePrompt(static_cast<uint16_t>(track), prio);
+}
+
+void Mp3::pushPrompt(uint16_t track, prompt_prio prio) {
+  // behind the pending prompts with the same or a higher priority
+  uint8_t pos = 0;
+  while (pos < promptCount && prompts[pos].prio >= prio)
+    ++pos;
+  if (promptCount == promptQueueSize) {
+    if (pos == promptCount) {
+      LOG(mp3_log, s_warning, F("prompt dropped "), track);
+      return;
+    }
+    LOG(mp3_log, s_warning, F("prompt dropped "), prompts[promptCount-1].track);
+    --promptCount;
+  }
+  for (uint8_t i = promptCount; i > pos; --i)
+    prompts[i] = prompts[i-1];
+  prompts[pos] = { track, prio };
+  ++promptCount;
+}
+
+void Mp3::cancelPrompts(prompt_prio upTo) {
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < promptCount; ++i) {
+    if (prompts[i].prio > upTo)
+      prompts[kept++] = prompts[i];
+  }
+  LOG(mp3_log, s_debug, F("cancel prompts "), promptCount - kept);
+  promptCount = kept;
+}
+#endif // PROMPT_QUEUE
+
+void Mp3::basePlayFolderTrack(uint8_t folder, track_t track) {
+#ifdef LARGE_FOLDERS
+  if (folder <= largeFolderLast) {
+    Base::playFolderTrack16(folder, track);
+    return;
+  }
+#endif
+  Base::playFolderTrack(folder, track);
+}
+
 void Mp3::playCurrent() {
   LOG(mp3_log, s_debug, F("play current"));
+  advState = adv_none;
   if (current_folder == 0) { // maybe play mp3 track
-    if (mp3_track != 0) {
-      LOG(mp3_log, s_info, F("play mp3 "), mp3_track);
+    const uint16_t track = nextMp3Track();
+    if (track != 0) {
+      LOG(mp3_log, s_info, F("play mp3 "), track);
       Mp3Notify::ResetLastTrackFinished(); // maybe the same mp3 track is played twice
-      LOG(mp3_log, s_debug, F("playMp3FolderTrack: "), mp3_track);
-      Base::playMp3FolderTrack(mp3_track);
+      LOG(mp3_log, s_debug, F("playMp3FolderTrack: "), track);
+      dfPlayMp3FolderTrack(track);
+      LatencyTrace::mark(LatencyTrace::play_current);
       isPause = false;
       startTrackTimer.start(dfPlayer_timeUntilStarts);
       playing = play_mp3;
+#ifdef PROMPT_QUEUE
+      --promptCount;
+      for (uint8_t i = 0; i < promptCount; ++i)
+        prompts[i] = prompts[i+1];
+#else
       mp3_track = 0;
       swap(mp3_track, mp3_track_next);
+#endif
     }
   }
   else { // play folder track
-    uint8_t t = q.get(current_track);
+    const track_t t = q.get(current_track);
     if (t != 0) {
       LOG(mp3_log, s_info, F("play "), current_folder, F("-"), t);
-      Base::playFolderTrack(current_folder, t);
+#ifdef TRACK_PRE_ARM
+      if (not preArmSent || t != preArmedTrack)
+        dfPlayFolderTrack(current_folder, t);
+      preArmSent    = false;
+      preArmedTrack = (current_track+1 < q.size()) ? q.get(current_track+1) : 0;
+#else
+      dfPlayFolderTrack(current_folder, t);
+#endif
+      LatencyTrace::mark(LatencyTrace::play_current);
       isPause = false;
       startTrackTimer.start(dfPlayer_timeUntilStarts);
       playing = play_folder;
+#ifdef DFPLAYER_BUSY_IRQ
+      busyArmed      = true;
+      trackStartTime = millis();
+#endif
     }
   }
 }
@@ -205,15 +451,19 @@ void Mp3::playNext(uint8_t tracks, bool fromOnPlayFinished) {
   if (playing == play_folder)
     tempSpkOn = 0;
 #endif
-  if (playing == play_folder && (current_track+1 < q.size() || endless)) {
+  if (playing == play_folder && q.size() != 0 && (current_track+1 < q.size() || endless)) {
     current_track += tracks;
+#ifdef SHUFFLE_NO_REPEAT
+    if (current_track >= q.size() && endless && shuffled)
+      reshuffleQueue();
+#endif
     if (current_track >= q.size())
       current_track = endless ? current_track % q.size() : q.size()-1;
     LOG(mp3_log, s_debug, F("playNext: "), current_track);
     playCurrent();
   }
-  else if (playing == play_mp3 && mp3_track != 0) {
-    LOG(mp3_log, s_debug, F("playNext mp3: "), mp3_track);
+  else if (playing == play_mp3 && nextMp3Track() != 0) {
+    LOG(mp3_log, s_debug, F("playNext mp3: "), nextMp3Track());
     playCurrent();
   }
   else if (fromOnPlayFinished) {
@@ -222,6 +472,20 @@ void Mp3::playNext(uint8_t tracks, bool fromOnPlayFinished) {
     playing = play_none;
   }
 }
+#ifdef TRACK_PRE_ARM
+void Mp3::playPreArmed() {
+  if (playing != play_folder || isPause || advState != adv_none || preArmedTrack == 0 || preArmSent ||
+      not Tonuino::getTonuino().isPreArmAllowed())
+    return;
+  LOG(mp3_log, s_info, F("pre-armed: "), current_folder, F("-"), preArmedTrack);
+  dfPlayFolderTrack(current_folder, preArmedTrack);
+#ifdef DFPLAYER_CMD_QUEUE
+  flushCommands(); // now and not with the next loop()
+#endif
+  preArmSent = true;
+}
+#endif // TRACK_PRE_ARM
+
 void Mp3::playPrevious(uint8_t tracks) {
   if (playing == play_folder) {
 #ifdef HPJACKDETECT
@@ -236,8 +500,36 @@ void Mp3::playPrevious(uint8_t tracks) {
 
 uint16_t Mp3::getFolderTrackCount(uint16_t folder)
 {
+#ifdef TRACK_COUNT_CACHE
+    for (const trackCount &entry: trackCountCache) {
+      if (entry.folder != 0 && entry.folder == folder) {
+        LOG(mp3_log, s_debug, F("getFolderTrackCount cached: "), entry.count);
+        return entry.count;
+      }
+    }
+#ifdef TRACK_COUNT_CACHE_EEPROM
+    const uint16_t flashCount = settings.readTrackCountFromFlash(folder);
+    if (flashCount != Settings::unknownTrackCount) {
+      LOG(mp3_log, s_debug, F("getFolderTrackCount flash: "), flashCount);
+      putTrackCount(folder, flashCount, false/*toFlash*/);
+      return flashCount;
+    }
+#endif // TRACK_COUNT_CACHE_EEPROM
+#endif // TRACK_COUNT_CACHE
+
     uint16_t ret = 0;
 
+#ifdef DFPLAYER_SHADOW
+    if (isSdKnownMissing()) {
+      LOG(mp3_log, s_debug, F("getFolderTrackCount: no SD"));
+      return ret;
+    }
+#endif
+
+#ifdef DFPLAYER_CMD_QUEUE
+    flushCommands();
+#endif
+
 #ifdef DFMiniMp3_T_CHIP_GD3200B
     Base::setVolume(0);
     delay(100);
@@ -254,13 +546,60 @@ uint16_t Mp3::getFolderTrackCount(uint16_t folder)
     Base::setVolume(*volume);
 #endif
 
+#ifdef TRACK_COUNT_CACHE
+    // 0 is also returned on a timeout, so do not keep it
+    if (ret != 0)
+      putTrackCount(folder, ret, true/*toFlash*/);
+#endif
+
     return ret;
 }
 
+#ifdef DFPLAYER_SHADOW
+void Mp3::resyncLoop() {
+  if (resyncShadow) {
+    resyncShadow = false;
+    LOG(mp3_log, s_info, F("resync volume/eq"));
+    dfSetVolume(*volume);
+    setEq(static_cast<DfMp3_Eq>(settings.eq - 1));
+  }
+}
+#endif
+
+
+#ifdef TRACK_COUNT_CACHE
+void Mp3::putTrackCount(uint8_t folder, uint16_t count, bool toFlash) {
+  trackCountCache[trackCountCacheNext] = { folder, count };
+  trackCountCacheNext = (trackCountCacheNext+1) % trackCountCacheSize;
+#ifdef TRACK_COUNT_CACHE_EEPROM
+  if (toFlash)
+    settings.writeTrackCountToFlash(folder, count);
+#else
+  (void)toFlash;
+#endif
+}
+
+void Mp3::setTrackCount(uint8_t folder, uint16_t count) {
+  for (trackCount &entry: trackCountCache)
+    if (entry.folder == folder)
+      entry.folder = 0;
+  putTrackCount(folder, count, true/*toFlash*/);
+}
+
+void Mp3::clearTrackCountCache() {
+  LOG(mp3_log, s_debug, F("clear track count cache"));
+  for (trackCount &entry: trackCountCache)
+    entry.folder = 0;
+#ifdef TRACK_COUNT_CACHE_EEPROM
+  settings.clearTrackCountsInFlash();
+#endif
+}
+#endif // TRACK_COUNT_CACHE
+
 void Mp3::increaseVolume() {
   if (*volume < *maxVolume) {
     LOG(mp3_log, s_debug, F("setVolume: "), *volume+1);
-    Base::setVolume(++*volume);
+    dfSetVolume(++*volume);
   }
 #ifdef NEO_RING_EXT
   volumeChangedTimer.start(1000);
@@ -271,7 +610,7 @@ void Mp3::increaseVolume() {
 void Mp3::decreaseVolume() {
   if (*volume > *minVolume) {
     LOG(mp3_log, s_debug, F("setVolume: "), *volume-1);
-    Base::setVolume(--*volume);
+    dfSetVolume(--*volume);
   }
 #ifdef NEO_RING_EXT
   volumeChangedTimer.start(1000);
@@ -285,31 +624,129 @@ void Mp3::setVolume() {
   hpVolume  = settings.hpInitVolume;
 #endif
   LOG(mp3_log, s_debug, F("setVolume: "), volume);
+#ifdef DFPLAYER_VOLUME_SYNC
+  requestVolumeSync();
+#else
+#ifdef DFPLAYER_CMD_QUEUE
+  flushCommands();
+#endif
+#ifdef FAST_BOOT
+  // the DfPlayer is already online (waitForReady()), it is enough to check the reply
+  constexpr unsigned long setVolumeWait = 10;
+#else
+  constexpr unsigned long setVolumeWait = 100;
+#endif
   uint8_t max_loop = 20; // 4 seconds
+#ifdef DFPLAYER_SHADOW
+  if (shadowVolume == *volume) // already verified
+    max_loop = 1;
+#endif
   while((--max_loop>0) && (Base::getVolume() != *volume)) {
-    delay(100);
+    delay(setVolumeWait);
     Base::setVolume(*volume);
-    delay(100);
+    delay(setVolumeWait);
   }
+#ifdef DFPLAYER_SHADOW
+  if (max_loop > 0)
+    shadowVolume = *volume;
+#endif
   LOG(mp3_log, s_debug, F("setVolume loops: "), 20-max_loop);
+#endif // DFPLAYER_VOLUME_SYNC
   logVolume();
 }
 
 void Mp3::setVolume(uint8_t v) {
   *volume = v;
   LOG(mp3_log, s_debug, F("setVolume: "), *volume);
-  Base::setVolume(*volume);
+  dfSetVolume(*volume);
   logVolume();
 }
 
+#ifdef FAST_BOOT
+void Mp3::waitForReady(unsigned long timeout) {
+  const unsigned long start = millis();
+  unsigned long lastQuery = start - dfPlayerReadyQueryTime;
+  while (not Mp3Notify::online && millis() - start < timeout) {
+    Base::loop();
+    if (millis() - lastQuery >= dfPlayerReadyQueryTime) {
+      // a DfPlayer that was already powered does not send the online notification
+      Mp3Notify::lastError = 0;
+      Base::getVolume();
+      if (Mp3Notify::lastError == 0)
+        Mp3Notify::online = true;
+      lastQuery = millis();
+    }
+    else
+      delay(10);
+  }
+  LOG(init_log, s_info, F("DfPlayer ready after "), millis() - start, F(" ms"));
+}
+#endif
+
+#ifdef DFPLAYER_VOLUME_SYNC
+void Mp3::syncVolume() {
+  switch (volumeSync) {
+  case vs_send:
+#ifdef DFPLAYER_SHADOW
+    shadowVolume = shadowUnknown; // send in any case, it is verified
+#endif
+    dfSetVolume(*volume);
+    volumeSync = vs_verify;
+    volumeSyncTimer.start(dfPlayerVolumeVerifyTime);
+    break;
+  case vs_verify:
+    if (not volumeSyncTimer.isExpired())
+      break;
+#ifdef DFPLAYER_CMD_QUEUE
+    flushCommands();
+#endif
+    if (Base::getVolume() == *volume) {
+      LOG(mp3_log, s_debug, F("setVolume loops: "), dfPlayerVolumeRetries-volumeSyncRetries+1);
+#ifdef DFPLAYER_SHADOW
+      shadowVolume = *volume;
+#endif
+      volumeSync = vs_idle;
+    }
+    else if (--volumeSyncRetries > 0)
+      volumeSync = vs_send;
+    else {
+      LOG(mp3_log, s_error, F("setVolume failed"));
+      volumeSync = vs_idle;
+    }
+    break;
+  case vs_idle:
+    break;
+  }
+}
+#endif // DFPLAYER_VOLUME_SYNC
+
+#ifdef DFPLAYER_SHADOW
+void Mp3::setPlaySource(DfMp3_PlaySources source, bool available) {
+  if (playSources == shadowUnknown)
+    playSources = 0;
+  if (available)
+    playSources |= source;
+  else
+    playSources &= ~source;
+}
+#endif // DFPLAYER_SHADOW
+
 void Mp3::logVolume() {
   LOG(mp3_log, s_info, F("Volume: "), *volume);
 }
 
 void Mp3::loop() {
 
+#ifdef PIN_CHANGE_IRQ
+  PinChange::loop();
+#endif
+
 #ifdef HPJACKDETECT
+#ifdef PIN_CHANGE_IRQ
+  level noHeadphoneJackDetect_now = getLevel(dfPlayer_noHeadphoneJackDetectType, hpJackHigh ? HIGH : LOW);
+#else
   level noHeadphoneJackDetect_now = getLevel(dfPlayer_noHeadphoneJackDetectType, digitalRead(dfPlayer_noHeadphoneJackDetect));
+#endif
   if (tempSpkOn)
     noHeadphoneJackDetect_now = level::active;
 
@@ -328,13 +765,28 @@ void Mp3::loop() {
       minVolume  = &settings.spkMinVolume;
       initVolume = &settings.spkInitVolume;
     }
-    Base::setVolume(*volume);
+#ifdef DFPLAYER_VOLUME_SYNC
+    requestVolumeSync();
+#else
+    dfSetVolume(*volume);
+#endif
     logVolume();
   }
 #endif
 
+#ifdef DFPLAYER_VOLUME_SYNC
+  syncVolume();
+#endif
 
-  if (not isPause && playing != play_none && startTrackTimer.isExpired() && not isPlaying()) {
+#ifdef DFPLAYER_SHADOW
+  resyncLoop();
+#endif
+
+#ifdef DFPLAYER_BUSY_IRQ
+  busyLoop();
+#endif
+
+  if (not isPause && playing != play_none && advState == adv_none && startTrackTimer.isExpired() && not isPlaying()) {
     if (not missingOnPlayFinishedTimer.isActive())
       missingOnPlayFinishedTimer.start(dfPlayer_timeUntilStarts);
   }
@@ -343,11 +795,134 @@ void Mp3::loop() {
   }
   if (missingOnPlayFinishedTimer.isActive() && missingOnPlayFinishedTimer.isExpired()) {
     LOG(mp3_log, s_info, F("missing OnPlayFinished"));
+    Telemetry::count(Telemetry::mp3_missing_finished);
     Tonuino::getTonuino().nextTrack(1/*tracks*/, true/*fromOnPlayFinished*/);
   }
   else
-  if (playing == play_none && (current_folder != 0 || mp3_track != 0)) {
+  if (playing == play_none && (current_folder != 0 || nextMp3Track() != 0)) {
     playCurrent();
   }
+  advLoop();
+#ifdef DFPLAYER_CMD_QUEUE
+  sendCommands();
+#endif
+  if (isPlaying())
+    LatencyTrace::mark(LatencyTrace::busy_active);
   Base::loop();
 }
+
+#ifdef DFPLAYER_BUSY_IRQ
+void Mp3::sampleBusy() {
+  const bool level = !digitalRead(dfPlayer_busyPin);
+  if (level == busyLevel)
+    return;
+  busyLevel = level;
+  if (level) {
+    busyStartTime = millis();
+    busyStarted   = true;
+  }
+  else {
+    busyEndTime   = millis();
+    busyEnded     = true;
+  }
+}
+
+void Mp3::busyLoop() {
+  noInterrupts();
+#ifndef PIN_CHANGE_IRQ
+  // sample also here, the interrupt is only for the exact time stamp
+  sampleBusy();
+#endif
+  const bool          ended     = busyEnded;
+  const bool          started   = busyStarted;
+  const unsigned long endTime   = busyEndTime;
+  const unsigned long startTime = busyStartTime;
+  busyEnded   = false;
+  busyStarted = false;
+  interrupts();
+
+  if (ended && busyAdvPending) {
+    // the busy signal is interrupted at the end of an advertisement on top of the track
+    busyAdvPending = false;
+  }
+  else if (ended && busyArmed && playing == play_folder && advState == adv_none) {
+    gapPending   = true;
+    trackEndTime = endTime;
+    // the end of the track before the current one (OnPlayFinished was faster) or the start of the current one
+    // which is not yet signaled by the busy pin does not count
+    if (static_cast<long>(endTime - trackStartTime) >= static_cast<long>(dfPlayer_timeUntilStarts)) {
+      LOG(mp3_log, s_info, F("busy end"));
+      busyEndTimer.start(dfPlayer_timeUntilStarts);
+      Tonuino::getTonuino().nextTrack(1/*tracks*/, true/*fromOnPlayFinished*/);
+    }
+  }
+  if (started && gapPending && static_cast<long>(startTime - trackEndTime) >= 0) {
+    gapPending = false;
+    LOG(mp3_log, s_info, F("track gap: "), startTime - trackEndTime, F(" ms"));
+  }
+}
+#endif // DFPLAYER_BUSY_IRQ
+
+#ifdef DFPLAYER_CMD_QUEUE
+// a new command replaces the last queued one, if it makes it obsolete
+void Mp3::enqueueCommand(cmd_type type, uint16_t arg, uint8_t folder) {
+  if (cmdCount > 0) {
+    mp3Command &last = cmdQueue[(cmdHead + cmdCount - 1) % dfPlayerCmdQueueSize];
+    const bool lastIsTransport = last.type == cmd_playFolderTrack || last.type == cmd_playMp3FolderTrack ||
+                                 last.type == cmd_start           || last.type == cmd_pause              ||
+                                 last.type == cmd_stop;
+    const bool replacesTransport = type == cmd_playFolderTrack || type == cmd_playMp3FolderTrack || type == cmd_stop;
+    if ((last.type == type && (type == cmd_setVolume || type == cmd_setEq)) || (lastIsTransport && replacesTransport)) {
+      LOG(mp3_log, s_debug, F("collapse cmd: "), static_cast<uint8_t>(last.type), F(" -> "), static_cast<uint8_t>(type));
+      last = { type, folder, arg, 0 };
+      return;
+    }
+  }
+  // queue is full --> make room (blocking)
+  if (cmdCount == dfPlayerCmdQueueSize)
+    sendCommands(1);
+  cmdQueue[(cmdHead + cmdCount) % dfPlayerCmdQueueSize] = { type, folder, arg, 0 };
+  ++cmdCount;
+}
+
+// each command waits for the ack of the DfPlayer (Base::), max limits the blocking time per call
+void Mp3::sendCommands(uint8_t max) {
+  for (; max > 0 && cmdCount > 0; --max) {
+    lastCmd = cmdQueue[cmdHead];
+    cmdHead = (cmdHead + 1) % dfPlayerCmdQueueSize;
+    --cmdCount;
+    sendCommand(lastCmd);
+  }
+}
+
+void Mp3::sendCommand(const mp3Command& cmd) {
+  LOG(mp3_log, s_debug, F("send cmd: "), static_cast<uint8_t>(cmd.type), str_Space(), cmd.arg);
+  switch (cmd.type) {
+  case cmd_playFolderTrack   : basePlayFolderTrack     (cmd.folder, cmd.arg)             ; break;
+  case cmd_playMp3FolderTrack: Base::playMp3FolderTrack(cmd.arg)                         ; break;
+  case cmd_playAdvertisement : Base::playAdvertisement (cmd.arg)                         ; break;
+  case cmd_start             : Base::start             ()                                ; break;
+  case cmd_pause             : Base::pause             ()                                ; break;
+  case cmd_stop              : Base::stop              ()                                ; break;
+  case cmd_setVolume         : Base::setVolume         (cmd.arg)                         ; break;
+  case cmd_setEq             : Base::setEq             (static_cast<DfMp3_Eq>(cmd.arg))  ; break;
+  default                    :                                                             break;
+  }
+}
+
+// the DfPlayer was busy or did not answer --> send the last command again
+void Mp3::retryCommand(uint16_t errorCode) {
+  if (errorCode != DfMp3_Error_Busy && errorCode != DfMp3_Error_RxTimeout)
+    return;
+  if (lastCmd.type == cmd_none || lastCmd.retries >= dfPlayerCmdRetries)
+    return;
+  LOG(mp3_log, s_info, F("retry cmd: "), static_cast<uint8_t>(lastCmd.type));
+  ++lastCmd.retries;
+  if (cmdCount == dfPlayerCmdQueueSize)
+    return;
+  cmdHead = (cmdHead + dfPlayerCmdQueueSize - 1) % dfPlayerCmdQueueSize;
+  cmdQueue[cmdHead] = lastCmd;
+  ++cmdCount;
+  lastCmd.type = cmd_none;
+}
+#endif // DFPLAYER_CMD_QUEUE
@@ -10,16 +10,33 @@
 #include "queue.hpp"
 #include "timer.hpp"
 
-#ifndef DFPlayerUsesHardwareSerial // make sure to include "constants.hpp" before this line!
+#if defined(DFPlayerUsesHardwareSerial) // make sure to include "constants.hpp" before this line!
+using SerialType = HardwareSerial;
+#elif defined(DFPLAYER_TIMER_SERIAL)
+#include "timer_serial.hpp"
+using SerialType = TimerSerial;
+#else
 #include <SoftwareSerial.h>
 using SerialType = SoftwareSerial;
-#else
-using SerialType = HardwareSerial;
 #endif // DFPlayerUsesHardwareSerial
 
 // forward declare the notify class, just the name
 class Mp3Notify;
 
+#ifdef DFPLAYER_BUSY_IRQ
+#if not defined(ALLinONE_Plus) and not defined(TonUINO_Every) and not defined(TonUINO_Every_4808) and not defined(TonUINO_ESP32) and not defined(UNIT_TESTS) \
+    and not defined(PIN_CHANGE_IRQ)
+#define USE_TIMER1
+#define DFPLAYER_BUSY_IRQ_USES_TIMER1
+#endif
+#endif
+
+#ifdef LARGE_FOLDERS
+using track_t = uint16_t;
+#else
+using track_t = uint8_t;
+#endif
+
 #ifdef DFMiniMp3_T_CHIP_MH2024K16SS
 #define DFMiniMp3_T_CHIP_VARIANT Mp3ChipMH2024K16SS
 #endif
@@ -192,6 +209,10 @@ public:
   static void OnPlaySourceRemoved (DfMp3&, DfMp3_PlaySources source);
 
   static void ResetLastTrackFinished() { lastTrackFinished = 0; }
+#ifdef FAST_BOOT
+  static bool     online;    // a play source reported online or inserted
+  static uint16_t lastError;
+#endif
 private:
   static void PrintlnSourceAction (DfMp3_PlaySources source, const __FlashStringHelper* action);
   static uint16_t lastTrackFinished;
@@ -208,6 +229,7 @@ public:
   void waitForTrackToStart();
   void playAdvertisement(uint16_t     track, bool olnyIfIsPlaying = true);
   void playAdvertisement(advertTracks track, bool olnyIfIsPlaying = true);
+  bool isPlayingAdvertisement() const { return advState != adv_none; }
 
   void clearFolderQueue();
   void clearMp3Queue();
@@ -219,26 +241,95 @@ public:
 #endif
   // firstTrack and lastTrack -> index in folder starting with 1
   // currentTrack             -> index in queue starting with 0
-  void enqueueTrack(uint8_t folder, uint8_t firstTrack, uint8_t lastTrack, uint8_t currentTrack = 0);
-  void enqueueTrack(uint8_t folder, uint8_t track);
+  void enqueueTrack(uint8_t folder, track_t firstTrack, track_t lastTrack, track_t currentTrack = 0);
+  void enqueueTrack(uint8_t folder, track_t track);
   void setEndless() { endless = true; }
   void shuffleQueue();
+#ifdef SHUFFLE_NO_REPEAT
+  // shuffles the queue for the next round, the last tracks are not at the start again
+  void reshuffleQueue();
+#endif
+#ifdef RESUME_SNAPSHOT
+  // the same seed gives the same order
+  void     shuffleQueue  (uint16_t seed);
+  uint16_t getShuffleSeed() const    { return shuffleSeed; }
+  void     setQueuePos   (uint16_t pos) { current_track = pos; }
+#endif
   void enqueueMp3FolderTrack(uint16_t  track, bool playAfter = false);
   void enqueueMp3FolderTrack(mp3Tracks track, bool playAfter = false);
+#ifdef PROMPT_QUEUE
+  enum class prompt_prio: uint8_t {
+    low   ,
+    normal, // enqueueMp3FolderTrack()
+    high  ,
+  };
+  // appends the prompt without stopping the playing or the pending ones. A prompt plays before the pending prompts
+  // with a lower priority, a full queue drops the one with the lowest priority.
+  void enqueuePrompt(uint16_t  track, prompt_prio prio = prompt_prio::normal);
+  void enqueuePrompt(mp3Tracks track, prompt_prio prio = prompt_prio::normal);
+  // removes the pending prompts up to this priority, the playing prompt continues
+  void cancelPrompts(prompt_prio upTo);
+  uint8_t pendingPrompts() const { return promptCount; }
+#endif
   void playCurrent();
   void playNext(uint8_t tracks, bool fromOnPlayFinished);
+#ifdef TRACK_PRE_ARM
+  // sends the play command of the next folder track, the following playCurrent() does not send it again
+  void playPreArmed();
+#endif
   void playPrevious(uint8_t tracks = 1);
-  uint8_t getCurrentTrack() { return playing ? q.get(current_track) : 0; }
+  track_t getCurrentTrack() { return playing ? q.get(current_track) : 0; }
+  uint16_t getQueuePos   () const { return current_track; }
+  uint16_t getQueueSize  ()       { return q.size(); }
   uint16_t getFolderTrackCount(uint16_t folder);
+#ifdef TRACK_COUNT_CACHE
+  void clearTrackCountCache();
+  // known track count of a folder (e.g. provisioned via SERIAL_REMOTE), replaces the cached one
+  void setTrackCount(uint8_t folder, uint16_t count);
+#endif
+
+#ifdef DFPLAYER_BUSY_IRQ
+  void start() { advState = adv_none; if (isPause) { isPause = false; busyArmed = true; dfStart();} }
+  void stop () { advState = adv_none; isPause = false; busyArmed = false; dfStop (); }
+  void pause() { advState = adv_none; isPause = true ; busyArmed = false; dfPause(); }
+
+  // records the edges of the busy pin, called from the ISR
+  static void sampleBusy();
+  // true if the next track was already started by the end of the busy signal (consumes the OnPlayFinished)
+  bool wasTrackEndByBusy() { const bool ret = not busyEndTimer.isExpired(); busyEndTimer.stop(); return ret; }
+#else
+  void start() { advState = adv_none; if (isPause) { isPause = false; dfStart();} }
+  void stop () { advState = adv_none; isPause = false; dfStop (); }
+  void pause() { advState = adv_none; isPause = true ; dfPause(); }
+#endif
+#ifdef DFPLAYER_SHADOW
+#ifdef DFPLAYER_CMD_QUEUE
+  void setEq(DfMp3_Eq eq) { if (updateShadow(shadowEq, eq)) enqueueCommand(cmd_setEq, eq); }
+#else
+  void setEq(DfMp3_Eq eq) { if (updateShadow(shadowEq, eq)) Base::setEq(eq); }
+#endif
+  // the DfPlayer state is unknown (error) or lost (restart, resync: send volume and EQ again)
+  void invalidateShadow(bool resync) { shadowVolume = shadowUnknown; shadowEq = shadowUnknown; resyncShadow |= resync; }
+  void setPlaySource   (DfMp3_PlaySources source, bool available);
+#elif defined(DFPLAYER_CMD_QUEUE)
+  void setEq(DfMp3_Eq eq) { enqueueCommand(cmd_setEq, eq); }
+#endif
+#ifdef DFPLAYER_CMD_QUEUE
+  void sleep()            { flushCommands(); Base::sleep(); }
 
-  void start() { if (isPause) { isPause = false; Base::start();} }
-  void stop () { isPause = false; Base::stop (); }
-  void pause() { isPause = true ; Base::pause(); }
+  void sendCommands (uint8_t max = dfPlayerCmdsPerLoop);
+  void flushCommands() { sendCommands(dfPlayerCmdQueueSize); }
+  void retryCommand (uint16_t errorCode);
+#endif
 
   void increaseVolume();
   void decreaseVolume();
   void setVolume     ();
   void setVolume     (uint8_t);
+#ifdef FAST_BOOT
+  // waits until the DfPlayer is online (notification or valid reply), max. timeout ms
+  void waitForReady  (unsigned long timeout);
+#endif
 #ifdef NEO_RING_EXT
   uint8_t getVolumeRel() const { return static_cast<uint16_t>(*volume-*minVolume)*0xff/(*maxVolume-*minVolume); }
   bool volumeChanged () { return not volumeChangedTimer.isExpired(); }
@@ -259,11 +350,88 @@ private:
   friend class tonuino_fixture;
 
   void logVolume();
+  void advLoop();
+#ifdef DFPLAYER_SHADOW
+  void resyncLoop();
+#endif
+#ifdef DFPLAYER_BUSY_IRQ
+  void busyLoop();
+#endif
+#ifdef DFPLAYER_VOLUME_SYNC
+  // sends the volume and verifies it in the background, see loop()
+  void requestVolumeSync() { volumeSync = vs_send; volumeSyncRetries = dfPlayerVolumeRetries; }
+  void syncVolume();
+  enum volumeSync_t: uint8_t {
+    vs_idle  ,
+    vs_send  ,
+    vs_verify,
+  };
+  volumeSync_t         volumeSync{vs_idle};
+  uint8_t              volumeSyncRetries{};
+  Timer                volumeSyncTimer{};
+#endif
+
+#ifdef DFPLAYER_CMD_QUEUE
+  enum cmd_type: uint8_t {
+    cmd_none,
+    cmd_playFolderTrack,
+    cmd_playMp3FolderTrack,
+    cmd_playAdvertisement,
+    cmd_start,
+    cmd_pause,
+    cmd_stop,
+    cmd_setVolume,
+    cmd_setEq,
+  };
+  struct mp3Command {
+    cmd_type           type;
+    uint8_t            folder;
+    uint16_t           arg;     // track, volume or eq
+    uint8_t            retries;
+  };
+  void enqueueCommand(cmd_type type, uint16_t arg = 0, uint8_t folder = 0);
+  void sendCommand   (const mp3Command& cmd);
+
+  void dfPlayFolderTrack   (uint8_t folder, track_t track) { enqueueCommand(cmd_playFolderTrack   , track, folder); }
+  void dfPlayMp3FolderTrack(uint16_t track               ) { enqueueCommand(cmd_playMp3FolderTrack, track); }
+  void dfPlayAdvertisement (uint16_t track               ) { enqueueCommand(cmd_playAdvertisement , track); }
+  void dfStart             (                             ) { enqueueCommand(cmd_start    ); }
+  void dfPause             (                             ) { enqueueCommand(cmd_pause    ); }
+  void dfStop              (                             ) { enqueueCommand(cmd_stop     ); }
+  void dfSetVolume         (uint8_t v                    ) { if (shadowVolumeChanged(v)) enqueueCommand(cmd_setVolume, v); }
+#else
+  void dfPlayFolderTrack   (uint8_t folder, track_t track) { basePlayFolderTrack     (folder, track); }
+  void dfPlayMp3FolderTrack(uint16_t track               ) { Base::playMp3FolderTrack(track); }
+  void dfPlayAdvertisement (uint16_t track               ) { Base::playAdvertisement (track); }
+  void dfStart             (                             ) { Base::start    (); }
+  void dfPause             (                             ) { Base::pause    (); }
+  void dfStop              (                             ) { Base::stop     (); }
+  void dfSetVolume         (uint8_t v                    ) { if (shadowVolumeChanged(v)) Base::setVolume(v); }
+#endif // DFPLAYER_CMD_QUEUE
+
+#ifdef DFPLAYER_SHADOW
+  static constexpr uint8_t shadowUnknown = 0xff;
+  // false if the DfPlayer has already this value
+  static bool updateShadow(uint8_t &shadow, uint8_t v) { if (shadow == v) return false; shadow = v; return true; }
+  // only the read back volume is known, a sent one is unknown until it is verified
+  bool shadowVolumeChanged(uint8_t v) { if (shadowVolume == v) return false; shadowVolume = shadowUnknown; return true; }
+  bool isSdKnownMissing() const { return playSources != shadowUnknown && not (playSources & DfMp3_PlaySources_Sd); }
+#else
+  static constexpr bool shadowVolumeChanged(uint8_t) { return true; }
+#endif
 
-  typedef queue<uint8_t, maxTracksInFolder> track_queue;
+  void basePlayFolderTrack (uint8_t folder, track_t track);
+
+#if defined(LARGE_FOLDERS)
+  typedef permutation_queue<maxTracksInLargeFolder, uint16_t> track_queue;
+#elif defined(TRACK_QUEUE_PERMUTATION)
+  typedef permutation_queue<maxTracksInFolder> track_queue;
+#else
+  typedef queue<uint8_t, maxTracksInFolder>    track_queue;
+#endif
 
 #ifndef DFPlayerUsesHardwareSerial
-  SoftwareSerial       softwareSerial;
+  SerialType           softwareSerial;
 #endif /* not DFPlayerUsesHardwareSerial */
   Settings&            settings;
 
@@ -284,10 +452,35 @@ private:
   uint8_t              current_folder{};
   uint16_t             current_track{};
   bool                 endless{false};
+#ifdef RESUME_SNAPSHOT
+  uint16_t             shuffleSeed{};
+#endif
+
+#ifdef TRACK_COUNT_CACHE
+  struct trackCount {
+    uint8_t            folder;
+    uint16_t           count;
+  };
+  void                 putTrackCount(uint8_t folder, uint16_t count, bool toFlash);
+  trackCount           trackCountCache[trackCountCacheSize]{};
+  uint8_t              trackCountCacheNext{};
+#endif
 
   // mp3 queue
+#ifdef PROMPT_QUEUE
+  struct prompt {
+    uint16_t           track;
+    prompt_prio        prio;
+  };
+  void                 pushPrompt(uint16_t track, prompt_prio prio);
+  uint16_t             nextMp3Track() const { return promptCount != 0 ? prompts[0].track : 0; }
+  prompt               prompts[promptQueueSize]{};
+  uint8_t              promptCount{};
+#else
+  uint16_t             nextMp3Track() const { return mp3_track; }
   uint16_t             mp3_track{};
   uint16_t             mp3_track_next{};
+#endif
 
   enum play_type: uint8_t {
     play_none,
@@ -298,15 +491,56 @@ private:
   Timer                startTrackTimer{};
   Timer                missingOnPlayFinishedTimer{};
   bool                 isPause{};
+#ifdef SHUFFLE_NO_REPEAT
+  bool                 shuffled{};
+#endif
+#ifdef DFPLAYER_BUSY_IRQ
+  bool                 busyArmed{};      // a folder track was started and not paused or stopped since
+  bool                 gapPending{};     // the busy signal of a folder track ended, the gap ends with the next start
+  bool                 busyAdvPending{}; // the next end of the busy signal belongs to an advertisement
+  unsigned long        trackStartTime{};
+  unsigned long        trackEndTime{};
+  Timer                busyEndTimer{};
+#endif
+#ifdef TRACK_PRE_ARM
+  track_t              preArmedTrack{}; // next track of the queue, 0: none
+  bool                 preArmSent{};
+#endif
 #ifdef DFMiniMp3_IGNORE_ONPLAYFINISHED_FOR_ADV
   bool                 advPlaying{false};
 #endif
 
+  // advertisement if nothing is playing, the sequence is driven by loop()
+  enum adv_state: uint8_t {
+    adv_none,
+    adv_waitTrackStarted,
+    adv_waitAdvFinished,
+    adv_waitTrackRestarted,
+  };
+  adv_state            advState{adv_none};
+  uint16_t             advTrack{};
+  Timer                advTimer{};
+  bool                 advGap{};   // the busy pin showed not playing since the advertisement was sent
+
 #ifdef HPJACKDETECT
   level                noHeadphoneJackDetect{level::unknown};
   uint8_t              tempSpkOn{};
 #endif
 
+#ifdef DFPLAYER_SHADOW
+  uint8_t              shadowVolume{shadowUnknown};
+  uint8_t              shadowEq    {shadowUnknown};
+  uint8_t              playSources {shadowUnknown}; // bit mask of DfMp3_PlaySources
+  bool                 resyncShadow{};
+#endif
+
+#ifdef DFPLAYER_CMD_QUEUE
+  mp3Command           cmdQueue[dfPlayerCmdQueueSize]{};
+  uint8_t              cmdHead{};
+  uint8_t              cmdCount{};
+  mp3Command           lastCmd{};
+#endif
+
 };
 
 #endif /* SRC_MP3_HPP_ */
@@ -0,0 +1,73 @@
+#include "pin_change.hpp"
+
+#include "constants.hpp"
+
+#ifdef PIN_CHANGE_IRQ
+#include "logger.hpp"
+
+#if defined(TonUINO_Classic) and not defined(UNIT_TESTS)
+#define PIN_CHANGE_USES_PCINT
+// one handler for all ports, it compares all subscribed pins
+ISR(PCINT0_vect) { PinChange::isr(); }
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+
+PinChange::subscriber PinChange::subscribers[pinChangeSubscribers]{};
+uint8_t               PinChange::count{};
+
+bool PinChange::subscribe(uint8_t pin, uint8_t debounce, callback cb) {
+  if (count == pinChangeSubscribers) {
+    LOG(init_log, s_error, F("pin change full: "), pin);
+    return false;
+  }
+  noInterrupts();
+  subscribers[count] = { pin, debounce, cb, digitalRead(pin) == HIGH, false, millis() };
+  ++count;
+#if defined(PIN_CHANGE_USES_PCINT)
+  *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+  *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+#elif not defined(UNIT_TESTS)
+  attachInterrupt(digitalPinToInterrupt(pin), PinChange::isr, CHANGE);
+#endif
+  interrupts();
+  return true;
+}
+
+void PinChange::check(subscriber &s, unsigned long now) {
+  const bool high = digitalRead(s.pin) == HIGH;
+  if (high == s.high) {
+    s.pending = false;
+    return;
+  }
+  if (now - s.lastChange < s.debounce) {
+    s.pending = true;
+    return;
+  }
+  s.high       = high;
+  s.pending    = false;
+  s.lastChange = now;
+  s.cb(high);
+}
+
+void PinChange::isr() {
+  const unsigned long now = millis();
+  for (uint8_t i = 0; i < count; ++i)
+    check(subscribers[i], now);
+}
+
+void PinChange::loop() {
+  noInterrupts();
+#ifdef UNIT_TESTS
+  isr();
+#else
+  const unsigned long now = millis();
+  for (uint8_t i = 0; i < count; ++i) {
+    if (subscribers[i].pending)
+      check(subscribers[i], now);
+  }
+#endif
+  interrupts();
+}
+
+#endif // PIN_CHANGE_IRQ
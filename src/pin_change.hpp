@@ -0,0 +1,44 @@
+#ifndef SRC_PIN_CHANGE_HPP_
+#define SRC_PIN_CHANGE_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+#ifdef PIN_CHANGE_IRQ
+// reports the edges of input pins to the subscribers instead of polling the pins in
+// every cycle. The pin change interrupt of the port is used on the ATmega328P
+// (TonUINO_Classic), the interrupt of the pin on the megaAVR and the AVR-DB
+// (TonUINO_Every, ALLinONE_Plus). Not on the ALLinONE, its DfPlayer needs the
+// SoftwareSerial. The callback runs in the ISR with the
+// new level. Edges within the debounce time after the last reported one are not
+// reported, loop() reports the level at the end of the debounce time if it differs.
+class PinChange {
+public:
+  using callback = void (*)(bool high);
+
+  // false if all pinChangeSubscribers are used
+  static bool subscribe(uint8_t pin, uint8_t debounce, callback cb);
+  // the debounced edges, on the host (without interrupts) also the edges
+  static void loop();
+
+  // called by the interrupts
+  static void isr();
+
+private:
+  struct subscriber {
+    uint8_t       pin;
+    uint8_t       debounce;  // ms
+    callback      cb;
+    bool          high;
+    bool          pending;   // edge within the debounce time
+    unsigned long lastChange;
+  };
+  static void check(subscriber &s, unsigned long now);
+
+  static subscriber subscribers[pinChangeSubscribers];
+  static uint8_t    count;
+};
+#endif // PIN_CHANGE_IRQ
+
+#endif /* SRC_PIN_CHANGE_HPP_ */
@@ -2,26 +2,63 @@
 
 #include "constants.hpp"
 
+#ifdef POTI_FILTER
+uint8_t PotiFilter::update(int16_t raw, uint8_t minValue, uint8_t maxValue) {
+  if (not initialized) {
+    acc         = raw << potiFilterShift;
+    initialized = true;
+  }
+  else {
+    acc += raw - static_cast<int16_t>(acc >> potiFilterShift);
+  }
+  const int16_t avg   = acc >> potiFilterShift;
+  const uint8_t steps = maxValue - minValue + 1;
+  const uint8_t step  = value - minValue;
+  if (value < minValue || value > maxValue ||
+      avg <  boundary(step  , steps) - potiHysteresis ||
+      avg >= boundary(step+1, steps) + potiHysteresis) {
+    const uint8_t newStep = static_cast<int32_t>(avg) * steps / (potiMaxLevel+1);
+    value = minValue + (newStep < steps ? newStep : steps-1);
+  }
+  return value;
+}
+#endif // POTI_FILTER
+
 #ifdef POTI
 #include "logger.hpp"
 #include "mp3.hpp"
-
-#ifdef ALLinONE
-  static constexpr int16_t maxLevel = 4064;
-#else
-  static constexpr int16_t maxLevel = 1023;
-#endif
+#include "adc_sampler.hpp"
 
 
 Poti::Poti(Mp3& mp3)
 : CommandSource()
 , mp3(mp3)
+#ifdef ADC_BACKGROUND
+, adcChannel(AdcSampler::add(potiPin))
+#endif
 {
   pinMode(potiPin, INPUT);
 }
 
 commandRaw Poti::getCommandRaw() {
-  const uint8_t volume = map( analogRead(potiPin), 0, maxLevel, mp3.getMinVolume(), mp3.getMaxVolume());
+#ifdef POTI_FILTER
+#ifdef ADC_BACKGROUND
+  const uint8_t volume = filter.update(AdcSampler::get(adcChannel), mp3.getMinVolume(), mp3.getMaxVolume());
+#else
+  const uint8_t volume = filter.update(analogRead(potiPin)        , mp3.getMinVolume(), mp3.getMaxVolume());
+#endif
+  if (volume != mp3.getVolume() && rateTimer.isExpired()) {
+    LOG(button_log, s_debug, F("poti volume: "), volume);
+    mp3.setVolume(volume);
+    rateTimer.start(potiMinInterval);
+  }
+  return commandRaw::none;
+#else // POTI_FILTER
+#ifdef ADC_BACKGROUND
+  const uint8_t volume = map( AdcSampler::get(adcChannel), 0, potiMaxLevel, mp3.getMinVolume(), mp3.getMaxVolume());
+#else
+  const uint8_t volume = map( analogRead(potiPin), 0, potiMaxLevel, mp3.getMinVolume(), mp3.getMaxVolume());
+#endif
 
   if (volume < mp3.getVolume()) {
     LOG(button_log, s_debug, F("poti volume: "), volume);
@@ -33,6 +70,7 @@ commandRaw Poti::getCommandRaw() {
   }
 
   return commandRaw::none;
+#endif // POTI_FILTER
 }
 
 #endif // POTI
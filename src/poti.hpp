@@ -4,9 +4,33 @@
 #include <Arduino.h>
 
 #include "commands.hpp"
+#include "constants.hpp"
+#include "timer.hpp"
 
 class Mp3;
 
+#ifdef ALLinONE
+inline constexpr int16_t potiMaxLevel = 4064;
+#else
+inline constexpr int16_t potiMaxLevel = 1023;
+#endif
+
+#ifdef POTI_FILTER
+// exponential average of the ADC value, the step in [minValue, maxValue] changes only if the
+// average is potiHysteresis beyond the boundary of the last step
+class PotiFilter {
+public:
+  uint8_t update(int16_t raw, uint8_t minValue, uint8_t maxValue);
+private:
+  int16_t boundary(uint8_t step, uint8_t steps) const {
+    return static_cast<int32_t>(step) * (potiMaxLevel+1) / steps;
+  }
+  uint16_t acc        {};
+  bool     initialized{};
+  uint8_t  value      {};
+};
+#endif // POTI_FILTER
+
 class Poti: public CommandSource {
 public:
 
@@ -15,6 +39,13 @@ public:
 
 private:
   Mp3&            mp3;
+#ifdef ADC_BACKGROUND
+  uint8_t         adcChannel;
+#endif
+#ifdef POTI_FILTER
+  PotiFilter      filter{};
+  Timer           rateTimer{};
+#endif
 };
 
 #endif /* SRC_POTI_HPP_ */
@@ -2,18 +2,22 @@
 #define SRC_QUEUE_HPP_
 
 #include "array.hpp"
+#include "type_traits.hpp"
 
 inline void setBit  (uint8_t &v, uint8_t b) { v |=  (1<<b); }
 inline void clearBit(uint8_t &v, uint8_t b) { v &= ~(1<<b); }
 inline bool getBit  (uint8_t &v, uint8_t b) { return v & (1<<b); }
 
-template<uint8_t BITS>
+// more than 255 bits need a 16 bit index
+template<uint16_t BITS>
 class bitfield {
 public:
-  void setBit  (uint8_t n) { uint8_t &v = bits[n/8]; ::setBit  (v, n%8); }
-  void clearBit(uint8_t n) { uint8_t &v = bits[n/8]; ::clearBit(v, n%8); }
-  bool getBit  (uint8_t n) { uint8_t &v = bits[n/8]; return ::getBit(v, n%8); }
-  void setAll  (uint8_t v) { for (uint8_t i = 0; i < BITS/8+1; ++i) bits[i] = v; }
+  typedef typename conditional<(BITS > 255), uint16_t, uint8_t>::type index_t;
+
+  void setBit  (index_t n) { uint8_t &v = bits[n/8]; ::setBit  (v, n%8); }
+  void clearBit(index_t n) { uint8_t &v = bits[n/8]; ::clearBit(v, n%8); }
+  bool getBit  (index_t n) { uint8_t &v = bits[n/8]; return ::getBit(v, n%8); }
+  void setAll  (uint8_t v) { for (index_t i = 0; i < BITS/8+1; ++i) bits[i] = v; }
 
 private:
   uint8_t bits[BITS/8+1]{};
@@ -39,12 +43,17 @@ public:
   void clear() { s = 0; }
   uint8_t size()  { return s; }
   void shuffle() {
-    // Queue mischen
-    for (uint8_t i = 0; i < s; ++i) {
-      const uint8_t j = random(0, s);
-      swap(c[i], c[j]);
+    // Queue mischen (Fisher-Yates, jede Reihenfolge gleich wahrscheinlich)
+    for (uint8_t i = s; i > 1; --i) {
+      const uint8_t j = random(0, i);
+      swap(c[i-1], c[j]);
     }
   }
+  // the same seed gives the same order (the random generator continues with this seed)
+  void shuffle(uint16_t seed) {
+    randomSeed(seed);
+    shuffle();
+  }
   // Iterators
   T *begin() { return c.begin(); }
   const T *begin() const { return c.begin(); }
@@ -56,4 +65,110 @@ private:
   uint8_t     s{};
 };
 
+// orders the value and the index of the ring_buffer, a compiler barrier on one core, a memory barrier
+// between the two cores of the ESP32 (producer and consumer in tasks on different cores)
+inline void ringBufferBarrier() {
+#ifdef ESP32
+  __sync_synchronize();
+#else
+  asm volatile("" ::: "memory");
+#endif
+}
+
+// lock-free ring buffer for one producer (e.g. an ISR or a task) and one consumer, N must be a power of 2
+template <class T, uint8_t N>
+class ring_buffer {
+  static_assert(N > 0 && (N & (N-1)) == 0, "N must be a power of 2");
+public:
+  bool push(const T& t) {
+    const uint8_t h = head;
+    if (static_cast<uint8_t>(h - tail) >= N)
+      return false;
+    c[h & (N-1)] = t;
+    ringBufferBarrier(); // write the value before the index
+    head = h + 1;
+    return true;
+  }
+  bool pop(T& t) {
+    const uint8_t tl = tail;
+    if (tl == head)
+      return false;
+    t = c[tl & (N-1)];
+    ringBufferBarrier(); // read the value before the index
+    tail = tl + 1;
+    return true;
+  }
+  uint8_t size() const { return head - tail; }
+  // the i-th value from the oldest one, only for the consumer
+  const T& peek(uint8_t i) const { return c[static_cast<uint8_t>(tail + i) & (N-1)]; }
+  void clear() { tail = head; }
+
+private:
+  T                c[N]{};
+  volatile uint8_t head{};
+  volatile uint8_t tail{};
+};
+
+// queue for a contiguous range of values (first, first+1, ...) with the same
+// interface like queue<>. It does not store the values, shuffle() selects a
+// random permutation of [0, size) that is computed in get() with a small Feistel
+// network and cycle walking. T is the value and index type (uint16_t for more
+// than 255 values).
+template <uint16_t N, class T = uint8_t>
+class permutation_queue {
+public:
+  void push(T t) {
+    if (s == 0)
+      first = t;
+    if (s < N && t == first + s)
+      ++s;
+  }
+  T get(T pos) const {
+    if (not shuffled || s < 2)
+      return first + pos;
+    // the permutation is over [0, 2^bits), walk until the value is in [0, s)
+    T x = pos;
+    do {
+      x = feistel(x);
+    } while (x >= s);
+    return first + x;
+  }
+  void clear() { s = 0; shuffled = false; }
+  T size() const { return s; }
+  void shuffle() { shuffle(random(0, 0x10000)); }
+  void shuffle(uint16_t a_seed) {
+    seed     = a_seed;
+    shuffled = true;
+  }
+
+private:
+  static constexpr uint8_t rounds = 4;
+
+  uint8_t halfBits() const {
+    uint8_t bits = 1;
+    while ((1ul << (2*bits)) < s)
+      ++bits;
+    return bits;
+  }
+  T feistel(T x) const {
+    const uint8_t h    = halfBits();
+    const uint8_t mask = (1u << h) - 1;
+    uint8_t l = (x >> h) & mask;
+    uint8_t r =  x       & mask;
+    for (uint8_t i = 0; i < rounds; ++i) {
+      const uint8_t k = seed >> (4*i);
+      const uint8_t f = ((r * 0x35) ^ (r >> 1) ^ k) + k;
+      const uint8_t t = r;
+      r = (l ^ f) & mask;
+      l = t;
+    }
+    return (static_cast<T>(l) << h) | r;
+  }
+
+  T        first   {};
+  T        s       {};
+  uint16_t seed    {};
+  bool     shuffled{};
+};
+
 #endif /* SRC_QUEUE_HPP_ */
@@ -1,29 +1,68 @@
 #include "constants.hpp"
 #ifdef NEO_RING
 #include "ring.hpp"
+#ifdef NEO_RING_USART
+#include "ws2812_usart.hpp"
+#endif
 
 #include <limits.h>
 
+namespace {
+
+// one period of pulse() from brightness_pulse_min to brightness_pulse_max and back (gamma 2.2)
+const uint8_t pulse_wave[32] PROGMEM = {
+   50,  50,  52,  54,  57,  62,  67,  74,  83,  92, 103, 116, 130, 145, 162, 180,
+  200, 180, 162, 145, 130, 116, 103,  92,  83,  74,  67,  62,  57,  54,  52,  50,
+};
+static_assert(brightness_pulse_min == 50 && brightness_pulse_max == 200, "pulse_wave does not match");
+
+// wheel position per pixel (in 1/256) for level()
+constexpr uint16_t level_per_pixel = 256ul*100/neoPixelNumber;
+
+}
+
 OneRing::OneRing(uint8_t pin, direction dir)
-: brightness_pulse{(dir==direction::cw) ? brightness_pulse_min : brightness_pulse_max}
+: pulse_phase{(dir==direction::cw) ? uint8_t{0} : uint8_t{128}}
 , dir{dir}
 , strip{neoPixelNumber, pin, NEO_GRB + NEO_KHZ800}
-{
-  if (dir==direction::ccw) {
-    brightness_pulse = brightness_pulse_max;
-    brightness_inc *= -1;
-  }
-}
+{}
 
 void OneRing::init() {
   strip.begin();
   strip.setBrightness(brightness);
+#ifdef NEO_RING_USART
+  Ws2812Usart::begin();
+#endif
+}
+
+void OneRing::showStrip(bool force) {
+  if (not dirty)
+    return;
+  if (not force and not frameTimer.isExpired())
+    return;
+#ifdef NEO_RING_USART
+  // the strip only holds the pixels (with brightness), the frame is sent in the background
+  if (not Ws2812Usart::show(strip.getPixels(), strip.numPixels()))
+    return;
+#else
+  strip.show();
+#endif
+  dirty = false;
+  frameTimer.start(neoPixelFrameTime);
+}
+
+void OneRing::setPixel(int pixel, color_t color) {
+  const uint8_t* p = strip.getPixels() + pixel*3;
+  const uint8_t old[3] = { p[0], p[1], p[2] };
+  strip.setPixelColor(pixel, strip.Color(color.r, color.g, color.b));
+  if (p[0] != old[0] or p[1] != old[1] or p[2] != old[2])
+    dirty = true;
 }
 
 void OneRing::pulse(const color_t color) {
-  brightness_pulse += brightness_inc;
-  if (brightness_pulse >= brightness_pulse_max or brightness_pulse <= brightness_pulse_min)
-    brightness_inc *= -1;
+  pulse_phase += pulse_phase_inc;
+  uint8_t brightness_pulse;
+  PROGMEM_read(&pulse_wave[pulse_phase >> 3], brightness_pulse);
 
   setAll(color*brightness_pulse);
 }
@@ -45,7 +84,7 @@ void OneRing::setAll(const color_t color) {
 void OneRing::level(uint8_t l) {
   const uint8_t last = static_cast<uint16_t>(l) * neoPixelNumber / 0xff;
   setAll([last, this](uint8_t i) {
-    return (i <= last) ? wheel(static_cast<uint16_t>(i)*100/neoPixelNumber) : black;}
+    return (i <= last) ? wheel(static_cast<uint16_t>(i)*level_per_pixel >> 8) : black;}
   );
 }
 
@@ -55,7 +94,9 @@ void OneRing::level(uint8_t l) {
 OneRing::color_t OneRing::wheel(byte WheelPos) const {
   color_t color;
   if (WheelPos == 255) WheelPos = 254;
-  const uint16_t WheelPos_times_3 = (WheelPos % 85) * 3;
+  const uint8_t WheelPos_times_3 = (WheelPos < 85 ) ? WheelPos * 3
+                                 : (WheelPos < 170) ? (WheelPos - 85) * 3
+                                 :                    (WheelPos - 170) * 3;
   if (WheelPos < 85) {
     color.r = WheelPos_times_3;
     color.g = 255 - WheelPos_times_3;
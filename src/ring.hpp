@@ -5,6 +5,7 @@
 
 #include "constants.hpp"
 #include "array.hpp"
+#include "timer.hpp"
 
 #include <Adafruit_NeoPixel.h>
 
@@ -30,10 +31,11 @@ public:
     byte r;
     byte g;
     byte b;
+    // fixed point scale with s/256 (instead of s/255), so that 255 * 255 is still 255
     constexpr color_t operator*(const uint8_t s) const {
-      return color_t { static_cast<byte>(static_cast<uint16_t>(r) * s / 255)
-                     , static_cast<byte>(static_cast<uint16_t>(g) * s / 255)
-                     , static_cast<byte>(static_cast<uint16_t>(b) * s / 255) };
+      return color_t { static_cast<byte>(static_cast<uint16_t>(r) * (s+1) >> 8)
+                     , static_cast<byte>(static_cast<uint16_t>(g) * (s+1) >> 8)
+                     , static_cast<byte>(static_cast<uint16_t>(b) * (s+1) >> 8) };
     }
   };
 
@@ -50,18 +52,21 @@ public:
   void call_on_game     () { rainbow  (10   ); }
   void call_on_pause    () { rainbow  (0    ); }
   void call_on_admin    () { pulse    (blue ); }
-  void call_on_sleep    () { setAll   (black); }
+  void call_on_sleep    () { setAll   (black); showStrip(true); }
   void call_on_volume(uint8_t v)
                            { level    (v    ); }
-  void call_on_sleep_timer() { if (++fire_sim%4==0) setAll   (orange*random(100,255)); }
+  void call_on_sleep_timer() { if (++fire_sim%4==0) setAll   (orange*random(100,255)); else showStrip(); }
   void call_before_sleep(uint8_t r) { setAll   (orange*r); }
 
-  void brightness_up    () { if (brightness < brightness_max) ++brightness; strip.setBrightness(brightness); }
-  void brightness_down  () { if (brightness > 0             ) --brightness; strip.setBrightness(brightness); }
+  void brightness_up    () { if (brightness < brightness_max) ++brightness; strip.setBrightness(brightness); dirty = true; }
+  void brightness_down  () { if (brightness > 0             ) --brightness; strip.setBrightness(brightness); dirty = true; }
+  uint8_t getBrightness() const { return brightness; }
 private:
 
-  void showStrip() { strip.show(); }
-  void setPixel(int pixel, color_t color) { strip.setPixelColor(pixel, strip.Color(color.r, color.g, color.b)); }
+  // show() blocks the interrupts (not with NEO_RING_USART), so only send a frame if the pixels changed and at most
+  // every neoPixelFrameTime
+  void showStrip(bool force = false);
+  void setPixel(int pixel, color_t color);
 
   color_t wheel(byte wheelPos) const;
 
@@ -74,8 +79,8 @@ private:
   uint8_t brightness { brightness_init };
 
   // for pulse()
-  uint8_t brightness_pulse{ brightness_pulse_min };
-  int8_t  brightness_inc  { cycleTime*255/pulse_per_second/1000 };
+  static constexpr uint8_t pulse_phase_inc = 256ul*cycleTime*pulse_per_second/1000;
+  uint8_t pulse_phase{ 0 };
 
   // for rainbow()
   uint8_t pixelCycle { 0 };  // Pattern Pixel Cycle
@@ -83,6 +88,10 @@ private:
   // for sleep timer
   uint8_t fire_sim = 0;
 
+  // for showStrip()
+  bool    dirty      { true };
+  Timer   frameTimer {};
+
   direction dir;
 
   Adafruit_NeoPixel strip;
@@ -111,6 +120,7 @@ public:
   void call_before_sleep(uint8_t r) { ring1.call_before_sleep  (r); ring2.call_before_sleep  (r); }
   void brightness_up             () { ring1.brightness_up      ( ); ring2.brightness_up      ( ); }
   void brightness_down           () { ring1.brightness_down    ( ); ring2.brightness_down    ( ); }
+  uint8_t getBrightness    () const { return ring1.getBrightness() ; }
 
 private:
   OneRing ring1;
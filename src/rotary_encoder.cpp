@@ -7,15 +7,48 @@
 
 volatile int8_t  RotaryEncoder::pos = 0;
 
+#ifdef ROTARY_ENCODER_QUADRATURE
+volatile uint8_t RotaryEncoder::state       = 0;
+volatile int8_t  RotaryEncoder::transitions = 0;
+
+namespace {
+// index: (old state << 2) | new state, 0 for no change and for an invalid (skipped) transition
+const int8_t quadratureTable[16] = { 0, -1,  1,  0,
+                                     1,  0,  0, -1,
+                                    -1,  0,  0,  1,
+                                     0,  1, -1,  0 };
+}
+
+void RotaryEncoder::update() {
+  const uint8_t s = (digitalRead(rotaryEncoderClkPin) << 1) | digitalRead(rotaryEncoderDtPin);
+  const int8_t  t = transitions + quadratureTable[(state << 2) | s];
+  state = s;
+  if (t >= static_cast<int8_t>(rotaryEncoderTransitionsPerDetent)) {
+    ++pos;
+    transitions = 0;
+  }
+  else if (t <= -static_cast<int8_t>(rotaryEncoderTransitionsPerDetent)) {
+    --pos;
+    transitions = 0;
+  }
+  else
+    transitions = t;
+}
+#endif // ROTARY_ENCODER_QUADRATURE
+
 #ifdef ROTARY_ENCODER_USES_TIMER1
 volatile uint8_t RotaryEncoder::clk = 0;
 
 void RotaryEncoder::timer_loop() {
+#ifdef ROTARY_ENCODER_QUADRATURE
+  update();
+#else
   const uint8_t old_clk = clk;
   clk = digitalRead(rotaryEncoderClkPin);
   if (clk < old_clk){
     RotaryEncoder::changed();
   }
+#endif
 }
 #endif
 
@@ -39,14 +72,56 @@ RotaryEncoder::RotaryEncoder(const Settings& settings)
   pinMode(rotaryEncoderClkPin, INPUT_PULLUP);
   pinMode(rotaryEncoderDtPin , INPUT_PULLUP);
 
-#ifndef ROTARY_ENCODER_USES_TIMER1
+#ifdef ROTARY_ENCODER_QUADRATURE
+  state = (digitalRead(rotaryEncoderClkPin) << 1) | digitalRead(rotaryEncoderDtPin);
+#if not defined(ROTARY_ENCODER_USES_TIMER1) and not defined(UNIT_TESTS)
+  attachInterrupt(digitalPinToInterrupt(rotaryEncoderClkPin), RotaryEncoder::update, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(rotaryEncoderDtPin ), RotaryEncoder::update, CHANGE);
+#endif
+#else
+#if not defined(ROTARY_ENCODER_USES_TIMER1) and not defined(UNIT_TESTS)
   attachInterrupt(digitalPinToInterrupt(rotaryEncoderClkPin), RotaryEncoder::changed, FALLING);
-#endif // ROTARY_ENCODER_USES_TIMER1
+#endif
+#endif // ROTARY_ENCODER_QUADRATURE
 }
 
 commandRaw RotaryEncoder::getCommandRaw() {
   commandRaw ret = commandRaw::none;
 
+#if defined(ROTARY_ENCODER_QUADRATURE) and not defined(ROTARY_ENCODER_LONGPRESS)
+
+  noInterrupts();
+  const int8_t detents = pos;
+  pos = 0;
+  interrupts();
+
+  if (detents != 0) {
+    // fast turns give more volume steps per click
+    const unsigned long now = millis();
+    const int8_t factor = (now - lastDetentTime < rotaryEncoderAccelTime) ? rotaryEncoderAccelFactor : 1;
+    lastDetentTime = now;
+    const int16_t steps = volumeSteps + detents*factor;
+    volumeSteps = steps >  rotaryEncoderMaxPendingSteps ?  rotaryEncoderMaxPendingSteps
+                : steps < -rotaryEncoderMaxPendingSteps ? -rotaryEncoderMaxPendingSteps
+                : steps;
+  }
+
+  // one volume step per call
+  if (volumeSteps > 0) {
+    ret = getCommandRawFromCommand(command::volume_up);
+    --volumeSteps;
+  }
+  else if (volumeSteps < 0) {
+    ret = getCommandRawFromCommand(command::volume_down);
+    ++volumeSteps;
+  }
+  if (ret != commandRaw::none)
+    LOG(button_log, s_debug, F("Rot Env raw: "), static_cast<uint8_t>(ret), F(" pending: "), volumeSteps);
+
+  return ret;
+
+#else
+
   if (pos == 0)
     return ret;
 
@@ -91,6 +166,8 @@ commandRaw RotaryEncoder::getCommandRaw() {
   }
 
   return ret;
+
+#endif // ROTARY_ENCODER_QUADRATURE and not ROTARY_ENCODER_LONGPRESS
 }
 
 commandRaw RotaryEncoder::getCommandRawFromCommand(const command& cmd) {
@@ -10,7 +10,7 @@
 #include "commands.hpp"
 #include "timer.hpp"
 
-#if not defined(ALLinONE_Plus) and not defined(TonUINO_Every) and not defined(TonUINO_Every_4808)
+#if not defined(ALLinONE_Plus) and not defined(TonUINO_Every) and not defined(TonUINO_Every_4808) and not defined(TonUINO_ESP32) and not defined(UNIT_TESTS)
 #define USE_TIMER1
 #define ROTARY_ENCODER_USES_TIMER1
 #endif
@@ -25,6 +25,10 @@ public:
 #ifdef USE_TIMER1
   static void timer_loop();
 #endif
+#ifdef ROTARY_ENCODER_QUADRATURE
+  // decodes the actual state of both channels, called from the ISR
+  static void update();
+#endif
 private:
 
   commandRaw getCommandRawFromCommand(const command& cmd);
@@ -35,6 +39,13 @@ private:
 #ifdef USE_TIMER1
   volatile static uint8_t clk;
 #endif
+#ifdef ROTARY_ENCODER_QUADRATURE
+  volatile static uint8_t state;       // (clk << 1) | dt of the last sample
+  volatile static int8_t  transitions; // not yet a full detent
+
+  int8_t                  volumeSteps   {};
+  unsigned long           lastDetentTime{};
+#endif
 
 #ifdef ROTARY_ENCODER_LONGPRESS
   Timer vol_timer;
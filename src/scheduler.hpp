@@ -0,0 +1,60 @@
+#ifndef SRC_SCHEDULER_HPP_
+#define SRC_SCHEDULER_HPP_
+
+#include <Arduino.h>
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+template<class Owner>
+struct SchedulerTask {
+  void (Owner::*run)();
+  unsigned long period;
+};
+
+// calls every task with its own period. In between the MCU sleeps in
+// SLEEP_MODE_IDLE and is woken up by the next interrupt (at least the
+// millis() timer interrupt every ms, also pin change or serial interrupts).
+template<uint8_t MaxTasks>
+class Scheduler {
+public:
+  // runs the due tasks for timeSlice ms
+  template<class Owner, uint8_t N>
+  void loop(Owner &owner, const SchedulerTask<Owner> (&tasks)[N], unsigned long timeSlice) {
+    static_assert(N <= MaxTasks, "too many tasks for the scheduler");
+    const unsigned long start = millis();
+    unsigned long       now   = start;
+    if (not started) {
+      started = true;
+      for (uint8_t i = 0; i < N; ++i)
+        nextRun[i] = now;
+    }
+    do {
+      unsigned long nextDue = start + timeSlice;
+      for (uint8_t i = 0; i < N; ++i) {
+        if (isDue(now, nextRun[i])) {
+          (owner.*tasks[i].run)();
+          nextRun[i] = now + tasks[i].period;
+        }
+        if (isDue(nextDue, nextRun[i]))
+          nextDue = nextRun[i];
+      }
+      idle(nextDue);
+      now = millis();
+    } while (now - start < timeSlice);
+  }
+
+private:
+  static bool isDue(unsigned long now, unsigned long time) { return static_cast<long>(now - time) >= 0; }
+
+  static void idle(unsigned long until) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while (not isDue(millis(), until))
+      sleep_mode();
+  }
+
+  unsigned long nextRun[MaxTasks]{};
+  bool          started{false};
+};
+
+#endif /* SRC_SCHEDULER_HPP_ */
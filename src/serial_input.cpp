@@ -2,6 +2,12 @@
 
 #include "constants.hpp"
 #include "logger.hpp"
+#include "latency_trace.hpp"
+#include "memory_monitor.hpp"
+#include "loop_profiler.hpp"
+#include "energy_monitor.hpp"
+#include "telemetry.hpp"
+#include "serial_remote.hpp"
 
 #ifdef SerialInputAsCommand
 SerialInput::SerialInput()
@@ -11,6 +17,10 @@ SerialInput::SerialInput()
 
 commandRaw SerialInput::getCommandRaw() {
   commandRaw ret = commandRaw::none;
+#ifdef SERIAL_REMOTE
+  if (SerialRemote::loop())
+    return ret;
+#endif
   if (Serial.available() > 0) {
     long optionSerial = Serial.parseInt();
     switch (optionSerial) {
@@ -22,6 +32,11 @@ commandRaw SerialInput::getCommandRaw() {
     case -6: ret = commandRaw::pauseLong ; break;
     case -4: ret = commandRaw::allLong   ; break;
     case -1: ret = commandRaw::updownLong; break;
+    case -7: LatencyTrace::printSummary(); break;
+    case -10: MemoryMonitor::printReport(); break;
+    case -11: LoopProfiler::printSummary(); break;
+    case -12: EnergyMonitor::printReport(); break;
+    case -13: Telemetry::printReport(); break;
     default:
       if (optionSerial > 0) {
         ret = commandRaw::menu_jump;
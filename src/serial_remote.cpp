@@ -0,0 +1,173 @@
+#include "serial_remote.hpp"
+
+#include "constants.hpp"
+
+#ifdef SERIAL_REMOTE
+#include "logger.hpp"
+#include "tonuino.hpp"
+#include "state_machine.hpp"
+
+// returns 0xff for an unknown command
+uint8_t SerialRemote::argSize(uint8_t c) {
+  switch (c) {
+  case c_command    : return 1;
+  case c_card_in    : return sizeof(folderSettings);
+  case c_card_out   : return 0;
+  case c_status     : return 0;
+#ifdef TRACK_COUNT_CACHE
+  case c_track_count: return 3;
+#endif
+#ifdef KEYMAP
+  case c_keymap     : return 3;
+#endif
+  }
+  return 0xff;
+}
+
+uint8_t SerialRemote::frame[3+serialRemoteMaxPayload+1]{};
+uint8_t SerialRemote::received{};
+Timer   SerialRemote::byteTimer{};
+
+bool SerialRemote::loop() {
+  if (received == 0 && (Serial.available() == 0 || Serial.peek() != frameStart))
+    return false;
+  // only the bytes already received, a frame can be spread over several cycles
+  while (Serial.available() > 0) {
+    frame[received++] = Serial.read();
+    byteTimer.start(serialRemoteByteTimeout);
+    if (received == 3 && frame[2] > serialRemoteMaxPayload) {
+      sendAck(frame[1], ack_length);
+      received = 0;
+      return true;
+    }
+    if (received >= 3 && received == 3 + frame[2] + 1) {
+      handleFrame();
+      received = 0;
+      return true;
+    }
+  }
+  if (byteTimer.isExpired()) { // the frame is incomplete
+    if (received >= 2)
+      sendAck(frame[1], ack_length);
+    received = 0;
+  }
+  return true;
+}
+
+void SerialRemote::handleFrame() {
+  const uint8_t  seq     = frame[1];
+  const uint8_t  len     = frame[2];
+  const uint8_t* payload = &frame[3];
+  uint8_t sum = seq + len;
+  for (uint8_t i = 0; i < len; ++i)
+    sum += payload[i];
+  if (sum != payload[len]) {
+    sendAck(seq, ack_checksum);
+    return;
+  }
+  const ackCode code = check(payload, len);
+  if (code == ack_ok)
+    execute(payload, len, seq);
+  sendAck(seq, code);
+}
+
+// the whole frame is checked before the first command is executed
+SerialRemote::ackCode SerialRemote::check(const uint8_t* payload, uint8_t len) {
+  for (uint8_t i = 0; i < len; i += 1 + argSize(payload[i])) {
+    const uint8_t size = argSize(payload[i]);
+    if (size == 0xff || i + size >= len) // unknown or argument missing
+      return ack_command;
+    if (payload[i] == c_command && (payload[i+1] == static_cast<uint8_t>(commandRaw::none) ||
+                                    payload[i+1] >= static_cast<uint8_t>(commandRaw::menu_jump)))
+      return ack_command;
+    if (payload[i] == c_track_count && (payload[i+1] == 0 || payload[i+1] > 99 ||
+                                        (payload[i+2] == 0 && payload[i+3] == 0)))
+      return ack_command;
+    if (payload[i] == c_keymap && (payload[i+1] == static_cast<uint8_t>(commandRaw::none) ||
+                                   payload[i+1] >= static_cast<uint8_t>(commandRaw::cmd_end) ||
+                                   payload[i+2] >  static_cast<uint8_t>(state_for_command::play_invert) ||
+                                   payload[i+3] >= static_cast<uint8_t>(command::adm_end)))
+      return ack_command;
+  }
+  return ack_ok;
+}
+
+void SerialRemote::execute(const uint8_t* payload, uint8_t len, uint8_t seq) {
+  Tonuino &tonuino = Tonuino::getTonuino();
+  for (uint8_t i = 0; i < len; i += 1 + argSize(payload[i])) {
+    const uint8_t* arg = &payload[i+1];
+    switch (payload[i]) {
+    case c_command:
+      LOG(tonuino_log, s_debug, F("remote cmd: "), arg[0]);
+      SM_tonuino::dispatch(command_e(static_cast<commandRaw>(arg[0])));
+      break;
+    case c_card_in: {
+      folderSettings card{ arg[0], static_cast<pmode_t>(arg[1]), arg[2], arg[3] };
+      LOG(tonuino_log, s_debug, F("remote card in: "), card.folder);
+      tonuino.getChipCard().simulateCard(card);
+      tonuino.dispatchCard(cardEvent::inserted);
+      // not read in every state (e.g. StartPlay), the next physical card must not get this content
+      tonuino.getChipCard().endSimulation();
+      break;
+    }
+    case c_card_out:
+      LOG(tonuino_log, s_debug, F("remote card out"));
+      tonuino.dispatchCard(cardEvent::removed);
+      break;
+    case c_status:
+      sendStatus(seq);
+      break;
+#ifdef TRACK_COUNT_CACHE
+    case c_track_count: {
+      const uint16_t count = arg[1] | (arg[2] << 8);
+      LOG(tonuino_log, s_debug, F("remote track count: "), arg[0], F(": "), count);
+      tonuino.getMp3().setTrackCount(arg[0], count);
+      break;
+    }
+#endif
+#ifdef KEYMAP
+    case c_keymap:
+      LOG(tonuino_log, s_debug, F("remote keymap: "), arg[0], F(" "), arg[1], F(": "), arg[2]);
+      if (not tonuino.getCommands().setKeymap(static_cast<commandRaw>(arg[0]), static_cast<state_for_command>(arg[1]),
+                                             static_cast<command>(arg[2])))
+        LOG(tonuino_log, s_error, F("keymap full"));
+      break;
+#endif
+    }
+  }
+}
+
+void SerialRemote::sendAck(uint8_t seq, ackCode code) {
+  Serial.write(ackStart);
+  Serial.write(seq);
+  Serial.write(static_cast<uint8_t>(code));
+}
+
+void SerialRemote::write16(uint16_t v) {
+  Serial.write(static_cast<uint8_t>(v));
+  Serial.write(static_cast<uint8_t>(v >> 8));
+}
+
+void SerialRemote::sendStatus(uint8_t seq) {
+  Tonuino &tonuino = Tonuino::getTonuino();
+  Mp3     &mp3     = tonuino.getMp3();
+  state s = st_admin;
+  if      (SM_tonuino::is_in_state<Idle     >()) s = st_idle;
+  else if (SM_tonuino::is_in_state<StartPlay>()) s = st_startPlay;
+  else if (SM_tonuino::is_in_state<Play     >()) s = st_play;
+  else if (SM_tonuino::is_in_state<Pause    >()) s = st_pause;
+  else if (SM_tonuino::is_in_state<Quiz     >()) s = st_quiz;
+  else if (SM_tonuino::is_in_state<Memory   >()) s = st_memory;
+
+  Serial.write(statusStart);
+  Serial.write(seq);
+  Serial.write(static_cast<uint8_t>(s));
+  Serial.write(tonuino.getFolder());
+  Serial.write(static_cast<uint8_t>(tonuino.getMyFolder().mode));
+  write16(mp3.getCurrentTrack());
+  Serial.write(mp3.getVolume());
+  write16(mp3.getQueuePos());
+  write16(mp3.getQueueSize());
+}
+
+#endif // SERIAL_REMOTE
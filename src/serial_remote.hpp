@@ -0,0 +1,76 @@
+#ifndef SRC_SERIAL_REMOTE_HPP_
+#define SRC_SERIAL_REMOTE_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+#include "timer.hpp"
+
+#ifdef SERIAL_REMOTE
+#ifndef SerialInputAsCommand
+#error "SERIAL_REMOTE needs SerialInputAsCommand"
+#endif
+
+// framed binary remote control via the serial input (for scripted tests on a box).
+// Every frame carries a batch of commands, they are dispatched in order to the
+// state machine. Each frame is answered with an ack, a status request additionally
+// with a status snapshot. With TRACK_COUNT_CACHE the track counts of the folders can
+// be provisioned in bulk (tools/sd_card_index.py), so the DfPlayer is not asked. With
+// KEYMAP the buttons are remapped (stored in the EEPROM).
+//
+//   request: frameStart, seq, len, len bytes commands, checksum (sum of seq, len and commands)
+//   ack    : ackStart   , seq, ackCode
+//   status : statusStart, seq, state, folder, mode, track (2 byte), volume, queue pos (2 byte), queue size (2 byte)
+//
+// all 16 bit values little endian
+class SerialRemote {
+public:
+  static constexpr uint8_t frameStart  = 0x5a; // not a character of the text input
+  static constexpr uint8_t ackStart    = 0xa6;
+  static constexpr uint8_t statusStart = 0xa7;
+
+  enum cmd: uint8_t {
+    c_command     = 0x01, // + commandRaw
+    c_card_in     = 0x02, // + folderSettings (folder, mode, special, special2)
+    c_card_out    = 0x03,
+    c_status      = 0x04,
+    c_track_count = 0x05, // + folder (1..99), track count (2 byte), only with TRACK_COUNT_CACHE
+    c_keymap      = 0x06, // + commandRaw, state_for_command, command, only with KEYMAP
+  };
+  enum ackCode: uint8_t {
+    ack_ok      ,
+    ack_checksum,
+    ack_length  , // frame too long or incomplete
+    ack_command , // unknown command or argument, nothing is executed
+  };
+  enum state: uint8_t {
+    st_idle     ,
+    st_startPlay,
+    st_play     ,
+    st_pause    ,
+    st_quiz     ,
+    st_memory   ,
+    st_admin    , // all the other states
+  };
+
+  // collects the bytes of a frame without waiting and executes it when complete. An incomplete frame is
+  // dropped (ack_length) after serialRemoteByteTimeout without a byte. Returns true while a frame is received.
+  static bool loop();
+
+private:
+  static void    handleFrame();
+  static ackCode check  (const uint8_t* payload, uint8_t len);
+  static void    execute(const uint8_t* payload, uint8_t len, uint8_t seq);
+  static void    sendAck   (uint8_t seq, ackCode code);
+  static void    sendStatus(uint8_t seq);
+  static void    write16   (uint16_t v);
+  static uint8_t argSize   (uint8_t c);
+
+  static uint8_t frame[3+serialRemoteMaxPayload+1]; // frameStart, seq, len, payload, checksum
+  static uint8_t received;
+  static Timer   byteTimer;
+};
+
+#endif // SERIAL_REMOTE
+
+#endif /* SRC_SERIAL_REMOTE_HPP_ */
@@ -2,15 +2,27 @@
 
 #include "constants.hpp"
 #include "logger.hpp"
+#include "eeprom_journal.hpp"
+#include "eeprom_kv_store.hpp"
+#include "timer.hpp"
 
 namespace {
 
 //  ############### EEPROM ################################
 //  Address       Usage
 //    0- 99       Folder Settings (Hoerbuch Fortschritt)
+//                with FOLDER_PROGRESS_KV: key-value store (4 Byte per slot, Every/AiOplus: 12, others: 25 slots)
 //  100-140       AdminSettings (41 Byte)
-//  141-155       reserved (15 Byte)
-//  156-255       extra Shortcuts (100 Byte, max. 25 Shortcuts)
+//  141-150       Folder Settings high byte of the folders 1-10 (only with LARGE_FOLDERS, not with FOLDER_PROGRESS_KV)
+//  151           reserved (1 Byte), with PACKED_SHORTCUTS: format of the extra Shortcuts
+//  152-155       boot counter (4 Byte, only with FAST_BOOT)
+//  156-255       extra Shortcuts (100 Byte, 25 Shortcuts, with PACKED_SHORTCUTS: 50 Shortcuts with 2 Byte)
+//  256-455       track count cache (200 Byte, only with TRACK_COUNT_CACHE_EEPROM)
+//  456-..        journal (TonUINO_Classic: 94 records, ALLinONE: 9 records, only with EEPROM_JOURNAL)
+//                with RESUME_SNAPSHOT: one record lesser and the snapshot (8 Byte) at the end
+//                with TELEMETRY: lesser records and the telemetry counters (2 or 4 Byte each) before the snapshot
+//                with KEYMAP: lesser records and the keymap (3 Byte per entry, format byte) at the end
+//                with MEMORY_UID_MATCH: lesser records and the memory cards (5 Byte per card, format byte) before the keymap
 
 // Nano:      2048 byte
 // Nano Every: 256 byte
@@ -21,10 +33,384 @@ constexpr uint16_t startAddressFolderSettings =   0;
 constexpr uint16_t startAddressAdminSettings  = 100;
 constexpr uint16_t startAddressExtraShortcuts = 156;
 constexpr uint16_t endAddress                 = 256;
+#ifdef FAST_BOOT
+constexpr uint16_t startAddressBootCount      = 152;
+#endif
+#ifdef FOLDER_PROGRESS_KV
+EepromKvStore folderProgress{startAddressFolderSettings, folderProgressSlots};
+static_assert(startAddressFolderSettings + folderProgressSlots * EepromKvStore::slotSize <= startAddressAdminSettings, "Too many folder progress slots");
+#elif defined(LARGE_FOLDERS)
+constexpr uint16_t startAddressFolderHigh     = 140; // + folder
+static_assert(startAddressFolderHigh + largeFolderLast < 152, "Too many large folders");
+
+bool isLargeFolder(uint8_t folder) { return folder >= 1 && folder <= largeFolderLast; }
+#endif
+#ifdef PACKED_SHORTCUTS
+constexpr uint16_t addressShortcutFormat      = 151;
+#if defined(LARGE_FOLDERS) and not defined(FOLDER_PROGRESS_KV)
+static_assert(startAddressFolderHigh + largeFolderLast < addressShortcutFormat, "Too many large folders");
+#endif
+#endif
+#ifdef TRACK_COUNT_CACHE_EEPROM
+constexpr uint16_t startAddressTrackCounts    = 256;
+constexpr uint16_t endAddressTrackCounts      = startAddressTrackCounts + 100 * sizeof(uint16_t);
+#endif
+#if defined(TonUINO_Classic)
+constexpr uint16_t endAddressEeprom           = 1024;
+#elif defined(ALLinONE)
+constexpr uint16_t endAddressEeprom           = 512;
+#endif
+#ifdef KEYMAP
+constexpr uint16_t addressKeymapFormat        = endAddressEeprom - 1;
+constexpr uint16_t startAddressKeymap         = addressKeymapFormat - keymapEntries * sizeof(Settings::keymap_entry_t);
+constexpr uint8_t  keymapFormat               = 0x4b; // version 1
+static_assert(startAddressKeymap >= 456, "Too many keymap entries");
+#endif
+#ifdef MEMORY_UID_MATCH
+#ifdef KEYMAP
+constexpr uint16_t endAddressMemoryUids       = startAddressKeymap;
+#else
+constexpr uint16_t endAddressMemoryUids       = endAddressEeprom;
+#endif
+constexpr uint16_t addressMemoryUidsFormat    = endAddressMemoryUids - 1;
+constexpr uint16_t startAddressMemoryUids     = addressMemoryUidsFormat - memoryUidEntries * sizeof(Settings::memory_uid_t);
+constexpr uint8_t  memoryUidsFormat           = 0x4d; // version 1: 4 byte of the UID
+static_assert(startAddressMemoryUids >= 456, "Too many memory cards (memoryUidEntries)");
+#endif
+
+// home location of the folder settings (folder < 100)
+void writeFolderSettingHome(uint8_t folder, uint16_t track) {
+#ifdef FOLDER_PROGRESS_KV
+  folderProgress.write(folder, track);
+#else
+  EEPROM_update(startAddressFolderSettings + folder, static_cast<uint8_t>(track));
+#ifdef LARGE_FOLDERS
+  if (isLargeFolder(folder))
+    EEPROM_update(startAddressFolderHigh + folder, static_cast<uint8_t>(track >> 8));
+#endif
+#endif
+}
+
+uint16_t readFolderSettingHome(uint8_t folder) {
+#ifdef FOLDER_PROGRESS_KV
+  uint16_t track = 0;
+  folderProgress.read(folder, track);
+  return track;
+#else
+#ifdef LARGE_FOLDERS
+  if (isLargeFolder(folder))
+    return EEPROM.read(startAddressFolderSettings + folder) | (EEPROM.read(startAddressFolderHigh + folder) << 8);
+#endif
+  return EEPROM.read(startAddressFolderSettings + folder);
+#endif
+}
+
+#ifdef SETTINGS_CRC
+constexpr uint8_t offsetSettingsCrc = offsetof(Settings, dummy);
+
+// CRC-8 (polynomial 0x07) over the settings without the CRC byte
+uint8_t settingsCrc(const Settings& settings) {
+  const uint8_t *p = reinterpret_cast<const uint8_t*>(&settings);
+  uint8_t crc = 0xff;
+  for (uint8_t i = 0; i < sizeof(Settings); ++i) {
+    if (i == offsetSettingsCrc)
+      continue;
+    crc ^= p[i];
+    for (uint8_t bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+#endif
+
+// extra shortcuts in the former layout (4 byte each)
+constexpr uint8_t rawShortcuts = (endAddress - startAddressExtraShortcuts) / sizeof(folderSettings);
+
+void readExtShortCutRaw(uint8_t shortCut, folderSettings& value) {
+  EEPROM_get(startAddressExtraShortcuts + shortCut * sizeof(folderSettings), value);
+}
+
+#ifdef PACKED_SHORTCUTS
+// The extra shortcuts are stored one after the other with variable length:
+//   header  : mode (low nibble, admin_card as 0xf), number of the following special bytes (bit 4-5)
+//   folder
+//   special : if special or special2 != 0
+//   special2: if special2 != 0
+// The last card (lastSortCut) is the first one, it is written most often. The header packedEnd follows the last
+// stored shortcut, all shortcuts behind it are empty and need no space. A change of the length moves all following
+// shortcuts. The format byte is packedShortcutsBusy while the shortcuts are moved (the new shortcut is written
+// before the marker is set again), after a power fail during the move all extra shortcuts are cleared.
+// The former layout is converted once at startup (loadSettingsFromFlash).
+constexpr uint8_t  packedShortcutsMarker = 0x5c;
+constexpr uint8_t  packedShortcutsBusy   = 0x5d;
+constexpr uint8_t  packedShortcuts       = lastSortCut + 1;
+constexpr uint8_t  packedMinSize         = 2;
+constexpr uint8_t  packedEnd             = 0xff; // number of special bytes 3 is invalid
+constexpr uint8_t  rawLastSortCut        = rawShortcuts - 1;
+static_assert(packedShortcuts * packedMinSize <= endAddress - startAddressExtraShortcuts, "Too many ExtraShortCuts");
+
+uint8_t packedSpecials(uint8_t header) {
+  return (header >> 4) & 0x03;
+}
+uint8_t packedSpecials(const folderSettings& value) {
+  return value.special2 != 0 ? 2 : value.special != 0 ? 1 : 0;
+}
+bool isPackedEnd(uint16_t address) {
+  return address >= endAddress || packedSpecials(EEPROM.read(address)) > 2;
+}
+bool isEmpty(const folderSettings& value) {
+  return value.folder == 0 && value.mode == pmode_t::none && value.special == 0 && value.special2 == 0;
+}
+uint8_t packedPosition(uint8_t shortCut) {
+  return shortCut == lastSortCut ? 0 : shortCut + 1;
+}
+
+// address of the shortcut at the position or of the end if there are less shortcuts stored (count)
+uint16_t packedAddress(uint8_t position, uint8_t &count) {
+  uint16_t address = startAddressExtraShortcuts;
+  for (count = 0; count < position && not isPackedEnd(address); ++count)
+    address += packedMinSize + packedSpecials(EEPROM.read(address));
+  return address;
+}
+uint16_t packedEndAddress() {
+  uint8_t count;
+  return packedAddress(packedShortcuts, count);
+}
+
+// returns the size
+uint8_t writePacked(uint16_t address, const folderSettings& value) {
+  const uint8_t specials = packedSpecials(value);
+  EEPROM_update(address  , static_cast<uint8_t>((static_cast<uint8_t>(value.mode) & 0x0f) | (specials << 4)));
+  EEPROM_update(address+1, value.folder);
+  if (specials > 0)
+    EEPROM_update(address+2, value.special );
+  if (specials > 1)
+    EEPROM_update(address+3, value.special2);
+  return packedMinSize + specials;
+}
+void writePackedEnd(uint16_t address) {
+  if (address < endAddress)
+    EEPROM_update(address, packedEnd);
+}
+
+void clearPacked() {
+  writePackedEnd(startAddressExtraShortcuts);
+  EEPROM_update(addressShortcutFormat, packedShortcutsMarker);
+}
+
+folderSettings readRawShortcut(uint8_t shortCut) {
+  folderSettings value{ 0, pmode_t::none, 0, 0 };
+  if (shortCut < rawShortcuts)
+    readExtShortCutRaw(shortCut, value);
+  // not initialized EEPROM
+  if (value.folder == 0xff && value.special == 0xff && value.special2 == 0xff)
+    value = { 0, pmode_t::none, 0, 0 };
+  return value;
+}
+
+void convertToPacked() {
+  LOG(settings_log, s_info, F("packShortcuts"));
+  EEPROM_update(addressShortcutFormat, packedShortcutsBusy);
+  // the written shortcuts (max. 4 byte each) end before the next raw shortcut, that is not yet read
+  folderSettings value = readRawShortcut(rawLastSortCut);
+  folderSettings next  = readRawShortcut(0);
+  uint16_t address = startAddressExtraShortcuts;
+  uint16_t end     = address;
+  for (uint8_t position = 0; position < rawShortcuts; ++position) {
+    address += writePacked(address, value);
+    if (not isEmpty(value))
+      end = address;
+    value = next;
+    next  = position+1 < rawLastSortCut ? readRawShortcut(position+1) : folderSettings{ 0, pmode_t::none, 0, 0 };
+  }
+  writePackedEnd(end);
+  EEPROM_update(addressShortcutFormat, packedShortcutsMarker);
+}
+
+void loadPacked() {
+  const uint8_t format = EEPROM.read(addressShortcutFormat);
+  if (format == packedShortcutsBusy) {
+    LOG(settings_log, s_error, F("shortcuts lost"));
+    clearPacked();
+  }
+  else if (format != packedShortcutsMarker)
+    convertToPacked();
+}
+
+void readExtShortCutHome(uint8_t shortCut, folderSettings& value) {
+  value = { 0, pmode_t::none, 0, 0 };
+  if (shortCut > lastSortCut)
+    return;
+  uint8_t count;
+  const uint16_t address = packedAddress(packedPosition(shortCut), count);
+  if (isPackedEnd(address))
+    return;
+  const uint8_t header = EEPROM.read(address);
+  const uint8_t mode   = header & 0x0f;
+  value.mode   = mode == 0x0f ? pmode_t::admin_card : static_cast<pmode_t>(mode);
+  value.folder = EEPROM.read(address+1);
+  const uint8_t specials = packedSpecials(header);
+  if (specials > 0)
+    value.special  = EEPROM.read(address+2);
+  if (specials > 1)
+    value.special2 = EEPROM.read(address+3);
+}
+
+bool writeExtShortCutHome(uint8_t shortCut, const folderSettings& value) {
+  if (shortCut > lastSortCut)
+    return false;
+  const uint8_t  position = packedPosition(shortCut);
+  uint8_t        count;
+  const uint16_t address  = packedAddress(position, count);
+  const uint8_t  newSize  = packedMinSize + packedSpecials(value);
+  if (count < position || isPackedEnd(address)) {
+    // behind the end: the empty shortcuts before are added
+    if (isEmpty(value))
+      return true;
+    const uint16_t end = address + (position - count) * packedMinSize + newSize;
+    if (end > endAddress) {
+      LOG(settings_log, s_error, F("no space for shortcut "), shortCut);
+      return false;
+    }
+    EEPROM_update(addressShortcutFormat, packedShortcutsBusy);
+    writePackedEnd(end);
+    uint16_t a = address;
+    for (; count < position; ++count)
+      a += writePacked(a, { 0, pmode_t::none, 0, 0 });
+    writePacked(a, value);
+    EEPROM_update(addressShortcutFormat, packedShortcutsMarker);
+    return true;
+  }
+  const uint8_t oldSize = packedMinSize + packedSpecials(EEPROM.read(address));
+  if (newSize == oldSize) {
+    writePacked(address, value);
+    return true;
+  }
+  const uint16_t from = address + oldSize;
+  const uint16_t to   = address + newSize;
+  const uint16_t end  = packedEndAddress();
+  if (end - oldSize + newSize > endAddress) {
+    LOG(settings_log, s_error, F("no space for shortcut "), shortCut);
+    return false;
+  }
+  EEPROM_update(addressShortcutFormat, packedShortcutsBusy);
+  if (to < from) {
+    for (uint16_t i = 0; i < end - from; ++i)
+      EEPROM_update(to + i, EEPROM.read(from + i));
+  }
+  else {
+    for (uint16_t i = end - from; i-- > 0; )
+      EEPROM_update(to + i, EEPROM.read(from + i));
+  }
+  writePackedEnd(end - oldSize + newSize);
+  writePacked(address, value);
+  EEPROM_update(addressShortcutFormat, packedShortcutsMarker);
+  return true;
+}
+#else
+void readExtShortCutHome(uint8_t shortCut, folderSettings& value) {
+  readExtShortCutRaw(shortCut, value);
+}
+
+bool writeExtShortCutHome(uint8_t shortCut, const folderSettings& value) {
+  const int address = startAddressExtraShortcuts + shortCut * sizeof(folderSettings);
+  const byte *p = (const byte *)(const void *)&value;
+  for (uint8_t i = 0; i < sizeof(folderSettings); ++i)
+    EEPROM_update(address + i, p[i]);
+  return true;
+}
+#endif // PACKED_SHORTCUTS
+
+#ifdef EEPROM_JOURNAL
+constexpr uint8_t noPendingFolder = 0xff;
+struct {
+  uint8_t        folder  {noPendingFolder};
+  uint16_t       track   {};
+  bool           lastCard{};
+  folderSettings lastCardValue{};
+#ifdef RESUME_SNAPSHOT
+  bool           snapshot{};
+  Settings::snapshot_t snapshotValue{};
+#endif
+  Timer          timer   {};
+} pending;
+
+#if defined(TonUINO_Classic) or defined(ALLinONE)
+constexpr uint8_t  journalKeyLastCard  = 0xfe;
+constexpr uint16_t startAddressJournal = 456;
+#if defined(MEMORY_UID_MATCH)
+constexpr uint16_t endAddressRegion    = startAddressMemoryUids;
+#elif defined(KEYMAP)
+constexpr uint16_t endAddressRegion    = startAddressKeymap;
+#else
+constexpr uint16_t endAddressRegion    = endAddressEeprom;
+#endif
+#ifdef RESUME_SNAPSHOT
+constexpr uint8_t  journalKeySnapshot  = 0xfc; // + 0, 1
+constexpr uint16_t startAddressSnapshot= endAddressRegion - sizeof(Settings::snapshot_t);
+static_assert(sizeof(Settings::snapshot_t) == 2 * EepromJournal::valueSize, "snapshot does not fit 2 journal values");
+#else
+constexpr uint16_t startAddressSnapshot= endAddressRegion;
+#endif
+#ifdef TELEMETRY
+constexpr uint8_t  journalKeyTelemetry = 0xc0; // + part
+constexpr uint16_t startAddressTelemetry = startAddressSnapshot - Telemetry::parts * EepromJournal::valueSize;
+constexpr uint16_t endAddressJournal   = startAddressTelemetry;
+static_assert(journalKeyTelemetry + Telemetry::parts <= journalKeySnapshot, "Too many telemetry counters");
+#else
+constexpr uint16_t endAddressJournal   = startAddressSnapshot;
+#endif
+constexpr uint16_t journalRecords      = (endAddressJournal - startAddressJournal) / EepromJournal::recordSize;
+static_assert(journalRecords < 0xff, "Too many journal records");
+
+void writeLastCardHome(const EepromJournal::value_t& value) {
+  folderSettings lastCard;
+  memcpy(&lastCard, value.begin(), sizeof(folderSettings));
+  writeExtShortCutHome(lastSortCut, lastCard);
+}
+
+void foldJournal(uint8_t key, const EepromJournal::value_t& value) {
+  if (key < 100)
+    writeFolderSettingHome(key, value[0] | (value[1] << 8));
+  else if (key == journalKeyLastCard)
+    writeLastCardHome(value);
+#ifdef RESUME_SNAPSHOT
+  else if (key == journalKeySnapshot || key == journalKeySnapshot+1) {
+    const int address = startAddressSnapshot + (key - journalKeySnapshot) * EepromJournal::valueSize;
+    for (uint8_t i = 0; i < EepromJournal::valueSize; ++i)
+      EEPROM_update(address + i, value[i]);
+  }
+#endif
+#ifdef TELEMETRY
+  else if (key >= journalKeyTelemetry && key < journalKeyTelemetry + Telemetry::parts) {
+    const int address = startAddressTelemetry + (key - journalKeyTelemetry) * EepromJournal::valueSize;
+    for (uint8_t i = 0; i < EepromJournal::valueSize; ++i)
+      EEPROM_update(address + i, value[i]);
+  }
+#endif
+}
+
+EepromJournal journal{startAddressJournal, journalRecords, foldJournal};
+
+#ifdef TELEMETRY
+void clearTelemetryHome() {
+  for (uint16_t i = startAddressTelemetry; i < startAddressSnapshot; ++i)
+    EEPROM_update(i, static_cast<uint8_t>(0));
+}
+#endif
+#define EEPROM_JOURNAL_REGION
+#endif // TonUINO_Classic or ALLinONE
+#if defined(RESUME_SNAPSHOT) and not defined(EEPROM_JOURNAL_REGION)
+#error "RESUME_SNAPSHOT needs TonUINO_Classic or ALLinONE"
+#endif
+static_assert(sizeof(folderSettings) == EepromJournal::valueSize, "journal value does not fit folderSettings");
+#endif // EEPROM_JOURNAL
 
 #ifdef BUTTONS3X3
-constexpr uint16_t maxExtraShortcuts = (endAddress - startAddressExtraShortcuts) / sizeof(folderSettings);
-static_assert(buttonExtSC_buttons < maxExtraShortcuts, "Too many ExtraShortCuts");
+static_assert(buttonExtSC_buttons <= lastSortCut, "Too many ExtraShortCuts");
+#endif
+#ifndef PACKED_SHORTCUTS
+static_assert(lastSortCut < rawShortcuts, "Too many ExtraShortCuts");
 #endif
 }
 
@@ -33,12 +419,57 @@ void Settings::clearEEPROM() {
   for (uint16_t i = startAddressFolderSettings; i < endAddress; ++i) {
     EEPROM.write(i, '\0');
   }
+#ifdef PACKED_SHORTCUTS
+  clearPacked();
+#endif
+#ifdef FOLDER_PROGRESS_KV
+  folderProgress.clear();
+#endif
+#ifdef TRACK_COUNT_CACHE_EEPROM
+  clearTrackCountsInFlash();
+#endif
+#ifdef KEYMAP
+  clearKeymapInFlash();
+#endif
+#ifdef MEMORY_UID_MATCH
+  clearMemoryUidsInFlash();
+#endif
+#ifdef EEPROM_JOURNAL
+  pending.folder   = noPendingFolder;
+  pending.lastCard = false;
+#ifdef RESUME_SNAPSHOT
+  pending.snapshot = false;
+  for (uint16_t i = startAddressSnapshot; i < endAddressRegion; ++i)
+    EEPROM.write(i, '\0');
+#endif
+#ifdef TELEMETRY
+  clearTelemetryHome();
+  Telemetry::clear();
+#endif
+  pending.timer.stop();
+#ifdef EEPROM_JOURNAL_REGION
+  journal.clear();
+#endif
+#endif
 }
 
 void Settings::writeSettingsToFlash() {
   static_assert(startAddressExtraShortcuts-startAddressAdminSettings > sizeof(Settings), "Settings to big");
+#ifdef FAST_BOOT
+  static_assert(startAddressBootCount-startAddressAdminSettings >= sizeof(Settings), "Settings to big");
+#endif
   LOG(settings_log, s_debug, F("writeSettingsToFlash"));
-  EEPROM_put(startAddressAdminSettings, *this);
+  // only the changed bytes are written (3.3 ms each on AVR)
+  const uint8_t *p = reinterpret_cast<const uint8_t*>(this);
+  for (uint8_t i = 0; i < sizeof(Settings); ++i) {
+#ifdef SETTINGS_CRC
+    if (i == offsetSettingsCrc) {
+      EEPROM_update(startAddressAdminSettings + i, settingsCrc(*this));
+      continue;
+    }
+#endif
+    EEPROM_update(startAddressAdminSettings + i, p[i]);
+  }
 }
 
 void Settings::resetSettings() {
@@ -72,8 +503,60 @@ void Settings::resetSettings() {
 void Settings::loadSettingsFromFlash() {
   LOG(settings_log, s_debug, F("loadSettings"));
   EEPROM_get(startAddressAdminSettings, *this);
-  if (cookie != cardCookie)
+#ifdef SETTINGS_CRC
+  const uint8_t crc = dummy;
+  dummy = 0;
+  if (cookie == cardCookie && crc != settingsCrc(*this)) {
+    if (crc == 0) {
+      LOG(settings_log, s_info, F("add CRC"));
+      EEPROM_update(startAddressAdminSettings + offsetSettingsCrc, settingsCrc(*this));
+    }
+    else {
+      LOG(settings_log, s_error, F("wrong CRC"));
+      cookie = 0; // --> reset
+    }
+  }
+#endif
+  if (cookie != cardCookie) {
     resetSettings();
+#ifdef TRACK_COUNT_CACHE_EEPROM
+    clearTrackCountsInFlash();
+#endif
+#ifdef KEYMAP
+    clearKeymapInFlash();
+#endif
+#ifdef MEMORY_UID_MATCH
+    clearMemoryUidsInFlash();
+#endif
+#ifdef TELEMETRY
+    clearTelemetryHome();
+#endif
+#ifdef EEPROM_JOURNAL_REGION
+    journal.clear();
+#endif
+  }
+#ifdef EEPROM_JOURNAL_REGION
+  else
+    journal.init();
+#endif
+
+#ifdef PACKED_SHORTCUTS
+  loadPacked();
+#endif
+#ifdef KEYMAP
+  // the region may hold the data of a firmware without KEYMAP
+  if (EEPROM.read(addressKeymapFormat) != keymapFormat) {
+    LOG(settings_log, s_info, F("no keymap"));
+    clearKeymapInFlash();
+  }
+#endif
+#ifdef MEMORY_UID_MATCH
+  // the region may hold the data of a firmware without MEMORY_UID_MATCH or with the 2 byte hash of the UID
+  if (EEPROM.read(addressMemoryUidsFormat) != memoryUidsFormat) {
+    LOG(settings_log, s_info, F("no memory cards"));
+    clearMemoryUidsInFlash();
+  }
+#endif
 
   if (pauseWhenCardRemoved == 255) {
     pauseWhenCardRemoved = 0;
@@ -97,25 +580,248 @@ void Settings::loadSettingsFromFlash() {
   LOG(settings_log, s_info, F("PCR:"), pauseWhenCardRemoved);
 }
 
-void Settings::writeFolderSettingToFlash(uint8_t folder, uint8_t track) {
+#ifndef EEPROM_JOURNAL
+void Settings::writeFolderSettingToFlash(uint8_t folder, uint16_t track) {
   if (folder < 100)
-    EEPROM.write(folder, track);
+    writeFolderSettingHome(folder, track);
 }
 
-uint8_t Settings::readFolderSettingFromFlash(uint8_t folder) {
-  return (folder < 100)? EEPROM.read(folder) : 0;
+uint16_t Settings::readFolderSettingFromFlash(uint8_t folder) {
+  return (folder < 100)? readFolderSettingHome(folder) : 0;
 }
 
-void Settings::writeExtShortCutToFlash (uint8_t shortCut, const folderSettings& value) {
-  const int address = startAddressExtraShortcuts + shortCut * sizeof(folderSettings);
-  EEPROM_put(address, value);
+bool Settings::writeExtShortCutToFlash (uint8_t shortCut, const folderSettings& value) {
+  return writeExtShortCutHome(shortCut, value);
 }
 
 void Settings::readExtShortCutFromFlash(uint8_t shortCut,       folderSettings& value) {
-  const int address = startAddressExtraShortcuts + shortCut * sizeof(folderSettings);
-  EEPROM_get(address, value);
+  readExtShortCutHome(shortCut, value);
+}
+
+#else // EEPROM_JOURNAL
+void Settings::writeFolderSettingToFlash(uint8_t folder, uint16_t track) {
+  if (folder >= 100)
+    return;
+  // only one folder is pending
+  if (pending.folder != folder)
+    flushToFlash();
+  pending.folder = folder;
+  pending.track  = track;
+  if (not pending.timer.isActive())
+    pending.timer.start(eepromLazyWriteTime);
+}
+
+uint16_t Settings::readFolderSettingFromFlash(uint8_t folder) {
+  if (folder >= 100)
+    return 0;
+  if (pending.folder == folder)
+    return pending.track;
+#ifdef EEPROM_JOURNAL_REGION
+  EepromJournal::value_t value;
+  if (journal.read(folder, value))
+    return value[0] | (value[1] << 8);
+#endif
+  return readFolderSettingHome(folder);
+}
+
+bool Settings::writeExtShortCutToFlash (uint8_t shortCut, const folderSettings& value) {
+  if (shortCut == lastSortCut) {
+    pending.lastCard      = true;
+    pending.lastCardValue = value;
+    if (not pending.timer.isActive())
+      pending.timer.start(eepromLazyWriteTime);
+    return true;
+  }
+  return writeExtShortCutHome(shortCut, value);
+}
+
+void Settings::readExtShortCutFromFlash(uint8_t shortCut,       folderSettings& value) {
+  if (shortCut == lastSortCut) {
+    if (pending.lastCard) {
+      value = pending.lastCardValue;
+      return;
+    }
+#ifdef EEPROM_JOURNAL_REGION
+    EepromJournal::value_t journalValue;
+    if (journal.read(journalKeyLastCard, journalValue)) {
+      memcpy(&value, journalValue.begin(), sizeof(folderSettings));
+      return;
+    }
+#endif
+  }
+  readExtShortCutHome(shortCut, value);
+}
+
+#ifdef RESUME_SNAPSHOT
+void Settings::writeSnapshotToFlash(const snapshot_t& value) {
+  pending.snapshot      = true;
+  pending.snapshotValue = value;
+  if (not pending.timer.isActive())
+    pending.timer.start(eepromLazyWriteTime);
+}
+
+void Settings::readSnapshotFromFlash(snapshot_t& value) {
+  if (pending.snapshot) {
+    value = pending.snapshotValue;
+    return;
+  }
+  EEPROM_get(startAddressSnapshot, value);
+  uint8_t *p = reinterpret_cast<uint8_t*>(&value);
+  for (uint8_t part = 0; part < 2; ++part) {
+    EepromJournal::value_t journalValue;
+    if (journal.read(journalKeySnapshot+part, journalValue))
+      memcpy(p + part * EepromJournal::valueSize, journalValue.begin(), EepromJournal::valueSize);
+  }
+}
+#endif // RESUME_SNAPSHOT
+
+#ifdef TELEMETRY
+void Settings::readTelemetryFromFlash(uint8_t part, array<uint8_t, 4>& value) {
+  EepromJournal::value_t journalValue;
+  if (journal.read(journalKeyTelemetry+part, journalValue)) {
+    value = journalValue;
+    return;
+  }
+  EEPROM_get(startAddressTelemetry + part * EepromJournal::valueSize, value);
+}
+
+void Settings::writeTelemetryToFlash(uint8_t part, const array<uint8_t, 4>& value) {
+  journal.write(journalKeyTelemetry+part, value);
+}
+#endif // TELEMETRY
+
+void Settings::flushToFlash() {
+  pending.timer.stop();
+  if (pending.folder != noPendingFolder) {
+    LOG(settings_log, s_debug, F("flush folder: "), pending.folder, F(" track: "), pending.track);
+#ifdef EEPROM_JOURNAL_REGION
+    journal.write(pending.folder, { static_cast<uint8_t>(pending.track), static_cast<uint8_t>(pending.track >> 8), 0, 0 });
+#else
+    writeFolderSettingHome(pending.folder, pending.track);
+#endif
+    pending.folder = noPendingFolder;
+  }
+  if (pending.lastCard) {
+    LOG(settings_log, s_debug, F("flush last card"));
+#ifdef EEPROM_JOURNAL_REGION
+    EepromJournal::value_t value;
+    memcpy(value.begin(), &pending.lastCardValue, sizeof(folderSettings));
+    journal.write(journalKeyLastCard, value);
+#else
+    writeExtShortCutHome(lastSortCut, pending.lastCardValue);
+#endif
+    pending.lastCard = false;
+  }
+#ifdef RESUME_SNAPSHOT
+  if (pending.snapshot) {
+    LOG(settings_log, s_debug, F("flush snapshot"));
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(&pending.snapshotValue);
+    for (uint8_t part = 0; part < 2; ++part) {
+      EepromJournal::value_t value;
+      memcpy(value.begin(), p + part * EepromJournal::valueSize, EepromJournal::valueSize);
+      journal.write(journalKeySnapshot+part, value);
+    }
+    pending.snapshot = false;
+  }
+#endif
+}
+
+void Settings::loop() {
+  if (pending.timer.isActive() && pending.timer.isExpired())
+    flushToFlash();
+}
+#endif // EEPROM_JOURNAL
+
+#ifdef TRACK_COUNT_CACHE_EEPROM
+void Settings::writeTrackCountToFlash(uint8_t folder, uint16_t count) {
+  if (folder < 100) {
+    const int address = startAddressTrackCounts + folder * sizeof(uint16_t);
+    EEPROM_update(address  , static_cast<uint8_t>(count & 0xff));
+    EEPROM_update(address+1, static_cast<uint8_t>(count >> 8  ));
+  }
+}
+
+uint16_t Settings::readTrackCountFromFlash(uint8_t folder) {
+  uint16_t count = unknownTrackCount;
+  if (folder < 100)
+    EEPROM_get(startAddressTrackCounts + folder * sizeof(uint16_t), count);
+  // 0 is never stored
+  return count == 0 ? unknownTrackCount : count;
 }
 
+void Settings::clearTrackCountsInFlash() {
+  LOG(settings_log, s_debug, F("clTrackCounts"));
+  for (uint16_t i = startAddressTrackCounts; i < endAddressTrackCounts; ++i)
+    EEPROM_update(i, static_cast<uint8_t>(0xff));
+}
+#endif // TRACK_COUNT_CACHE_EEPROM
+
+#ifdef KEYMAP
+void Settings::writeKeymapEntryToFlash(uint8_t entry, const keymap_entry_t& value) {
+  if (entry < keymapEntries) {
+    const int address = startAddressKeymap + entry * sizeof(keymap_entry_t);
+    EEPROM_update(address  , value.raw  );
+    EEPROM_update(address+1, value.state);
+    EEPROM_update(address+2, value.cmd  );
+  }
+}
+
+void Settings::readKeymapEntryFromFlash(uint8_t entry, keymap_entry_t& value) {
+  value = { 0, 0, 0 };
+  if (entry < keymapEntries)
+    EEPROM_get(startAddressKeymap + entry * sizeof(keymap_entry_t), value);
+}
+
+void Settings::clearKeymapInFlash() {
+  LOG(settings_log, s_debug, F("clKeymap"));
+  for (uint16_t i = startAddressKeymap; i < addressKeymapFormat; ++i)
+    EEPROM_update(i, static_cast<uint8_t>(0));
+  EEPROM_update(addressKeymapFormat, keymapFormat);
+}
+#endif // KEYMAP
+
+#ifdef MEMORY_UID_MATCH
+uint8_t Settings::readMemoryUidFromFlash(uint32_t uidKey) {
+  memory_uid_t entry;
+  for (uint8_t i = 0; i < memoryUidEntries; ++i) {
+    EEPROM_get(startAddressMemoryUids + i * sizeof(memory_uid_t), entry);
+    if (entry.pair != 0 && entry.uidKey() == uidKey)
+      return entry.pair;
+  }
+  return 0;
+}
+// a new card is stored in the first free entry, if there is none in the entry of the key
+void Settings::writeMemoryUidToFlash(uint32_t uidKey, uint8_t pair) {
+  int8_t own  = -1;
+  int8_t free = -1;
+  for (uint8_t i = 0; i < memoryUidEntries; ++i) {
+    memory_uid_t entry;
+    EEPROM_get(startAddressMemoryUids + i * sizeof(memory_uid_t), entry);
+    if (entry.pair != 0 && entry.uidKey() == uidKey) {
+      if (entry.pair == pair)
+        return;
+      own = i;
+      break;
+    }
+    if (entry.pair == 0 && free < 0)
+      free = i;
+  }
+  if (own < 0 && pair == 0)
+    return;
+  const uint8_t i = own >= 0 ? own : free >= 0 ? free : uidKey % memoryUidEntries;
+  LOG(settings_log, s_debug, F("wrMemUid "), i, F(": "), pair);
+  const int address = startAddressMemoryUids + i * sizeof(memory_uid_t);
+  for (uint8_t b = 0; b < 4; ++b)
+    EEPROM_update(address+b, static_cast<uint8_t>(uidKey >> (8*b)));
+  EEPROM_update(address+4, pair);
+}
+void Settings::clearMemoryUidsInFlash() {
+  LOG(settings_log, s_debug, F("clMemUids"));
+  for (uint16_t i = startAddressMemoryUids; i < addressMemoryUidsFormat; ++i)
+    EEPROM_update(i, static_cast<uint8_t>(0));
+  EEPROM_update(addressMemoryUidsFormat, memoryUidsFormat);
+}
+#endif // MEMORY_UID_MATCH
 
 folderSettings Settings::getShortCut(uint8_t shortCut) {
   if (shortCut > 0 && shortCut <= 4)
@@ -131,15 +837,25 @@ folderSettings Settings::getShortCut(uint8_t shortCut) {
   return { 0, pmode_t::none, 0, 0 };
 }
 
-void Settings::setShortCut(uint8_t shortCut, const folderSettings& value) {
+bool Settings::setShortCut(uint8_t shortCut, const folderSettings& value) {
   if (shortCut > 0 && shortCut <= 4) {
     shortCuts[shortCut-1] = value;
     // writeSettingsToFlash(); -- will be done in state machine
   }
 #ifdef BUTTONS3X3
   else if (shortCut >= buttonExtSC_begin && shortCut < buttonExtSC_begin + buttonExtSC_buttons) {
-    writeExtShortCutToFlash(shortCut-buttonExtSC_begin, value);
+    return writeExtShortCutToFlash(shortCut-buttonExtSC_begin, value);
   }
 #endif
+  return true;
 }
 
+#ifdef FAST_BOOT
+uint32_t Settings::incrementBootCount() {
+  uint32_t count;
+  EEPROM_get(startAddressBootCount, count);
+  ++count;
+  EEPROM_put(startAddressBootCount, count);
+  return count;
+}
+#endif
@@ -6,6 +6,11 @@
 
 #include "array.hpp"
 #include "chip_card.hpp"
+#include "telemetry.hpp"
+
+#if defined(RESUME_SNAPSHOT) and not (defined(EEPROM_JOURNAL) and defined(STORE_LAST_CARD))
+#error "RESUME_SNAPSHOT needs EEPROM_JOURNAL and STORE_LAST_CARD"
+#endif
 
 // admin settings stored in eeprom
 struct Settings {
@@ -21,14 +26,82 @@ struct Settings {
   void resetSettings();
   void loadSettingsFromFlash();
 
-  void    writeFolderSettingToFlash (uint8_t folder, uint8_t track);
-  uint8_t readFolderSettingFromFlash(uint8_t folder);
+  void     writeFolderSettingToFlash (uint8_t folder, uint16_t track);
+  uint16_t readFolderSettingFromFlash(uint8_t folder);
 
-  void    writeExtShortCutToFlash (uint8_t shortCut, const folderSettings& value);
+  // false if there is no space (PACKED_SHORTCUTS), the former shortcut is kept
+  bool    writeExtShortCutToFlash (uint8_t shortCut, const folderSettings& value);
   void    readExtShortCutFromFlash(uint8_t shortCut,       folderSettings& value);
 
+#ifdef EEPROM_JOURNAL
+  // writes the pending folder setting and last card
+  void    flushToFlash();
+  void    loop();
+#else
+  void    flushToFlash() {}
+  void    loop() {}
+#endif
+
+#ifdef RESUME_SNAPSHOT
+  // playback of the last card (STORE_LAST_CARD), written lazy like the last card
+  struct snapshot_t {
+    uint8_t  folder     ; // 0: no snapshot
+    pmode_t  mode       ;
+    uint8_t  volume     ;
+    uint8_t  reserved   ;
+    uint16_t queuePos   ;
+    uint16_t shuffleSeed;
+  };
+  void    writeSnapshotToFlash (const snapshot_t& value);
+  void    readSnapshotFromFlash(      snapshot_t& value);
+#endif
+
+#ifdef TRACK_COUNT_CACHE_EEPROM
+  static constexpr uint16_t unknownTrackCount = 0xffff;
+  void     writeTrackCountToFlash (uint8_t folder, uint16_t count);
+  uint16_t readTrackCountFromFlash(uint8_t folder);
+  void     clearTrackCountsInFlash();
+#endif
+
+#ifdef KEYMAP
+  // custom mapping of a raw command in a state (commandRaw, state_for_command, command), raw 0: free entry
+  struct keymap_entry_t {
+    uint8_t raw  ;
+    uint8_t state;
+    uint8_t cmd  ;
+  };
+  static void writeKeymapEntryToFlash (uint8_t entry, const keymap_entry_t& value);
+  static void readKeymapEntryFromFlash(uint8_t entry,       keymap_entry_t& value);
+  static void clearKeymapInFlash();
+#endif
+
+#ifdef MEMORY_UID_MATCH
+  // pair of a memory game card by the first 4 byte of its UID, pair 0: free entry
+  struct memory_uid_t {
+    uint8_t uid[4];
+    uint8_t pair  ;
+    uint32_t uidKey() const { return uid[0] | (uid[1] << 8) | (static_cast<uint32_t>(uid[2]) << 16) | (static_cast<uint32_t>(uid[3]) << 24); }
+  };
+  // 0 if unknown
+  static uint8_t readMemoryUidFromFlash(uint32_t uidKey);
+  // pair 0 removes the card
+  static void    writeMemoryUidToFlash (uint32_t uidKey, uint8_t pair);
+  static void    clearMemoryUidsInFlash();
+#endif
+
+#ifdef TELEMETRY
+  // part (2 counters) of the telemetry, the write goes to the journal
+  static void readTelemetryFromFlash(uint8_t part,       array<uint8_t, 4>& value);
+  static void writeTelemetryToFlash (uint8_t part, const array<uint8_t, 4>& value);
+#endif
+
+#ifdef FAST_BOOT
+  // increments the boot counter in the EEPROM and returns the new value
+  uint32_t incrementBootCount();
+#endif
+
   folderSettings getShortCut(uint8_t shortCut);
-  void           setShortCut(uint8_t shortCut, const folderSettings& value);
+  bool           setShortCut(uint8_t shortCut, const folderSettings& value);
 
   uint32_t    cookie              {};
   byte        version             {};
@@ -55,8 +128,10 @@ int EEPROM_put(int ee, const T &value) {
   const byte *p = (const byte *)(const void *)&value;
   unsigned int i;
 
-  for (i = 0; i < sizeof(value); i++)
+  for (i = 0; i < sizeof(value); i++) {
     EEPROM.write(ee++, *p++);
+    Telemetry::count(Telemetry::eeprom_writes);
+  }
   return i;
 }
 
@@ -72,7 +147,10 @@ int EEPROM_get(int ee, T &value) {
 
 template <class T>
 void EEPROM_update(int ee, const T &value) {
-  EEPROM.read(ee) != value ? EEPROM.write(ee, value) : delay(0);
+  if (EEPROM.read(ee) != value) {
+    EEPROM.write(ee, value);
+    Telemetry::count(Telemetry::eeprom_writes);
+  }
 }
 
 #endif /* SRC_SETTINGS_HPP_ */
@@ -53,10 +53,21 @@ const __FlashStringHelper* str_to                      () { return F(" -> ") ; }
 const __FlashStringHelper* str_enter                   () { return F("enter ") ; }
 const __FlashStringHelper* str_abort                   () { return F(" abort") ; }
 
+StateArena stateArena{};
+
 }
 
 // #######################################################
 
+template<SM_type SMT>
+void SM<SMT>::exit() {
+  waitForPlayFinish = false;
+#ifdef PROMPT_QUEUE
+  // the low prompts belong to the state that queued them (e.g. "continue" of a menu)
+  mp3.cancelPrompts(Mp3::prompt_prio::low);
+#endif
+}
+
 template<SM_type SMT>
 bool SM<SMT>::isAbort(command cmd) {
   if (cmd == command::adm_end) {
@@ -70,60 +81,83 @@ bool SM<SMT>::isAbort(command cmd) {
 
 // #######################################################
 
+template<SM_type SMT>
+VoiceMenuData &VoiceMenu<SMT>::data() {
+  static_assert(SMT == SM_type::tonuino or SMT == SM_type::setupCard, "no voice menu in the writeCard state machine");
+  return stateArena.voiceMenu[static_cast<uint8_t>(SMT)];
+}
+
 template<SM_type SMT>
 void VoiceMenu<SMT>::entry(bool entryPlayAfter) {
-  LOG(state_log, s_debug, str_VoiceMenu(), F("::entry() "), static_cast<int>(startMessage));
-  if (startMessage != mp3Tracks::t_0)
-    mp3.enqueueMp3FolderTrack(startMessage, entryPlayAfter);
+  VoiceMenuData &d = data();
+  LOG(state_log, s_debug, str_VoiceMenu(), F("::entry() "), static_cast<int>(d.startMessage));
+  if (d.startMessage != mp3Tracks::t_0) {
+#ifdef PROMPT_QUEUE
+    // behind the confirmation of the step before, that one is never dropped for it
+    if (entryPlayAfter)
+      mp3.enqueuePrompt(d.startMessage, Mp3::prompt_prio::low);
+    else
+#endif
+    mp3.enqueueMp3FolderTrack(d.startMessage, entryPlayAfter);
+  }
 
-  currentValue      = 0;
+  d.currentValue      = 0;
 }
 
 template<SM_type SMT>
 void VoiceMenu<SMT>::playCurrentValue() {
-  mp3.enqueueMp3FolderTrack(messageOffset + currentValue);
-  previewStarted = false;
+  VoiceMenuData &d = data();
+#ifdef VOICE_MENU_BARGE_IN
+  d.previewTimer.start(voiceMenuPreviewDelay);
+#endif
+  // not playAfter: replaces the playing prompt/preview in the next mp3.loop()
+  mp3.enqueueMp3FolderTrack(d.messageOffset + d.currentValue);
+  d.previewStarted = false;
 }
 
 template<SM_type SMT>
 void VoiceMenu<SMT>::react(command cmd) {
-  if (   currentValue != 0
-      && preview
-      && not previewStarted
+  VoiceMenuData &d = data();
+  if (   d.currentValue != 0
+      && d.preview
+      && not d.previewStarted
+#ifdef VOICE_MENU_BARGE_IN
+      && d.previewTimer.isExpired()
+#endif
       && not mp3.isPlayingMp3())
   {
-    LOG(state_log, s_debug, str_VoiceMenu(), F("::react() start preview "), currentValue);
-    if (previewFromFolder == 0)
-      mp3.enqueueTrack(currentValue, 1);
+    LOG(state_log, s_debug, str_VoiceMenu(), F("::react() start preview "), d.currentValue);
+    if (d.previewFromFolder == 0)
+      mp3.enqueueTrack(d.currentValue, 1);
     else
-      mp3.enqueueTrack(previewFromFolder, currentValue);
-    previewStarted = true;
+      mp3.enqueueTrack(d.previewFromFolder, d.currentValue);
+    d.previewStarted = true;
   }
 
   switch(cmd) {
   case command::next10:
-    currentValue = min(currentValue + 10, numberOfOptions);
+    d.currentValue = min(d.currentValue + 10, static_cast<int>(d.numberOfOptions));
     playCurrentValue();
     break;
 
   case command::next:
-    currentValue = min(currentValue + 1, numberOfOptions);
+    d.currentValue = min(d.currentValue + 1, static_cast<int>(d.numberOfOptions));
     playCurrentValue();
     break;
 
   case command::previous10:
-    currentValue = max(currentValue - 10, 1);
+    d.currentValue = max(d.currentValue - 10, 1);
     playCurrentValue();
     break;
 
   case command::previous:
-    currentValue = max(currentValue - 1, 1);
+    d.currentValue = max(d.currentValue - 1, 1);
     playCurrentValue();
     break;
 
 #ifdef SerialInputAsCommand
   case command::menu_jump:
-    currentValue = min(max(tonuino.getMenuJump(), 1),numberOfOptions);
+    d.currentValue = min(max(tonuino.getMenuJump(), static_cast<uint8_t>(1)),d.numberOfOptions);
     playCurrentValue();
     break;
 #endif
@@ -136,20 +170,22 @@ void VoiceMenu<SMT>::react(command cmd) {
 // #######################################################
 
 void ChMode::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_ChMode());
 
   folder = folderSettings{};
 
-  numberOfOptions   = 14;
-  startMessage      = mp3Tracks::t_310_select_mode;
-  messageOffset     = mp3Tracks::t_310_select_mode;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 14;
+  d.startMessage      = mp3Tracks::t_310_select_mode;
+  d.messageOffset     = mp3Tracks::t_310_select_mode;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 }
 
 void ChMode::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw == commandRaw::none) {
     LOG(state_log, s_debug, str_ChMode(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -160,9 +196,9 @@ void ChMode::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    folder.mode = static_cast<pmode_t>(currentValue);
-    LOG(state_log, s_info, str_ChMode(), F(": "), currentValue);
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    folder.mode = static_cast<pmode_t>(d.currentValue);
+    LOG(state_log, s_info, str_ChMode(), F(": "), d.currentValue);
     if (folder.mode == pmode_t::admin) {
       folder.folder = 0;
       folder.mode = pmode_t::admin_card;
@@ -194,18 +230,20 @@ void ChMode::react(command_e const &cmd_e) {
 // #######################################################
 
 void ChFolder::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_ChFolder());
 
-  numberOfOptions   = 99;
-  startMessage      = mp3Tracks::t_301_select_folder;
-  messageOffset     = mp3Tracks::t_0;
-  preview           = true;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 99;
+  d.startMessage      = mp3Tracks::t_301_select_folder;
+  d.messageOffset     = mp3Tracks::t_0;
+  d.preview           = true;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 }
 
 void ChFolder::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_ChFolder(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -216,9 +254,9 @@ void ChFolder::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    folder.folder = currentValue;
-    LOG(state_log, s_info, str_ChFolder(), F(": "), currentValue);
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    folder.folder = d.currentValue;
+    LOG(state_log, s_info, str_ChFolder(), F(": "), d.currentValue);
 #ifdef QUIZ_GAME
     if (folder.mode == pmode_t::quiz_game) {
       transit<ChNumAnswer>();
@@ -247,18 +285,20 @@ void ChFolder::react(command_e const &cmd_e) {
 // #######################################################
 
 void ChTrack::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_ChTrack());
 
-  numberOfOptions   = mp3.getFolderTrackCount(folder.folder);
-  startMessage      = mp3Tracks::t_327_select_file;
-  messageOffset     = mp3Tracks::t_0;
-  preview           = true;
-  previewFromFolder = folder.folder;
+  d.numberOfOptions   = mp3.getFolderTrackCount(folder.folder);
+  d.startMessage      = mp3Tracks::t_327_select_file;
+  d.messageOffset     = mp3Tracks::t_0;
+  d.preview           = true;
+  d.previewFromFolder = folder.folder;
 
   VoiceMenu::entry();
 }
 
 void ChTrack::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_ChTrack(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -269,9 +309,9 @@ void ChTrack::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    folder.special = currentValue;
-    LOG(state_log, s_info, str_ChTrack(), F(": "), currentValue);
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    folder.special = d.currentValue;
+    LOG(state_log, s_info, str_ChTrack(), F(": "), d.currentValue);
     transit<finished>();
     return;
   }
@@ -280,18 +320,20 @@ void ChTrack::react(command_e const &cmd_e) {
 // #######################################################
 
 void ChFirstTrack::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_ChFirstTrack());
 
-  numberOfOptions   = mp3.getFolderTrackCount(folder.folder);
-  startMessage      = mp3Tracks::t_328_select_first_file;
-  messageOffset     = mp3Tracks::t_0;
-  preview           = true;
-  previewFromFolder = folder.folder;
+  d.numberOfOptions   = mp3.getFolderTrackCount(folder.folder);
+  d.startMessage      = mp3Tracks::t_328_select_first_file;
+  d.messageOffset     = mp3Tracks::t_0;
+  d.preview           = true;
+  d.previewFromFolder = folder.folder;
 
   VoiceMenu::entry();
 }
 
 void ChFirstTrack::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_ChFirstTrack(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -302,9 +344,9 @@ void ChFirstTrack::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    folder.special = currentValue;
-    LOG(state_log, s_info, str_ChFirstTrack(), F(": "), currentValue);
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    folder.special = d.currentValue;
+    LOG(state_log, s_info, str_ChFirstTrack(), F(": "), d.currentValue);
     transit<ChLastTrack>();
     return;
   }
@@ -313,20 +355,22 @@ void ChFirstTrack::react(command_e const &cmd_e) {
 // #######################################################
 
 void ChLastTrack::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_ChLastTrack());
 
-  numberOfOptions   = mp3.getFolderTrackCount(folder.folder);
-  startMessage      = mp3Tracks::t_329_select_last_file;
-  messageOffset     = mp3Tracks::t_0;
-  preview           = true;
-  previewFromFolder = folder.folder;
+  d.numberOfOptions   = mp3.getFolderTrackCount(folder.folder);
+  d.startMessage      = mp3Tracks::t_329_select_last_file;
+  d.messageOffset     = mp3Tracks::t_0;
+  d.preview           = true;
+  d.previewFromFolder = folder.folder;
 
   VoiceMenu::entry();
 
-  currentValue      = folder.special;
+  d.currentValue      = folder.special;
 }
 
 void ChLastTrack::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_ChLastTrack(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -337,9 +381,9 @@ void ChLastTrack::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    folder.special2 = currentValue;
-    LOG(state_log, s_info, str_ChLastTrack(), F(": "), currentValue);
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    folder.special2 = d.currentValue;
+    LOG(state_log, s_info, str_ChLastTrack(), F(": "), d.currentValue);
     transit<finished>();
     return;
   }
@@ -348,20 +392,22 @@ void ChLastTrack::react(command_e const &cmd_e) {
 // #######################################################
 
 void ChNumAnswer::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_ChNumAnswer());
 
-  numberOfOptions   = 5;
-  startMessage      = mp3Tracks::t_333_num_answer;
-  messageOffset     = mp3Tracks::t_333_num_answer;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 5;
+  d.startMessage      = mp3Tracks::t_333_num_answer;
+  d.messageOffset     = mp3Tracks::t_333_num_answer;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 
-  currentValue      = 0;
+  d.currentValue      = 0;
 }
 
 void ChNumAnswer::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_ChNumAnswer(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -372,16 +418,16 @@ void ChNumAnswer::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    if (currentValue == 5) {
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    if (d.currentValue == 5) {
       folder.special  = 0;
       folder.special2 = 1;
     }
     else {
-      folder.special  = ((currentValue-1)%2+1)*2;
-      folder.special2 = (currentValue-1) / 2;
+      folder.special  = ((d.currentValue-1)%2+1)*2;
+      folder.special2 = (d.currentValue-1) / 2;
     }
-    LOG(state_log, s_info, str_ChNumAnswer(), F(": "), currentValue);
+    LOG(state_log, s_info, str_ChNumAnswer(), F(": "), d.currentValue);
     transit<finished>();
     return;
   }
@@ -390,20 +436,22 @@ void ChNumAnswer::react(command_e const &cmd_e) {
 // #######################################################
 
 void ChNumTracks::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_ChNumTracks());
 
-  numberOfOptions   = 5;
-  startMessage      = mp3Tracks::t_340_num_tracks;
-  messageOffset     = mp3Tracks::t_0;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 5;
+  d.startMessage      = mp3Tracks::t_340_num_tracks;
+  d.messageOffset     = mp3Tracks::t_0;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 
-  currentValue      = 0;
+  d.currentValue      = 0;
 }
 
 void ChNumTracks::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_ChNumTracks(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -414,9 +462,9 @@ void ChNumTracks::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    folder.special  = currentValue-1;
-    LOG(state_log, s_info, str_ChNumTracks(), F(": "), currentValue);
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    folder.special  = d.currentValue-1;
+    LOG(state_log, s_info, str_ChNumTracks(), F(": "), d.currentValue);
     transit<finished>();
     return;
   }
@@ -427,6 +475,10 @@ void ChNumTracks::react(command_e const &cmd_e) {
 void WriteCard::entry() {
   LOG(state_log, s_info, str_enter(), str_WriteCard());
   current_subState = start_waitCardInserted;
+#ifdef BATCH_CARD_WRITE
+  batch      = startBatch;
+  startBatch = false;
+#endif
 }
 
 void WriteCard::react(command_e const &cmd_e) {
@@ -441,7 +493,11 @@ void WriteCard::react(command_e const &cmd_e) {
 
   switch (current_subState) {
   case start_waitCardInserted:
-    if (chip_card.isCardRemoved())
+    if (chip_card.isCardRemoved()
+#ifdef BATCH_CARD_WRITE
+        && not batch
+#endif
+       )
       mp3.enqueueMp3FolderTrack(mp3Tracks::t_800_waiting_for_card/*, true*//*playAfter*/); // TODO
     current_subState = run_writeCard;
     break;
@@ -450,7 +506,11 @@ void WriteCard::react(command_e const &cmd_e) {
       folderSettings newCard;
       newCard = folder;
       if (chip_card.writeCard(newCard))
+#ifdef BATCH_CARD_WRITE
+        mp3.enqueueMp3FolderTrack(batch ? mp3Tracks::t_262_pling : mp3Tracks::t_400_ok);
+#else
         mp3.enqueueMp3FolderTrack(mp3Tracks::t_400_ok);
+#endif
       else
         mp3.enqueueMp3FolderTrack(mp3Tracks::t_401_error);
       timer.start(dfPlayer_timeUntilStarts);
@@ -458,6 +518,12 @@ void WriteCard::react(command_e const &cmd_e) {
     }
     break;
   case end_writeCard:
+#ifdef BATCH_CARD_WRITE
+    if (batch) { // do not wait for the end of the pling
+      current_subState = run_waitCardRemoved;
+      break;
+    }
+#endif
     if (timer.isExpired() && not mp3.isPlaying())
       current_subState = run_waitCardRemoved;
     break;
@@ -625,6 +691,10 @@ void Base::handleBrightness(command cmd) {
 void Idle::entry() {
   LOG(state_log, s_info, str_enter(), str_Idle());
   tonuino.setStandbyTimer();
+#ifdef RESUME_SNAPSHOT
+  tonuino.clearSnapshot();
+#endif
+  settings.flushToFlash();
 }
 
 void Idle::react(command_e const &cmd_e) {
@@ -684,6 +754,10 @@ void Idle::react(command_e const &cmd_e) {
   }
 }
 
+void Idle::react(tick_e const &) {
+  // nothing is time driven in Idle (the standby timer is handled in Tonuino::loop())
+}
+
 void Idle::react(card_e const &c_e) {
   if (c_e.card_ev != cardEvent::none) {
     LOG(state_log, s_debug, str_Idle(), F("::react(c) "), static_cast<int>(c_e.card_ev));
@@ -772,6 +846,18 @@ void Play::react(command_e const &cmd_e) {
   }
 }
 
+void Play::react(tick_e const &) {
+  // same as react(command_e(commandRaw::none)) without the command lookup
+  if (tonuino.getActiveModifier().handleButton(command::none))
+    return;
+
+  if (not mp3.isPlayingFolder()) {
+    if (mp3.isPlaying())
+      mp3.stop();
+    transit<Idle>();
+  }
+}
+
 void Play::react(card_e const &c_e) {
   if (c_e.card_ev != cardEvent::none) {
     LOG(state_log, s_debug, str_Play(), F("::react(c) "), static_cast<int>(c_e.card_ev));
@@ -802,6 +888,10 @@ void Pause::entry() {
   LOG(state_log, s_info, str_enter(), str_Pause());
   tonuino.setStandbyTimer();
   mp3.pause();
+#ifdef RESUME_SNAPSHOT
+  tonuino.saveSnapshot();
+#endif
+  settings.flushToFlash();
 }
 
 void Pause::react(command_e const &cmd_e) {
@@ -841,6 +931,10 @@ void Pause::react(command_e const &cmd_e) {
   }
 }
 
+void Pause::react(tick_e const &) {
+  // nothing is time driven in Pause (the standby timer is handled in Tonuino::loop())
+}
+
 void Pause::react(card_e const &c_e) {
   if (c_e.card_ev != cardEvent::none) {
     LOG(state_log, s_debug, str_Pause(), F("::react(c) "), static_cast<int>(c_e.card_ev));
@@ -874,6 +968,9 @@ void StartPlay::entry() {
   LOG(state_log, s_info, str_enter(), str_StartPlay());
   mp3.enqueueMp3FolderTrack(mp3Tracks::t_262_pling);
   timer.stop();
+#ifdef CARD_PIPELINED_START
+  prefetched = false;
+#endif
 }
 
 void StartPlay::react(command_e const &/*cmd_e*/) {
@@ -891,51 +988,66 @@ void StartPlay::react(command_e const &/*cmd_e*/) {
     tonuino.playFolder();
     timer.start(dfPlayer_timeUntilStarts);
   }
+#ifdef CARD_PIPELINED_START
+  // ask for the track count while the pling is playing, after it only the play command is left
+  else if (not prefetched) {
+    prefetched = true;
+    if (tonuino.getMyFolder().folder != 0)
+      mp3.getFolderTrackCount(tonuino.getMyFolder().folder);
+  }
+#endif
 }
 
 // #######################################################
 
 void Quiz::entry() {
+  Data &d = data();
+  d = Data{};
   LOG(state_log, s_info, str_enter(), str_Quiz());
   tonuino.disableStandbyTimer();
   tonuino.resetActiveModifier();
   tonuino.playFolder();
-  numAnswer   = tonuino.getMyFolder().special;
-  numSolution = tonuino.getMyFolder().special2;
-  if (numAnswer != 0 and numAnswer != 2 and numAnswer != 4) {
-    LOG(state_log, s_error, F("numA: "), numAnswer);
+  d.numAnswer   = tonuino.getMyFolder().special;
+  d.numSolution = tonuino.getMyFolder().special2;
+  if (d.numAnswer != 0 and d.numAnswer != 2 and d.numAnswer != 4) {
+    LOG(state_log, s_error, F("numA: "), d.numAnswer);
     finish();
     return;
   }
-  if (numSolution > 1) {
-    LOG(state_log, s_error, F("numS: "), numSolution);
+  if (d.numSolution > 1) {
+    LOG(state_log, s_error, F("numS: "), d.numSolution);
     finish();
     return;
   }
-  quizState = QuizState::playQuestion;
-  numQuestion = tonuino.getNumTracksInFolder()/(numAnswer+numSolution+1);
+  d.quizState = QuizState::playQuestion;
+  d.numQuestion = tonuino.getNumTracksInFolder()/(d.numAnswer+d.numSolution+1);
 
-  a.clear();
-  if (numAnswer >= 2) {
-    a.push(0);
-    a.push(1);
+  d.nextA.clear();
+  if (d.numAnswer >= 2) {
+    d.nextA.push(0);
+    d.nextA.push(1);
   }
-  if (numAnswer == 4) {
-    a.push(2);
-    a.push(3);
+  if (d.numAnswer == 4) {
+    d.nextA.push(2);
+    d.nextA.push(3);
   }
 
-  remainingQuestions = 0;
+  d.order.clear();
+  for (uint8_t i = 0; i < d.numQuestion; ++i)
+    d.order.push(i);
+  d.nextPos = d.numQuestion; // shuffle in prefetch()
+  prefetch();
 
   timer.start(timeout);
 
-  if (numAnswer == 0)
+  if (d.numAnswer == 0)
     mp3.enqueueMp3FolderTrack(mp3Tracks::t_509_quiz_game_buzzer_intro);
   else
     mp3.enqueueMp3FolderTrack(mp3Tracks::t_500_quiz_game_intro);
 }
 
 void Quiz::react(command_e const &cmd_e) {
+  Data &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     timer.start(timeout);
     LOG(state_log, s_debug, str_Quiz(), F("::react(cmd_e) "), static_cast<int>(cmd_e.cmd_raw));
@@ -949,13 +1061,13 @@ void Quiz::react(command_e const &cmd_e) {
   if (checkForShortcutAndShutdown(cmd))
     return;
 
-  if (quizState == QuizState::playWeiter && not mp3.isPlayingFolder()) {
+  if (d.quizState == QuizState::playWeiter && not mp3.isPlayingFolder()) {
     mp3.enqueueMp3FolderTrack(mp3Tracks::t_510_quiz_game_continue);
-    quizState = QuizState::playQuestion;
+    d.quizState = QuizState::playQuestion;
   }
-  if (quizState == QuizState::playSolution && not mp3.isPlayingMp3()) {
-    mp3.enqueueTrack(tonuino.getFolder(), trackQuestion+numAnswer+1);
-    quizState = QuizState::playWeiter;
+  if (d.quizState == QuizState::playSolution && not mp3.isPlayingMp3()) {
+    mp3.enqueueTrack(tonuino.getFolder(), d.trackQuestion+d.numAnswer+1);
+    d.quizState = QuizState::playWeiter;
   }
 
   switch (cmd) {
@@ -968,79 +1080,54 @@ void Quiz::react(command_e const &cmd_e) {
   case command::pause:
     LOG(state_log, s_debug, F("Pause Taste"));
 
-    switch (quizState) {
+    switch (d.quizState) {
     case QuizState::playQuestion:
     case QuizState::playSolution:
     case QuizState::playWeiter:
-      if (remainingQuestions == 0) {
-        remainingQuestions = numQuestion;
-        r.setAll(0xFF);
-      }
-      question = random(0, remainingQuestions);
-      LOG(state_log, s_debug, F("random: "), question, F(", remain: "), remainingQuestions);
-      {
-        uint8_t i = 0;
-        while (true) {
-          if (question == 0) {
-            while (not r.getBit(i)) ++i;
-            question = i;
-            r.clearBit(i);
-            LOG(state_log, s_debug, F("question: "), question);
-            break;
-          }
-          if (r.getBit(i++)) {
-            --question;
-          }
-        }
-      }
-      --remainingQuestions;
-      LOG(state_log, s_debug, F("r: "), lf_no);
-      for (uint8_t i = 0; i<numQuestion; ++i)
-        LOG(state_log, s_debug, r.getBit(i), lf_no);
-      LOG(state_log, s_debug, F(" "));
-
-      trackQuestion = question*(numAnswer+numSolution+1)+1;
-      a.shuffle();
-      mp3.enqueueTrack(tonuino.getFolder(), trackQuestion);
-      quizState = QuizState::playAnswer;
-      actAnswer = 0xff;
+      d.trackQuestion = d.nextQuestion;
+      d.a             = d.nextA;
+      LOG(state_log, s_debug, F("question: "), d.trackQuestion);
+      mp3.enqueueTrack(tonuino.getFolder(), d.trackQuestion);
+      d.quizState = QuizState::playAnswer;
+      d.actAnswer = 0xff;
+      prefetch();
       break;
     case QuizState::playAnswer:
-      if (numAnswer == 0) {
+      if (d.numAnswer == 0) {
         // nothing
       }
-      else if (actAnswer == 0) {
+      else if (d.actAnswer == 0) {
         LOG(state_log, s_debug, F("richtig"));
-        mp3.enqueueMp3FolderTrack(mp3Tracks::t_501_quiz_game_ok+numSolution*2);
+        mp3.enqueueMp3FolderTrack(mp3Tracks::t_501_quiz_game_ok+d.numSolution*2);
       }
       else {
         LOG(state_log, s_debug, F("falsch"));
-        mp3.enqueueMp3FolderTrack(mp3Tracks::t_502_quiz_game_bad+numSolution*2);
+        mp3.enqueueMp3FolderTrack(mp3Tracks::t_502_quiz_game_bad+d.numSolution*2);
       }
-      if (numSolution == 1)
-        quizState = QuizState::playSolution;
+      if (d.numSolution == 1)
+        d.quizState = QuizState::playSolution;
       else
-        quizState = QuizState::playQuestion;
+        d.quizState = QuizState::playQuestion;
       break;
     }
     break;
   case command::track:
-    if (quizState == QuizState::playAnswer) {
-      mp3.enqueueTrack(tonuino.getFolder(), trackQuestion);
+    if (d.quizState == QuizState::playAnswer) {
+      mp3.enqueueTrack(tonuino.getFolder(), d.trackQuestion);
     }
     break;
   case command::volume_up:
-    if (quizState == QuizState::playAnswer) {
-      if (numAnswer == 0) {
-        if ((actAnswer == 0xff) || (actAnswer == 1)) {
+    if (d.quizState == QuizState::playAnswer) {
+      if (d.numAnswer == 0) {
+        if ((d.actAnswer == 0xff) || (d.actAnswer == 1)) {
           LOG(state_log, s_debug, F("Buzzer vol up"));
           mp3.enqueueMp3FolderTrack(mp3Tracks::t_508_quiz_game_buzzer_volu);
-          actAnswer = 1;
+          d.actAnswer = 1;
         }
       }
       else {
-        actAnswer = a.get(0);
-        mp3.enqueueTrack(tonuino.getFolder(), trackQuestion+actAnswer+1);
+        d.actAnswer = d.a.get(0);
+        mp3.enqueueTrack(tonuino.getFolder(), d.trackQuestion+d.actAnswer+1);
       }
     }
     else {
@@ -1048,32 +1135,32 @@ void Quiz::react(command_e const &cmd_e) {
     }
     break;
   case command::next:
-    if (quizState == QuizState::playAnswer) {
-      if (numAnswer == 0) {
-        if ((actAnswer == 0xff) || (actAnswer == 2)) {
+    if (d.quizState == QuizState::playAnswer) {
+      if (d.numAnswer == 0) {
+        if ((d.actAnswer == 0xff) || (d.actAnswer == 2)) {
           LOG(state_log, s_debug, F("Buzzer up"));
           mp3.enqueueMp3FolderTrack(mp3Tracks::t_506_quiz_game_buzzer_up);
-          actAnswer = 2;
+          d.actAnswer = 2;
         }
       }
       else {
-        actAnswer = a.get(1);
-        mp3.enqueueTrack(tonuino.getFolder(), trackQuestion+actAnswer+1);
+        d.actAnswer = d.a.get(1);
+        mp3.enqueueTrack(tonuino.getFolder(), d.trackQuestion+d.actAnswer+1);
       }
     }
     break;
   case command::volume_down:
-    if (quizState == QuizState::playAnswer) {
-      if (numAnswer == 0) {
-        if ((actAnswer == 0xff) || (actAnswer == 3)) {
+    if (d.quizState == QuizState::playAnswer) {
+      if (d.numAnswer == 0) {
+        if ((d.actAnswer == 0xff) || (d.actAnswer == 3)) {
           LOG(state_log, s_debug, F("Buzzer vol down"));
           mp3.enqueueMp3FolderTrack(mp3Tracks::t_507_quiz_game_buzzer_vold);
-          actAnswer = 3;
+          d.actAnswer = 3;
         }
       }
       else {
-        actAnswer = a.get(2%numAnswer);
-        mp3.enqueueTrack(tonuino.getFolder(), trackQuestion+actAnswer+1);
+        d.actAnswer = d.a.get(2%d.numAnswer);
+        mp3.enqueueTrack(tonuino.getFolder(), d.trackQuestion+d.actAnswer+1);
       }
     }
     else {
@@ -1081,17 +1168,17 @@ void Quiz::react(command_e const &cmd_e) {
     }
     break;
   case command::previous:
-    if (quizState == QuizState::playAnswer) {
-      if (numAnswer == 0) {
-        if ((actAnswer == 0xff) || (actAnswer == 4)) {
+    if (d.quizState == QuizState::playAnswer) {
+      if (d.numAnswer == 0) {
+        if ((d.actAnswer == 0xff) || (d.actAnswer == 4)) {
           LOG(state_log, s_debug, F("Buzzer down"));
           mp3.enqueueMp3FolderTrack(mp3Tracks::t_505_quiz_game_buzzer_down);
-          actAnswer = 4;
+          d.actAnswer = 4;
         }
       }
       else {
-        actAnswer = a.get(3%numAnswer);
-        mp3.enqueueTrack(tonuino.getFolder(), trackQuestion+actAnswer+1);
+        d.actAnswer = d.a.get(3%d.numAnswer);
+        mp3.enqueueTrack(tonuino.getFolder(), d.trackQuestion+d.actAnswer+1);
       }
     }
     break;
@@ -1125,6 +1212,17 @@ void Quiz::react(card_e const &c_e) {
   }
 }
 
+void Quiz::prefetch() {
+  Data &d = data();
+  // all questions asked: next round in a new order
+  if (d.nextPos >= d.numQuestion) {
+    d.order.shuffle();
+    d.nextPos = 0;
+  }
+  d.nextQuestion = d.order.get(d.nextPos++)*(d.numAnswer+d.numSolution+1)+1;
+  d.nextA.shuffle();
+}
+
 void Quiz::finish() {
   // todo play end
   if (mp3.isPlaying()) {
@@ -1135,15 +1233,20 @@ void Quiz::finish() {
 }
 
 
+// #######################################################
+
+Quiz  ::Data &Quiz  ::data() { return stateArena.game.quiz  ; }
+Memory::Data &Memory::data() { return stateArena.game.memory; }
+
 // #######################################################
 
 void Memory::entry() {
+  Data &d = data();
   LOG(state_log, s_info, str_enter(), str_Memory());
   tonuino.disableStandbyTimer();
   tonuino.resetActiveModifier();
   tonuino.playFolder();
-  first  = 0;
-  second = 0;
+  d = Data{};
 
   timer.start(timeout);
 
@@ -1151,6 +1254,7 @@ void Memory::entry() {
 }
 
 void Memory::react(command_e const &cmd_e) {
+  Data &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     timer.start(timeout);
     LOG(state_log, s_debug, str_Memory(), F("::react(cmd_e) "), static_cast<int>(cmd_e.cmd_raw));
@@ -1173,15 +1277,15 @@ void Memory::react(command_e const &cmd_e) {
     return;
   case command::pause:
     LOG(state_log, s_debug, F("Pause Taste"));
-    if (first == 0) {
+    if (d.first == 0) {
       mp3.enqueueMp3FolderTrack(mp3Tracks::t_523_memory_game_1);
     }
-    else if (second == 0) {
+    else if (d.second == 0) {
       mp3.enqueueMp3FolderTrack(mp3Tracks::t_524_memory_game_2);
     }
     else {
-      if (((first+1 == second  ) && (first %2 == 1)) ||
-          ((first   == second+1) && (second%2 == 1))   ) {
+      if (((d.first+1 == d.second  ) && (d.first %2 == 1)) ||
+          ((d.first   == d.second+1) && (d.second%2 == 1))   ) {
         // match
         mp3.enqueueMp3FolderTrack(mp3Tracks::t_521_memory_game_ok);
       }
@@ -1189,16 +1293,16 @@ void Memory::react(command_e const &cmd_e) {
         // no match
         mp3.enqueueMp3FolderTrack(mp3Tracks::t_522_memory_game_bad);
       }
-      first  = 0;
-      second = 0;
+      d.first  = 0;
+      d.second = 0;
     }
     break;
 
   case command::track:
-    if (second != 0)
-      mp3.enqueueTrack(tonuino.getFolder(), second);
-    else if (first != 0)
-      mp3.enqueueTrack(tonuino.getFolder(), first);
+    if (d.second != 0)
+      mp3.enqueueTrack(tonuino.getFolder(), d.second);
+    else if (d.first != 0)
+      mp3.enqueueTrack(tonuino.getFolder(), d.first);
     else
       mp3.enqueueMp3FolderTrack(mp3Tracks::t_262_pling);
     break;
@@ -1224,25 +1328,33 @@ void Memory::react(command_e const &cmd_e) {
 }
 
 void Memory::react(card_e const &c_e) {
+  Data &d = data();
   if (c_e.card_ev != cardEvent::none) {
     timer.start(timeout);
     LOG(state_log, s_debug, str_Memory(), F("::react(c) "), static_cast<int>(c_e.card_ev));
   }
   switch (c_e.card_ev) {
   case cardEvent::inserted:
+#ifdef MEMORY_UID_MATCH
+    // a known memory game card is not read, only the UID
+    if (const uint8_t pair = chip_card.getMemoryPair())
+      lastCardRead = { 0, pmode_t::memory_game, pair, 0 };
+    else
+#endif
     if (readCard()) {
 #ifdef DONT_ACCEPT_SAME_RFID_TWICE
       if (not (tonuino.getMyFolder() == lastCardRead))
 #endif
         handleReadCard();
+      return;
     }
-    else if (lastCardRead.mode == pmode_t::memory_game && lastCardRead.folder == 0) {
+    if (lastCardRead.mode == pmode_t::memory_game && lastCardRead.folder == 0) {
       mp3.enqueueTrack(tonuino.getFolder(), lastCardRead.special);
-      if (first == 0) {
-        first = lastCardRead.special;
+      if (d.first == 0) {
+        d.first = lastCardRead.special;
       }
-      else if (second == 0) {
-        second = lastCardRead.special;
+      else if (d.second == 0) {
+        d.second = lastCardRead.special;
       }
       else {
         mp3.enqueueMp3FolderTrack(mp3Tracks::t_262_pling);
@@ -1291,6 +1403,19 @@ bool Amin_BaseWriteCard::handleWriteCard(command_e const &cmd_e, bool return_to_
   return false;
 }
 
+#ifdef BATCH_CARD_WRITE
+void Amin_BaseWriteCard::startBatch() {
+  batchCards     = 0;
+  batchStartTime = millis();
+}
+
+void Amin_BaseWriteCard::logBatchCardWritten() {
+  ++batchCards;
+  const unsigned long duration = millis() - batchStartTime;
+  LOG(card_log, s_info, F("batch: "), batchCards, F(" cards, "), duration != 0 ? batchCards * 60000ul / duration : 0ul, F(" per min"));
+}
+#endif
+
 // #######################################################
 
 void Admin_Allow::entry() {
@@ -1412,27 +1537,32 @@ void Admin_Allow::react(command_e const &cmd_e) {
 // #######################################################
 
 void Admin_Entry::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_Entry());
   tonuino.disableStandbyTimer();
   tonuino.resetActiveModifier();
+#ifdef TRACK_COUNT_CACHE
+  mp3.clearTrackCountCache(); // maybe the content of the SD card was changed
+#endif
 
-  numberOfOptions   = 14;
-  startMessage      = lastCurrentValue == 0 ? mp3Tracks::t_900_admin : mp3Tracks::t_919_continue_admin;
-  messageOffset     = mp3Tracks::t_900_admin;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 14;
+  d.startMessage      = lastCurrentValue == 0 ? mp3Tracks::t_900_admin : mp3Tracks::t_919_continue_admin;
+  d.messageOffset     = mp3Tracks::t_900_admin;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   if (mp3.isPlayingFolder()) {
     mp3.clearFolderQueue();
     mp3.stop();
   }
 
-  VoiceMenu::entry(startMessage == mp3Tracks::t_919_continue_admin);
+  VoiceMenu::entry(d.startMessage == mp3Tracks::t_919_continue_admin);
 
-  currentValue      = lastCurrentValue;
+  d.currentValue      = lastCurrentValue;
 }
 
 void Admin_Entry::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_Entry(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -1449,9 +1579,9 @@ void Admin_Entry::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    lastCurrentValue = currentValue;
-    switch (currentValue) {
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    lastCurrentValue = d.currentValue;
+    switch (d.currentValue) {
     case 0:  break;
     case 1:  // create new card
              LOG(state_log, s_debug, str_Admin_Entry(), str_to(), str_Admin_NewCard());
@@ -1580,32 +1710,34 @@ void Admin_NewCard::react(command_e const &cmd_e) {
 // #######################################################
 
 void Admin_SimpleSetting::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_SimpleSetting(), type);
 
-  numberOfOptions   = type == maxVolume  ? 30 - mp3.getMinVolume()                        :
+  d.numberOfOptions   = type == maxVolume  ? 30 - mp3.getMinVolume()                        :
                       type == minVolume  ? mp3.getMaxVolume() - 1                         :
                       type == initVolume ? mp3.getMaxVolume() - mp3.getMinVolume() + 1    :
                       type == eq         ? 6                                              : 0;
-  startMessage      = type == maxVolume  ? mp3Tracks::t_930_max_volume_intro              :
+  d.startMessage      = type == maxVolume  ? mp3Tracks::t_930_max_volume_intro              :
                       type == minVolume  ? mp3Tracks::t_931_min_volume_into               :
                       type == initVolume ? mp3Tracks::t_932_init_volume_into              :
                       type == eq         ? mp3Tracks::t_920_eq_intro                      : mp3Tracks::t_0;
-  messageOffset     = type == maxVolume  ? static_cast<mp3Tracks>(mp3.getMinVolume())     :
+  d.messageOffset     = type == maxVolume  ? static_cast<mp3Tracks>(mp3.getMinVolume())     :
                       type == minVolume  ? mp3Tracks::t_0                                 :
                       type == initVolume ? static_cast<mp3Tracks>(mp3.getMinVolume() - 1) :
                       type == eq         ? mp3Tracks::t_920_eq_intro                      : mp3Tracks::t_0;
-  preview           = false;
-  previewFromFolder = 0;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 
-  currentValue      = type == maxVolume  ? mp3.getMaxVolume()  - mp3.getMinVolume()        :
+  d.currentValue      = type == maxVolume  ? mp3.getMaxVolume()  - mp3.getMinVolume()        :
                       type == minVolume  ? mp3.getMinVolume()                             :
                       type == initVolume ? mp3.getInitVolume() - mp3.getMinVolume() + 1   :
                       type == eq         ? settings.eq                                    : 0;
 }
 
 void Admin_SimpleSetting::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_SimpleSetting(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -1616,12 +1748,12 @@ void Admin_SimpleSetting::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
     switch (type) {
-    case maxVolume : mp3.getMaxVolume () = currentValue + mp3.getMinVolume()    ; break;
-    case minVolume : mp3.getMinVolume () = currentValue                         ; break;
-    case initVolume: mp3.getInitVolume() = currentValue + mp3.getMinVolume() - 1; break;
-    case eq        : settings.eq = currentValue;
+    case maxVolume : mp3.getMaxVolume () = d.currentValue + mp3.getMinVolume()    ; break;
+    case minVolume : mp3.getMinVolume () = d.currentValue                         ; break;
+    case initVolume: mp3.getInitVolume() = d.currentValue + mp3.getMinVolume() - 1; break;
+    case eq        : settings.eq = d.currentValue;
                      mp3.setEq(static_cast<DfMp3_Eq>(settings.eq - 1))          ; break;
 
     }
@@ -1633,13 +1765,14 @@ void Admin_SimpleSetting::react(command_e const &cmd_e) {
 // #######################################################
 
 void Admin_ModCard::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_ModCard());
 
-  numberOfOptions   = 7;
-  startMessage      = mp3Tracks::t_970_modifier_Intro;
-  messageOffset     = mp3Tracks::t_970_modifier_Intro;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 7;
+  d.startMessage      = mp3Tracks::t_970_modifier_Intro;
+  d.messageOffset     = mp3Tracks::t_970_modifier_Intro;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 
@@ -1652,6 +1785,7 @@ void Admin_ModCard::entry() {
 }
 
 void Admin_ModCard::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_ModCard(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -1665,20 +1799,20 @@ void Admin_ModCard::react(command_e const &cmd_e) {
 
   switch (current_subState) {
   case get_mode           :
-    if (Commands::isSelect(cmd) && (currentValue != 0)) {
-      folder.mode = static_cast<pmode_t>(currentValue);
+    if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+      folder.mode = static_cast<pmode_t>(d.currentValue);
 
       if (folder.mode == pmode_t::sleep_timer) {
-        numberOfOptions   = 4;
-        startMessage      = mp3Tracks::t_960_timer_intro;
-        messageOffset     = mp3Tracks::t_960_timer_intro;
+        d.numberOfOptions   = 4;
+        d.startMessage      = mp3Tracks::t_960_timer_intro;
+        d.messageOffset     = mp3Tracks::t_960_timer_intro;
         VoiceMenu::entry();
         current_subState = get_sleeptime_timer;
       }
       else if (folder.mode == pmode_t::freeze_dance || folder.mode == pmode_t::fi_wa_ai) {
-        numberOfOptions   = 3;
-        startMessage      = mp3Tracks::t_966_dance_pause_intro;
-        messageOffset     = mp3Tracks::t_966_dance_pause_intro;
+        d.numberOfOptions   = 3;
+        d.startMessage      = mp3Tracks::t_966_dance_pause_intro;
+        d.messageOffset     = mp3Tracks::t_966_dance_pause_intro;
         VoiceMenu::entry();
         current_subState = get_play_time;
       }
@@ -1689,8 +1823,8 @@ void Admin_ModCard::react(command_e const &cmd_e) {
     }
     break;
   case get_sleeptime_timer:
-    if (Commands::isSelect(cmd) && (currentValue != 0)) {
-      switch (currentValue) {
+    if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+      switch (d.currentValue) {
       case 1:
         folder.special = 5;
         break;
@@ -1704,23 +1838,23 @@ void Admin_ModCard::react(command_e const &cmd_e) {
         folder.special = 60;
         break;
       }
-      numberOfOptions   = 2;
-      startMessage      = mp3Tracks::t_938_modifier_sleep_mode;
-      messageOffset     = mp3Tracks::t_933_switch_volume_intro;
+      d.numberOfOptions   = 2;
+      d.startMessage      = mp3Tracks::t_938_modifier_sleep_mode;
+      d.messageOffset     = mp3Tracks::t_933_switch_volume_intro;
       VoiceMenu::entry();
       current_subState = get_sleeptime_mode;
     }
     break;
   case get_sleeptime_mode :
-    if (Commands::isSelect(cmd) && (currentValue != 0)) {
-      if (currentValue == 2)
+    if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+      if (d.currentValue == 2)
         folder.special += 0x80;
       current_subState = start_writeCard;
     }
     break;
   case get_play_time:
-    if (Commands::isSelect(cmd) && (currentValue != 0)) {
-      folder.special = currentValue-1;
+    if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+      folder.special = d.currentValue-1;
       current_subState = start_writeCard;
     }
     break;
@@ -1739,13 +1873,14 @@ void Admin_ModCard::react(command_e const &cmd_e) {
 // #######################################################
 
 void Admin_ShortCut::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_ShortCut());
 
-  numberOfOptions   = 4;
-  startMessage      = mp3Tracks::t_940_shortcut_into;
-  messageOffset     = mp3Tracks::t_940_shortcut_into;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 4;
+  d.startMessage      = mp3Tracks::t_940_shortcut_into;
+  d.messageOffset     = mp3Tracks::t_940_shortcut_into;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 
@@ -1753,6 +1888,7 @@ void Admin_ShortCut::entry() {
 }
 
 void Admin_ShortCut::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_ShortCut(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -1764,8 +1900,8 @@ void Admin_ShortCut::react(command_e const &cmd_e) {
     return;
 
   if (shortcut == 0) {
-    if (Commands::isSelect(cmd) && (currentValue != 0)) {
-      shortcut = currentValue;
+    if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+      shortcut = d.currentValue;
       current_subState = start_setupCard;
     }
 #ifdef BUTTONS3X3
@@ -1795,7 +1931,11 @@ void Admin_ShortCut::react(command_e const &cmd_e) {
       }
       break;
     case end_setupCard:
-      settings.setShortCut(shortcut, SM_setupCard::folder);
+      if (not settings.setShortCut(shortcut, SM_setupCard::folder)) {
+        mp3.enqueueMp3FolderTrack(mp3Tracks::t_401_error);
+        transit<Admin_End>();
+        return;
+      }
       saveAndTransit();
       return;
     default:
@@ -1808,18 +1948,20 @@ void Admin_ShortCut::react(command_e const &cmd_e) {
 // #######################################################
 
 void Admin_StandbyTimer::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_StandbyTimer());
 
-  numberOfOptions   = 5;
-  startMessage      = mp3Tracks::t_960_timer_intro;
-  messageOffset     = mp3Tracks::t_960_timer_intro;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 5;
+  d.startMessage      = mp3Tracks::t_960_timer_intro;
+  d.messageOffset     = mp3Tracks::t_960_timer_intro;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 }
 
 void Admin_StandbyTimer::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_StandbyTimer(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -1830,8 +1972,8 @@ void Admin_StandbyTimer::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    switch (currentValue) {
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    switch (d.currentValue) {
     case 1: settings.standbyTimer =  5; break;
     case 2: settings.standbyTimer = 15; break;
     case 3: settings.standbyTimer = 30; break;
@@ -1886,26 +2028,45 @@ void Admin_CardsForFolder::react(command_e const &cmd_e) {
     special2      = SM_setupCard::folder.special2;
     mp3.enqueueMp3FolderTrack(mp3Tracks::t_936_batch_cards_intro);
     timer.start(dfPlayer_timeUntilStarts);
+#ifdef BATCH_CARD_WRITE
+    startBatch();
+#endif
     current_subState = prepare_writeCard;
     break;
 
   case prepare_writeCard:
-    if (timer.isExpired() && not mp3.isPlaying() && chip_card.isCardRemoved()) {
+    if (
+#if not defined(BATCH_CARD_WRITE) and not defined(PROMPT_QUEUE) // batch/queue: do not wait for the end of the prompts
+        timer.isExpired() && not mp3.isPlaying() &&
+#endif
+        chip_card.isCardRemoved()) {
       if (special > special2) {
         LOG(state_log, s_debug, str_Admin_CardsForFolder(), str_to(), str_Idle());
         transit<Admin_End>();
         return;
       }
       folder.special = special;
+#ifdef PROMPT_QUEUE
+      // the number of the card waits behind the intro
+      mp3.enqueuePrompt(special);
+#else
       mp3.enqueueMp3FolderTrack(special, true/*playAfter*/);
+#endif
       timer.start(dfPlayer_timeUntilStarts);
       LOG(card_log, s_info, special, F("-te Karte auflegen"));
       current_subState = start_writeCard;
     }
     break;
   case start_writeCard:
-    if (timer.isExpired() && not mp3.isPlaying() && chip_card.isCardRemoved()) {
+    if (
+#ifndef BATCH_CARD_WRITE
+        timer.isExpired() && not mp3.isPlaying() &&
+#endif
+        chip_card.isCardRemoved()) {
       SM_writeCard::folder = folder;
+#ifdef BATCH_CARD_WRITE
+      WriteCard::startBatch = true;
+#endif
       SM_writeCard::start();
       current_subState = run_writeCard;
     }
@@ -1913,6 +2074,9 @@ void Admin_CardsForFolder::react(command_e const &cmd_e) {
   case run_writeCard:
     SM_writeCard::dispatch(cmd_e);
     if (SM_writeCard::is_in_state<finished_writeCard>()) {
+#ifdef BATCH_CARD_WRITE
+      logBatchCardWritten();
+#endif
       ++special;
       current_subState = prepare_writeCard;
     }
@@ -1930,18 +2094,20 @@ void Admin_CardsForFolder::react(command_e const &cmd_e) {
 // #######################################################
 
 void Admin_InvButtons::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_InvButtons());
 
-  numberOfOptions   = 2;
-  startMessage      = mp3Tracks::t_933_switch_volume_intro;
-  messageOffset     = mp3Tracks::t_933_switch_volume_intro;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 2;
+  d.startMessage      = mp3Tracks::t_933_switch_volume_intro;
+  d.messageOffset     = mp3Tracks::t_933_switch_volume_intro;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 }
 
 void Admin_InvButtons::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_InvButtons(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -1952,8 +2118,8 @@ void Admin_InvButtons::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    switch (currentValue) {
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    switch (d.currentValue) {
     case 1: settings.invertVolumeButtons = 0; break;
     case 2: settings.invertVolumeButtons = 1; break;
     }
@@ -1968,6 +2134,9 @@ void Admin_ResetEeprom::entry() {
   LOG(state_log, s_info, str_enter(), str_Admin_ResetEeprom());
   settings.clearEEPROM();
   settings.resetSettings();
+#ifdef KEYMAP
+  commands.loadKeymap();
+#endif
   mp3.enqueueMp3FolderTrack(mp3Tracks::t_999_reset_ok);
 }
 
@@ -1980,13 +2149,14 @@ void Admin_ResetEeprom::react(command_e const &/*cmd_e*/) {
 // #######################################################
 
 void Admin_LockAdmin::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_LockAdmin());
 
-  numberOfOptions   = 3;
-  startMessage      = mp3Tracks::t_980_admin_lock_intro;
-  messageOffset     = mp3Tracks::t_980_admin_lock_intro;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 3;
+  d.startMessage      = mp3Tracks::t_980_admin_lock_intro;
+  d.messageOffset     = mp3Tracks::t_980_admin_lock_intro;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 
@@ -1994,6 +2164,7 @@ void Admin_LockAdmin::entry() {
 }
 
 void Admin_LockAdmin::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_LockAdmin(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -2006,8 +2177,8 @@ void Admin_LockAdmin::react(command_e const &cmd_e) {
   switch(current_subState) {
   case get_mode:
     VoiceMenu::react(cmd);
-    if (Commands::isSelect(cmd) && (currentValue != 0)) {
-      settings.adminMenuLocked = currentValue-1;
+    if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+      settings.adminMenuLocked = d.currentValue-1;
       if (settings.adminMenuLocked == 2) {
         current_subState = get_pin;
         pin_number = 0;
@@ -2039,18 +2210,20 @@ void Admin_LockAdmin::react(command_e const &cmd_e) {
 // #######################################################
 
 void Admin_PauseIfCardRemoved::entry() {
+  VoiceMenuData &d = data();
   LOG(state_log, s_info, str_enter(), str_Admin_PauseIfCardRemoved());
 
-  numberOfOptions   = 2;
-  startMessage      = mp3Tracks::t_913_pause_on_card_removed;
-  messageOffset     = mp3Tracks::t_933_switch_volume_intro;
-  preview           = false;
-  previewFromFolder = 0;
+  d.numberOfOptions   = 2;
+  d.startMessage      = mp3Tracks::t_913_pause_on_card_removed;
+  d.messageOffset     = mp3Tracks::t_933_switch_volume_intro;
+  d.preview           = false;
+  d.previewFromFolder = 0;
 
   VoiceMenu::entry();
 }
 
 void Admin_PauseIfCardRemoved::react(command_e const &cmd_e) {
+  VoiceMenuData &d = data();
   if (cmd_e.cmd_raw != commandRaw::none) {
     LOG(state_log, s_debug, str_Admin_PauseIfCardRemoved(), F("::react() "), static_cast<int>(cmd_e.cmd_raw));
   }
@@ -2061,8 +2234,8 @@ void Admin_PauseIfCardRemoved::react(command_e const &cmd_e) {
   if (isAbort(cmd))
     return;
 
-  if (Commands::isSelect(cmd) && (currentValue != 0)) {
-    switch (currentValue) {
+  if (Commands::isSelect(cmd) && (d.currentValue != 0)) {
+    switch (d.currentValue) {
     case 1: settings.pauseWhenCardRemoved = 0; break;
     case 2: settings.pauseWhenCardRemoved = 1; break;
     }
@@ -2083,6 +2256,9 @@ void Admin_MemoryGameCards::entry() {
 
   mp3.enqueueMp3FolderTrack(mp3Tracks::t_937_memory_game_cards_intro);
   timer.start(dfPlayer_timeUntilStarts);
+#ifdef BATCH_CARD_WRITE
+  startBatch();
+#endif
 
   current_subState = prepare_writeCard;
 }
@@ -2131,21 +2307,37 @@ void Admin_MemoryGameCards::react(command_e const &cmd_e) {
 
   switch (current_subState) {
   case prepare_writeCard:
-    if (timer.isExpired() && not mp3.isPlaying() && chip_card.isCardRemoved()) {
+    if (
+#if not defined(BATCH_CARD_WRITE) and not defined(PROMPT_QUEUE) // batch/queue: do not wait for the end of the prompts
+        timer.isExpired() && not mp3.isPlaying() &&
+#endif
+        chip_card.isCardRemoved()) {
       if (folder.special == 255) {
         LOG(state_log, s_debug, str_Admin_MemoryGameCards(), str_to(), str_Idle());
         transit<Admin_End>();
         return;
       }
+#ifdef PROMPT_QUEUE
+      // the number of the card waits behind the intro
+      mp3.enqueuePrompt(folder.special);
+#else
       mp3.enqueueMp3FolderTrack(folder.special, true/*playAfter*/);
+#endif
       timer.start(dfPlayer_timeUntilStarts);
       LOG(card_log, s_info, folder.special, F("-te Karte auflegen"));
       current_subState = start_writeCard;
     }
     break;
   case start_writeCard:
-    if (timer.isExpired() && not mp3.isPlaying() && chip_card.isCardRemoved()) {
+    if (
+#ifndef BATCH_CARD_WRITE
+        timer.isExpired() && not mp3.isPlaying() &&
+#endif
+        chip_card.isCardRemoved()) {
       SM_writeCard::folder = folder;
+#ifdef BATCH_CARD_WRITE
+      WriteCard::startBatch = true;
+#endif
       SM_writeCard::start();
       current_subState = run_writeCard;
     }
@@ -2153,6 +2345,9 @@ void Admin_MemoryGameCards::react(command_e const &cmd_e) {
   case run_writeCard:
     SM_writeCard::dispatch(cmd_e);
     if (SM_writeCard::is_in_state<finished_writeCard>()) {
+#ifdef BATCH_CARD_WRITE
+      logBatchCardWritten();
+#endif
       ++folder.special;
       current_subState = prepare_writeCard;
     }
@@ -2181,23 +2376,12 @@ Timer           SM<SMT>::timer{};
 template<SM_type SMT>
 bool            SM<SMT>::waitForPlayFinish{};
 
-template<SM_type SMT>
-uint8_t   VoiceMenu<SMT>::numberOfOptions  ;
-template<SM_type SMT>
-mp3Tracks VoiceMenu<SMT>::startMessage     ;
-template<SM_type SMT>
-mp3Tracks VoiceMenu<SMT>::messageOffset    ;
-template<SM_type SMT>
-bool      VoiceMenu<SMT>::preview          ;
-template<SM_type SMT>
-uint8_t   VoiceMenu<SMT>::previewFromFolder;
-template<SM_type SMT>
-uint8_t   VoiceMenu<SMT>::currentValue     ;
-
-template<SM_type SMT>
-bool      VoiceMenu<SMT>::previewStarted   ;
-
 folderSettings Base::lastCardRead{};
+#ifdef BATCH_CARD_WRITE
+bool          WriteCard::startBatch{false};
+uint8_t       Amin_BaseWriteCard::batchCards{};
+unsigned long Amin_BaseWriteCard::batchStartTime{};
+#endif
 uint8_t Admin_Entry::lastCurrentValue{};
 Admin_SimpleSetting::Type Admin_SimpleSetting::type{};
 bool Admin_NewCard::return_to_idle{false};
@@ -20,6 +20,8 @@ struct card_e  : tinyfsm::Event {
   card_e(cardEvent card_ev): card_ev{card_ev} {}
   cardEvent card_ev;
 };
+// dispatched every cycle without a button/command event (time driven work only)
+struct tick_e  : tinyfsm::Event {};
 
 // ----------------------------------------------------------------------------
 // State Machine Base Class Declaration
@@ -54,9 +56,11 @@ public:
 
   virtual void react(command_e const &) { };
   virtual void react(card_e    const &) { };
+  // default: handle the tick like the former command_e(commandRaw::none)
+  virtual void react(tick_e    const &) { react(command_e(commandRaw::none)); };
 
   virtual void entry(void) { };
-  void         exit (void) { waitForPlayFinish = false; };
+  void         exit (void);
 
   bool isAbort(command cmd);
 
@@ -89,6 +93,7 @@ public:
   void entry() override;
   void react(command_e const &) override;
   void react(card_e    const &) override;
+  void react(tick_e    const &) override;
 };
 
 class StartPlay: public Base
@@ -96,6 +101,10 @@ class StartPlay: public Base
 public:
   void entry() override;
   void react(command_e const &) override;
+#ifdef CARD_PIPELINED_START
+private:
+  bool prefetched{};
+#endif
 };
 
 class Play: public Base
@@ -104,6 +113,7 @@ public:
   void entry() override;
   void react(command_e const &) override;
   void react(card_e    const &) override;
+  void react(tick_e    const &) override;
 };
 
 class Pause: public Base
@@ -112,6 +122,7 @@ public:
   void entry() override;
   void react(command_e const &) override;
   void react(card_e    const &) override;
+  void react(tick_e    const &) override;
 };
 
 class Quiz: public Base
@@ -120,6 +131,8 @@ public:
   void entry() override;
   void react(command_e const &) override;
   void react(card_e    const &) override;
+
+  struct Data;
 private:
   enum class QuizState: uint8_t {
     playQuestion,
@@ -128,19 +141,27 @@ private:
     playWeiter,
   };
 
+  void prefetch();
   void finish();
+  static Data &data();
+
+  static constexpr long timeout{ 5 * 60 * 1000l};
+};
 
+// the state of the quiz, shared with Memory (see GameData)
+struct Quiz::Data {
   uint8_t   numAnswer    {};
   uint8_t   numSolution  {};
   QuizState quizState    {};
-  uint8_t   question     {};
   uint8_t   trackQuestion{};
   uint8_t   numQuestion  {};
   uint8_t   actAnswer    {};
-  queue<uint8_t, 4>     a{};
-  bitfield<128>         r{}; // max in buzzer mode (num answer = 0, num solution = 1)
-  uint8_t remainingQuestions{};
-  static constexpr long timeout{ 5 * 60 * 1000l};
+  queue<uint8_t, 4>      a{};
+  // the next question is selected while the current one plays
+  permutation_queue<255> order        {}; // questions in random order
+  uint8_t                nextPos      {}; // position of the next question in order
+  uint8_t                nextQuestion {}; // first track of the next question
+  queue<uint8_t, 4>      nextA        {}; // answers of the next question
 };
 
 class Memory: public Base
@@ -149,15 +170,26 @@ public:
   void entry() override;
   void react(command_e const &) override;
   void react(card_e    const &) override;
+
+  struct Data {
+    uint8_t   first {};
+    uint8_t   second{};
+  };
 private:
 
   void finish();
+  static Data &data();
 
-  uint8_t     first {};
-  uint8_t     second{};
   static constexpr long timeout{ 5 * 60 * 1000l};
 };
 
+// the games never run at the same time, so they keep their state in the same RAM
+union GameData {
+  GameData(): quiz{} {}
+  Quiz::Data   quiz;
+  Memory::Data memory;
+};
+
 // ----------------------------------------------------------------------------
 // State Machine end states
 //
@@ -169,6 +201,21 @@ class finished_abort_writeCard: public SM_writeCard{};
 // ----------------------------------------------------------------------------
 // State Declarations
 //
+// the state of a voice menu, lives in the StateArena
+struct VoiceMenuData {
+  uint8_t   numberOfOptions  {};
+  mp3Tracks startMessage     {};
+  mp3Tracks messageOffset    {};
+  bool      preview          {};
+  uint8_t   previewFromFolder{};
+  uint8_t   currentValue     {};
+
+  bool      previewStarted   {};
+#ifdef VOICE_MENU_BARGE_IN
+  Timer     previewTimer     {};
+#endif
+};
+
 template<SM_type SMT>
 class VoiceMenu : public SM<SMT>
 {
@@ -177,19 +224,22 @@ protected:
   void react(command cmd);
   void playCurrentValue();
 
-  static uint8_t   numberOfOptions  ;
-  static mp3Tracks startMessage     ;
-  static mp3Tracks messageOffset    ;
-  static bool      preview          ;
-  static uint8_t   previewFromFolder;
-  static uint8_t   currentValue     ;
-
-  static bool      previewStarted   ;
+  static VoiceMenuData &data();
 };
 
 using VoiceMenu_tonuino   = VoiceMenu<SM_type::tonuino  >;
 using VoiceMenu_setupCard = VoiceMenu<SM_type::setupCard>;
 
+// the admin menu (with the setupCard and writeCard state machines) and the games never run at
+// the same time, so they share this RAM. The entry() of a state builds its data. All members
+// are trivially destructible (the union would not compile otherwise), so exit() has nothing to
+// destroy.
+union StateArena {
+  StateArena(): game{} {}
+  GameData      game;
+  VoiceMenuData voiceMenu[2]; // VoiceMenu_tonuino and VoiceMenu_setupCard at the same time
+};
+
 class ChMode : public VoiceMenu_setupCard
 {
 public:
@@ -244,6 +294,9 @@ class WriteCard : public SM_writeCard
 public:
   void entry() final;
   void react(command_e const &) final;
+#ifdef BATCH_CARD_WRITE
+  static bool startBatch; // set before SM_writeCard::start() to write the next card in batch mode
+#endif
 private:
   enum subState: uint8_t {
     start_waitCardInserted,
@@ -252,6 +305,9 @@ private:
     run_waitCardRemoved,
   };
   subState current_subState{};
+#ifdef BATCH_CARD_WRITE
+  bool     batch           {};
+#endif
 };
 
 class Admin_BaseSetting: public VoiceMenu_tonuino
@@ -263,6 +319,13 @@ protected:
 class Amin_BaseWriteCard: public VoiceMenu_tonuino {
 protected:
   bool handleWriteCard(command_e const &cmd_e, bool return_to_idle = false);
+#ifdef BATCH_CARD_WRITE
+  static void startBatch();
+  static void logBatchCardWritten();
+
+  static uint8_t       batchCards;
+  static unsigned long batchStartTime;
+#endif
 };
 
 class Admin_Allow: public VoiceMenu_tonuino
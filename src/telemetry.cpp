@@ -0,0 +1,119 @@
+#include "telemetry.hpp"
+
+#include "constants.hpp"
+
+#ifdef TELEMETRY
+#include "logger.hpp"
+#include "settings.hpp"
+
+static_assert(Telemetry::parts <= 32, "Too many telemetry counters (telemetryFolders)");
+
+namespace {
+
+const __FlashStringHelper* counterName(uint8_t c) {
+  switch (c) {
+  case Telemetry::boots               : return F("boots"           );
+  case Telemetry::watchdog_resets     : return F("watchdog"        );
+  case Telemetry::card_reads          : return F("card reads"      );
+  case Telemetry::card_auth_errors    : return F("card auth err"   );
+  case Telemetry::card_read_errors    : return F("card read err"   );
+  case Telemetry::mp3_missing_finished: return F("missing finished");
+  case Telemetry::eeprom_writes       : return F("eeprom writes"   );
+  default                             : return F("?"               );
+  }
+}
+
+} // anonymous namespace
+
+uint16_t      Telemetry::counters[parts * 2]{};
+uint32_t      Telemetry::dirty              {};
+unsigned long Telemetry::lastFlush          {};
+
+void Telemetry::begin() {
+  for (uint8_t part = 0; part < parts; ++part) {
+    array<uint8_t, 4> value;
+    Settings::readTelemetryFromFlash(part, value);
+    counters[2*part  ] = value[0] | (value[1] << 8);
+    counters[2*part+1] = value[2] | (value[3] << 8);
+  }
+  dirty     = 0;
+  lastFlush = millis();
+  count(boots);
+}
+
+void Telemetry::count(counter c) {
+  if (c < wideCounters) {
+    if (++counters[c] == 0 && ++counters[c+1] == 0)
+      counters[c] = counters[c+1] = 0xffff;
+  }
+  else {
+    if (counters[c] == 0xffff)
+      return;
+    ++counters[c];
+  }
+  // the EEPROM writes are flushed with the other counters, else every flush would need the next one
+  if (c != eeprom_writes)
+    dirty |= 1ul << (c / 2);
+}
+
+void Telemetry::play(uint8_t folder, pmode_t mode) {
+  const uint8_t m = static_cast<uint8_t>(mode);
+  if (m >= 1 && m <= 13)
+    count(static_cast<counter>(plays_mode + m - 1));
+  count(static_cast<counter>(plays_folder + ((folder >= 1 && folder <= telemetryFolders) ? folder - 1 : telemetryFolders)));
+}
+
+void Telemetry::mp3Error(uint16_t errorCode) {
+  count(static_cast<counter>(mp3_errors + ((errorCode >= 1 && errorCode <= 7) ? errorCode - 1 : 7)));
+}
+
+void Telemetry::loop() {
+  if (dirty != 0 && millis() - lastFlush >= telemetryFlushTime)
+    flush();
+}
+
+void Telemetry::flush() {
+  lastFlush = millis();
+  if (dirty == 0)
+    return;
+  LOG(settings_log, s_debug, F("flush telemetry"));
+  // the journal writes count themselves: take the parts before writing
+  const uint32_t toWrite = dirty | (1ul << (eeprom_writes / 2));
+  dirty = 0;
+  for (uint8_t part = 0; part < parts; ++part) {
+    if ((toWrite & (1ul << part)) == 0)
+      continue;
+    const uint16_t c0 = counters[2*part  ];
+    const uint16_t c1 = counters[2*part+1];
+    Settings::writeTelemetryToFlash(part, { static_cast<uint8_t>(c0), static_cast<uint8_t>(c0 >> 8),
+                                            static_cast<uint8_t>(c1), static_cast<uint8_t>(c1 >> 8) });
+  }
+}
+
+void Telemetry::printReport() {
+  LOG(trace_log, s_info, F("telemetry:"), lf_no);
+  for (uint8_t c = 0; c < mp3_errors; c += c < wideCounters ? 2 : 1)
+    LOG(trace_log, s_info, F(" "), counterName(c), F(": "), get(static_cast<counter>(c)), lf_no);
+  LOG(trace_log, s_info, F(""));
+  LOG(trace_log, s_info, F("mp3 err (1..7, other):"), lf_no);
+  for (uint8_t c = mp3_errors; c < plays_mode; ++c)
+    LOG(trace_log, s_info, F(" "), counters[c], lf_no);
+  LOG(trace_log, s_info, F(""));
+  LOG(trace_log, s_info, F("plays mode (1..13):"), lf_no);
+  for (uint8_t c = plays_mode; c < plays_folder; ++c)
+    LOG(trace_log, s_info, F(" "), counters[c], lf_no);
+  LOG(trace_log, s_info, F(""));
+  LOG(trace_log, s_info, F("plays folder (1.."), telemetryFolders, F(", other):"), lf_no);
+  for (uint8_t c = plays_folder; c < num_counters; ++c)
+    LOG(trace_log, s_info, F(" "), counters[c], lf_no);
+  LOG(trace_log, s_info, F(""));
+}
+
+void Telemetry::clear() {
+  for (uint16_t &c: counters)
+    c = 0;
+  dirty     = 0;
+  lastFlush = millis();
+}
+
+#endif // TELEMETRY
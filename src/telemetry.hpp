@@ -0,0 +1,66 @@
+#ifndef SRC_TELEMETRY_HPP_
+#define SRC_TELEMETRY_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+#include "chip_card.hpp"
+
+// counts the usage and the errors of the box over its life time: plays per mode and
+// folder, card reads and their failures, DfPlayer errors, recoveries of a missing
+// OnPlayFinished, watchdog resets and EEPROM writes. The counters are aggregated in
+// RAM and only the parts (2 counters) that changed are written through the EEPROM
+// journal every telemetryFlushTime and before the power off. The card reads and the
+// EEPROM writes have 32 bit (a whole part), they stop at 0xffffffff, the others at
+// 0xffff. Without TELEMETRY the calls compile to nothing.
+class Telemetry {
+public:
+  enum counter: uint8_t {
+    card_reads          = 0, // 32 bit: payload read from the chip
+    eeprom_writes       = 2, // 32 bit: bytes
+    boots               = 4,
+    watchdog_resets     ,
+    card_auth_errors    ,
+    card_read_errors    , // MIFARE_Read
+    mp3_missing_finished,
+    mp3_errors          , // DfMp3_Error 1..7, then the other codes
+    plays_mode          = mp3_errors + 8,                    // pmode_t 1..13
+    plays_folder        = plays_mode + 13,                   // folder 1..telemetryFolders, then the others
+    num_counters        = plays_folder + telemetryFolders + 1,
+  };
+  static constexpr uint8_t parts        = (num_counters + 1) / 2; // 4 byte each in the journal
+  static constexpr uint8_t wideCounters = boots;                  // the 32 bit counters take 2 slots
+
+#ifdef TELEMETRY
+  // loads the counters, after Settings::loadSettingsFromFlash()
+  static void     begin     ();
+  static void     count     (counter c);
+  static void     play      (uint8_t folder, pmode_t mode);
+  static void     mp3Error  (uint16_t errorCode);
+  // flushes every telemetryFlushTime
+  static void     loop      ();
+  static void     flush     ();
+  static void     printReport();
+  // after the EEPROM was cleared
+  static void     clear     ();
+
+  static uint32_t get       (counter c) { return c < wideCounters ? counters[c] | (static_cast<uint32_t>(counters[c+1]) << 16)
+                                                                  : counters[c]; }
+
+private:
+  static uint16_t      counters[parts * 2];
+  static uint32_t      dirty;      // bit per part
+  static unsigned long lastFlush;
+#else
+  static void begin     () {}
+  static void count     (counter) {}
+  static void play      (uint8_t, pmode_t) {}
+  static void mp3Error  (uint16_t) {}
+  static void loop      () {}
+  static void flush     () {}
+  static void printReport() {}
+  static void clear     () {}
+#endif // TELEMETRY
+};
+
+#endif /* SRC_TELEMETRY_HPP_ */
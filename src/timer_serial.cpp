@@ -0,0 +1,196 @@
+#include "timer_serial.hpp"
+
+#include "constants.hpp"
+
+#if defined(DFPLAYER_TIMER_SERIAL) and defined(__AVR__)
+
+#include "queue.hpp"
+
+namespace {
+
+constexpr uint8_t txPin = dfPlayer_transmitPin;
+constexpr uint8_t rxPin = dfPlayer_receivePin;
+static_assert(txPin == 9 && rxPin == 8, "the pins of timer 1 are OC1A (D9) and ICP1 (D8)");
+
+constexpr uint8_t txStartBit = 0;
+constexpr uint8_t txStopBit  = 9;
+constexpr uint8_t txIdle     = 10; // after the stop bit
+
+uint16_t ticksPerBit;
+
+ring_buffer<uint8_t, timerSerialTxBuffer> txBuffer;
+volatile uint8_t  txBit  = txIdle;
+uint8_t           txByte;
+volatile bool     txActive; // flush() waits for the ISR to clear it
+
+ring_buffer<uint8_t, timerSerialRxBuffer> rxBuffer;
+uint8_t           rxBit; // 0: wait for the start bit, 1..8 data bits
+uint8_t           rxByte;
+uint16_t          rxTarget; // middle of the next bit
+
+// the level is set by the hardware at the next compare match
+inline void txLevelAtMatch(bool high) {
+  if (high) TCCR1A |=  _BV(COM1A0);             // set
+  else      TCCR1A  = (TCCR1A & ~_BV(COM1A0)) | _BV(COM1A1); // clear
+}
+
+inline void rxEdge(bool rising) {
+  if (rising) TCCR1B |=  _BV(ICES1);
+  else        TCCR1B &= ~_BV(ICES1);
+  TIFR1 = _BV(ICF1); // changing the edge can set the flag
+}
+
+void rxPushBits(uint16_t until, bool level) {
+  while (rxBit != 0 && static_cast<int16_t>(until - rxTarget) >= 0) {
+    rxByte >>= 1;
+    if (level)
+      rxByte |= 0x80;
+    rxTarget += ticksPerBit;
+    if (++rxBit > 8) {
+      rxBuffer.push(rxByte);
+      rxBit = 0;
+      TIMSK1 &= ~_BV(OCIE1B);
+      rxEdge(false);
+    }
+  }
+}
+
+} // anonymous namespace
+
+void TimerSerial::startTimer() {
+  TCCR1A = 0;
+  TCCR1B = _BV(ICNC1) | _BV(CS10); // normal mode, noise canceler for ICP1
+}
+
+void TimerSerial::begin(unsigned long baud) {
+  const uint8_t oldSREG = SREG;
+  cli();
+  startTimer();
+  ticksPerBit = (F_CPU + baud / 2) / baud;
+
+  // TX idle high, OC1A sets the pin to high on the compare match
+  digitalWrite(txPin, HIGH);
+  pinMode(txPin, OUTPUT);
+  TCCR1A |= _BV(COM1A1) | _BV(COM1A0);
+  TCCR1C  = _BV(FOC1A); // the OC1A latch starts low: force it high
+  txBit    = txIdle;
+  txActive = false;
+
+  pinMode(rxPin, INPUT_PULLUP);
+  rxBit = 0;
+  rxEdge(false);
+  TIFR1  = _BV(ICF1) | _BV(OCF1B);
+  TIMSK1 |= _BV(ICIE1);
+  SREG = oldSREG;
+}
+
+void TimerSerial::end() {
+  TIMSK1 &= ~(_BV(ICIE1) | _BV(OCIE1A) | _BV(OCIE1B));
+  TCCR1A = 0;
+}
+
+// the ring buffers are lock free with one producer and one consumer
+int TimerSerial::available() {
+  return rxBuffer.size();
+}
+
+int TimerSerial::read() {
+  uint8_t b;
+  return rxBuffer.pop(b) ? b : -1;
+}
+
+int TimerSerial::peek() {
+  return rxBuffer.size() == 0 ? -1 : rxBuffer.peek(0);
+}
+
+void TimerSerial::flush() {
+  while (txActive)
+    ;
+}
+
+size_t TimerSerial::write(uint8_t b) {
+  for (;;) {
+    const uint8_t oldSREG = SREG;
+    cli();
+    if (not txActive) {
+      // the start bit follows right after
+      txByte   = b;
+      txBit    = txStartBit;
+      txActive = true;
+      txLevelAtMatch(false);
+      OCR1A  = TCNT1 + 16;
+      TIFR1  = _BV(OCF1A);
+      TIMSK1 |= _BV(OCIE1A);
+      SREG = oldSREG;
+      return 1;
+    }
+    const bool pushed = txBuffer.push(b);
+    SREG = oldSREG;
+    if (pushed)
+      return 1;
+    // buffer full: wait with the interrupts enabled
+  }
+}
+
+// the bit txBit is on the line now, prepare the level of the next one
+void TimerSerial::txCompare() {
+  uint8_t next = txBit + 1;
+  if (next >= txIdle) {
+    // the next byte follows the stop bit directly
+    if (txBuffer.pop(txByte))
+      next = txStartBit;
+    else if (next > txIdle) { // the stop bit is complete
+      TIMSK1 &= ~_BV(OCIE1A);
+      txActive = false;
+      return;
+    }
+  }
+  const bool high = (next == txStartBit) ? false
+                  : (next >= txStopBit ) ? true
+                  : (txByte >> (next - 1)) & 0x01;
+  txLevelAtMatch(high);
+  OCR1A += ticksPerBit;
+  txBit  = next;
+}
+
+void TimerSerial::rxCapture() {
+  const uint16_t capture = ICR1;
+  const bool     rising  = TCCR1B & _BV(ICES1);
+  if (rxBit == 0) {
+    if (rising)
+      return;
+    // start bit: sample in the middle of the data bits, the end of the frame by timeout (after 9.25 bits)
+    rxBit    = 1;
+    rxByte   = 0;
+    rxTarget = capture + ticksPerBit + ticksPerBit / 2;
+    OCR1B    = capture + ticksPerBit * 37 / 4;
+    TIFR1    = _BV(OCF1B);
+    TIMSK1  |= _BV(OCIE1B);
+    rxEdge(true);
+    return;
+  }
+  // the bits up to this edge have the level before the edge
+  rxPushBits(capture, not rising);
+  if (rxBit != 0)
+    rxEdge(not rising);
+}
+
+void TimerSerial::rxTimeout() {
+  // no edge since the last one, the rest of the data bits has the current level (stop bit: high)
+  const bool high = not (TCCR1B & _BV(ICES1));
+  rxPushBits(rxTarget + ticksPerBit * 8, high);
+}
+
+ISR(TIMER1_COMPA_vect) {
+  TimerSerial::txCompare();
+}
+
+ISR(TIMER1_CAPT_vect) {
+  TimerSerial::rxCapture();
+}
+
+ISR(TIMER1_COMPB_vect) {
+  TimerSerial::rxTimeout();
+}
+
+#endif // DFPLAYER_TIMER_SERIAL and __AVR__
@@ -0,0 +1,40 @@
+#ifndef SRC_TIMER_SERIAL_HPP_
+#define SRC_TIMER_SERIAL_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+#ifdef DFPLAYER_TIMER_SERIAL
+// software UART for the DfPlayer with timer 1 of the ATmega328P (like AltSoftSerial).
+// RX is the input capture pin ICP1 (D8), TX the output compare pin OC1A (D9). The
+// edges are captured and generated by the timer hardware, the interrupts only have
+// to run within one bit (104 us at 9600 baud). So all other interrupts stay enabled
+// and RX works while sending.
+// The timer runs free with F_CPU, the samplers of USE_TIMER1 run on its overflow
+// (every 4.096 ms at 16 MHz).
+class TimerSerial: public Stream {
+public:
+  TimerSerial() {}
+
+  void begin(unsigned long baud);
+  void end();
+
+  int    available() override;
+  int    read     () override;
+  int    peek     () override;
+  void   flush    () override; // waits until all bytes are sent
+  size_t write    (uint8_t b) override;
+  using Print::write;
+
+  // free running timer 1 with F_CPU, also for the samplers of USE_TIMER1
+  static void startTimer();
+
+  // called from the timer interrupts
+  static void txCompare();
+  static void rxCapture();
+  static void rxTimeout();
+};
+#endif // DFPLAYER_TIMER_SERIAL
+
+#endif // SRC_TIMER_SERIAL_HPP_
@@ -1,7 +1,12 @@
 #include "tonuino.hpp"
 
 #include <Arduino.h>
+#ifndef TonUINO_ESP32
 #include <avr/sleep.h>
+#endif
+#if defined(LIGHT_SLEEP) and defined(TonUINO_Classic) and not defined(UNIT_TESTS)
+#include <avr/wdt.h>
+#endif
 
 #include "array.hpp"
 #include "chip_card.hpp"
@@ -9,24 +14,91 @@
 #include "constants.hpp"
 #include "logger.hpp"
 #include "state_machine.hpp"
+#include "latency_trace.hpp"
+#include "adc_sampler.hpp"
+#include "memory_monitor.hpp"
+#include "loop_profiler.hpp"
+#include "log_buffer.hpp"
+#include "watchdog.hpp"
+#include "energy_monitor.hpp"
+#include "telemetry.hpp"
 
 namespace {
 
 const __FlashStringHelper* str_bis      () { return F(" bis "); }
 
+#ifdef LIGHT_SLEEP
+#if defined(TonUINO_Classic) and not defined(UNIT_TESTS)
+static_assert(lightSleepPollTime == 250, "lightSleepPollTime must match the watchdog period");
+
+// power down until the watchdog fires (250 ms) or the play/pause button changes. The pin change
+// interrupt is taken by the ISR of SoftwareSerial (all PCINT vectors), of PinChange or the empty one below.
+void lightSleepPowerDown() {
+  cli();
+  *digitalPinToPCMSK(buttonPausePin) |= _BV(digitalPinToPCMSKbit(buttonPausePin));
+  *digitalPinToPCICR(buttonPausePin) |= _BV(digitalPinToPCICRbit(buttonPausePin));
+  wdt_reset();
+  WDTCSR = _BV(WDCE) | _BV(WDE);
+  WDTCSR = _BV(WDIE) | _BV(WDP2); // interrupt only, 250 ms
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sei();
+  sleep_cpu();
+  sleep_disable();
+  wdt_disable();
+#ifndef PIN_CHANGE_IRQ // the pin change service keeps it
+  *digitalPinToPCMSK(buttonPausePin) &= ~_BV(digitalPinToPCMSKbit(buttonPausePin));
+#endif
+}
+#else
+void lightSleepPowerDown() { delay(lightSleepPollTime); }
+#endif
+#endif // LIGHT_SLEEP
+
 } // anonymous namespace
 
+#if defined(LIGHT_SLEEP) and defined(TonUINO_Classic) and not defined(UNIT_TESTS)
+EMPTY_INTERRUPT(WDT_vect)
+// without SoftwareSerial and PinChange nobody has the PCINT vectors, the wake up would jump to the reset vector
+#if (defined(DFPLAYER_TIMER_SERIAL) or defined(DFPlayerUsesHardwareSerial)) and not defined(PIN_CHANGE_IRQ)
+EMPTY_INTERRUPT(PCINT0_vect)
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+#endif
+
 #ifdef USE_TIMER1
+#ifdef DFPLAYER_TIMER_SERIAL
+// timer 1 runs free for the serial to the DfPlayer (compare A is used by TX)
+ISR(TIMER1_OVF_vect){
+#else
 ISR(TIMER1_COMPA_vect){
   TCNT1  = 0;
+#endif
 #ifdef ROTARY_ENCODER_USES_TIMER1
   RotaryEncoder::timer_loop();
 #endif
+#ifdef BUTTONS_EDGE_BUFFER_USES_TIMER1
+  Buttons::sample();
+#endif
+#ifdef DFPLAYER_BUSY_IRQ_USES_TIMER1
+  Mp3::sampleBusy();
+#endif
 }
 #endif
 
 void Tonuino::setup() {
-#ifdef USE_TIMER1
+  Watchdog::begin();
+#ifdef TonUINO_ESP32
+  EEPROM.begin(eepromSize);
+#endif
+
+#if defined(USE_TIMER1) and defined(DFPLAYER_TIMER_SERIAL)
+  cli();
+  TimerSerial::startTimer();
+  TIMSK1 |= (1 << TOIE1);  // samplers with F_CPU/65536 (244 Hz)
+  sei();
+#elif defined(USE_TIMER1)
   cli();//stop interrupts
 
   TCCR1A = 0;              // set entire TCCR1A register to 0
@@ -90,22 +162,47 @@ void Tonuino::setup() {
 
   // DFPlayer Mini initialisieren
   mp3.begin();
-  delay(2000);
+#ifdef FAST_BOOT
+  // NFC Leser initialisieren, while the DfPlayer boots
+  chip_card.initCard();
+  mp3.waitForReady(2000);
+#else
+  // after the watchdog reset the DfPlayer is already up
+  if (not Watchdog::recovered())
+    delay(2000);
 
   // NFC Leser initialisieren
   chip_card.initCard();
+#endif
 
   // RESET --- ALLE DREI KNÖPFE BEIM STARTEN GEDRÜCKT HALTEN -> alle EINSTELLUNGEN werden gelöscht
   if (buttons.isReset()) {
     settings.clearEEPROM();
     settings.loadSettingsFromFlash();
   }
+#ifdef KEYMAP
+  commands.loadKeymap();
+#endif
+  Telemetry::begin();
+  if (Watchdog::recovered())
+    Telemetry::count(Telemetry::watchdog_resets);
+
+#ifdef RESUME_SNAPSHOT
+  settings.readSnapshotFromFlash(resumeSnapshot);
+  if (not (resumeSnapshot.folder == myFolder.folder && resumeSnapshot.mode == myFolder.mode))
+    resumeSnapshot.folder = 0;
+  LOG(init_log, s_debug, F("snapshot, folder: "), resumeSnapshot.folder, F(", pos: "), resumeSnapshot.queuePos);
+#endif
 
   // DFPlayer Mini initialisieren (2)
 #if defined SPKONOFF
   digitalWrite(ampEnablePin, getLevel(ampEnablePinType, level::active));
 #endif
   mp3.setVolume();
+#ifdef RESUME_SNAPSHOT
+  if (resumeSnapshot.folder != 0 && resumeSnapshot.volume >= mp3.getMinVolume() && resumeSnapshot.volume <= mp3.getMaxVolume())
+    mp3.setVolume(resumeSnapshot.volume);
+#endif
   mp3.setEq(static_cast<DfMp3_Eq>(settings.eq - 1));
   mp3.loop();
 
@@ -115,6 +212,11 @@ void Tonuino::setup() {
   commands.getCommandRaw();
 
   // Start Shortcut "at Startup" - e.g. Welcome Sound
+#ifdef WATCHDOG
+  if (Watchdog::recovered()) {
+    // continue silently in Idle after the watchdog reset
+  } else
+#endif // WATCHDOG
 #ifdef SPECIAL_START_SHORTCUT
 
 #ifdef TonUINO_Classic
@@ -132,12 +234,113 @@ void Tonuino::setup() {
 #endif // SPECIAL_START_SHORTCUT
 
     SM_tonuino::dispatch(command_e(commandRaw::start));
+
+#ifdef ADC_BACKGROUND
+  AdcSampler::start();
+#endif
+#ifdef FAST_BOOT
+  LOG(init_log, s_info, F("boot to ready: "), millis(), F(" ms"));
+#endif
+#ifdef BUFFERED_LOG
+  // from now on the log is sent in the idle time of the cycle
+  LogBuffer::getLogBuffer().setBuffered(true);
+#endif
+  Watchdog::start();
 }
 
+#ifdef TICK_SCHEDULER
+const SchedulerTask<Tonuino> Tonuino::schedulerTasks[] = {
+  { &Tonuino::loopHousekeeping, cycleTime          },
+#ifdef BAT_VOLTAGE_MEASUREMENT
+  { &Tonuino::loopBatVoltage  , tickTimeBatVoltage },
+#endif
+  { &Tonuino::loopMp3         , tickTimeMp3        },
+  { &Tonuino::loopModifier    , cycleTime          },
+  { &Tonuino::loopCommands    , tickTimeCommands   },
+  { &Tonuino::loopCard        , cycleTime          },
+#ifdef EVENT_QUEUE
+  { &Tonuino::loopEvents      , tickTimeCommands   },
+#endif
+#ifdef NEO_RING
+  { &Tonuino::loopRing        , cycleTime          },
+#endif
+};
+#endif // TICK_SCHEDULER
+
 void Tonuino::loop() {
 
+#ifdef TICK_SCHEDULER
+  scheduler.loop(*this, schedulerTasks, cycleTime);
+#ifdef BUFFERED_LOG
+  LogBuffer::getLogBuffer().drain();
+#endif
+#else
   unsigned long  start_cycle = millis();
+
+  { // measure the cycle without the delay
+    LoopProfiler::Section profile{LoopProfiler::cycle};
+    loopHousekeeping();
+#ifdef BAT_VOLTAGE_MEASUREMENT
+    loopBatVoltage();
+#endif
+    loopMp3();
+    loopModifier();
+    loopCommands();
+    loopCard();
+#ifdef EVENT_QUEUE
+    loopEvents();
+#endif
+#ifdef NEO_RING
+    loopRing();
+#endif
+#ifdef DFPLAYER_CMD_QUEUE
+    {
+      LoopProfiler::Section profile{LoopProfiler::send_mp3};
+      // send the commands of this cycle, the DfPlayer loop will run in the next cycle
+      mp3.sendCommands();
+    }
+#endif
+  }
+
+  unsigned long  stop_cycle = millis();
+
+#ifdef BUFFERED_LOG
+  // send the log in the idle time of the cycle, drain() does not block
+  while (stop_cycle-start_cycle < cycleTime && LogBuffer::getLogBuffer().drain())
+    stop_cycle = millis();
+#endif
+
+  if (stop_cycle-start_cycle < cycleTime)
+    delay(cycleTime - (stop_cycle - start_cycle));
+#endif // TICK_SCHEDULER
+}
+
+#ifdef TonUINO_ESP32
+void Tonuino::loopUi(cardEvent card_ev) {
+  LoopProfiler::Section profile{LoopProfiler::cycle};
+  loopHousekeeping();
+  loopModifier();
+  loopCommands();
+  if (card_ev != cardEvent::none)
+    dispatchCard(card_ev);
+#ifdef NEO_RING
+  loopRing();
+#endif
+  // the emulated EEPROM is only written to the flash with commit() (nothing to do if not changed)
+  EEPROM.commit();
+}
+#endif // TonUINO_ESP32
+
+void Tonuino::loopHousekeeping() {
+  LoopProfiler::Section profile{LoopProfiler::housekeeping};
+#ifdef ENERGY_MONITOR
+  loopEnergy();
+#endif
   checkStandby();
+  settings.loop();
+  Telemetry::loop();
+  MemoryMonitor::loop();
+  Watchdog::loop();
 
   static bool is_playing = false;
   LOG_CODE(play_log, s_info, {
@@ -147,25 +350,135 @@ void Tonuino::loop() {
     }
   } );
 
+#ifdef BT_MODULE
+  if (btModulePairingTimer.isActive() && btModulePairingTimer.isExpired())
+    digitalWrite(btModulePairingPin, getLevel(btModulePairingPinType, level::inactive));
+#endif // BT_MODULE
+}
+
+#ifdef ENERGY_MONITOR
+void Tonuino::loopEnergy() {
+  EnergyMonitor::counter state = EnergyMonitor::idle;
+  if (mp3.isPlaying()) {
+    const uint8_t band = static_cast<uint16_t>(mp3.getVolume() - mp3.getMinVolume()) * 3 / (mp3.getMaxVolume() - mp3.getMinVolume() + 1);
+    state = static_cast<EnergyMonitor::counter>(EnergyMonitor::play_low + band);
+  }
+#if defined SPKONOFF
+  const bool ampOn = digitalRead(ampEnablePin) == getLevel(ampEnablePinType, level::active);
+#else
+  const bool ampOn = false;
+#endif
+#ifdef NEO_RING
+  const uint8_t ringBrightness = static_cast<uint16_t>(ring.getBrightness()) * 0xff / brightness_max;
+#else
+  const uint8_t ringBrightness = 0;
+#endif
+  EnergyMonitor::loop(state, ampOn, ringBrightness);
+}
+#endif // ENERGY_MONITOR
+
 #ifdef BAT_VOLTAGE_MEASUREMENT
+void Tonuino::loopBatVoltage() {
+  LoopProfiler::Section profile{LoopProfiler::bat_voltage};
   if (batVoltage.check())
     shutdown();
+}
 #endif
 
+void Tonuino::loopMp3() {
+  LoopProfiler::Section profile{LoopProfiler::mp3};
+  Watchdog::Heartbeat   heartbeat{Watchdog::mp3};
   mp3.loop();
+}
+
+void Tonuino::loopModifier() {
+  LoopProfiler::Section profile{LoopProfiler::modifier};
+  modifiers.loop();
+}
+
+void Tonuino::loopCommands() {
+  LoopProfiler::Section profile{LoopProfiler::commands};
+  Watchdog::Heartbeat   heartbeat{Watchdog::commands};
+  const commandRaw cmd_raw = commands.getCommandRaw();
+#ifdef ADAPTIVE_CARD_POLL
+  if (cmd_raw != commandRaw::none)
+    chip_card.pollFast();
+#endif
+#ifdef EVENT_QUEUE
+  if (cmd_raw != commandRaw::none)
+    events.push(events_t::p_command, static_cast<uint8_t>(cmd_raw));
+#else
+  Watchdog::Heartbeat heartbeat_sm{Watchdog::state_machine};
+  if (cmd_raw != commandRaw::none)
+    SM_tonuino::dispatch(command_e(cmd_raw));
+  else
+    SM_tonuino::dispatch(tick_e());
+#endif
+}
 
-  activeModifier->loop();
+void Tonuino::loopCard() {
+  LoopProfiler::Section profile{LoopProfiler::card};
+  Watchdog::Heartbeat   heartbeat{Watchdog::card};
+#ifdef ADAPTIVE_CARD_POLL
+  // the slow poll only while waiting or playing, the admin menu and the games need the card at once
+  if (not (   SM_tonuino::is_in_state<Idle >()
+           or SM_tonuino::is_in_state<Play >()
+           or SM_tonuino::is_in_state<Pause>()))
+    chip_card.pollFast();
+#endif
+  const cardEvent card_ev = chip_card.getCardEvent();
+#ifdef EVENT_QUEUE
+  if (card_ev != cardEvent::none)
+    events.push(events_t::p_card, static_cast<uint8_t>(card_ev));
+#else
+  if (card_ev != cardEvent::none)
+    dispatchCard(card_ev);
+#endif
+}
 
-  SM_tonuino::dispatch(command_e(commands.getCommandRaw()));
-  SM_tonuino::dispatch(card_e(chip_card.getCardEvent()));
+#ifdef EVENT_QUEUE
+void Tonuino::loopEvents() {
+  LoopProfiler::Section profile{LoopProfiler::commands};
+  Watchdog::Heartbeat   heartbeat{Watchdog::state_machine};
+  bool command_dispatched = false;
+  events_t::event ev;
+  while (events.pop(ev)) {
+    if (ev.prio == events_t::p_card) {
+      // the state machine gets its tick before the card like without the queue
+      if (not command_dispatched) {
+        SM_tonuino::dispatch(tick_e());
+        command_dispatched = true;
+      }
+      dispatchCard(static_cast<cardEvent>(ev.value));
+    }
+    else {
+      SM_tonuino::dispatch(command_e(static_cast<commandRaw>(ev.value)));
+      command_dispatched = true;
+    }
+  }
+  if (not command_dispatched)
+    SM_tonuino::dispatch(tick_e());
+}
+#endif // EVENT_QUEUE
+
+void Tonuino::dispatchCard(cardEvent card_ev) {
+  Watchdog::Heartbeat heartbeat{Watchdog::state_machine};
+  SM_tonuino::dispatch(card_e(card_ev));
+  if (card_ev == cardEvent::inserted)
+    LatencyTrace::mark(LatencyTrace::card_dispatched);
+  else if (card_ev == cardEvent::removed)
+    settings.flushToFlash();
+}
 
 #ifdef NEO_RING
+void Tonuino::loopRing() {
+  LoopProfiler::Section profile{LoopProfiler::ring};
 #ifdef NEO_RING_EXT
   if (mp3.volumeChanged())
     ring.call_on_volume(mp3.getVolumeRel());
   else if (standbyTimer.remainingTime() < 60*1000ul)
     ring.call_before_sleep(standbyTimer.remainingTime() / 1000 * 255 / 60);
-  else if (activeModifier->getActive() == pmode_t::sleep_timer)
+  else if (modifiers.getActive() == pmode_t::sleep_timer)
     ring.call_on_sleep_timer();
   else
 #endif // NEO_RING_EXT
@@ -187,67 +500,89 @@ void Tonuino::loop() {
 #endif // MEMORY_GAME
   else // admin menu
     ring.call_on_admin();
-#endif // NEO_RING
-
-#ifdef BT_MODULE
-  if (btModulePairingTimer.isActive() && btModulePairingTimer.isExpired())
-    digitalWrite(btModulePairingPin, getLevel(btModulePairingPinType, level::inactive));
-#endif // BT_MODULE
-
-
-  unsigned long  stop_cycle = millis();
-
-  if (stop_cycle-start_cycle < cycleTime)
-    delay(cycleTime - (stop_cycle - start_cycle));
 }
+#endif // NEO_RING
 
 void Tonuino::playFolder() {
   LOG(play_log, s_debug, F("playFolder"));
+  LatencyTrace::mark(LatencyTrace::play_folder);
+  Telemetry::play(myFolder.folder, myFolder.mode);
   numTracksInFolder = mp3.getFolderTrackCount(myFolder.folder);
   LOG(play_log, s_warning, numTracksInFolder, F(" tr in folder "), myFolder.folder);
-  numTracksInFolder = min(numTracksInFolder, 0xffu);
+#ifdef LARGE_FOLDERS
+  numTracksInFolder = min(numTracksInFolder, static_cast<uint16_t>((myFolder.folder <= largeFolderLast) ? maxTracksInLargeFolder : 0xffu));
+#else
+  numTracksInFolder = min(numTracksInFolder, static_cast<uint16_t>(0xff));
+#endif
   mp3.clearAllQueue();
 
+#ifdef RESUME_SNAPSHOT
+  // continue with the queue of the snapshot (only once after the startup)
+  const bool resume = resumeSnapshot.folder != 0 && resumeSnapshot.folder == myFolder.folder && resumeSnapshot.mode == myFolder.mode;
+  resumeSnapshot.folder = 0;
+#endif
+
+  // the range of the von-bis modes (the card has only 8 bit)
+  track_t firstTrack = myFolder.special;
+  track_t lastTrack  = myFolder.special2;
+
   switch (myFolder.mode) {
 
   case pmode_t::hoerspiel:
     // Hörspielmodus: eine zufällige Datei aus dem Ordner
     myFolder.special = 1;
     myFolder.special2 = numTracksInFolder;
+    firstTrack = 1;
+    lastTrack  = numTracksInFolder;
     __attribute__ ((fallthrough));
     /* no break */
   case pmode_t::hoerspiel_vb:
     // Spezialmodus Von-Bin: Hörspiel: eine zufällige Datei aus dem Ordner
     LOG(play_log, s_info, F("Hörspiel"));
-    LOG(play_log, s_info, myFolder.special, str_bis(), myFolder.special2);
-    mp3.enqueueTrack(myFolder.folder, random(myFolder.special, myFolder.special2 + 1));
+    LOG(play_log, s_info, firstTrack, str_bis(), lastTrack);
+#ifdef SHUFFLE_NO_REPEAT
+    mp3.enqueueTrack(myFolder.folder, randomEpisode(firstTrack, lastTrack));
+#else
+    mp3.enqueueTrack(myFolder.folder, random(firstTrack, lastTrack + 1));
+#endif
     break;
 
   case pmode_t::album:
     // Album Modus: kompletten Ordner spielen
     myFolder.special = 1;
     myFolder.special2 = numTracksInFolder;
+    firstTrack = 1;
+    lastTrack  = numTracksInFolder;
     __attribute__ ((fallthrough));
     /* no break */
   case pmode_t::album_vb:
     // Spezialmodus Von-Bis: Album: alle Dateien zwischen Start und Ende spielen
     LOG(play_log, s_info, F("Album"));
-    LOG(play_log, s_info, myFolder.special, str_bis() , myFolder.special2);
-    mp3.enqueueTrack(myFolder.folder, myFolder.special, myFolder.special2);
+    LOG(play_log, s_info, firstTrack, str_bis() , lastTrack);
+    mp3.enqueueTrack(myFolder.folder, firstTrack, lastTrack);
     break;
 
   case pmode_t::party:
     // Party Modus: Ordner in zufälliger Reihenfolge
     myFolder.special = 1;
     myFolder.special2 = numTracksInFolder;
+    firstTrack = 1;
+    lastTrack  = numTracksInFolder;
     __attribute__ ((fallthrough));
     /* no break */
   case pmode_t::party_vb:
     // Spezialmodus Von-Bis: Party Ordner in zufälliger Reihenfolge
     LOG(play_log, s_info, F("Party"));
-    LOG(play_log, s_info, myFolder.special, str_bis(), myFolder.special2);
-    mp3.enqueueTrack(myFolder.folder, myFolder.special, myFolder.special2);
+    LOG(play_log, s_info, firstTrack, str_bis(), lastTrack);
+    mp3.enqueueTrack(myFolder.folder, firstTrack, lastTrack);
+#ifdef RESUME_SNAPSHOT
+    if (resume)
+      mp3.shuffleQueue(resumeSnapshot.shuffleSeed);
+    else
+      mp3.shuffleQueue();
+#else
     mp3.shuffleQueue();
+#endif
     mp3.setEndless();
     break;
 
@@ -272,20 +607,89 @@ void Tonuino::playFolder() {
   default:
     break;
   }
+
+#ifdef RESUME_SNAPSHOT
+  if (resume && resumeSnapshot.queuePos < mp3.getQueueSize()) {
+    LOG(play_log, s_info, F("resume at "), resumeSnapshot.queuePos);
+    mp3.setQueuePos(resumeSnapshot.queuePos);
+    snapshotStored = true;
+  }
+#endif
+}
+
+#ifdef RESUME_SNAPSHOT
+void Tonuino::saveSnapshot() {
+  if (not mp3.isPlayingFolder())
+    return;
+  switch (myFolder.mode) {
+  case pmode_t::album   :
+  case pmode_t::album_vb:
+  case pmode_t::party   :
+  case pmode_t::party_vb: break;
+  default               : return;
+  }
+  settings.writeSnapshotToFlash({ myFolder.folder, myFolder.mode, mp3.getVolume(), 0, mp3.getQueuePos(), mp3.getShuffleSeed() });
+  snapshotStored = true;
+}
+
+void Tonuino::clearSnapshot() {
+  if (snapshotStored) {
+    settings.writeSnapshotToFlash({});
+    snapshotStored = false;
+  }
 }
+#endif // RESUME_SNAPSHOT
 
 void Tonuino::playTrackNumber () {
-  const uint8_t advertTrack = mp3.getCurrentTrack();
+  const track_t advertTrack = mp3.getCurrentTrack();
   if (advertTrack != 0)
     mp3.playAdvertisement(advertTrack);
 }
 
 
 // Leider kann das Modul selbst keine Queue abspielen, daher müssen wir selbst die Queue verwalten
+#ifdef SHUFFLE_NO_REPEAT
+track_t Tonuino::randomEpisode(track_t first, track_t last) {
+  if (episodesFolder != myFolder.folder) {
+    episodesPlayed.setAll(0);
+    episodesFolder = myFolder.folder;
+  }
+  const auto countOpen = [&]() {
+    uint16_t open = 0;
+    for (track_t t = first; ; ++t) {
+      if (not episodesPlayed.getBit(t))
+        ++open;
+      if (t == last) // no overflow for last = 0xff
+        break;
+    }
+    return open;
+  };
+  uint16_t open = countOpen();
+  if (open == 0) {
+    // all played --> next round, but not the last one again
+    episodesPlayed.setAll(0);
+    if (first != last)
+      episodesPlayed.setBit(lastEpisode);
+    open = countOpen();
+  }
+  uint16_t n = random(0, open);
+  for (track_t t = first; ; ++t) {
+    if (not episodesPlayed.getBit(t) && n-- == 0) {
+      episodesPlayed.setBit(t);
+      lastEpisode = t;
+      return t;
+    }
+    if (t == last)
+      break;
+  }
+  return first;
+}
+#endif // SHUFFLE_NO_REPEAT
+
 void Tonuino::nextTrack(uint8_t tracks, bool fromOnPlayFinished) {
   LOG(play_log, s_info, F("nextTrack"));
   if (fromOnPlayFinished && mp3.isPlayingFolder() && (myFolder.mode == pmode_t::hoerbuch || myFolder.mode == pmode_t::hoerbuch_1)) {
-    const uint8_t trackToSave = (mp3.getCurrentTrack() < numTracksInFolder) ? mp3.getCurrentTrack()+1 : 1;
+    const track_t trackToSave = (mp3.getCurrentTrack() < numTracksInFolder) ? mp3.getCurrentTrack()+1 : 1;
     settings.writeFolderSettingToFlash(myFolder.folder, trackToSave);
     if (myFolder.mode == pmode_t::hoerbuch_1) {
       if (myFolder.special > 0)
@@ -294,7 +698,7 @@ void Tonuino::nextTrack(uint8_t tracks, bool fromOnPlayFinished) {
         mp3.clearFolderQueue();
     }
   }
-  if (activeModifier->handleNext())
+  if (modifiers.handleNext())
     return;
   mp3.playNext(tracks, fromOnPlayFinished);
   if (not fromOnPlayFinished && mp3.isPlayingFolder() && (myFolder.mode == pmode_t::hoerbuch || myFolder.mode == pmode_t::hoerbuch_1)) {
@@ -302,9 +706,27 @@ void Tonuino::nextTrack(uint8_t tracks, bool fromOnPlayFinished) {
   }
 }
 
+#ifdef TRACK_PRE_ARM
+bool Tonuino::isPreArmAllowed() const {
+  switch (modifiers.getActive()) {
+  case pmode_t::sleep_timer  :
+  case pmode_t::kindergarden :
+  case pmode_t::repeat_single: return false;
+  default                    : break;
+  }
+  switch (myFolder.mode) {
+  case pmode_t::album     :
+  case pmode_t::album_vb  :
+  case pmode_t::hoerbuch  : return true;
+  case pmode_t::hoerbuch_1: return myFolder.special > 0;
+  default                 : return false;
+  }
+}
+#endif // TRACK_PRE_ARM
+
 void Tonuino::previousTrack(uint8_t tracks) {
   LOG(play_log, s_info, F("previousTrack"));
-  if (activeModifier->handlePrevious())
+  if (modifiers.handlePrevious())
     return;
   mp3.playPrevious(tracks);
   if (mp3.isPlayingFolder() && (myFolder.mode == pmode_t::hoerbuch || myFolder.mode == pmode_t::hoerbuch_1)) {
@@ -331,12 +753,59 @@ void Tonuino::disableStandbyTimer() {
 
 void Tonuino::checkStandby() {
   if (standbyTimer.isActive() && standbyTimer.isExpired()) {
+#ifdef LIGHT_SLEEP
+    standbyTimer.stop();
+    if (lightSleep()) {
+      setStandbyTimer();
+      return;
+    }
+#endif
     shutdown();
   }
 }
 
+#ifdef LIGHT_SLEEP
+// returns true if woken up by a new card or the play/pause button, false after lightSleepTime.
+// The state (Idle or Pause) is kept, the card or the button is handled by the next loop.
+bool Tonuino::lightSleep() {
+  LOG(standby_log, s_info, F("light sleep"));
+  Telemetry::flush();
+  settings.flushToFlash();
+
+#ifdef NEO_RING
+  ring.call_on_sleep();
+#endif
+#if defined SPKONOFF
+  digitalWrite(ampEnablePin, getLevel(ampEnablePinType, level::inactive));
+#endif
+  chip_card.sleepCard();
+
+  bool woken = false;
+  unsigned long t = 0;
+  for (; t < lightSleepTime && not woken; t += lightSleepPollTime) {
+    lightSleepPowerDown();
+    woken = digitalRead(buttonPausePin) == getLevel(buttonPinType, level::active)
+         || chip_card.pollCardInSleep();
+  }
+  EnergyMonitor::addSleep(t);
+
+  chip_card.wakeCard();
+#if defined SPKONOFF
+  if (woken)
+    digitalWrite(ampEnablePin, getLevel(ampEnablePinType, level::active));
+#endif
+  LOG(standby_log, s_info, F("woken: "), woken);
+  return woken;
+}
+#endif // LIGHT_SLEEP
+
 void Tonuino::shutdown() {
   LOG(standby_log, s_info, F("power off!"));
+#ifdef RESUME_SNAPSHOT
+  saveSnapshot();
+#endif
+  Telemetry::flush();
+  settings.flushToFlash();
 
 #ifdef NEO_RING
   ring.call_on_sleep();
@@ -356,9 +825,15 @@ void Tonuino::shutdown() {
   chip_card.sleepCard();
   mp3.sleep();
 
+  Watchdog::disable();
+#ifdef TonUINO_ESP32
+  EEPROM.commit();
+  esp_deep_sleep_start();
+#else
   set_sleep_mode(SLEEP_MODE_PWR_DOWN);
   cli();  // Disable interrupts
   sleep_mode();
+#endif
 }
 
 #ifdef BT_MODULE
@@ -382,7 +857,7 @@ void Tonuino::btModulePairing() {
 
 bool Tonuino::specialCard(const folderSettings &nfcTag) {
   LOG(card_log, s_debug, F("special card, mode = "), static_cast<uint8_t>(nfcTag.mode));
-  if (activeModifier->getActive() == nfcTag.mode) {
+  if (modifiers.getActive() == nfcTag.mode) {
     resetActiveModifier();
     LOG(card_log, s_info, F("modifier removed"));
     mp3.playAdvertisement(advertTracks::t_261_deactivate_mod_card, false/*olnyIfIsPlaying*/);
@@ -399,46 +874,44 @@ bool Tonuino::specialCard(const folderSettings &nfcTag) {
 #endif // MEMORY_GAME
 
 
+  if (not modifiers.activate(nfcTag.mode, nfcTag.special)) {
+#ifdef BT_MODULE
+    if (nfcTag.mode == pmode_t::bt_module) {
+      LOG(card_log, s_info, F("toggle bt module from "), btModuleOn);
+      switchBtModuleOnOff();
+      return true;
+    }
+#endif // BT_MODULE
+    return false;
+  }
+
   switch (nfcTag.mode) {
   case pmode_t::sleep_timer:  LOG(card_log, s_info, F("act. sleepTimer"));
                               mp3.playAdvertisement(advertTracks::t_302_sleep            , false/*olnyIfIsPlaying*/);
-                              activeModifier = &sleepTimer;
                               break;
 
   case pmode_t::freeze_dance: LOG(card_log, s_info, F("act. freezeDance"));
                               mp3.playAdvertisement(advertTracks::t_300_freeze_into      , false/*olnyIfIsPlaying*/);
-                              activeModifier = &danceGame;
                               break;
 
   case pmode_t::fi_wa_ai:     LOG(card_log, s_info, F("act. FeWaLu"));
                               mp3.playAdvertisement(advertTracks::t_303_fi_wa_ai         , false/*olnyIfIsPlaying*/);
-                              activeModifier = &danceGame;
                               break;
 
   case pmode_t::toddler:      LOG(card_log, s_info, F("act. toddlerMode"));
                               mp3.playAdvertisement(advertTracks::t_304_buttonslocked    , false/*olnyIfIsPlaying*/);
-                              activeModifier = &toddlerMode;
                               break;
 
   case pmode_t::kindergarden: LOG(card_log, s_info, F("act. kindergardenMode"));
                               mp3.playAdvertisement(advertTracks::t_305_kindergarden     , false/*olnyIfIsPlaying*/);
-                              activeModifier = &kindergardenMode;
                               break;
 
   case pmode_t::repeat_single:LOG(card_log, s_info, F("act. repeatSingleModifier"));
                               mp3.playAdvertisement(advertTracks::t_260_activate_mod_card, false/*olnyIfIsPlaying*/);
-                              activeModifier = &repeatSingleModifier;
                               break;
 
-#ifdef BT_MODULE
-  case pmode_t::bt_module:    LOG(card_log, s_info, F("toggle bt module from "), btModuleOn);
-                              switchBtModuleOnOff();
-                              return true;
-#endif // BT_MODULE
-
-  default:                    return false;
+  default:                    break;
   }
-  activeModifier->init(nfcTag.mode, nfcTag.special);
   return true;
 }
 
@@ -446,6 +919,16 @@ bool Tonuino::specialCard(const folderSettings &nfcTag) {
 // adapted from https://rheingoldheavy.com/better-arduino-random-values
 uint32_t Tonuino::generateRamdomSeed()
 {
+#ifdef FAST_BOOT
+  // a persisted boot counter makes the seed unique, a short noise sample (without delay) adds some entropy
+  uint32_t seedLongValue = settings.incrementBootCount() * 2654435761ul; // Knuth's multiplicative hash
+  for (uint8_t i = 0; i < 16; ++i) {
+    seedLongValue ^= static_cast<uint32_t>(analogRead(openAnalogPin)) << (i*2 % 32);
+    seedLongValue ^= seedLongValue << 13;
+    seedLongValue ^= seedLongValue >> 17;
+    seedLongValue ^= seedLongValue << 5;
+  }
+#else
   uint32_t seedLongValue = 0;
 
   for (uint8_t bitShift = 0; bitShift < 32; bitShift++) { // 32 bits in a uint32_t
@@ -456,6 +939,7 @@ uint32_t Tonuino::generateRamdomSeed()
     }
     seedLongValue |= ((seedBitValue & 0x01) << bitShift); // Build a stack of 32 flipped coins
   }
+#endif
   LOG(init_log, s_debug, F("RamdonSeed: "), seedLongValue);
   return (seedLongValue);
 }
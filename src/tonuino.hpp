@@ -12,6 +12,10 @@
 #include "modifier.hpp"
 #include "timer.hpp"
 #include "batVoltage.hpp"
+#ifdef TICK_SCHEDULER
+#include "scheduler.hpp"
+#endif
+#include "event_queue.hpp"
 #ifdef NEO_RING
 #include "ring.hpp"
 #endif
@@ -23,6 +27,10 @@ public:
 
   void setup          ();
   void loop           ();
+#ifdef TonUINO_ESP32
+  // one cycle of the ui task (see esp32_tasks.hpp), the card event comes from the card task
+  void loopUi         (cardEvent card_ev);
+#endif
 
   void playFolder     ();
   void playTrackNumber();
@@ -30,8 +38,14 @@ public:
   void       nextTrack(uint8_t tracks = 1, bool fromOnPlayFinished = false);
   void   previousTrack(uint8_t tracks = 1);
 
-  void resetActiveModifier   () { activeModifier = &noneModifier; }
-  Modifier& getActiveModifier() { return *activeModifier; }
+  void dispatchCard(cardEvent card_ev);
+
+  void resetActiveModifier   () { modifiers.reset(); }
+  Modifiers& getActiveModifier() { return modifiers; }
+#ifdef TRACK_PRE_ARM
+  // true if the next track of the queue follows without any decision (mode album or hoerbuch, no modifier for next)
+  bool isPreArmAllowed() const;
+#endif
 
   void setStandbyTimer();
   void disableStandbyTimer();
@@ -57,13 +71,18 @@ public:
 #ifdef NEO_RING
   Ring&     getRing     () { return ring     ; }
 #endif
-  static uint32_t generateRamdomSeed();
+  uint32_t generateRamdomSeed();
 
 #ifdef SerialInputAsCommand
   uint8_t getMenuJump() const { return serialInput.get_menu_jump(); }
 #endif
 
   void shutdown();
+#ifdef RESUME_SNAPSHOT
+  // the snapshot of the queue is saved on pause and shutdown and removed if the queue finished (Idle)
+  void saveSnapshot ();
+  void clearSnapshot();
+#endif
 
   uint16_t getNumTracksInFolder() const {return numTracksInFolder; }
 
@@ -76,8 +95,33 @@ public:
 private:
 
   void checkStandby();
+#ifdef LIGHT_SLEEP
+  bool lightSleep  ();
+#endif
+
+  void loopHousekeeping();
+#ifdef ENERGY_MONITOR
+  void loopEnergy      ();
+#endif
+#ifdef BAT_VOLTAGE_MEASUREMENT
+  void loopBatVoltage  ();
+#endif
+  void loopMp3         ();
+  void loopModifier    ();
+  void loopCommands    ();
+  void loopCard        ();
+#ifdef EVENT_QUEUE
+  void loopEvents      ();
+#endif
+#ifdef NEO_RING
+  void loopRing        ();
+#endif
 
   bool specialCard(const folderSettings &nfcTag);
+#ifdef SHUFFLE_NO_REPEAT
+  // random track of [first, last] that was not played since all were played (per folder)
+  track_t randomEpisode(track_t first, track_t last);
+#endif
 
   Settings             settings            {};
   Mp3                  mp3                 {settings};
@@ -120,25 +164,41 @@ private:
 
   friend class Base;
 
-  Modifier             noneModifier        {};
-  SleepTimer           sleepTimer          {};
-  DanceGame            danceGame           {};
-  ToddlerMode          toddlerMode         {};
-  KindergardenMode     kindergardenMode    {};
-  RepeatSingleModifier repeatSingleModifier{};
-
-  Modifier*            activeModifier      {&noneModifier};
+  Modifiers            modifiers           {};
 
   Timer                standbyTimer        {};
 
   folderSettings       myFolder            {};
   bool                 myFolderIsCard      {};
   uint16_t             numTracksInFolder   {};
+#ifdef SHUFFLE_NO_REPEAT
+#ifdef LARGE_FOLDERS
+  bitfield<maxTracksInLargeFolder> episodesPlayed {}; // bit of the track number (376 byte)
+#else
+  bitfield<255>        episodesPlayed      {}; // bit of the track number
+#endif
+  uint8_t              episodesFolder      {};
+  track_t              lastEpisode         {};
+#endif
+#ifdef RESUME_SNAPSHOT
+  Settings::snapshot_t resumeSnapshot      {}; // read on startup, used once by playFolder()
+  bool                 snapshotStored      {};
+#endif
 
 #ifdef BT_MODULE
   bool                 btModuleOn          {};
   Timer                btModulePairingTimer{};
 #endif
+
+#ifdef EVENT_QUEUE
+  using events_t = event_queue<eventQueueSize>;
+  events_t             events              {};
+#endif
+
+#ifdef TICK_SCHEDULER
+  static const SchedulerTask<Tonuino> schedulerTasks[];
+  Scheduler<8>         scheduler           {};
+#endif
 };
 
 #endif /* SRC_TONUINO_HPP_ */
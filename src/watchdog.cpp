@@ -0,0 +1,119 @@
+#include "watchdog.hpp"
+
+#include "constants.hpp"
+
+#ifdef WATCHDOG
+#include "logger.hpp"
+
+#ifdef __AVR__
+#include <avr/wdt.h>
+#endif
+
+namespace {
+
+constexpr uint16_t stallMagic = 0x5744;
+constexpr uint8_t  allAlive   = ((1 << Watchdog::num_subsystems) - 1) & ~(1 << Watchdog::none);
+
+struct stall_t {
+  uint16_t magic;
+  uint8_t  stalled; // subsystem
+  uint8_t  alive;   // subsystems that checked in since the last reset of the watchdog
+  uint16_t pc;      // byte address
+};
+
+#ifdef __AVR__
+// not cleared by the startup code, so it survives the watchdog reset
+stall_t stall __attribute__ ((section(".noinit")));
+#else
+stall_t stall{};
+#endif
+
+const __FlashStringHelper* subsystemName(uint8_t s) {
+  switch (s) {
+  case Watchdog::mp3          : return F("mp3");
+  case Watchdog::card         : return F("card");
+  case Watchdog::commands     : return F("commands");
+  case Watchdog::state_machine: return F("state machine");
+  default                     : return F("none");
+  }
+}
+
+} // anonymous namespace
+
+volatile Watchdog::subsystem Watchdog::active      {};
+volatile uint8_t             Watchdog::alive       {};
+bool                         Watchdog::wasRecovered{};
+
+#ifdef __AVR__
+// the watchdog stays on with 16 ms after its reset, switch it off before the
+// constructors run. No stack is used here (naked).
+void watchdogOff() __attribute__ ((naked, used, section(".init3")));
+void watchdogOff() {
+  MCUSR = 0;
+  wdt_disable();
+}
+
+extern "C" void watchdog_stall(const uint8_t *sp) __attribute__ ((used, noreturn));
+extern "C" void watchdog_stall(const uint8_t *sp) {
+  // the return address of the interrupt is on top of the stack (word address, high byte first)
+  Watchdog::onTimeout(((sp[1] << 8) | sp[2]) << 1);
+  wdt_enable(WDTO_15MS);
+  for (;;) {}
+}
+
+// nothing is pushed (naked), so the stack pointer points to the return address
+ISR(WDT_vect, ISR_NAKED) {
+  asm volatile(
+    "in  r24, __SP_L__   \n\t"
+    "in  r25, __SP_H__   \n\t"
+    "clr r1              \n\t"
+    "jmp watchdog_stall  \n\t"
+  );
+}
+#endif // __AVR__
+
+void Watchdog::begin() {
+  wasRecovered = stall.magic == stallMagic;
+  if (wasRecovered) {
+    LOG(init_log, s_error, F("watchdog reset, stalled: "), subsystemName(stall.stalled),
+                           F(", missing: "), allAlive & ~stall.alive, F(", pc: "), stall.pc);
+  }
+  stall.magic = 0;
+  active      = none;
+  alive       = 0;
+}
+
+void Watchdog::start() {
+#ifdef __AVR__
+  const uint8_t sreg = SREG;
+  cli();
+  wdt_reset();
+  WDTCSR = _BV(WDCE) | _BV(WDE);
+  WDTCSR = _BV(WDIE) | _BV(WDE) | _BV(WDP3) | _BV(WDP0); // interrupt and reset, 8 s
+  SREG = sreg;
+#endif
+}
+
+void Watchdog::loop() {
+  if ((alive & allAlive) != allAlive)
+    return;
+#ifdef __AVR__
+  wdt_reset();
+#endif
+  alive = 0;
+}
+
+void Watchdog::disable() {
+#ifdef __AVR__
+  wdt_disable();
+#endif
+}
+
+void Watchdog::onTimeout(uint16_t pc) {
+  stall.magic   = stallMagic;
+  stall.stalled = active;
+  stall.alive   = alive;
+  stall.pc      = pc;
+}
+
+#endif // WATCHDOG
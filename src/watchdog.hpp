@@ -0,0 +1,60 @@
+#ifndef SRC_WATCHDOG_HPP_
+#define SRC_WATCHDOG_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+// resets the box with the hardware watchdog if one of the subsystems did not
+// check in for 8 s. The subsystems mark their part of the cycle with a
+// Heartbeat. The watchdog interrupt stores the subsystem that was running and
+// the interrupted program address in .noinit RAM, begin() logs them after the
+// reset. Without WATCHDOG the calls compile to nothing.
+class Watchdog {
+public:
+  enum subsystem: uint8_t {
+    none         ,
+    mp3          , // Mp3::loop()
+    card         , // Chip_card::getCardEvent()
+    commands     , // Commands::getCommandRaw()
+    state_machine, // SM_tonuino::dispatch()
+    num_subsystems,
+  };
+
+#ifdef WATCHDOG
+  static void begin    (); // reports the stall before the reset
+  static void start    (); // 8 s, interrupt and then reset
+  static void loop     (); // resets the watchdog if all subsystems checked in
+  static void disable  (); // before the power down
+  static bool recovered() { return wasRecovered; } // the last reset was by the watchdog
+
+  // called by the watchdog interrupt with the interrupted program address
+  static void onTimeout(uint16_t pc);
+
+  class Heartbeat {
+  public:
+    explicit Heartbeat(subsystem s): prev{active} { active = s; }
+    ~Heartbeat() { alive |= 1 << active; active = prev; }
+  private:
+    subsystem prev;
+  };
+
+private:
+  static volatile subsystem active;
+  static volatile uint8_t   alive;
+  static bool               wasRecovered;
+#else
+  static void begin    () {}
+  static void start    () {}
+  static void loop     () {}
+  static void disable  () {}
+  static bool recovered() { return false; }
+
+  class Heartbeat {
+  public:
+    explicit Heartbeat(subsystem) {}
+  };
+#endif // WATCHDOG
+};
+
+#endif /* SRC_WATCHDOG_HPP_ */
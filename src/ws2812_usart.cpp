@@ -0,0 +1,72 @@
+#include "ws2812_usart.hpp"
+
+#include "constants.hpp"
+
+#ifdef NEO_RING_USART
+
+namespace {
+
+// 4 SPI bits per WS2812 bit and 2 WS2812 bits per SPI byte: T0H 1/4, T1H 2/4 of 1.5 us at 16 MHz.
+// Every SPI byte ends low, so a late ISR only stretches the low phase of a bit (the WS2812
+// latches only after a low phase of more than 50 us). The timing is not verified with a scope.
+constexpr uint8_t  spiDivider = (F_CPU + 2500000ul) / 5000000ul; // fBAUD = F_CPU/(2*spiDivider)
+constexpr uint8_t  bytesPerPixel = 3 * 4;
+// one zero byte at the end, so that TXD stays low after the frame (reset of the WS2812)
+constexpr uint16_t frameSize = neoPixelNumber * bytesPerPixel + 1;
+
+uint8_t           frame[frameSize];
+// only the ISR changes the positions while sending, busy() reads the 8 bit flag
+const uint8_t    *framePos = frame;
+const uint8_t    *frameEnd = frame;
+volatile bool     sending  = false;
+
+// 8 bit color to 32 SPI bits
+inline void encode(uint8_t c, uint8_t *out) {
+  for (uint8_t i = 0; i < 4; ++i) {
+    out[i] = ((c & 0x80) ? 0b11000000 : 0b10000000)
+           | ((c & 0x40) ? 0b00001100 : 0b00001000);
+    c <<= 2;
+  }
+}
+
+} // anonymous namespace
+
+void Ws2812Usart::begin() {
+  PORTA.OUTCLR = PIN0_bm;
+  PORTA.DIRSET = PIN0_bm;
+  PORTMUX.USARTROUTEA &= ~PORTMUX_USART0_gm; // TXD on PA0
+  // in SPI host mode the fractional part of BAUD is not used
+  USART0.BAUD  = static_cast<uint16_t>(spiDivider) << 6;
+  USART0.CTRLC = USART_CMODE_MSPI_gc; // MSB first, the XCK pin is not used
+  USART0.CTRLB = USART_TXEN_bm;
+}
+
+bool Ws2812Usart::busy() {
+  return sending;
+}
+
+bool Ws2812Usart::show(const uint8_t *pixels, uint8_t numPixels) {
+  if (busy())
+    return false;
+  if (numPixels > neoPixelNumber)
+    numPixels = neoPixelNumber;
+  uint8_t *out = frame;
+  for (uint8_t i = 0; i < numPixels * 3; ++i, out += 4)
+    encode(pixels[i], out);
+  *out++ = 0;
+  framePos = frame;
+  frameEnd = out;
+  sending  = true;
+  USART0.CTRLA |= USART_DREIE_bm;
+  return true;
+}
+
+ISR(USART0_DRE_vect) {
+  USART0.TXDATAL = *framePos;
+  if (++framePos == frameEnd) {
+    USART0.CTRLA &= ~USART_DREIE_bm;
+    sending = false;
+  }
+}
+
+#endif // NEO_RING_USART
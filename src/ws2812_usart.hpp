@@ -0,0 +1,24 @@
+#ifndef SRC_WS2812_USART_HPP_
+#define SRC_WS2812_USART_HPP_
+
+#include <Arduino.h>
+
+#include "constants.hpp"
+
+#ifdef NEO_RING_USART
+// sends the pixels of the ring with USART0 in SPI host mode on its TXD pin
+// (D2 = PA0 on the Nano Every). Every WS2812 bit is encoded as 4 SPI bits
+// (0 -> 1000, 1 -> 1100) at about 2.7 MHz, so one SPI byte holds 2 WS2812 bits
+// and ends low. The data register empty interrupt feeds the encoded bytes, a
+// late interrupt only stretches the low phase. So the interrupts stay enabled,
+// show() only encodes the frame (12 byte per pixel) and returns.
+class Ws2812Usart {
+public:
+  static void begin();
+  // false if the last frame is still sent, then try again later
+  static bool show(const uint8_t *pixels, uint8_t numPixels);
+  static bool busy();
+};
+#endif // NEO_RING_USART
+
+#endif // SRC_WS2812_USART_HPP_
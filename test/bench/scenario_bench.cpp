@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include "tonuino_fixture.hpp"
+
+// replays scripted scenarios on the mocks and reports the simulated time, the
+// time spent in delay() (including the wait at the end of each cycle) and the
+// number of commands sent to the DfPlayer. Run the bench_<config> executable
+// to see the numbers, they are a regression metric for blocking code paths.
+class scenario_bench: public tonuino_fixture {
+public:
+  struct measurement {
+    unsigned long start_time;
+    unsigned long start_delay;
+    uint32_t      start_commands;
+  };
+
+  void start() {
+    m = { current_time, delay_time, getMp3().commands_sent };
+  }
+
+  void report(const char* scenario) {
+    printf("[ BENCH    ] %-24s time: %7lu ms  delay: %7lu ms  df commands: %4u\n", scenario,
+           current_time - m.start_time, delay_time - m.start_delay,
+           static_cast<unsigned>(getMp3().commands_sent - m.start_commands));
+  }
+
+  void wait_for_play() {
+    for (int i = 0; i < 1000 && not SM_tonuino::is_in_state<Play>(); ++i) {
+      if (getMp3().is_playing_mp3())
+        getMp3().end_track();
+      execute_cycle();
+    }
+    EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+    EXPECT_TRUE(getMp3().is_playing_folder());
+  }
+
+  measurement m{};
+};
+
+TEST_F(scenario_bench, startup) {
+  start();
+  tonuino.setup();
+  report("startup");
+}
+
+TEST_F(scenario_bench, card_insert_to_play) {
+  goto_idle();
+  start();
+  card_in({ 1, pmode_t::album, 0, 0 }, 10);
+  wait_for_play();
+  report("card insert -> play");
+}
+
+TEST_F(scenario_bench, next_track) {
+  goto_play({ 1, pmode_t::album, 0, 0 }, 10);
+  const uint8_t track = getMp3().df_folder_track;
+  start();
+  button_for_command(command::next, state_for_command::play);
+  for (int i = 0; i < 100 && getMp3().df_folder_track == track; ++i)
+    execute_cycle();
+  EXPECT_NE(getMp3().df_folder_track, track);
+  report("next track");
+}
+
+TEST_F(scenario_bench, pause_resume) {
+  goto_play({ 1, pmode_t::album, 0, 0 }, 10);
+  start();
+  button_for_command(command::pause, state_for_command::play);
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_pause());
+  button_for_command(command::pause, state_for_command::idle_pause);
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  report("pause -> resume");
+}
+
+TEST_F(scenario_bench, card_swap) {
+  goto_play({ 1, pmode_t::album, 0, 0 }, 10);
+  start();
+  card_out();
+  card_in({ 2, pmode_t::hoerbuch, 0, 0 }, 12);
+  wait_for_play();
+  EXPECT_EQ(getMp3().df_folder, 2);
+  report("card swap");
+}
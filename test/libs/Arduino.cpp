@@ -7,6 +7,7 @@
 #include <Arduino.h>
 
 unsigned long current_time = 0;
+unsigned long delay_time   = 0;
 uint8_t pin_mode[max_pin] = { LOW };
 int pin_value[max_pin] = { INPUT };
 
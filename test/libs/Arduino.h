@@ -8,6 +8,7 @@
 #include <string.h>
 #include <math.h>
 #include <sstream>
+#include <deque>
 
 
 #ifdef __cplusplus
@@ -41,8 +42,10 @@ typedef char __FlashStringHelper;
 #define F(x) x
 
 extern unsigned long current_time;
+extern unsigned long delay_time; // sum of all delay() calls, used by the benchmarks
 inline unsigned long millis() { return current_time; }
-inline void delay(unsigned long ms) { current_time += ms; }
+inline unsigned long micros() { return current_time * 1000ul; }
+inline void delay(unsigned long ms) { current_time += ms; delay_time += ms; }
 
 #define DEC 10
 #define HEX 16
@@ -99,6 +102,9 @@ inline void reset_pin_value(uint8_t pin) {
       pin_value[pin] = 0;
   }
 }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
 inline void pinMode(uint8_t pin, uint8_t mode) {
   if (pin < max_pin) {
     pin_mode[pin] = mode;
@@ -128,7 +134,7 @@ inline void release_button(uint8_t pin) { if (pin < max_pin) pin_value[pin] = HI
 
 #define set_sleep_mode(mode)
 #define cli()
-#define sleep_mode()
+inline void sleep_mode() { delay(1); } // woken up by the timer0 interrupt
 
 #ifdef __cplusplus
 } // extern "C"
@@ -184,7 +190,7 @@ class Print
     static std::string get_output() { return s.str(); }
     static void clear_output() { s.str(std::string());; }
 
-    size_t write(uint8_t o) { s << o; return 1; }
+    virtual size_t write(uint8_t o) { s << o; return 1; }
     size_t write(const char *str) {
       if (str == NULL) return 0;
       return write((const uint8_t *)str, strlen(str));
@@ -219,8 +225,39 @@ private:
 
 class HardwareSerial: public Print {
 public:
-  int available() { return 0; }
-  long parseInt() { return 0; }
+  // bytes received from the host, filled by the tests
+  std::deque<uint8_t> input{};
+  // free space in the TX buffer, set by the tests
+  int txFree{64};
+
+  int availableForWrite() { return txFree; }
+
+  int available() { return input.size(); }
+  int peek() { return input.empty() ? -1 : input.front(); }
+  int read() {
+    if (input.empty())
+      return -1;
+    const uint8_t c = input.front();
+    input.pop_front();
+    return c;
+  }
+  size_t readBytes(uint8_t *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && not input.empty())
+      buffer[count++] = read();
+    return count;
+  }
+  long parseInt() {
+    while (not input.empty() && input.front() != '-' && (input.front() < '0' || input.front() > '9'))
+      input.pop_front();
+    const bool negative = not input.empty() && input.front() == '-';
+    if (negative)
+      input.pop_front();
+    long value = 0;
+    while (not input.empty() && input.front() >= '0' && input.front() <= '9')
+      value = value*10 + (read() - '0');
+    return negative ? -value : value;
+  }
 };
 
 extern HardwareSerial Serial;
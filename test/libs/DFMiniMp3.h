@@ -114,13 +114,14 @@ public:
       called_begin = true;
     }
 
+    uint32_t commands_sent = 0;
     bool df_playing = false;
     bool df_playing_adv = false;
     int df_playing_adv_counter = 0;
     bool df_stopped = true;
     uint16_t df_mp3_track = 0;
     uint8_t df_folder = 0;
-    uint8_t df_folder_track = 0;
+    uint16_t df_folder_track = 0;
     uint16_t df_adv_track = 0;
     void loop()
     {
@@ -165,6 +166,10 @@ public:
         df_mp3_track = 0;
         T_NOTIFICATION_METHOD::OnPlayFinished(*this, DfMp3_PlaySources_Sd, replyArg);
       }
+      if (called_source_inserted) {
+        called_source_inserted = false;
+        T_NOTIFICATION_METHOD::OnPlaySourceInserted(*this, DfMp3_PlaySources_Sd);
+      }
       if (error_code) {
         uint16_t replyArg = error_code;
         error_code = 0;
@@ -175,6 +180,7 @@ public:
     // sd:/mp3/####track name
     void playMp3FolderTrack(uint16_t track)
     {
+      ++commands_sent;
       df_stopped = false;
       called_start = true;
       df_mp3_track = track;
@@ -187,8 +193,22 @@ public:
     // folder and track numbers are zero padded
     void playFolderTrack(uint8_t folder, uint8_t track)
     {
+      ++commands_sent;
+      df_stopped = false;
+      called_start = true;
+      df_folder = folder;
+      df_folder_track = track;
+      df_mp3_track = 0;
+    }
+
+    // sd:/##/####track name (large folder mode: folder 01-15, track 0001-3000)
+    bool called_playFolderTrack16 = false;
+    void playFolderTrack16(uint8_t folder, uint16_t track)
+    {
+      ++commands_sent;
       df_stopped = false;
       called_start = true;
+      called_playFolderTrack16 = true;
       df_folder = folder;
       df_folder_track = track;
       df_mp3_track = 0;
@@ -198,52 +218,63 @@ public:
     uint8_t current_volume = 0;
     void setVolume(uint8_t volume)
     {
+      ++commands_sent;
       current_volume = volume;
     }
 
     uint8_t getVolume()
     {
+      ++commands_sent;
       return current_volume;
     }
 
     DfMp3_Eq current_eq = DfMp3_Eq_Normal;
     void setEq(DfMp3_Eq eq)
     {
+      ++commands_sent;
       current_eq = eq;
     }
 
     bool called_sleep = false;
     void sleep()
     {
+      ++commands_sent;
       called_sleep = true;
     }
 
     bool called_start = false;
     void start()
     {
+      ++commands_sent;
       called_start = true;
     }
 
     bool called_pause = false;
     void pause()
     {
+      ++commands_sent;
       called_pause = true;
     }
 
     bool called_stop = false;
     void stop()
     {
+      ++commands_sent;
       called_stop = true;
     }
 
+    uint8_t called_getFolderTrackCount = 0;
     uint16_t getFolderTrackCount(uint16_t folder)
     {
+      ++commands_sent;
+      ++called_getFolderTrackCount;
         return df_folder_track_count[static_cast<uint8_t>(folder)];
     }
 
     // sd:/advert/####track name
     void playAdvertisement(uint16_t track)
     {
+      ++commands_sent;
       if (df_playing) {
         df_playing_adv = true;
         df_adv_track = track;
@@ -270,7 +301,11 @@ public:
       error_code = code;
     }
     uint16_t df_folder_track_count[0xff] = { 0 };
+    bool called_source_inserted = false;
     void set_folder_track_count(uint8_t folder, uint16_t count) {
+      // changing the content of the SD card means to (re)insert it
+      if (df_folder_track_count[folder] != count)
+        called_source_inserted = true;
       df_folder_track_count[folder] = count;
     }
     bool is_playing_folder() {
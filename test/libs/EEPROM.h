@@ -5,10 +5,11 @@
 #include <assert.h>
 
 struct EEPROMClass{
-  static constexpr int max_len = 300;
+  static constexpr int max_len = 2048;
   uint8_t eeprom_mem[max_len];
+  uint32_t writes = 0; // number of write() calls, used by the simulator
   uint8_t read( int idx )              { assert(idx >= 0 && idx < max_len); return eeprom_mem[idx]; return 0; }
-  void write( int idx, uint8_t val )   { assert(idx >= 0 && idx < max_len); eeprom_mem[idx] = val; }
+  void write( int idx, uint8_t val )   { assert(idx >= 0 && idx < max_len); eeprom_mem[idx] = val; ++writes; }
   uint16_t length()                    { return max_len; }
 };
 
@@ -116,6 +116,22 @@ public:
 		PICC_CMD_UL_WRITE		= 0xA2		// Writes one 4 byte page to the PICC.
 	};
 	
+	// MFRC522 RxGain[2:0] masks, defines the receiver's signal voltage gain factor (on the PCD).
+	// Described in 9.3.3.6 / table 98 of the datasheet at http://www.nxp.com/documents/data_sheet/MFRC522.pdf
+	enum PCD_RxGain : byte {
+		RxGain_18dB				= 0x00 << 4,	// 000b - 18 dB, minimum
+		RxGain_23dB				= 0x01 << 4,	// 001b - 23 dB
+		RxGain_18dB_2			= 0x02 << 4,	// 010b - 18 dB, it seems 010b is a duplicate for 000b
+		RxGain_23dB_2			= 0x03 << 4,	// 011b - 23 dB, it seems 011b is a duplicate for 001b
+		RxGain_33dB				= 0x04 << 4,	// 100b - 33 dB, average, and typical default
+		RxGain_38dB				= 0x05 << 4,	// 101b - 38 dB
+		RxGain_43dB				= 0x06 << 4,	// 110b - 43 dB
+		RxGain_48dB				= 0x07 << 4,	// 111b - 48 dB, maximum
+		RxGain_min				= 0x00 << 4,	// 000b - 18 dB, minimum, convenience for RxGain_18dB
+		RxGain_avg				= 0x04 << 4,	// 100b - 33 dB, average, convenience for RxGain_33dB
+		RxGain_max				= 0x07 << 4		// 111b - 48 dB, maximum, convenience for RxGain_48dB
+	};
+
 	// MIFARE constants that does not fit anywhere else
 	enum MIFARE_Misc {
 		MF_ACK					= 0xA,		// The MIFARE Classic uses a 4 bit ACK/NAK. Any other value than 0xA is NAK.
@@ -184,21 +200,29 @@ public:
 	/////////////////////////////////////////////////////////////////////////////////////
   bool called_Init = false;
 	void PCD_Init() { called_Init = true; }
+  bool antenna_on = true;
   bool called_AntennaOff = false;
-	void PCD_AntennaOff() { called_AntennaOff = true; }
+	void PCD_AntennaOff() { called_AntennaOff = true; antenna_on = false; }
+  uint16_t count_AntennaOn = 0;
+	void PCD_AntennaOn() { ++count_AntennaOn; antenna_on = true; }
+  byte antenna_gain = RxGain_33dB;
+	byte PCD_GetAntennaGain() { return antenna_gain; }
+	void PCD_SetAntennaGain(byte mask) { antenna_gain = mask & (0x07<<4); }
 	
 	/////////////////////////////////////////////////////////////////////////////////////
 	// Power control functions
 	/////////////////////////////////////////////////////////////////////////////////////
   bool called_SoftPowerDown = false;
 	void PCD_SoftPowerDown() { called_SoftPowerDown = true; }
+  bool called_SoftPowerUp = false;
+	void PCD_SoftPowerUp() { called_SoftPowerUp = true; }
 	
 	/////////////////////////////////////////////////////////////////////////////////////
 	// Functions for communicating with PICCs
 	/////////////////////////////////////////////////////////////////////////////////////
 	bool called_PICC_RequestA = false;
 	StatusCode PICC_RequestA(byte *bufferATQA, byte *bufferSize) {
-	  if (!called_PCD_Authenticate && card_is_in) {
+	  if (!called_PCD_Authenticate && card_is_in && antenna_on) {
 	    called_PICC_RequestA = true;
 	    return STATUS_OK;
 	  }
@@ -206,9 +230,42 @@ public:
 	  return STATUS_ERROR;
 	}
 
+	bool called_PICC_WakeupA = false;
+	uint16_t count_PICC_WakeupA_ignored = 0;
+	StatusCode PICC_WakeupA(byte *bufferATQA, byte *bufferSize) {
+	  // a selected card does not answer, it goes back to IDLE
+	  if (card_is_in && card_active) {
+	    card_active = false;
+	    ++count_PICC_WakeupA_ignored;
+	    called_PICC_WakeupA = false;
+	    return STATUS_TIMEOUT;
+	  }
+	  if (!called_PCD_Authenticate && card_is_in && antenna_on) {
+	    card_halted = false;
+	    called_PICC_WakeupA = true;
+	    return STATUS_OK;
+	  }
+	  called_PICC_WakeupA = false;
+	  return STATUS_ERROR;
+	}
+
+	uint16_t count_PICC_Select = 0;
+	StatusCode PICC_Select(Uid *uid, byte validBits = 0) {
+	  ++count_PICC_Select;
+	  if (card_is_in && called_PICC_WakeupA && uid->size == 4 && validBits == 32 && memcmp(uid->uidByte, card_uid, 4) == 0) {
+	    called_PICC_WakeupA = false;
+	    card_active = true;
+	    return STATUS_OK;
+	  }
+	  called_PICC_WakeupA = false;
+	  return STATUS_TIMEOUT;
+	}
+
 	bool called_PICC_HaltA = false;
 	StatusCode PICC_HaltA() {
 	  called_PICC_HaltA = true;
+	  card_active = false;
+	  card_halted = card_is_in;
 	  return STATUS_OK;
 	}
 
@@ -217,6 +274,10 @@ public:
 	/////////////////////////////////////////////////////////////////////////////////////
 	bool called_PCD_Authenticate = false;
 	StatusCode PCD_Authenticate(byte command, byte blockAddr, MIFARE_Key *key, Uid *uid) {
+	  if (antenna_gain < card_min_gain || card_halted) {
+	    called_PCD_Authenticate = false;
+	    return STATUS_TIMEOUT;
+	  }
 	  if (command == PICC_CMD_MF_AUTH_KEY_A && blockAddr == 7 && key->keyByte[0] == 0xff && uid->size != 0) {
 	    called_PCD_Authenticate = true;
 	    return STATUS_OK;
@@ -227,20 +288,38 @@ public:
 	void PCD_StopCrypto1() {
 	  called_PCD_Authenticate = false;
 	}
+	uint8_t mifare_reads  = 0;
+	uint8_t mifare_writes = 0;
 	StatusCode MIFARE_Read(byte blockAddr, byte *buffer, byte *bufferSize) {
+	  ++mifare_reads;
+	  if (ultralight && (!called_PCD_Authenticate || blockAddr != 8 || *bufferSize < buffferSizeRead))
+	    return STATUS_ERROR;
 	  if (!called_PCD_Authenticate && blockAddr != 4 && *bufferSize != buffferSizeRead)
 	    return STATUS_ERROR;
 	  memcpy(buffer, t_buffer, buffferSizeRead);
 	  return STATUS_OK;
 	}
 	StatusCode MIFARE_Write(byte blockAddr, byte *buffer, byte bufferSize) {
+	  ++mifare_writes;
     if (!called_PCD_Authenticate && blockAddr != 4 && bufferSize != buffferSizeWrite)
       return STATUS_ERROR;
     memcpy(t_buffer, buffer, buffferSizeWrite);
 	  return STATUS_OK;
 	}
+	StatusCode MIFARE_Ultralight_Write(byte page, byte *buffer, byte bufferSize) {
+	  ++mifare_writes;
+	  if (!ultralight || !called_PCD_Authenticate || page < 8 || page > 11 || bufferSize != 4)
+	    return STATUS_ERROR;
+	  memcpy(t_buffer + 4*(page-8), buffer, 4);
+	  return STATUS_OK;
+	}
 	StatusCode PCD_NTAG216_AUTH(byte *passWord, byte pACK[]) {
-	  return STATUS_ERROR; // todo: implement UL
+	  if (ultralight && uid.size != 0 && antenna_gain >= card_min_gain) {
+	    called_PCD_Authenticate = true;
+	    return STATUS_OK;
+	  }
+	  called_PCD_Authenticate = false;
+	  return STATUS_ERROR;
 	}
 	
 	/////////////////////////////////////////////////////////////////////////////////////
@@ -292,13 +371,17 @@ public:
 	/////////////////////////////////////////////////////////////////////////////////////
 	// Convenience functions - does not add extra functionality
 	/////////////////////////////////////////////////////////////////////////////////////
+	uint16_t count_ReadCardSerial = 0;
 	virtual bool PICC_ReadCardSerial() {
+	  ++count_ReadCardSerial;
 	  if (card_is_in && called_PICC_RequestA) {
 	    called_PICC_RequestA = false;
 	    uid.size = 4;
 	    for (uint8_t i = 0; i < uid.size; ++i)
-	      uid.uidByte[i] = i+1;
-	    uid.sak = 0x08; // todo: implement other card types
+	      uid.uidByte[i] = card_uid[i];
+	    uid.sak = ultralight ? 0x00 : 0x08;
+	    card_active = true;
+	    card_halted = false;
 	    return true;
 	  }
 	  return false;
@@ -308,6 +391,9 @@ public:
 	// Chip_card::getCardEvent():
 	//   PICC_RequestA() if card in --> return STATUS_OK
 	//   PICC_ReadCardSerial() if card in --> init uid
+	//   with CARD_PRESENCE_CHECK for a card already on the reader:
+	//   PICC_WakeupA() if card in --> return STATUS_OK
+	//   PICC_Select() if card in with the same uid --> return STATUS_OK
 	// Chip_card::readCard()
   //   PICC_GetType() --> PICC_TYPE_MIFARE_MINI, PICC_TYPE_MIFARE_1K, PICC_TYPE_MIFARE_4K or PICC_TYPE_MIFARE_UL
 	//   Chip_card::auth()
@@ -326,8 +412,15 @@ public:
   byte t_buffer[buffferSizeRead]{};
 
   bool card_is_in{false};
+  bool ultralight{false}; // NTAG/Ultralight instead of MIFARE Classic 1K
+  byte card_min_gain{};   // a marginal card answers the authentication only with this antenna gain
+  byte card_uid[4]{};
+  bool card_active{false}; // selected
+  bool card_halted{false}; // only answers WUPA
 	void card_in(uint32_t cookie, uint8_t version, uint8_t folder, uint8_t mode, uint8_t special, uint8_t special2) {
 	  card_is_in    = true    ;
+	  card_active   = false   ;
+	  card_halted   = false   ;
 	  byte coockie_4 = (cookie & 0x000000ff) >>  0;
 	  byte coockie_3 = (cookie & 0x0000ff00) >>  8;
 	  byte coockie_2 = (cookie & 0x00ff0000) >> 16;
@@ -341,12 +434,21 @@ public:
                                  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
              };
 	  memcpy(t_buffer, buffer, buffferSizeRead);
+	  // different cards have different UIDs, every blank card is a new one
+	  for (uint8_t i = 0; i < 4; ++i)
+	    card_uid[i] = buffer[5+i]+i+1;
+	  if (cookie == 0)
+	    card_uid[0] = 0xb0 + ++blank_cards;
 	}
+	uint8_t blank_cards{};
 	void card_out() {
     card_is_in = false;
+    card_active = false;
+    card_halted = false;
     uid.size = 0;
     uid.sak  = 0;
     called_PICC_RequestA = false;
+    called_PICC_WakeupA  = false;
 	}
 	void card_decode(uint32_t &cookie, uint8_t &version, uint8_t &folder, uint8_t &mode, uint8_t &special, uint8_t &special2) {
 	  cookie = (static_cast<uint32_t>(t_buffer[0]) << 24) +
@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+
+#include <Arduino.h>
+
+#include <queue.hpp>
+#include <commands.hpp>
+#include <settings.hpp>
+#include <linearAnalogKeypad.h>
+#include <tonuino.hpp>
+#include <state_machine.hpp>
+
+// host microbenchmarks of hot paths, to compare alternative implementations before
+// they go onto the AVR. The host numbers are only relative: compare two variants in
+// the same run, not with the cycles on the target. OneRing needs the NeoPixel
+// library and is not built on the host.
+//
+//   micro_<config> [--benchmark_filter=<regex>]
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// track queue
+
+void BM_queue_shuffle(benchmark::State& state) {
+  queue<uint8_t, 255> q{};
+  for (uint8_t i = 1; not (q.size() == state.range(0)); ++i)
+    q.push(i);
+  for (auto _: state) {
+    q.shuffle();
+    benchmark::DoNotOptimize(q.get(0));
+  }
+}
+BENCHMARK(BM_queue_shuffle)->Arg(16)->Arg(255);
+
+// the permutation shuffle computes the position in get(), so read the whole queue
+void BM_permutation_queue_shuffle_and_get(benchmark::State& state) {
+  permutation_queue<255> q{};
+  for (uint8_t i = 1; not (q.size() == state.range(0)); ++i)
+    q.push(i);
+  for (auto _: state) {
+    q.shuffle();
+    for (uint8_t i = 0; i < q.size(); ++i)
+      benchmark::DoNotOptimize(q.get(i));
+  }
+}
+BENCHMARK(BM_permutation_queue_shuffle_and_get)->Arg(16)->Arg(255);
+
+void BM_queue_get(benchmark::State& state) {
+  queue<uint8_t, 255> q{};
+  for (uint8_t i = 1; i < 255; ++i)
+    q.push(i);
+  q.shuffle();
+  uint8_t pos = 0;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(q.get(pos));
+    pos = (pos + 1) % q.size();
+  }
+}
+BENCHMARK(BM_queue_get);
+
+void BM_permutation_queue_get(benchmark::State& state) {
+  permutation_queue<255> q{};
+  for (uint8_t i = 1; i < 255; ++i)
+    q.push(i);
+  q.shuffle(0x1234);
+  uint8_t pos = 0;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(q.get(pos));
+    pos = (pos + 1) % q.size();
+  }
+}
+BENCHMARK(BM_permutation_queue_get);
+
+// ---------------------------------------------------------------------------
+// bitfield and ring buffer
+
+void BM_bitfield_set_get(benchmark::State& state) {
+  bitfield<128> b{};
+  uint8_t n = 0;
+  for (auto _: state) {
+    b.setBit(n);
+    benchmark::DoNotOptimize(b.getBit((n + 64) % 128));
+    b.clearBit((n + 32) % 128);
+    n = (n + 1) % 128;
+  }
+}
+BENCHMARK(BM_bitfield_set_get);
+
+void BM_ring_buffer_push_pop(benchmark::State& state) {
+  ring_buffer<uint8_t, 16> r{};
+  uint8_t v = 0;
+  for (auto _: state) {
+    r.push(v++);
+    r.pop(v);
+    benchmark::DoNotOptimize(v);
+  }
+}
+BENCHMARK(BM_ring_buffer_push_pop);
+
+// ---------------------------------------------------------------------------
+// commands: cmd_table is read with pgm_read_byte()
+
+void BM_commands_getCommand(benchmark::State& state) {
+  Settings settings{};
+  settings.resetSettings();
+  Commands commands{settings, nullptr};
+  constexpr uint8_t rawCount   = static_cast<uint8_t>(commandRaw::menu_jump);
+  constexpr uint8_t stateCount = static_cast<uint8_t>(state_for_command::play_invert) + 1;
+  uint8_t raw = 0, s = 0;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(commands.getCommand(static_cast<commandRaw>(raw), static_cast<state_for_command>(s)));
+    if (++raw == rawCount) {
+      raw = 0;
+      s = (s + 1) % stateCount;
+    }
+  }
+}
+BENCHMARK(BM_commands_getCommand);
+
+// ---------------------------------------------------------------------------
+// analog keypad (Buttons3x3)
+
+void BM_linearAnalogKeypad_getKey(benchmark::State& state) {
+  linearAnalogKeypad keypad{A3, 9, 1023, 1000};
+  int16_t value = 0;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(keypad.getKey(value));
+    value = (value + 37) % 1024;
+  }
+}
+BENCHMARK(BM_linearAnalogKeypad_getKey);
+
+// ---------------------------------------------------------------------------
+// state machine
+
+void BM_dispatch_tick_idle(benchmark::State& state) {
+  reset_all_pin_values();
+  Tonuino &tonuino = Tonuino::getTonuino();
+  tonuino.getSettings().resetSettings();
+  tonuino.setup();
+  for (auto _: state)
+    SM_tonuino::dispatch(tick_e());
+  Print::clear_output();
+}
+BENCHMARK(BM_dispatch_tick_idle);
+
+void BM_dispatch_command_idle(benchmark::State& state) {
+  reset_all_pin_values();
+  Tonuino &tonuino = Tonuino::getTonuino();
+  tonuino.getSettings().resetSettings();
+  tonuino.setup();
+  for (auto _: state)
+    SM_tonuino::dispatch(command_e(commandRaw::none));
+  Print::clear_output();
+}
+BENCHMARK(BM_dispatch_command_idle);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,344 @@
+// runs the whole firmware on the mocks faster than real time. The DfPlayer mock
+// gets track durations from a manifest of the SD card (tools/create_sim_manifest.py),
+// the simulator ends the tracks in time, adds the ack delay for every DfPlayer
+// command and plays scripted listening sessions (card in, buttons, card out).
+//
+//   sim_<config> [--manifest <file>] [--days <n>] [--seed <n>]
+//
+// Without manifest a synthetic SD card is used. The exit code is 1 if a stall
+// (state Play but no track playing for more than stallTime) was detected.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include <tonuino.hpp>
+#include <state_machine.hpp>
+#include <chip_card.hpp>
+
+namespace {
+
+constexpr unsigned long ackDelay       =   30; // ms per DfPlayer command (send, ack)
+constexpr unsigned long stallTime      = 5000; // ms
+constexpr unsigned long messageDefault = 2000; // ms per mp3/advert message
+
+struct manifest {
+  std::map<uint8_t, std::vector<unsigned long>> folders; // track durations in ms
+  unsigned long messageDuration = messageDefault;
+};
+
+// ---------------------------------------------------------------------------
+// minimal JSON reader for the manifest:
+//   { "message_duration": 2.0, "folders": { "01": [ 185.3, 201.0 ], ... } }
+// all durations in seconds
+class json_reader {
+public:
+  json_reader(const std::string &text): s{text} {}
+
+  bool read(manifest &m) {
+    if (not expect('{'))
+      return false;
+    while (true) {
+      std::string key;
+      if (not string(key) || not expect(':'))
+        return false;
+      if (key == "folders") {
+        if (not folders(m))
+          return false;
+      }
+      else if (key == "message_duration") {
+        double d;
+        if (not number(d))
+          return false;
+        m.messageDuration = d * 1000;
+      }
+      else
+        return false;
+      if (peek() == ',') { ++pos; continue; }
+      return expect('}');
+    }
+  }
+
+private:
+  bool folders(manifest &m) {
+    if (not expect('{'))
+      return false;
+    if (peek() == '}') { ++pos; return true; }
+    while (true) {
+      std::string key;
+      if (not string(key) || not expect(':') || not expect('['))
+        return false;
+      std::vector<unsigned long> &tracks = m.folders[atoi(key.c_str())];
+      while (peek() != ']') {
+        double d;
+        if (not number(d))
+          return false;
+        tracks.push_back(d * 1000);
+        if (peek() == ',')
+          ++pos;
+      }
+      ++pos;
+      if (peek() == ',') { ++pos; continue; }
+      return expect('}');
+    }
+  }
+  char peek() {
+    while (pos < s.size() && isspace(s[pos]))
+      ++pos;
+    return pos < s.size() ? s[pos] : '\0';
+  }
+  bool expect(char c) {
+    if (peek() != c)
+      return false;
+    ++pos;
+    return true;
+  }
+  bool string(std::string &out) {
+    if (not expect('"'))
+      return false;
+    const size_t end = s.find('"', pos);
+    if (end == std::string::npos)
+      return false;
+    out = s.substr(pos, end-pos);
+    pos = end+1;
+    return true;
+  }
+  bool number(double &d) {
+    peek();
+    char *end;
+    d = strtod(s.c_str()+pos, &end);
+    if (end == s.c_str()+pos)
+      return false;
+    pos = end - s.c_str();
+    return true;
+  }
+
+  const std::string &s;
+  size_t             pos{};
+};
+
+manifest synthetic_manifest() {
+  manifest m;
+  for (uint8_t folder = 1; folder <= 5; ++folder)
+    for (uint8_t track = 0; track < 12; ++track)
+      m.folders[folder].push_back((120 + 15*track + 7*folder) * 1000ul);
+  return m;
+}
+
+struct stats {
+  unsigned long cards          {};
+  unsigned long tracks         {};
+  unsigned long messages       {};
+  unsigned long stalls         {};
+  unsigned long shutdowns      {};
+  unsigned long buttons        {};
+  unsigned long eeprom_writes  {};
+  unsigned long df_commands    {};
+  unsigned long longest_stall  {};
+};
+
+} // anonymous namespace
+
+class simulator {
+public:
+  simulator(const manifest &m, unsigned long seed)
+  : m{m}
+  , tonuino{Tonuino::getTonuino()}
+  {
+    reset_all_pin_values();
+    for (const auto &f: m.folders)
+      tonuino.getMp3().set_folder_track_count(f.first, f.second.size());
+    tonuino.getSettings().resetSettings();
+    tonuino.setup();
+    srand(seed); // after setup(), it seeds the random generator too
+  }
+
+  void run(unsigned long duration) {
+    const unsigned long end = current_time + duration;
+    while (current_time < end)
+      session();
+  }
+
+  void print_stats(double wall_seconds) {
+    const double sim_hours = current_time / 3600000.0;
+    printf("simulated   : %.1f h (x%.0f real time)\n", sim_hours, wall_seconds > 0 ? current_time / 1000.0 / wall_seconds : 0.0);
+    printf("cards       : %lu\n", s.cards);
+    printf("buttons     : %lu\n", s.buttons);
+    printf("tracks      : %lu (%.1f per h)\n", s.tracks, s.tracks / sim_hours);
+    printf("messages    : %lu\n", s.messages);
+    printf("df commands : %lu\n", s.df_commands);
+    printf("eeprom write: %lu (%.1f per h)\n", s.eeprom_writes, s.eeprom_writes / sim_hours);
+    printf("shutdowns   : %lu\n", s.shutdowns);
+    printf("stalls      : %lu (longest %lu ms)\n", s.stalls, s.longest_stall);
+  }
+
+  const stats& get_stats() const { return s; }
+
+private:
+  Mp3&     mp3    () { return tonuino.getMp3(); }
+  MFRC522& mfrc522() { return tonuino.getChipCard().mfrc522; }
+
+  unsigned long rand_between(unsigned long a, unsigned long b) { return a + rand() % (b-a+1); }
+
+  // one listening session: idle, card in, some buttons, pause, card out
+  void session() {
+    run_for(rand_between(1, 30) * 60000ul);
+
+    auto folder = m.folders.begin();
+    std::advance(folder, rand() % m.folders.size());
+    const pmode_t modes[] = { pmode_t::album, pmode_t::party, pmode_t::hoerbuch };
+    const pmode_t mode = modes[rand() % 3];
+    mfrc522().card_in(cardCookie, cardVersion, folder->first, static_cast<uint8_t>(mode), 0, 0);
+    ++s.cards;
+    run_for(2000);
+    mfrc522().card_out();
+
+    const unsigned long minutes = rand_between(10, 90);
+    for (unsigned long i = 0; i < minutes; ++i) {
+      const int r = rand() % 100;
+      if      (r <  8) button(buttonUpPin  , buttonLongPress + 200); // next
+      else if (r < 10) button(buttonDownPin, buttonLongPress + 200); // previous
+      else if (r < 13) button(buttonUpPin  , 100);                   // volume
+      else if (r < 16) button(buttonDownPin, 100);
+      else if (r < 18) {                                             // short break
+        button(buttonPausePin, 100);
+        run_for(rand_between(10, 120) * 1000ul);
+        button(buttonPausePin, 100);
+      }
+      run_for(60000ul);
+    }
+    if (SM_tonuino::is_in_state<Play>())
+      button(buttonPausePin, 100);
+  }
+
+  void button(uint8_t pin, unsigned long ms) {
+    ++s.buttons;
+    press_button(pin);
+    run_for(ms);
+    release_button(pin);
+    run_for(200);
+  }
+
+  void run_for(unsigned long ms) {
+    const unsigned long end = current_time + ms;
+    while (current_time < end)
+      cycle();
+  }
+
+  void cycle() {
+    const uint32_t commands = mp3().commands_sent;
+    const unsigned long before = current_time;
+    tonuino.loop();
+    Print::clear_output();
+
+    // DfPlayer timing: ack delay per command, end of track after its duration
+    const uint32_t sent = mp3().commands_sent - commands;
+    s.df_commands += sent;
+    current_time  += sent * ackDelay;
+    player(current_time - before);
+
+    s.eeprom_writes = EEPROM.writes;
+
+    if (pin_value[shutdownPin] == getLevel(shutdownPinType, level::active)) {
+      ++s.shutdowns;
+      pin_value[shutdownPin] = getLevel(shutdownPinType, level::inactive);
+      mp3().reset_to_initial_state();
+      tonuino.setup();
+    }
+  }
+
+  void player(unsigned long elapsed) {
+    const track_id id{ mp3().df_folder, mp3().df_folder_track, mp3().df_mp3_track };
+    if (not (id == playing)) {
+      playing = id;
+      played  = 0;
+      if (id.mp3_track)
+        ++s.messages;
+      else if (id.folder_track)
+        ++s.tracks;
+    }
+    if (mp3().df_playing && not mp3().df_playing_adv && (id.folder_track || id.mp3_track)) {
+      played += elapsed;
+      if (played >= duration(id)) {
+        mp3().end_track();
+        playing = {};
+      }
+    }
+
+    // stall: the state machine plays, but the DfPlayer does not
+    if (SM_tonuino::is_in_state<Play>() && not mp3().df_playing) {
+      stalled += elapsed;
+    }
+    else {
+      if (stalled > stallTime) {
+        ++s.stalls;
+        if (stalled > s.longest_stall)
+          s.longest_stall = stalled;
+      }
+      stalled = 0;
+    }
+  }
+
+  struct track_id {
+    uint8_t  folder      {};
+    uint16_t folder_track{};
+    uint16_t mp3_track   {};
+    bool operator==(const track_id &o) const { return folder == o.folder && folder_track == o.folder_track && mp3_track == o.mp3_track; }
+  };
+
+  unsigned long duration(const track_id &id) {
+    if (id.mp3_track)
+      return m.messageDuration;
+    const auto f = m.folders.find(id.folder);
+    if (f == m.folders.end() || id.folder_track == 0 || id.folder_track > f->second.size())
+      return m.messageDuration;
+    return f->second[id.folder_track-1];
+  }
+
+  const manifest &m;
+  Tonuino        &tonuino;
+  stats           s{};
+  track_id        playing{};
+  unsigned long   played {};
+  unsigned long   stalled{};
+};
+
+int main(int argc, char **argv) {
+  manifest      m     = synthetic_manifest();
+  double        days  = 1;
+  unsigned long seed  = 1;
+  for (int i = 1; i+1 < argc; i += 2) {
+    if (strcmp(argv[i], "--manifest") == 0) {
+      std::ifstream file(argv[i+1]);
+      std::stringstream text;
+      text << file.rdbuf();
+      manifest read;
+      if (not file || not json_reader(text.str()).read(read) || read.folders.empty()) {
+        fprintf(stderr, "cannot read manifest %s\n", argv[i+1]);
+        return 2;
+      }
+      m = read;
+    }
+    else if (strcmp(argv[i], "--days") == 0)
+      days = atof(argv[i+1]);
+    else if (strcmp(argv[i], "--seed") == 0)
+      seed = strtoul(argv[i+1], nullptr, 0);
+    else {
+      fprintf(stderr, "usage: %s [--manifest <file>] [--days <n>] [--seed <n>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const clock_t start = clock();
+  simulator sim(m, seed);
+  sim.run(days * 24 * 3600000ul);
+  sim.print_stats(static_cast<double>(clock() - start) / CLOCKS_PER_SEC);
+  return sim.get_stats().stalls == 0 ? 0 : 1;
+}
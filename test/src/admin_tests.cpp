@@ -383,6 +383,11 @@ TEST_F(admin_test_fixture, sunny_day_adm) {
   execute_cycle_for_ms(time_check_play);
   EXPECT_TRUE(getMp3().is_playing_mp3());
   EXPECT_EQ(getMp3().df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_402_ok_settings));
+#ifdef PROMPT_QUEUE
+  // t_919_continue_admin waits behind it in the prompt queue
+  EXPECT_TRUE(SM_tonuino::is_in_state<Admin_Entry>());
+  EXPECT_EQ(getMp3().pendingPrompts(), 1);
+#endif
 
   // end t_402_ok_settings
   getMp3().end_track();
@@ -1167,7 +1172,33 @@ TEST_F(admin_test_fixture, Admin_CardsForFolder) {
   execute_cycle_for_ms(time_check_play);  // --> prepare_writeCard
   EXPECT_TRUE(getMp3().is_playing_mp3());
   EXPECT_EQ(getMp3().df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_936_batch_cards_intro));
+#ifdef PROMPT_QUEUE
+  // the number of the first card waits behind the intro
+  EXPECT_EQ(getMp3().pendingPrompts(), 1);
+#endif
+
+#ifdef BATCH_CARD_WRITE
+  // batch: write each card as soon as it is placed, confirm with a pling
+  for (uint8_t track = first; track <= last; ++track) {
+
+    execute_cycle();
+    execute_cycle();
+    ASSERT_TRUE(SM_writeCard::is_in_state<WriteCard>());
+
+    card_in({ 1, pmode_t::album       , 0, 0 });
+    execute_cycle(); // --> end_writeCard
+    execute_cycle_for_ms(100);
+    EXPECT_TRUE(getMp3().is_playing_mp3());
+    EXPECT_EQ(getMp3().df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_262_pling));
+
+    folderSettings card_expected = { folder, pmode_t::einzel , track, 0 };
+    EXPECT_EQ(card_expected, card_decode());
 
+    card_out();
+    execute_cycle();
+  }
+  EXPECT_NE(Print::get_output().find("batch: 4 cards"), std::string::npos);
+#else
   for (uint8_t track = first; track <= last; ++track) {
 
     getMp3().end_track();
@@ -1187,6 +1218,7 @@ TEST_F(admin_test_fixture, Admin_CardsForFolder) {
     folderSettings card_expected = { folder, pmode_t::einzel , track, 0 };
     EXPECT_EQ(card_expected, card_decode());
   }
+#endif // BATCH_CARD_WRITE
 
   goto_idle();
 
@@ -1450,3 +1482,53 @@ TEST_F(admin_test_fixture, Admin_PauseIfCardRemoved) {
 }
 
 
+
+#ifdef VOICE_MENU_BARGE_IN
+// =======================================================
+// Test fast navigation in the voice menu
+// =======================================================
+
+TEST_F(admin_test_fixture, voice_menu_barge_in) {
+
+  goto_idle();
+
+  getMp3().set_folder_track_count(3, 10);
+
+  card_in(0, 0, 0, 0, 0, 0);
+  ASSERT_TRUE(SM_tonuino::is_in_state<Admin_NewCard>());
+
+  // wait for end t_300_new_tag
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts);
+  getMp3().end_track();
+  execute_cycle();
+  execute_cycle();
+  execute_cycle(); // --> start_setupCard
+  ASSERT_TRUE(SM_setupCard::is_in_state<ChMode>());
+
+  // select mode hoerspiel
+  button_for_command(command::next, state_for_command::admin);
+  execute_cycle_for_ms(time_check_play);
+  button_for_command(command::select, state_for_command::admin);
+  ASSERT_TRUE(SM_setupCard::is_in_state<ChFolder>());
+
+  // scroll to folder 3 without waiting for the end of the prompts
+  for (uint8_t folder = 1; folder <= 3; ++folder) {
+    button_for_command(command::next, state_for_command::admin);
+    execute_cycle_for_ms(100);
+    EXPECT_TRUE(getMp3().is_playing_mp3());
+    EXPECT_EQ(getMp3().df_mp3_track, folder);
+  }
+
+  // prompt finished, but the selection is not stable yet --> no preview
+  getMp3().end_track();
+  execute_cycle_for_ms(voiceMenuPreviewDelay/2);
+  EXPECT_FALSE(getMp3().is_playing_folder());
+
+  // selection stable --> preview of folder 3 only
+  execute_cycle_for_ms(voiceMenuPreviewDelay/2);
+  execute_cycle_for_ms(time_check_play);
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder, 3);
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+}
+#endif // VOICE_MENU_BARGE_IN
@@ -238,3 +238,39 @@ TEST_F(buttons_test_fixture, all_commands) {
     }
   }
 }
+
+#ifdef BUTTONS_EDGE_BUFFER
+TEST_F(buttons_test_fixture, edge_buffer_press_during_blocking) {
+  EXPECT_EQ(execute_cycle(), commandRaw::none);
+
+  // short press while the loop is blocked, only the ISR sees the edges
+  press_button(buttonUpPin);
+  Buttons::sample();
+  current_time += 2*buttonDbTime;
+  release_button(buttonUpPin);
+  Buttons::sample();
+  current_time += 1000;
+
+  EXPECT_EQ(execute_cycle(), commandRaw::none);
+  EXPECT_EQ(execute_cycle(), commandRaw::up  );
+  EXPECT_EQ(execute_cycle(), commandRaw::none);
+
+  // bounce is filtered
+  press_button(buttonPausePin);
+  Buttons::sample();
+  current_time += 2;
+  release_button(buttonPausePin);
+  Buttons::sample();
+  current_time += 2;
+  press_button(buttonPausePin);
+  Buttons::sample();
+  current_time += 2*buttonDbTime;
+  release_button(buttonPausePin);
+  Buttons::sample();
+  current_time += 1000;
+
+  EXPECT_EQ(execute_cycle(), commandRaw::none );
+  EXPECT_EQ(execute_cycle(), commandRaw::pause);
+  EXPECT_EQ(execute_cycle(), commandRaw::none );
+}
+#endif
@@ -183,3 +183,312 @@ TEST_F(chip_card_test_fixture, write_card_works) {
   }
 }
 
+TEST_F(chip_card_test_fixture, ultralight_card_minimum_transactions) {
+  getMFRC522().ultralight = true;
+  const folderSettings card{ 1, pmode_t::album, 0, 0 };
+  card_in(card);
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+
+  // all 4 pages with one READ
+  folderSettings nfcTag{};
+  getMFRC522().mifare_reads = 0;
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(card, nfcTag);
+  EXPECT_EQ(getMFRC522().mifare_reads, 1);
+
+  // only the changed page is written
+  const folderSettings newCard{ 1, pmode_t::einzel, 5, 0 };
+  getMFRC522().mifare_reads  = 0;
+  getMFRC522().mifare_writes = 0;
+  EXPECT_TRUE(chip_card.writeCard(newCard));
+  EXPECT_EQ(newCard, card_decode());
+  EXPECT_EQ(getMFRC522().mifare_reads , 1);
+  EXPECT_EQ(getMFRC522().mifare_writes, 1);
+
+  // unchanged --> nothing to write
+  getMFRC522().mifare_writes = 0;
+  EXPECT_TRUE(chip_card.writeCard(newCard));
+  EXPECT_EQ(getMFRC522().mifare_writes, 0);
+}
+
+
+#ifdef CARD_LOW_POWER_DETECT
+TEST_F(chip_card_test_fixture, low_power_field_off_without_card) {
+  execute_cycle();
+  EXPECT_FALSE(getMFRC522().antenna_on);
+  const uint16_t count = getMFRC522().count_AntennaOn;
+
+  // no poll before cardPollCycles
+  card_in({ 1, pmode_t::album, 0, 0 });
+  for (uint8_t i = 1; i < cardPollCycles; ++i) {
+    EXPECT_EQ(execute_cycle(), cardEvent::none);
+    EXPECT_FALSE(getMFRC522().antenna_on);
+  }
+  EXPECT_EQ(getMFRC522().count_AntennaOn, count);
+
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  EXPECT_EQ(getMFRC522().count_AntennaOn, count+1);
+  EXPECT_TRUE(getMFRC522().antenna_on);
+
+  // field stays on while the card is present
+  for (uint8_t i = 0; i < 5; ++i)
+    EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(getMFRC522().count_AntennaOn, count+1);
+  EXPECT_TRUE(getMFRC522().antenna_on);
+
+  card_out();
+  execute_cycle();
+  execute_cycle();
+  EXPECT_EQ(execute_cycle(), cardEvent::removed);
+  EXPECT_FALSE(getMFRC522().antenna_on);
+}
+#endif // CARD_LOW_POWER_DETECT
+
+#ifdef CARD_PRESENCE_CHECK
+TEST_F(chip_card_test_fixture, presence_check_without_anticollision) {
+  card_in({ 1, pmode_t::album, 0, 0 });
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  folderSettings nfcTag;
+  chip_card.readCard(nfcTag);
+  const uint16_t readSerial = getMFRC522().count_ReadCardSerial;
+  const uint16_t select     = getMFRC522().count_PICC_Select;
+
+  for (uint8_t i = 0; i < 10; ++i)
+    EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(getMFRC522().count_ReadCardSerial, readSerial);
+  EXPECT_EQ(getMFRC522().count_PICC_Select, select+10);
+}
+
+TEST_F(chip_card_test_fixture, presence_check_halts_the_card) {
+  card_in({ 1, pmode_t::album, 0, 0 });
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  folderSettings nfcTag;
+  chip_card.readCard(nfcTag);
+
+  // only the first check after the read needs the second WUPA
+  for (uint8_t i = 0; i < 10; ++i)
+    EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(getMFRC522().count_PICC_WakeupA_ignored, 1);
+  EXPECT_TRUE(getMFRC522().card_halted);
+
+  // selected again for the write and the read
+  EXPECT_TRUE(chip_card.writeCard({ 3, pmode_t::party, 0, 0 }));
+  EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(nfcTag.folder, 3);
+}
+
+TEST_F(chip_card_test_fixture, presence_check_removal_in_ms) {
+  card_in({ 1, pmode_t::album, 0, 0 });
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  EXPECT_EQ(execute_cycle(), cardEvent::none);
+
+  // independent of the cycle time
+  card_out();
+  for (unsigned long t = 20; t < cardRemoveTime; t += 20)
+    EXPECT_EQ(execute_cycle(20), cardEvent::none);
+  EXPECT_EQ(execute_cycle(20), cardEvent::removed);
+  EXPECT_EQ(execute_cycle(20), cardEvent::none);
+}
+
+TEST_F(chip_card_test_fixture, presence_check_other_card) {
+  card_in({ 1, pmode_t::album, 0, 0 });
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+
+  // swapped within one cycle: the other UID does not answer the select
+  card_in({ 2, pmode_t::album, 0, 0 });
+  cardEvent ce = cardEvent::none;
+  for (unsigned long t = 0; t < cardRemoveTime && ce == cardEvent::none; t += cycleTime)
+    ce = execute_cycle();
+  EXPECT_EQ(ce, cardEvent::removed);
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  folderSettings nfcTag;
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(nfcTag.folder, 2);
+}
+#endif // CARD_PRESENCE_CHECK
+
+#ifdef ADAPTIVE_CARD_POLL
+TEST_F(chip_card_test_fixture, adaptive_poll_backs_off) {
+  EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(chip_card.pollInterval(), 0);
+
+  for (unsigned long t = cycleTime; t < cardPollBackoffTime; t += cycleTime)
+    EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(chip_card.pollInterval(), 2*cycleTime);
+
+  for (uint8_t i = 0; i < 10; ++i)
+    for (unsigned long t = 0; t < cardPollBackoffTime; t += cycleTime)
+      execute_cycle();
+  EXPECT_EQ(chip_card.pollInterval(), cardPollSlowTime);
+
+  // inserted with the next poll
+  card_in({ 1, pmode_t::album, 0, 0 });
+  cardEvent ce = cardEvent::none;
+  unsigned long t = 0;
+  for (; t <= cardPollSlowTime && ce == cardEvent::none; t += cycleTime)
+    ce = execute_cycle();
+  EXPECT_EQ(ce, cardEvent::inserted);
+  EXPECT_LE(t, cardPollSlowTime + cycleTime);
+  EXPECT_EQ(chip_card.pollInterval(), 0);
+
+  // activity
+  for (unsigned long t = 0; t < 3*cardPollBackoffTime; t += cycleTime)
+    execute_cycle();
+  EXPECT_GT(chip_card.pollInterval(), 0);
+  chip_card.pollFast();
+  EXPECT_EQ(chip_card.pollInterval(), 0);
+  card_out();
+}
+
+TEST_F(chip_card_test_fixture, adaptive_poll_removal_of_present_card) {
+  card_in({ 1, pmode_t::album, 0, 0 });
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  for (uint8_t i = 0; i < 10; ++i)
+    for (unsigned long t = 0; t < cardPollBackoffTime; t += cycleTime)
+      EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(chip_card.pollInterval(), cardPollSlowTime);
+
+  // the first failed poll switches to every cycle, then the removal takes the usual time
+  card_out();
+  cardEvent ce = cardEvent::none;
+  unsigned long t = 0;
+  for (; t <= 2*cardPollSlowTime && ce == cardEvent::none; t += cycleTime)
+    ce = execute_cycle();
+  EXPECT_EQ(ce, cardEvent::removed);
+  EXPECT_LE(t, cardPollSlowTime + (cardRemoveDelay+1)*cycleTime);
+  EXPECT_EQ(chip_card.pollInterval(), 0);
+}
+#endif // ADAPTIVE_CARD_POLL
+
+#ifdef CARD_READ_RETRY
+namespace {
+constexpr uint8_t maxCycles = 100;
+}
+
+TEST_F(chip_card_test_fixture, read_retry_with_higher_gain) {
+  const folderSettings card{ 3, pmode_t::album, 0, 0 };
+  getMFRC522().card_min_gain = MFRC522::RxGain_43dB;
+  card_in(card);
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+
+  folderSettings nfcTag;
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(nfcTag, card);
+  // back to the default gain for the detection
+  EXPECT_EQ(getMFRC522().antenna_gain, MFRC522::RxGain_33dB);
+
+  card_out();
+  for (uint8_t i = 0; i < maxCycles && execute_cycle() != cardEvent::removed; ++i)
+    ;
+  EXPECT_TRUE(chip_card.isCardRemoved());
+
+  // the same card starts with the gain that worked
+  card_in(card);
+  for (uint8_t i = 0; i < maxCycles && execute_cycle() != cardEvent::inserted; ++i)
+    ;
+  const uint16_t selects = getMFRC522().count_PICC_Select;
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(getMFRC522().count_PICC_Select, selects);
+  EXPECT_EQ(getMFRC522().antenna_gain, MFRC522::RxGain_33dB);
+  card_out();
+}
+
+TEST_F(chip_card_test_fixture, read_retry_bounded) {
+  getMFRC522().card_min_gain = 0xff; // does not answer with any gain
+  card_in({ 3, pmode_t::album, 0, 0 });
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+
+  const uint16_t selects = getMFRC522().count_PICC_Select;
+  folderSettings nfcTag;
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::none);
+  EXPECT_EQ(getMFRC522().count_PICC_Select, selects + cardReadRetries);
+  EXPECT_EQ(getMFRC522().antenna_gain, MFRC522::RxGain_33dB);
+  card_out();
+}
+#endif // CARD_READ_RETRY
+
+#ifdef CARD_CACHE
+TEST_F(chip_card_test_fixture, card_cache_hit) {
+  const folderSettings card{ 3, pmode_t::album, 0, 0 };
+  card_in(card);
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  folderSettings nfcTag;
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(nfcTag, card);
+  card_out();
+  execute_cycle();
+  execute_cycle();
+  EXPECT_EQ(execute_cycle(), cardEvent::removed);
+
+  // same card again --> from cache without auth
+  card_in(card);
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  getMFRC522().t_buffer[5] = 0; // read would fail now
+  nfcTag = {};
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(nfcTag, card);
+  getMFRC522().t_buffer[5] = card.folder;
+
+  // validation does not insert the card again
+  EXPECT_EQ(execute_cycle(), cardEvent::none);
+  EXPECT_EQ(execute_cycle(), cardEvent::none);
+}
+
+TEST_F(chip_card_test_fixture, card_cache_rewritten_card) {
+  const folderSettings card    { 3, pmode_t::album   , 0, 0 };
+  const folderSettings newCard { 4, pmode_t::hoerbuch, 0, 0 };
+  card_in(card);
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  folderSettings nfcTag;
+  chip_card.readCard(nfcTag);
+  card_out();
+  execute_cycle();
+  execute_cycle();
+  execute_cycle();
+
+  // card is rewritten in another box
+  card_in(card);
+  getMFRC522().t_buffer[5] = newCard.folder;
+  getMFRC522().t_buffer[6] = static_cast<uint8_t>(newCard.mode);
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(nfcTag, card);
+
+  // validation finds the new content
+  EXPECT_EQ(execute_cycle(), cardEvent::inserted);
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+  EXPECT_EQ(nfcTag, newCard);
+  EXPECT_EQ(execute_cycle(), cardEvent::none);
+}
+
+TEST_F(chip_card_test_fixture, card_cache_lru) {
+  for (uint8_t folder = 1; folder <= cardCacheSize+1; ++folder) {
+    card_in({ folder, pmode_t::album, 0, 0 });
+    execute_cycle();
+    folderSettings nfcTag;
+    chip_card.readCard(nfcTag);
+    card_out();
+    execute_cycle();
+    execute_cycle();
+    execute_cycle();
+  }
+  // the first card dropped out: a failing read is not hidden by the cache
+  card_in({ 1, pmode_t::album, 0, 0 });
+  execute_cycle();
+  memset(getMFRC522().t_buffer, 0, 4);
+  folderSettings nfcTag;
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::empty);
+  card_out();
+  execute_cycle();
+  execute_cycle();
+  execute_cycle();
+
+  // the last card is still cached
+  card_in({ cardCacheSize+1, pmode_t::album, 0, 0 });
+  execute_cycle();
+  memset(getMFRC522().t_buffer, 0, 4);
+  EXPECT_EQ(chip_card.readCard(nfcTag), Chip_card::readCardEvent::known);
+}
+#endif // CARD_CACHE
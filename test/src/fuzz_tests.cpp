@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "tonuino_fixture.hpp"
+
+// feeds random interleavings of buttons, cards and track ends into the firmware
+// and measures the simulated time of every loop() call. A call that takes longer
+// than the budget blocks the box and is reported with the seed and the last
+// actions. The shutdown (power off) is the only call that may block.
+//
+//   TONUINO_FUZZ_SEED  =<n>  replay only this seed
+//   TONUINO_FUZZ_BUDGET=<ms> budget per loop() call (default 200 ms)
+//   TONUINO_FUZZ_STEPS =<n>  actions per seed (default 2000)
+class fuzz_test_fixture: public tonuino_fixture {
+public:
+  static constexpr unsigned long defaultBudget = 200;
+  static constexpr unsigned long defaultSteps  = 2000;
+  static constexpr unsigned long defaultSeeds  = 10;
+  static constexpr uint8_t       numFolders    = 5;
+
+  static unsigned long env(const char *name, unsigned long def) {
+    const char *v = getenv(name);
+    return v ? strtoul(v, nullptr, 0) : def;
+  }
+
+  unsigned long rand_below(unsigned long n) { return rand() % n; }
+
+  void log_action(const std::string &action) {
+    history.push_back(action);
+    if (history.size() > 12)
+      history.erase(history.begin());
+  }
+
+  std::string last_actions() const {
+    std::string s;
+    for (const auto &a: history)
+      s += " " + a;
+    return s;
+  }
+
+  // one loop() call, returns false if it blocked longer than the budget
+  bool checked_cycle(unsigned long seed, unsigned long step) {
+    const unsigned long start = current_time;
+    execute_cycle();
+    const unsigned long used = current_time - start;
+
+    if (pin_value[shutdownPin] == getLevel(shutdownPinType, level::active)) {
+      // powered off: switch on again
+      log_action("shutdown");
+      pin_value[shutdownPin] = getLevel(shutdownPinType, level::inactive);
+      getMp3().reset_to_initial_state();
+      tonuino.setup();
+      return true;
+    }
+    if (used > max(budget, cycleTime)) {
+      ADD_FAILURE() << "loop() blocked " << used << " ms, seed: " << seed << " step: " << step
+                    << " last actions:" << last_actions();
+      return false;
+    }
+    return true;
+  }
+
+  void run_seed(unsigned long seed) {
+    srand(seed);
+    history.clear();
+    for (uint8_t folder = 1; folder <= numFolders; ++folder)
+      getMp3().set_folder_track_count(folder, 1 + rand_below(30));
+
+    std::vector<uint8_t> buttons{ buttonPausePin, buttonUpPin, buttonDownPin };
+#ifdef FIVEBUTTONS
+    buttons.push_back(buttonFourPin);
+    buttons.push_back(buttonFivePin);
+#endif
+
+    for (unsigned long step = 0; step < steps; ++step) {
+      const unsigned long r = rand_below(100);
+      if (r < 20) {
+        const uint8_t pin = buttons[rand_below(buttons.size())];
+        if (pin_value[pin] == LOW) {
+          release_button(pin);
+          log_action("release " + std::to_string(pin));
+        }
+        else {
+          press_button(pin);
+          log_action("press " + std::to_string(pin));
+        }
+      }
+      else if (r < 28) {
+        folderSettings card;
+        const unsigned long c = rand_below(10);
+        if (c == 0)
+          card = { 0, pmode_t::admin_card, 0, 0 };
+        else if (c < 3) // modifier card
+          card = { 0, static_cast<pmode_t>(1 + rand_below(7)), static_cast<uint8_t>(rand_below(3)), 0 };
+        else
+          card = { static_cast<uint8_t>(1 + rand_below(numFolders)), static_cast<pmode_t>(1 + rand_below(13)),
+                   static_cast<uint8_t>(rand_below(4)), static_cast<uint8_t>(rand_below(4)) };
+        const uint32_t cookie = rand_below(20) == 0 ? 0 : cardCookie; // sometimes an empty card
+        getMFRC522().card_in(cookie, cardVersion, card.folder, static_cast<uint8_t>(card.mode), card.special, card.special2);
+        log_action("card_in " + std::to_string(card.folder) + "/" + std::to_string(static_cast<uint8_t>(card.mode)));
+      }
+      else if (r < 34) {
+        getMFRC522().card_out();
+        log_action("card_out");
+      }
+      else if (r < 44) {
+        getMp3().end_track();
+        log_action("end_track");
+      }
+      else if (r < 46) {
+        // wait for the timeouts (start of tracks, long press, admin menu timer)
+        const unsigned long ms = 1000 + rand_below(10000);
+        log_action("wait " + std::to_string(ms));
+        for (unsigned long t = 0; t < ms; t += cycleTime)
+          if (not checked_cycle(seed, step))
+            return;
+        continue;
+      }
+      if (not checked_cycle(seed, step))
+        return;
+    }
+  }
+
+  unsigned long budget = env("TONUINO_FUZZ_BUDGET", defaultBudget);
+  unsigned long steps  = env("TONUINO_FUZZ_STEPS" , defaultSteps );
+  std::vector<std::string> history{};
+};
+
+TEST_F(fuzz_test_fixture, random_events_do_not_block) {
+  const unsigned long seed = env("TONUINO_FUZZ_SEED", 0);
+  if (seed) {
+    run_seed(seed);
+    return;
+  }
+  for (unsigned long s = 1; s <= defaultSeeds && not HasFailure(); ++s)
+    run_seed(s);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <Arduino.h>
+#include <log.hpp>
+
+DEFINE_LOGGER(binary_test_log, s_info, binary_logger);
+
+namespace {
+const uint8_t* token(const __FlashStringHelper* s) {
+  static uint16_t t;
+  t = static_cast<uint16_t>(reinterpret_cast<uintptr_t>(s));
+  return reinterpret_cast<const uint8_t*>(&t);
+}
+}
+
+TEST(binary_logger_test, record) {
+  const __FlashStringHelper* text = F("value: ");
+  Print::clear_output();
+  LOG(binary_test_log, s_warning, text, static_cast<uint8_t>(5), static_cast<int16_t>(-2));
+  const std::string out = Print::get_output();
+
+  ASSERT_EQ(out.size(), 13u);
+  EXPECT_EQ(static_cast<uint8_t>(out[0]), binary_logger::recordStart);
+  EXPECT_EQ(static_cast<uint8_t>(out[1]), s_warning);
+  EXPECT_EQ(static_cast<uint8_t>(out[2]), token(binary_test_log::name())[0]);
+  EXPECT_EQ(static_cast<uint8_t>(out[3]), token(binary_test_log::name())[1]);
+  EXPECT_EQ(static_cast<uint8_t>(out[4]), binary_logger::t_flash);
+  EXPECT_EQ(static_cast<uint8_t>(out[5]), token(text)[0]);
+  EXPECT_EQ(static_cast<uint8_t>(out[6]), token(text)[1]);
+  EXPECT_EQ(static_cast<uint8_t>(out[7]), binary_logger::t_unsigned | 1);
+  EXPECT_EQ(static_cast<uint8_t>(out[8]), 5);
+  EXPECT_EQ(static_cast<uint8_t>(out[9]), binary_logger::t_signed | 2);
+  EXPECT_EQ(static_cast<uint8_t>(out[10]), 0xfe);
+  EXPECT_EQ(static_cast<uint8_t>(out[11]), 0xff);
+  EXPECT_EQ(static_cast<uint8_t>(out[12]), binary_logger::t_end_lf);
+}
+
+TEST(binary_logger_test, severity_and_linefeed) {
+  Print::clear_output();
+  LOG(binary_test_log, s_debug, static_cast<uint32_t>(1));
+  EXPECT_EQ(Print::get_output().size(), 0u);
+
+  LOG(binary_test_log, s_info, static_cast<uint32_t>(0x01020304), lf_no);
+  const std::string out = Print::get_output();
+  ASSERT_EQ(out.size(), 10u);
+  EXPECT_EQ(static_cast<uint8_t>(out[4]), binary_logger::t_unsigned | 4);
+  EXPECT_EQ(static_cast<uint8_t>(out[5]), 0x04);
+  EXPECT_EQ(static_cast<uint8_t>(out[8]), 0x01);
+  EXPECT_EQ(static_cast<uint8_t>(out[9]), binary_logger::t_end);
+}
+
+#ifdef BUFFERED_LOG
+DEFINE_LOGGER(buffer_test_log, s_info, void);
+
+class log_buffer_test: public ::testing::Test {
+protected:
+  void SetUp() override {
+    LogBuffer::getLogBuffer().setBuffered(true);
+    Print::clear_output();
+  }
+  void TearDown() override {
+    Serial.txFree = 64;
+    while (LogBuffer::getLogBuffer().drain()) {}
+    LogBuffer::getLogBuffer().drain(); // the log of the dropped records
+    LogBuffer::getLogBuffer().setBuffered(false);
+  }
+  LogBuffer &logBuffer = LogBuffer::getLogBuffer();
+};
+
+TEST_F(log_buffer_test, record_sent_by_drain) {
+  LOG(buffer_test_log, s_info, F("abc"), 5);
+  EXPECT_EQ(Print::get_output(), "");
+  EXPECT_EQ(logBuffer.size(), 5);
+
+  EXPECT_FALSE(logBuffer.drain());
+  EXPECT_EQ(Print::get_output(), "abc5\n");
+  EXPECT_EQ(logBuffer.size(), 0);
+}
+
+TEST_F(log_buffer_test, drain_does_not_block) {
+  LOG(buffer_test_log, s_info, F("abc"));
+  Serial.txFree = 0;
+  EXPECT_TRUE(logBuffer.drain());
+  EXPECT_EQ(Print::get_output(), "");
+
+  Serial.txFree = 64;
+  EXPECT_FALSE(logBuffer.drain());
+  EXPECT_EQ(Print::get_output(), "abc\n");
+}
+
+TEST_F(log_buffer_test, overflow_drops_whole_record) {
+  const std::string first (100, 'a');
+  const std::string second( 50, 'b');
+  LOG(buffer_test_log, s_info, first.c_str());
+  LOG(buffer_test_log, s_info, second.c_str());
+  EXPECT_EQ(logBuffer.size(), 101);
+  EXPECT_EQ(logBuffer.dropped(), 1);
+
+  // the record after the drop fits again
+  LOG(buffer_test_log, s_info, F("c"));
+  EXPECT_EQ(logBuffer.size(), 103);
+
+  logBuffer.drain();
+  EXPECT_EQ(Print::get_output(), first + "\nc\n");
+  EXPECT_EQ(logBuffer.dropped(), 0);
+}
+#endif // BUFFERED_LOG
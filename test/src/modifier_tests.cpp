@@ -188,6 +188,7 @@ TEST_F(tonuino_test_fixture, FiWaAi) {
 // Test ToddlerMode
 // =======================================================
 
+#ifndef DISABLE_TODDLER_MODE
 TEST_F(tonuino_test_fixture, ToddlerMode_in_idle) {
 
   goto_idle();
@@ -197,10 +198,15 @@ TEST_F(tonuino_test_fixture, ToddlerMode_in_idle) {
   card_in({ 0, pmode_t::toddler, 0, 0 });
 
   EXPECT_EQ(getModifier().getActive(), pmode_t::toddler);
-//  EXPECT_TRUE(getMp3().is_playing_adv());
-//  EXPECT_EQ(getMp3().df_adv_track, static_cast<uint16_t>(advertTracks::t_304_buttonslocked));
+  EXPECT_TRUE(getMp3().isPlayingAdvertisement());
+  for (uint8_t i = 0; i < 10 && not getMp3().is_playing_adv(); ++i)
+    execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_adv());
+  EXPECT_EQ(getMp3().df_adv_track, static_cast<uint16_t>(advertTracks::t_304_buttonslocked));
   card_out();
   EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts + time_check_play);
+  EXPECT_FALSE(getMp3().isPlayingAdvertisement());
   EXPECT_TRUE(getMp3().is_stopped() || getMp3().is_pause());
 
   button_for_command(command::shortcut1, state_for_command::idle_pause);
@@ -233,6 +239,30 @@ TEST_F(tonuino_test_fixture, ToddlerMode_in_idle) {
   //EXPECT_TRUE(false) << "log: " << Print::get_output();
 }
 
+TEST_F(tonuino_test_fixture, ToddlerMode_kept_after_unknown_card) {
+
+  goto_idle();
+  card_out();
+
+  card_in({ 0, pmode_t::toddler, 0, 0 });
+  EXPECT_EQ(getModifier().getActive(), pmode_t::toddler);
+  card_out();
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts + time_check_play);
+
+  // no modifier: the buttons stay locked
+  card_in({ 0, static_cast<pmode_t>(8), 0, 0 });
+  EXPECT_EQ(getModifier().getActive(), pmode_t::toddler);
+  card_out();
+
+  button_for_command(command::shortcut1, state_for_command::idle_pause);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+
+  card_in({ 0, pmode_t::toddler, 0, 0 });
+  EXPECT_EQ(getModifier().getActive(), pmode_t::none);
+  card_out();
+  //EXPECT_TRUE(false) << "log: " << Print::get_output();
+}
+
 TEST_F(tonuino_test_fixture, ToddlerMode_in_play) {
 
   goto_play({ 2, pmode_t::album, 0, 0 });
@@ -307,6 +337,7 @@ TEST_F(tonuino_test_fixture, ToddlerMode_in_play) {
   goto_idle();
   //EXPECT_TRUE(false) << "log: " << Print::get_output();
 }
+#endif // DISABLE_TODDLER_MODE
 
 // =======================================================
 // Test KindergardenMode
@@ -374,6 +405,10 @@ TEST_F(tonuino_test_fixture, KindergardenMode) {
 
   card_in({ 3, pmode_t::einzel, 4, 0 });
   EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+#ifdef KINDERGARDEN_QUEUE_ANNOUNCE
+  EXPECT_EQ(getMp3().df_adv_track, 1);
+  getMp3().end_adv();
+#endif
   EXPECT_TRUE(getMp3().is_playing_folder());
   EXPECT_EQ(getMp3().df_folder, 2);
   EXPECT_EQ(getMp3().df_folder_track, 1);
@@ -395,10 +430,62 @@ TEST_F(tonuino_test_fixture, KindergardenMode) {
   //EXPECT_TRUE(false) << "log: " << Print::get_output();
 }
 
+TEST_F(tonuino_test_fixture, KindergardenMode_queue) {
+
+  goto_play({ 2, pmode_t::album, 0, 0 });
+  card_out();
+
+  card_in({ 0, pmode_t::kindergarden, 0, 0 });
+  card_out();
+  EXPECT_EQ(getModifier().getActive(), pmode_t::kindergarden);
+  Print::clear_output();
+
+  // the cards are played in the order they came, a card queued twice only once
+  const folderSettings cards[] = { { 3, pmode_t::einzel, 4, 0 }, { 4, pmode_t::album, 0, 0 }, { 3, pmode_t::einzel, 4, 0 } };
+  for (uint8_t i = 0; i < 3; ++i) {
+    card_in(cards[i]);
+#ifdef KINDERGARDEN_QUEUE_ANNOUNCE
+    // the position in the queue
+    EXPECT_EQ(getMp3().df_adv_track, i < 2 ? i+1 : 0);
+    getMp3().end_adv();
+#endif
+    card_out();
+    EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+    EXPECT_EQ(getMp3().df_folder, 2);
+  }
+
+  getMp3().end_track();
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder, 3);
+  EXPECT_EQ(getMp3().df_folder_track, 4);
+
+  getMp3().end_track();
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder, 4);
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+
+  // queue empty: the album goes on
+  getMp3().end_track();
+  execute_cycle();
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder, 4);
+  EXPECT_EQ(getMp3().df_folder_track, 2);
+
+  card_in({ 0, pmode_t::kindergarden, 0, 0 });
+  card_out();
+  EXPECT_EQ(getModifier().getActive(), pmode_t::none);
+
+  goto_idle();
+}
+
 // =======================================================
 // Test RepeatSingleModifier
 // =======================================================
 
+#ifndef DISABLE_REPEAT_SINGLE
 TEST_F(tonuino_test_fixture, RepeatSingleModifier) {
 
   goto_play({ 2, pmode_t::album, 0, 0 });
@@ -459,4 +546,27 @@ TEST_F(tonuino_test_fixture, RepeatSingleModifier) {
   goto_idle();
   //EXPECT_TRUE(false) << "log: " << Print::get_output();
 }
+#else
+TEST_F(tonuino_test_fixture, RepeatSingleModifier_disabled) {
+
+  goto_play({ 2, pmode_t::album, 0, 0 });
+  card_out();
+  Print::clear_output();
+
+  card_in({ 0, pmode_t::repeat_single, 0, 0 });
+
+  EXPECT_EQ(getModifier().getActive(), pmode_t::none);
+  EXPECT_FALSE(getMp3().is_playing_adv());
+  card_out();
+
+  button_for_command(command::next, state_for_command::play);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder, 2);
+  EXPECT_EQ(getMp3().df_folder_track, 2);
+
+  goto_idle();
+  //EXPECT_TRUE(false) << "log: " << Print::get_output();
+}
+#endif // DISABLE_REPEAT_SINGLE
 
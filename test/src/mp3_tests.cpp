@@ -4,6 +4,9 @@
 #include <tonuino.hpp>
 #include <mp3.hpp>
 
+#include <algorithm>
+#include <vector>
+
 class mp3_test_fixture: public ::testing::Test {
 public:
   mp3_test_fixture()
@@ -20,6 +23,21 @@ public:
     mp3.loop();
   }
 
+#ifdef DFPLAYER_SHADOW
+  // sets the init volume and reads it back
+  uint8_t set_verified_volume() {
+    tonuino.getSettings().spkInitVolume = 12;
+    mp3.setVolume();
+#ifdef DFPLAYER_VOLUME_SYNC
+    for (uint8_t i = 0; i < 4; ++i) {
+      current_time += dfPlayerVolumeVerifyTime;
+      execute_cycle();
+    }
+#endif
+    return mp3.current_volume;
+  }
+#endif
+
   // because mp3::OnPlayFinished() uses Tonuino::nextTrack() we have to use mp3 from Tonuino
   Tonuino& tonuino;
   Mp3&     mp3;
@@ -69,6 +87,113 @@ TEST_F(mp3_test_fixture, enqueue_mp3_with_playafter) {
   EXPECT_TRUE(mp3.is_stopped());
 }
 
+TEST_F(mp3_test_fixture, endless_empty_queue) {
+  mp3.enqueueTrack(1, 5, 5);
+  execute_cycle();
+  EXPECT_TRUE(mp3.is_playing_folder());
+
+  // a party card of an empty folder: the queue of the track before is cleared
+  mp3.enqueueTrack(1, 1, 0);
+  mp3.setEndless();
+  execute_cycle();
+  mp3.end_track();
+  execute_cycle();
+  execute_cycle();
+  EXPECT_FALSE(mp3.is_playing_folder());
+}
+
+#ifdef PROMPT_QUEUE
+TEST_F(mp3_test_fixture, prompt_queue_sequence) {
+  mp3.enqueueMp3FolderTrack(mp3Tracks::t_262_pling);
+  mp3.enqueuePrompt(1);
+  mp3.enqueuePrompt(2);
+  mp3.enqueuePrompt(3);
+  EXPECT_EQ(mp3.pendingPrompts(), 4);
+
+  // every prompt starts after the one before without waiting
+  const uint16_t expected[] = { static_cast<uint16_t>(mp3Tracks::t_262_pling), 1, 2, 3 };
+  for (uint16_t track: expected) {
+    execute_cycle();
+    execute_cycle();
+    EXPECT_TRUE(mp3.is_playing_mp3());
+    EXPECT_EQ(mp3.df_mp3_track, track);
+    mp3.end_track();
+  }
+  execute_cycle();
+  EXPECT_TRUE(mp3.is_stopped());
+  EXPECT_EQ(mp3.pendingPrompts(), 0);
+}
+
+TEST_F(mp3_test_fixture, prompt_queue_priority) {
+  mp3.enqueueMp3FolderTrack(mp3Tracks::t_262_pling);
+  execute_cycle();
+  EXPECT_EQ(mp3.df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_262_pling));
+
+  mp3.enqueuePrompt(1, Mp3::prompt_prio::low);
+  mp3.enqueuePrompt(2);
+  mp3.enqueuePrompt(3, Mp3::prompt_prio::high);
+  mp3.enqueuePrompt(4, Mp3::prompt_prio::low);
+  EXPECT_EQ(mp3.pendingPrompts(), 4);
+  EXPECT_EQ(mp3.df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_262_pling));
+
+  for (uint16_t track: { 3, 2, 1, 4 }) {
+    mp3.end_track();
+    execute_cycle();
+    execute_cycle();
+    EXPECT_EQ(mp3.df_mp3_track, track);
+  }
+  mp3.end_track();
+  execute_cycle();
+  EXPECT_TRUE(mp3.is_stopped());
+}
+
+TEST_F(mp3_test_fixture, prompt_queue_cancel) {
+  mp3.enqueueMp3FolderTrack(mp3Tracks::t_262_pling);
+  execute_cycle();
+  EXPECT_EQ(mp3.df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_262_pling));
+
+  mp3.enqueuePrompt(1, Mp3::prompt_prio::low);
+  mp3.enqueuePrompt(2);
+  mp3.enqueuePrompt(3, Mp3::prompt_prio::low);
+  mp3.cancelPrompts(Mp3::prompt_prio::low);
+  EXPECT_EQ(mp3.pendingPrompts(), 1);
+  // the playing prompt continues
+  EXPECT_TRUE(mp3.is_playing_mp3());
+  EXPECT_EQ(mp3.df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_262_pling));
+
+  mp3.end_track();
+  execute_cycle();
+  execute_cycle();
+  EXPECT_EQ(mp3.df_mp3_track, 2);
+  mp3.end_track();
+  execute_cycle();
+  EXPECT_TRUE(mp3.is_stopped());
+}
+
+TEST_F(mp3_test_fixture, prompt_queue_full) {
+  for (uint8_t i = 1; i <= promptQueueSize; ++i)
+    mp3.enqueuePrompt(i, Mp3::prompt_prio::low);
+  // drops the last one with the lowest priority
+  mp3.enqueuePrompt(100, Mp3::prompt_prio::high);
+  EXPECT_EQ(mp3.pendingPrompts(), promptQueueSize);
+  // no place for the same priority
+  mp3.enqueuePrompt(101, Mp3::prompt_prio::low);
+  EXPECT_EQ(mp3.pendingPrompts(), promptQueueSize);
+
+  execute_cycle();
+  EXPECT_EQ(mp3.df_mp3_track, 100);
+  for (uint8_t i = 1; i < promptQueueSize; ++i) {
+    mp3.end_track();
+    execute_cycle();
+    execute_cycle();
+    EXPECT_EQ(mp3.df_mp3_track, i);
+  }
+  mp3.end_track();
+  execute_cycle();
+  EXPECT_TRUE(mp3.is_stopped());
+}
+#endif // PROMPT_QUEUE
+
 TEST_F(mp3_test_fixture, enqueue_folder_track) {
   mp3.enqueueTrack(1, 2);
   execute_cycle();
@@ -179,3 +304,291 @@ TEST_F(mp3_test_fixture, enqueue_folder_tracks_and_jump) {
   EXPECT_TRUE(mp3.is_stopped());
 }
 
+#ifdef SHUFFLE_NO_REPEAT
+TEST_F(mp3_test_fixture, shuffle_no_repeat_across_rounds) {
+  constexpr uint8_t tracks = 10;
+  constexpr uint8_t rounds = 20;
+  mp3.enqueueTrack(1, 1, tracks);
+  mp3.shuffleQueue();
+  mp3.setEndless();
+  execute_cycle();
+
+  std::vector<track_t> played;
+  for (uint16_t i = 0; i < tracks*rounds; ++i) {
+    played.push_back(mp3.getCurrentTrack());
+    mp3.playNext(1, false);
+    execute_cycle();
+  }
+  for (uint8_t r = 0; r < rounds; ++r) {
+    // each round contains all tracks
+    std::vector<track_t> round(played.begin()+r*tracks, played.begin()+(r+1)*tracks);
+    std::sort(round.begin(), round.end());
+    for (uint8_t t = 0; t < tracks; ++t)
+      EXPECT_EQ(round[t], t+1);
+  }
+  // no track repeats within the repeat distance, also not at the start of a round
+  for (size_t i = 0; i < played.size(); ++i)
+    for (size_t j = i+1; j < played.size() && j <= i+shuffleRepeatDistance; ++j)
+      EXPECT_NE(played[i], played[j]) << "pos " << i << " and " << j;
+  // the rounds are shuffled again
+  EXPECT_FALSE(std::equal(played.begin(), played.begin()+tracks, played.begin()+tracks));
+
+  mp3.clearFolderQueue();
+}
+#endif // SHUFFLE_NO_REPEAT
+
+TEST_F(mp3_test_fixture, play_advertisement_not_playing) {
+  execute_cycle();
+  EXPECT_FALSE(mp3.isPlaying());
+
+  mp3.playAdvertisement(advertTracks::t_262_pling, false /*olnyIfIsPlaying*/);
+  EXPECT_TRUE(mp3.isPlayingAdvertisement());
+  execute_cycle();
+  EXPECT_TRUE(mp3.is_playing_folder());
+
+  execute_cycle();
+  execute_cycle();
+  EXPECT_TRUE(mp3.is_playing_adv());
+  EXPECT_EQ(mp3.df_adv_track, static_cast<uint16_t>(advertTracks::t_262_pling));
+  EXPECT_TRUE(mp3.isPlayingAdvertisement());
+
+  // the advertisement ended, the track is only paused after the start time of the DfPlayer
+  for (uint8_t i = 0; i < 10 && mp3.is_playing_adv(); ++i)
+    execute_cycle();
+  EXPECT_FALSE(mp3.is_playing_adv());
+  execute_cycle();
+  EXPECT_TRUE(mp3.isPlayingAdvertisement());
+
+  for (uint8_t i = 0; i < dfPlayer_timeUntilStarts / cycleTime + 10 && mp3.isPlayingAdvertisement(); ++i) {
+    current_time += cycleTime;
+    execute_cycle();
+  }
+  execute_cycle();
+  EXPECT_FALSE(mp3.isPlayingAdvertisement());
+  EXPECT_FALSE(mp3.is_playing_adv());
+  EXPECT_TRUE(mp3.is_pause());
+}
+
+TEST_F(mp3_test_fixture, play_advertisement_not_playing_aborted) {
+  execute_cycle();
+  EXPECT_FALSE(mp3.isPlaying());
+
+  mp3.playAdvertisement(advertTracks::t_262_pling, false /*olnyIfIsPlaying*/);
+  execute_cycle();
+  EXPECT_TRUE(mp3.isPlayingAdvertisement());
+
+  mp3.enqueueTrack(1, 2);
+  execute_cycle();
+  EXPECT_FALSE(mp3.isPlayingAdvertisement());
+  EXPECT_TRUE(mp3.is_playing_folder());
+  EXPECT_EQ(mp3.df_folder_track, 2);
+
+  for (uint8_t i = 0; i < 10; ++i)
+    execute_cycle();
+  EXPECT_TRUE(mp3.is_playing_folder());
+}
+
+#ifdef TRACK_COUNT_CACHE
+TEST_F(mp3_test_fixture, track_count_cache) {
+  mp3.set_folder_track_count(5, 10);
+  execute_cycle();
+  EXPECT_EQ(mp3.getFolderTrackCount(5), 10);
+
+  // changed without notification --> cached value
+  mp3.df_folder_track_count[5] = 20;
+  EXPECT_EQ(mp3.getFolderTrackCount(5), 10);
+
+  // SD card inserted --> cache cleared
+  mp3.set_folder_track_count(5, 30);
+  execute_cycle();
+  EXPECT_EQ(mp3.getFolderTrackCount(5), 30);
+}
+
+TEST_F(mp3_test_fixture, track_count_cache_not_for_0) {
+  mp3.set_folder_track_count(6, 0);
+  execute_cycle();
+  EXPECT_EQ(mp3.getFolderTrackCount(6), 0);
+
+  mp3.df_folder_track_count[6] = 12;
+  EXPECT_EQ(mp3.getFolderTrackCount(6), 12);
+}
+
+#ifdef TRACK_COUNT_CACHE_EEPROM
+TEST_F(mp3_test_fixture, track_count_cache_eeprom) {
+  Settings& settings = tonuino.getSettings();
+  mp3.set_folder_track_count(7, 15);
+  execute_cycle();
+  EXPECT_EQ(settings.readTrackCountFromFlash(7), Settings::unknownTrackCount);
+  EXPECT_EQ(mp3.getFolderTrackCount(7), 15);
+  EXPECT_EQ(settings.readTrackCountFromFlash(7), 15);
+
+  mp3.set_folder_track_count(7, 16);
+  execute_cycle();
+  EXPECT_EQ(settings.readTrackCountFromFlash(7), Settings::unknownTrackCount);
+}
+#endif // TRACK_COUNT_CACHE_EEPROM
+#endif // TRACK_COUNT_CACHE
+
+#ifdef DFPLAYER_CMD_QUEUE
+TEST_F(mp3_test_fixture, cmd_queue_collapse_volume) {
+  execute_cycle();
+  const uint32_t sent = mp3.commands_sent;
+
+  mp3.setVolume(5);
+  mp3.setVolume(6);
+  mp3.setVolume(7);
+  EXPECT_EQ(mp3.commands_sent, sent);
+
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+1);
+  EXPECT_EQ(mp3.current_volume, 7);
+}
+
+TEST_F(mp3_test_fixture, cmd_queue_play_replaces_stop) {
+  mp3.enqueueTrack(1, 2);
+  execute_cycle();
+  const uint32_t sent = mp3.commands_sent;
+
+  mp3.stop();
+  mp3.enqueueTrack(1, 3);
+  mp3.playCurrent();
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+1);
+  EXPECT_TRUE(mp3.is_playing_folder());
+  EXPECT_EQ(mp3.df_folder_track, 3);
+}
+
+TEST_F(mp3_test_fixture, cmd_queue_bounded_per_loop) {
+  execute_cycle();
+  const uint32_t sent = mp3.commands_sent;
+
+  mp3.setVolume(5);
+  mp3.setEq(DfMp3_Eq_Pop);
+  mp3.pause();
+  mp3.setVolume(6);
+
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+dfPlayerCmdsPerLoop);
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+4);
+  EXPECT_EQ(mp3.current_volume, 6);
+  EXPECT_EQ(mp3.current_eq, DfMp3_Eq_Pop);
+}
+
+TEST_F(mp3_test_fixture, cmd_queue_retry_on_timeout) {
+  execute_cycle();
+  const uint32_t sent = mp3.commands_sent;
+
+  mp3.setVolume(8);
+  mp3.set_error(DfMp3_Error_RxTimeout);
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+1);
+
+  // sent again, but only dfPlayerCmdRetries times
+  for (uint8_t i = 0; i < dfPlayerCmdRetries+2; ++i) {
+    mp3.set_error(DfMp3_Error_RxTimeout);
+    execute_cycle();
+  }
+  EXPECT_EQ(mp3.commands_sent, sent+1+dfPlayerCmdRetries);
+  EXPECT_EQ(mp3.current_volume, 8);
+}
+#endif // DFPLAYER_CMD_QUEUE
+
+#ifdef DFPLAYER_SHADOW
+TEST_F(mp3_test_fixture, shadow_volume_sent_once) {
+  const uint8_t v = set_verified_volume();
+  ASSERT_EQ(v, 12);
+  const uint32_t sent = mp3.commands_sent;
+
+  mp3.setVolume(v);
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent);
+
+  mp3.setVolume(v-1);
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+1);
+  EXPECT_EQ(mp3.current_volume, v-1);
+}
+
+TEST_F(mp3_test_fixture, shadow_volume_unknown_until_verified) {
+  mp3.setVolume(9);
+  execute_cycle();
+  const uint32_t sent = mp3.commands_sent;
+
+  // not read back --> sent again
+  mp3.setVolume(9);
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+1);
+  EXPECT_EQ(mp3.current_volume, 9);
+}
+
+TEST_F(mp3_test_fixture, shadow_eq_sent_once) {
+  mp3.setEq(DfMp3_Eq_Rock);
+  execute_cycle();
+  const uint32_t sent = mp3.commands_sent;
+
+  mp3.setEq(DfMp3_Eq_Rock);
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent);
+  EXPECT_EQ(mp3.current_eq, DfMp3_Eq_Rock);
+}
+
+TEST_F(mp3_test_fixture, shadow_invalid_after_error) {
+  const uint8_t v = set_verified_volume();
+
+  mp3.set_error(DfMp3_Error_Busy);
+  execute_cycle();
+  execute_cycle();
+  const uint32_t sent = mp3.commands_sent;
+
+  // the DfPlayer state is unknown --> sent again
+  mp3.setVolume(v);
+  execute_cycle();
+  EXPECT_EQ(mp3.commands_sent, sent+1);
+  EXPECT_EQ(mp3.current_volume, v);
+}
+#endif // DFPLAYER_SHADOW
+
+#ifdef FAST_BOOT
+TEST_F(mp3_test_fixture, wait_for_ready_with_reply) {
+  Mp3Notify::online = false;
+  const unsigned long start = millis();
+  mp3.waitForReady(2000);
+  EXPECT_TRUE(Mp3Notify::online);
+  EXPECT_LT(millis() - start, 100ul);
+}
+
+TEST_F(mp3_test_fixture, wait_for_ready_with_notification) {
+  Mp3Notify::online = false;
+  mp3.called_source_inserted = true;
+  mp3.waitForReady(2000);
+  EXPECT_TRUE(Mp3Notify::online);
+}
+#endif // FAST_BOOT
+
+#ifdef DFPLAYER_VOLUME_SYNC
+TEST_F(mp3_test_fixture, volume_sync_in_background) {
+  mp3.current_volume = 0;
+  const unsigned long start = millis();
+  mp3.setVolume();
+  EXPECT_EQ(millis(), start);
+  EXPECT_EQ(mp3.current_volume, 0);
+
+  // sent in the next loop, verified later
+  execute_cycle();
+#ifdef DFPLAYER_CMD_QUEUE
+  execute_cycle();
+#endif
+  EXPECT_EQ(mp3.current_volume, mp3.getVolume());
+
+  // DfPlayer lost the volume --> sent again after the verification
+  mp3.current_volume = 0;
+  current_time += dfPlayerVolumeVerifyTime;
+  execute_cycle();
+  execute_cycle();
+#ifdef DFPLAYER_CMD_QUEUE
+  execute_cycle();
+#endif
+  EXPECT_EQ(mp3.current_volume, mp3.getVolume());
+}
+#endif // DFPLAYER_VOLUME_SYNC
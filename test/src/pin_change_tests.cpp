@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <Arduino.h>
+
+#include <pin_change.hpp>
+
+#ifdef PIN_CHANGE_IRQ
+
+namespace {
+constexpr uint8_t testPin      = 30;
+constexpr uint8_t testDebounce = 20;
+
+uint8_t edges{};
+bool    lastHigh{};
+void onChange(bool high) { ++edges; lastHigh = high; }
+}
+
+// the subscribers are static, so one test (the Tonuino singleton subscribes the busy pin, the buttons and the jack)
+TEST(pin_change_test, edges_and_debounce) {
+  pin_value[testPin] = LOW;
+  ASSERT_TRUE(PinChange::subscribe(testPin, testDebounce, onChange));
+
+  PinChange::loop();
+  EXPECT_EQ(edges, 0);
+
+  current_time += 100;
+  pin_value[testPin] = HIGH;
+  PinChange::isr();
+  EXPECT_EQ(edges, 1);
+  EXPECT_TRUE(lastHigh);
+
+  // bouncing within the debounce time
+  current_time += 1;
+  pin_value[testPin] = LOW;
+  PinChange::isr();
+  current_time += 1;
+  pin_value[testPin] = HIGH;
+  PinChange::isr();
+  EXPECT_EQ(edges, 1);
+
+  // the last bounce is in the debounce time, loop() reports the level after it
+  current_time += 1;
+  pin_value[testPin] = LOW;
+  PinChange::isr();
+  EXPECT_EQ(edges, 1);
+  current_time += testDebounce;
+  PinChange::loop();
+  EXPECT_EQ(edges, 2);
+  EXPECT_FALSE(lastHigh);
+
+  current_time += 100;
+  PinChange::loop();
+  EXPECT_EQ(edges, 2);
+
+  // full
+  while (PinChange::subscribe(testPin, 0, onChange))
+    ;
+  EXPECT_FALSE(PinChange::subscribe(testPin, 0, onChange));
+}
+
+#endif // PIN_CHANGE_IRQ
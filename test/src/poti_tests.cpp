@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <poti.hpp>
+
+#ifdef POTI_FILTER
+
+TEST(poti_filter_test, first_sample_sets_the_step) {
+  PotiFilter filter;
+  EXPECT_EQ(filter.update(0           , 5, 25),  5);
+  PotiFilter filter2;
+  EXPECT_EQ(filter2.update(potiMaxLevel, 5, 25), 25);
+  PotiFilter filter3;
+  EXPECT_EQ(filter3.update(potiMaxLevel/2, 0, 30), 15);
+}
+
+TEST(poti_filter_test, noise_at_a_boundary_does_not_toggle) {
+  PotiFilter filter;
+  // boundary between step 14 and 15 for [0, 30]
+  const int16_t boundary = 15 * (potiMaxLevel+1) / 31;
+  const uint8_t first = filter.update(boundary, 0, 30);
+  for (uint16_t i = 0; i < 1000; ++i) {
+    const int16_t noise = (i%2 == 0) ? potiHysteresis-1 : -(potiHysteresis-1);
+    EXPECT_EQ(filter.update(boundary + noise, 0, 30), first) << "sample " << i;
+  }
+}
+
+TEST(poti_filter_test, follows_a_turn_monotonic) {
+  PotiFilter filter;
+  uint8_t last = filter.update(0, 0, 30);
+  EXPECT_EQ(last, 0);
+  for (int16_t raw = 0; raw <= potiMaxLevel; raw += 2) {
+    const uint8_t v = filter.update(raw, 0, 30);
+    EXPECT_GE(v, last);
+    EXPECT_LE(v, last+1);
+    last = v;
+  }
+  for (uint8_t i = 0; i < 100; ++i)
+    last = filter.update(potiMaxLevel, 0, 30);
+  EXPECT_EQ(last, 30);
+}
+
+TEST(poti_filter_test, spike_is_averaged) {
+  PotiFilter filter;
+  EXPECT_EQ(filter.update(potiMaxLevel/2, 0, 30), 15);
+  // one sample at the end of the range moves the average by 1/2^potiFilterShift only
+  EXPECT_LE(filter.update(potiMaxLevel, 0, 30), 15 + (31 >> potiFilterShift) + 1);
+}
+
+#endif // POTI_FILTER
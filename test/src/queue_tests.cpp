@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <Arduino.h>
+#include <queue.hpp>
+#include <event_queue.hpp>
+
+#include <vector>
+
+TEST(queue_test, push_get) {
+  queue<uint8_t, 5> q;
+  EXPECT_EQ(q.size(), 0);
+  for (uint8_t i = 1; i <= 6; ++i)
+    q.push(i);
+  EXPECT_EQ(q.size(), 5);
+  for (uint8_t i = 0; i < 5; ++i)
+    EXPECT_EQ(q.get(i), i+1);
+  q.clear();
+  EXPECT_EQ(q.size(), 0);
+}
+
+TEST(queue_test, shuffle_is_unbiased) {
+  // the swap with any index would give 4/27 or 5/27 for the 6 orders, Fisher-Yates 1/6 each
+  randomSeed(4711);
+  std::vector<unsigned> count(6);
+  constexpr unsigned runs = 60000;
+  for (unsigned r = 0; r < runs; ++r) {
+    queue<uint8_t, 3> q;
+    for (uint8_t i = 0; i < 3; ++i)
+      q.push(i);
+    q.shuffle();
+    const uint8_t order = q.get(0)*2 + (q.get(1) > q.get(2) ? 1 : 0);
+    ++count[order];
+  }
+  for (unsigned c: count) {
+    EXPECT_GT(c, runs/6 - 500);
+    EXPECT_LT(c, runs/6 + 500);
+  }
+}
+
+TEST(permutation_queue_test, push_get) {
+  permutation_queue<255> q;
+  EXPECT_EQ(q.size(), 0);
+  for (uint8_t i = 3; i <= 12; ++i)
+    q.push(i);
+  EXPECT_EQ(q.size(), 10);
+  for (uint8_t i = 0; i < 10; ++i)
+    EXPECT_EQ(q.get(i), i+3);
+
+  // only contiguous values
+  q.push(20);
+  EXPECT_EQ(q.size(), 10);
+
+  q.clear();
+  EXPECT_EQ(q.size(), 0);
+}
+
+TEST(permutation_queue_test, max_size) {
+  permutation_queue<255> q;
+  for (uint16_t i = 1; i <= 0xff; ++i)
+    q.push(i);
+  EXPECT_EQ(q.size(), 255);
+  EXPECT_EQ(q.get(254), 255);
+}
+
+TEST(permutation_queue_test, shuffle_is_permutation) {
+  for (uint16_t size = 1; size <= 255; ++size) {
+    for (uint8_t run = 0; run < 4; ++run) {
+      permutation_queue<255> q;
+      for (uint16_t i = 1; i <= size; ++i)
+        q.push(i);
+      q.shuffle();
+      bool seen[256] = {};
+      for (uint16_t pos = 0; pos < size; ++pos) {
+        const uint8_t t = q.get(pos);
+        ASSERT_GE(t, 1);
+        ASSERT_LE(t, size);
+        ASSERT_FALSE(seen[t]) << "size " << size << " pos " << pos;
+        seen[t] = true;
+        ASSERT_EQ(t, q.get(pos)); // stable
+      }
+    }
+  }
+}
+
+TEST(permutation_queue_test, shuffle_changes_order) {
+  permutation_queue<255> q;
+  for (uint8_t i = 1; i <= 50; ++i)
+    q.push(i);
+  uint8_t unchanged = 0;
+  q.shuffle();
+  for (uint8_t pos = 0; pos < 50; ++pos)
+    if (q.get(pos) == pos+1)
+      ++unchanged;
+  EXPECT_LT(unchanged, 10);
+}
+
+TEST(permutation_queue_test, shuffle_is_permutation_16bit) {
+  for (uint16_t size: { 256, 300, 1000, 3000 }) {
+    permutation_queue<3000, uint16_t> q;
+    for (uint16_t i = 1; i <= size; ++i)
+      q.push(i);
+    EXPECT_EQ(q.size(), size);
+    q.shuffle();
+    std::vector<bool> seen(size+1);
+    for (uint16_t pos = 0; pos < size; ++pos) {
+      const uint16_t t = q.get(pos);
+      ASSERT_GE(t, 1);
+      ASSERT_LE(t, size);
+      ASSERT_FALSE(seen[t]) << "size " << size << " pos " << pos;
+      seen[t] = true;
+    }
+  }
+}
+
+TEST(event_queue_test, priority_then_fifo) {
+  using eq = event_queue<4>;
+  eq q;
+  eq::event e;
+  q.push(eq::p_command, 1);
+  q.push(eq::p_command, 2);
+  q.push(eq::p_card   , 3);
+  EXPECT_EQ(q.size(), 3);
+  ASSERT_TRUE(q.pop(e)); EXPECT_EQ(e.value, 3); EXPECT_EQ(e.prio, eq::p_card);
+  ASSERT_TRUE(q.pop(e)); EXPECT_EQ(e.value, 1); EXPECT_EQ(e.prio, eq::p_command);
+  ASSERT_TRUE(q.pop(e)); EXPECT_EQ(e.value, 2);
+  EXPECT_FALSE(q.pop(e));
+}
+
+TEST(event_queue_test, full) {
+  using eq = event_queue<2>;
+  eq q;
+  eq::event e;
+  EXPECT_TRUE (q.push(eq::p_command, 1));
+  EXPECT_TRUE (q.push(eq::p_card   , 2));
+  EXPECT_FALSE(q.push(eq::p_card   , 3));
+  EXPECT_EQ(q.size(), 2);
+  ASSERT_TRUE(q.pop(e)); EXPECT_EQ(e.value, 2);
+  ASSERT_TRUE(q.pop(e)); EXPECT_EQ(e.value, 1);
+  EXPECT_FALSE(q.pop(e));
+}
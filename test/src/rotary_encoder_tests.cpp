@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <rotary_encoder.hpp>
+#include <settings.hpp>
+
+#ifdef ROTARY_ENCODER_QUADRATURE
+
+class rotary_encoder_test_fixture: public ::testing::Test {
+public:
+  rotary_encoder_test_fixture()
+  : initializer{}
+  , settings{}
+  , encoder{settings}
+  {
+    settings.invertVolumeButtons = 1;
+  }
+
+  struct Initializer {
+    Initializer() {
+      pin_value[rotaryEncoderClkPin] = HIGH;
+      pin_value[rotaryEncoderDtPin ] = HIGH;
+    }
+  };
+
+  void set(uint8_t clk, uint8_t dt) {
+    pin_value[rotaryEncoderClkPin] = clk;
+    pin_value[rotaryEncoderDtPin ] = dt;
+    RotaryEncoder::update();
+  }
+  // one full Gray code cycle per click, clockwise: 11 01 00 10 11
+  void turn(int8_t clicks) {
+    for (; clicks > 0; --clicks) { set(0, 1); set(0, 0); set(1, 0); set(1, 1); }
+    for (; clicks < 0; ++clicks) { set(1, 0); set(0, 0); set(0, 1); set(1, 1); }
+  }
+  commandRaw execute_cycle(unsigned long t = cycleTime) {
+    current_time += t;
+    return encoder.getCommandRaw();
+  }
+
+  Initializer   initializer;
+  Settings      settings;
+  RotaryEncoder encoder;
+};
+
+TEST_F(rotary_encoder_test_fixture, one_click_one_step) {
+  execute_cycle(1000);
+  EXPECT_EQ(execute_cycle(), commandRaw::none);
+
+  turn(1);
+  EXPECT_EQ(execute_cycle(1000), commandRaw::up);
+  EXPECT_EQ(execute_cycle(), commandRaw::none);
+
+  turn(-1);
+  EXPECT_EQ(execute_cycle(1000), commandRaw::down);
+  EXPECT_EQ(execute_cycle(), commandRaw::none);
+}
+
+TEST_F(rotary_encoder_test_fixture, bounce_and_half_clicks_are_no_step) {
+  execute_cycle(1000);
+
+  // contact bounce on one channel
+  for (uint8_t i = 0; i < 5; ++i) { set(0, 1); set(1, 1); }
+  EXPECT_EQ(execute_cycle(1000), commandRaw::none);
+
+  // half a click forward and back
+  set(0, 1); set(0, 0); set(0, 1); set(1, 1);
+  EXPECT_EQ(execute_cycle(1000), commandRaw::none);
+}
+
+TEST_F(rotary_encoder_test_fixture, fast_turn_within_one_cycle_is_not_lost) {
+  execute_cycle(1000);
+
+  // all transitions of 3 clicks before the next cycle
+  turn(3);
+  uint8_t steps = 0;
+  while (execute_cycle(1000) == commandRaw::up)
+    ++steps;
+  EXPECT_EQ(steps, 3);
+}
+
+TEST_F(rotary_encoder_test_fixture, fast_clicks_are_accelerated) {
+  execute_cycle(1000);
+
+  turn(1);
+  EXPECT_EQ(execute_cycle(1000), commandRaw::up);
+
+  // the next click within rotaryEncoderAccelTime
+  turn(1);
+  uint8_t steps = 0;
+  while (execute_cycle(rotaryEncoderAccelTime/2) == commandRaw::up)
+    ++steps;
+  EXPECT_EQ(steps, rotaryEncoderAccelFactor);
+
+  // turning back stops the pending steps
+  turn(1);
+  turn(-2);
+  EXPECT_EQ(execute_cycle(1000), commandRaw::down);
+  EXPECT_EQ(execute_cycle(1000), commandRaw::none);
+}
+
+#endif // ROTARY_ENCODER_QUADRATURE
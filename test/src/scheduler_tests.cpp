@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <scheduler.hpp>
+
+struct task_counter {
+  void fast() { ++fast_count; }
+  void slow() { ++slow_count; }
+
+  int fast_count{};
+  int slow_count{};
+};
+
+const SchedulerTask<task_counter> tasks[] = {
+  { &task_counter::fast, 10 },
+  { &task_counter::slow, 50 },
+};
+
+class scheduler_test_fixture: public ::testing::Test {
+public:
+  Scheduler<2> scheduler{};
+  task_counter counter{};
+};
+
+TEST_F(scheduler_test_fixture, loop_takes_time_slice) {
+  const unsigned long start = current_time;
+  scheduler.loop(counter, tasks, 50);
+  EXPECT_EQ(current_time - start, 50u);
+  scheduler.loop(counter, tasks, 50);
+  EXPECT_EQ(current_time - start, 100u);
+}
+
+TEST_F(scheduler_test_fixture, tasks_with_own_period) {
+  for (int i = 0; i < 10; ++i)
+    scheduler.loop(counter, tasks, 50);
+  EXPECT_EQ(counter.fast_count, 50);
+  EXPECT_EQ(counter.slow_count, 10);
+}
+
+TEST_F(scheduler_test_fixture, late_task_is_not_repeated) {
+  scheduler.loop(counter, tasks, 50);
+  delay(200);
+  scheduler.loop(counter, tasks, 50);
+  EXPECT_EQ(counter.fast_count, 5+5);
+  EXPECT_EQ(counter.slow_count, 1+1);
+}
+
+#ifdef TICK_SCHEDULER
+#include "tonuino_fixture.hpp"
+
+class tick_scheduler_test_fixture: public tonuino_fixture {};
+
+TEST_F(tick_scheduler_test_fixture, full_loop_cycle) {
+  goto_play({ 1, pmode_t::album, 0, 0 }, 5);
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+
+  // one loop takes cycleTime, the DfPlayer task runs every tickTimeMp3 in it,
+  // so the next track already plays at the end of the cycle
+  const unsigned long start = current_time;
+  getMp3().end_track();
+  execute_cycle();
+  EXPECT_EQ(current_time - start, cycleTime);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder_track, 2);
+
+  // button pause --> pause within the cycle
+  button_for_command(command::pause, state_for_command::play);
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<Pause>());
+  EXPECT_TRUE(getMp3().is_pause());
+}
+#endif // TICK_SCHEDULER
@@ -3,6 +3,7 @@
 
 #include <settings.hpp>
 #include <chip_card.hpp>
+#include <eeprom_kv_store.hpp>
 
 class settings_test_fixture: public ::testing::Test {
 public:
@@ -132,6 +133,51 @@ TEST_F(settings_test_fixture, reset_settings_works) {
   EXPECT_EQ(settings, default_settings);
 }
 
+TEST_F(settings_test_fixture, write_settings_only_changed_bytes) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+  settings.writeSettingsToFlash();
+
+  const uint32_t writes = EEPROM.writes;
+  settings.writeSettingsToFlash();
+  EXPECT_EQ(EEPROM.writes, writes);
+
+  settings.spkMaxVolume = 20;
+  settings.writeSettingsToFlash();
+#ifdef SETTINGS_CRC
+  EXPECT_EQ(EEPROM.writes, writes+2);
+#else
+  EXPECT_EQ(EEPROM.writes, writes+1);
+#endif
+  Settings r_settings;
+  r_settings.loadSettingsFromFlash();
+  EXPECT_EQ(r_settings, settings);
+}
+
+#ifdef SETTINGS_CRC
+TEST_F(settings_test_fixture, settings_crc_former_format_is_kept) {
+  init_brand_new();
+  init_with_settings(other_settings);
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings, other_settings);
+  EXPECT_NE(EEPROM.eeprom_mem[startAddressAdminSettings + offsetof(Settings, dummy)], 0);
+
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings, other_settings);
+}
+
+TEST_F(settings_test_fixture, settings_crc_detects_corruption) {
+  init_brand_new();
+  init_with_settings(other_settings);
+  settings.loadSettingsFromFlash();
+
+  EEPROM.eeprom_mem[startAddressAdminSettings + offsetof(Settings, spkMaxVolume)] = 30;
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings, default_settings);
+}
+#endif // SETTINGS_CRC
+
 TEST_F(settings_test_fixture, read_write_folderSettings_works) {
   init_brand_new();
 
@@ -161,3 +207,463 @@ TEST_F(settings_test_fixture, read_folderSettings_returns_0_if_folder_bigger_tha
     EXPECT_EQ(r_track, 0);
   }
 }
+
+#ifdef EEPROM_JOURNAL
+TEST_F(settings_test_fixture, lazy_write_folderSettings) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+
+  settings.writeFolderSettingToFlash(5, 12);
+  EXPECT_EQ(settings.readFolderSettingFromFlash(5), 12);
+  for (int i = 0; i < EEPROM.max_len; ++i) {
+#ifdef PACKED_SHORTCUTS
+    // converted at startup
+    if (i == 151 || (i >= 156 && i < 256))
+      continue;
+#endif
+#ifdef KEYMAP
+    // format written at startup
+    if (i >= 1024 - keymapEntries * 3 - 1 && i < 1024)
+      continue;
+#endif
+#ifdef MEMORY_UID_MATCH
+    // format written at startup, before the keymap
+#ifdef KEYMAP
+    const int endMemoryUids = 1024 - keymapEntries * 3 - 1;
+#else
+    const int endMemoryUids = 1024;
+#endif
+    if (i >= endMemoryUids - memoryUidEntries * 5 - 1 && i < endMemoryUids)
+      continue;
+#endif
+    if (i < startAddressAdminSettings || i >= startAddressAdminSettings + static_cast<int>(sizeof(Settings))) {
+      EXPECT_EQ(EEPROM.eeprom_mem[i], 0xff);
+    }
+  }
+
+  settings.flushToFlash();
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(5), 12);
+}
+
+TEST_F(settings_test_fixture, lazy_write_flushes_other_folder) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+
+  settings.writeFolderSettingToFlash(5, 12);
+  settings.writeFolderSettingToFlash(6, 13);
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(5), 12);
+  EXPECT_EQ(settings.readFolderSettingFromFlash(6), 13);
+  settings.flushToFlash();
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(6), 13);
+}
+
+TEST_F(settings_test_fixture, lazy_write_last_card) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+
+  const folderSettings card{ 7, pmode_t::hoerbuch, 0, 0 };
+  folderSettings r_card{};
+  settings.writeExtShortCutToFlash(lastSortCut, card);
+  settings.readExtShortCutFromFlash(lastSortCut, r_card);
+  EXPECT_EQ(r_card, card);
+
+  settings.flushToFlash();
+  settings.loadSettingsFromFlash();
+  r_card = {};
+  settings.readExtShortCutFromFlash(lastSortCut, r_card);
+  EXPECT_EQ(r_card, card);
+}
+
+#ifdef TonUINO_Classic
+TEST_F(settings_test_fixture, journal_survives_wrap) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+
+  settings.writeFolderSettingToFlash(1, 7);
+  settings.flushToFlash();
+  const folderSettings card{ 3, pmode_t::album, 0, 0 };
+  settings.writeExtShortCutToFlash(lastSortCut, card);
+  settings.flushToFlash();
+
+  for (uint16_t i = 0; i < 1000; ++i) {
+    settings.writeFolderSettingToFlash(2, i % 256);
+    settings.flushToFlash();
+  }
+#ifndef FOLDER_PROGRESS_KV
+  // the first records are compacted to their home location
+  EXPECT_EQ(EEPROM.eeprom_mem[1], 7);
+#endif
+
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(1), 7);
+  EXPECT_EQ(settings.readFolderSettingFromFlash(2), 999 % 256);
+  folderSettings r_card{};
+  settings.readExtShortCutFromFlash(lastSortCut, r_card);
+  EXPECT_EQ(r_card, card);
+#ifndef FOLDER_PROGRESS_KV
+  // the hot folder is not written to its home location
+  EXPECT_EQ(EEPROM.eeprom_mem[2], 0xff);
+#endif
+}
+
+TEST_F(settings_test_fixture, journal_interrupted_write) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+
+  for (uint8_t i = 1; i <= 10; ++i) {
+    settings.writeFolderSettingToFlash(4, i);
+    settings.flushToFlash();
+  }
+  // power loss while writing the 10th record: seq not yet written
+  const int journalStart = 456;
+  EEPROM.eeprom_mem[journalStart + 9*6] = 0xff;
+
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(4), 9);
+
+  settings.writeFolderSettingToFlash(4, 20);
+  settings.flushToFlash();
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(4), 20);
+}
+
+TEST_F(settings_test_fixture, journal_cleared_with_eeprom) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+
+  settings.writeFolderSettingToFlash(8, 33);
+  settings.flushToFlash();
+  settings.clearEEPROM();
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(8), 0);
+}
+
+#ifdef RESUME_SNAPSHOT
+TEST_F(settings_test_fixture, snapshot_survives_wrap_and_clear) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  settings.loadSettingsFromFlash();
+
+  const Settings::snapshot_t snapshot{ 3, pmode_t::party, 12, 0, 17, 0xbeef };
+  Settings::snapshot_t r_snapshot{};
+  settings.writeSnapshotToFlash(snapshot);
+  settings.readSnapshotFromFlash(r_snapshot);
+  EXPECT_EQ(memcmp(&r_snapshot, &snapshot, sizeof(snapshot)), 0);
+
+  settings.flushToFlash();
+  settings.loadSettingsFromFlash();
+  r_snapshot = {};
+  settings.readSnapshotFromFlash(r_snapshot);
+  EXPECT_EQ(memcmp(&r_snapshot, &snapshot, sizeof(snapshot)), 0);
+
+  // the snapshot records are compacted to the home location
+  for (uint16_t i = 0; i < 1000; ++i) {
+    settings.writeFolderSettingToFlash(2, i % 256);
+    settings.flushToFlash();
+  }
+  settings.loadSettingsFromFlash();
+  r_snapshot = {};
+  settings.readSnapshotFromFlash(r_snapshot);
+  EXPECT_EQ(memcmp(&r_snapshot, &snapshot, sizeof(snapshot)), 0);
+
+  settings.clearEEPROM();
+  settings.loadSettingsFromFlash();
+  settings.readSnapshotFromFlash(r_snapshot);
+  EXPECT_EQ(r_snapshot.folder, 0);
+}
+#endif // RESUME_SNAPSHOT
+#endif // TonUINO_Classic
+#endif // EEPROM_JOURNAL
+
+#ifdef FOLDER_PROGRESS_KV
+TEST_F(settings_test_fixture, kv_folder_progress_16_bit_and_collisions) {
+  init_brand_new();
+  const uint8_t other = 5 + folderProgressSlots; // same home slot
+
+  settings.writeFolderSettingToFlash(5    , 1234);
+  settings.writeFolderSettingToFlash(other,  777);
+  settings.flushToFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(5    ), 1234);
+  EXPECT_EQ(settings.readFolderSettingFromFlash(other),  777);
+  EXPECT_EQ(settings.readFolderSettingFromFlash(6    ),    0);
+
+  // only the used slots are written
+  int used = 0;
+  for (int i = 0; i < folderProgressSlots*EepromKvStore::slotSize; i += EepromKvStore::slotSize)
+    if (EEPROM.eeprom_mem[i] != EepromKvStore::emptyKey)
+      ++used;
+  EXPECT_EQ(used, 2);
+}
+
+TEST_F(settings_test_fixture, kv_corrupted_slot_is_ignored) {
+  init_brand_new();
+  settings.writeFolderSettingToFlash(3, 42);
+  settings.writeFolderSettingToFlash(3+folderProgressSlots, 43);
+  settings.flushToFlash();
+
+  // the slot of folder 3 is broken, the next slot in the chain is still found
+  EEPROM.eeprom_mem[3*EepromKvStore::slotSize + 1] ^= 0x01;
+  EXPECT_EQ(settings.readFolderSettingFromFlash(3), 0);
+  EXPECT_EQ(settings.readFolderSettingFromFlash(3+folderProgressSlots), 43);
+
+  settings.writeFolderSettingToFlash(3, 44);
+  settings.flushToFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(3), 44);
+  EXPECT_EQ(settings.readFolderSettingFromFlash(3+folderProgressSlots), 43);
+}
+
+TEST_F(settings_test_fixture, kv_full_store_overwrites) {
+  init_brand_new();
+  for (uint8_t folder = 1; folder <= folderProgressSlots; ++folder) {
+    settings.writeFolderSettingToFlash(folder, 300+folder);
+    settings.flushToFlash();
+  }
+  for (uint8_t folder = 1; folder <= folderProgressSlots; ++folder)
+    EXPECT_EQ(settings.readFolderSettingFromFlash(folder), 300+folder);
+
+  settings.writeFolderSettingToFlash(90, 500);
+  settings.flushToFlash();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(90), 500);
+  // the folder in the home slot is lost
+  EXPECT_EQ(settings.readFolderSettingFromFlash(90 % folderProgressSlots), 0);
+}
+
+TEST_F(settings_test_fixture, kv_cleared_with_eeprom) {
+  init_brand_new();
+  settings.writeFolderSettingToFlash(8, 333);
+  settings.flushToFlash();
+  settings.clearEEPROM();
+  EXPECT_EQ(settings.readFolderSettingFromFlash(8), 0);
+}
+#endif // FOLDER_PROGRESS_KV
+
+#ifdef PACKED_SHORTCUTS
+namespace {
+bool same(const folderSettings& lhs, const folderSettings& rhs) {
+  return lhs.folder == rhs.folder && lhs.mode == rhs.mode && lhs.special == rhs.special && lhs.special2 == rhs.special2;
+}
+const folderSettings packedCards[] = {
+  {  1, pmode_t::album        ,   0,   0 },
+  {  2, pmode_t::einzel       ,  17,   0 },
+  {  3, pmode_t::album_vb     ,   4,  12 },
+  {  0, pmode_t::sleep_timer  ,  10,   0 },
+  {  0, pmode_t::admin_card   ,   0,   0 },
+};
+constexpr uint8_t packedCardCount = sizeof(packedCards)/sizeof(packedCards[0]);
+}
+
+// the shortcuts of the former layout
+constexpr uint8_t rawShortcuts = 25;
+bool isStored(uint8_t i) { return i < rawShortcuts-1 || i == lastSortCut; }
+
+TEST_F(settings_test_fixture, packed_shortcuts_length_change_keeps_others) {
+  init_brand_new();
+  settings.loadSettingsFromFlash();
+
+  for (uint8_t i = 0; i <= lastSortCut; ++i)
+    if (isStored(i)) {
+      EXPECT_TRUE(settings.writeExtShortCutToFlash(i, packedCards[i % packedCardCount]));
+    }
+#ifdef EEPROM_JOURNAL
+  settings.flushToFlash();
+#endif
+
+  // 4 byte --> 2 byte --> 4 byte in the middle
+  settings.writeExtShortCutToFlash(7, { 9, pmode_t::party, 0, 0 });
+  folderSettings r_card{};
+  settings.readExtShortCutFromFlash(7, r_card);
+  EXPECT_TRUE(same(r_card, { 9, pmode_t::party, 0, 0 }));
+  settings.writeExtShortCutToFlash(7, { 8, pmode_t::party_vb, 1, 200 });
+
+  settings.loadSettingsFromFlash();
+  for (uint8_t i = 0; i <= lastSortCut; ++i) {
+    settings.readExtShortCutFromFlash(i, r_card);
+    if (i == 7) {
+      EXPECT_TRUE(same(r_card, { 8, pmode_t::party_vb, 1, 200 }));
+    }
+    else if (isStored(i)) {
+      EXPECT_TRUE(same(r_card, packedCards[i % packedCardCount])) << "shortcut " << static_cast<int>(i);
+    }
+    else {
+      EXPECT_TRUE(same(r_card, { 0, pmode_t::none, 0, 0 })) << "shortcut " << static_cast<int>(i);
+    }
+  }
+}
+
+TEST_F(settings_test_fixture, packed_shortcuts_converted_from_former_layout) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  const int startAddressExtraShortcuts = 156;
+  for (uint8_t i = 0; i < rawShortcuts; ++i)
+    memcpy(&EEPROM.eeprom_mem[startAddressExtraShortcuts + i * sizeof(folderSettings)], &packedCards[i % packedCardCount], sizeof(folderSettings));
+
+  settings.loadSettingsFromFlash();
+  folderSettings r_card{};
+  for (uint8_t i = 0; i <= lastSortCut; ++i) {
+    settings.readExtShortCutFromFlash(i, r_card);
+    if (i < rawShortcuts-1) {
+      EXPECT_TRUE(same(r_card, packedCards[i % packedCardCount])) << "shortcut " << static_cast<int>(i);
+    }
+    else if (i == lastSortCut) { // the former last card
+      EXPECT_TRUE(same(r_card, packedCards[(rawShortcuts-1) % packedCardCount]));
+    }
+    else {
+      EXPECT_TRUE(same(r_card, { 0, pmode_t::none, 0, 0 })) << "shortcut " << static_cast<int>(i);
+    }
+  }
+
+  // converted only once
+  settings.writeExtShortCutToFlash(0, { 5, pmode_t::hoerspiel, 0, 0 });
+  settings.loadSettingsFromFlash();
+  settings.readExtShortCutFromFlash(0, r_card);
+  EXPECT_TRUE(same(r_card, { 5, pmode_t::hoerspiel, 0, 0 }));
+
+  // last card and 4 cards: 2+2+3+4+3 byte instead of 20 byte
+  uint16_t used = 0;
+  for (uint8_t i = 0; i < packedCardCount; ++i)
+    used += 2 + ((EEPROM.eeprom_mem[startAddressExtraShortcuts + used] >> 4) & 0x03);
+  EXPECT_EQ(used, 14);
+}
+
+TEST_F(settings_test_fixture, packed_shortcuts_all_and_no_space) {
+  init_brand_new();
+  settings.loadSettingsFromFlash();
+
+  // only one shortcut: the empty ones before take 2 byte each
+  EXPECT_TRUE(settings.writeExtShortCutToFlash(40, { 3, pmode_t::album_vb, 4, 12 }));
+  folderSettings r_card{};
+  settings.readExtShortCutFromFlash(40, r_card);
+  EXPECT_TRUE(same(r_card, { 3, pmode_t::album_vb, 4, 12 }));
+  settings.readExtShortCutFromFlash(39, r_card);
+  EXPECT_TRUE(same(r_card, { 0, pmode_t::none, 0, 0 }));
+
+  // 50 shortcuts with 2 byte
+  for (uint8_t i = 0; i <= lastSortCut; ++i)
+    EXPECT_TRUE(settings.writeExtShortCutToFlash(i, { static_cast<uint8_t>(i+1), pmode_t::album, 0, 0 }));
+#ifdef EEPROM_JOURNAL
+  settings.flushToFlash();
+#endif
+  EXPECT_EQ(lastSortCut, 49);
+
+  // no space for a longer one, all are kept
+  EXPECT_FALSE(settings.writeExtShortCutToFlash(10, { 2, pmode_t::einzel, 17, 0 }));
+  settings.loadSettingsFromFlash();
+  for (uint8_t i = 0; i <= lastSortCut; ++i) {
+    settings.readExtShortCutFromFlash(i, r_card);
+    EXPECT_TRUE(same(r_card, { static_cast<uint8_t>(i+1), pmode_t::album, 0, 0 })) << "shortcut " << static_cast<int>(i);
+  }
+}
+
+TEST_F(settings_test_fixture, packed_shortcuts_cleared_after_power_fail_while_moved) {
+  init_brand_new();
+  settings.loadSettingsFromFlash();
+  for (uint8_t i = 0; i < packedCardCount; ++i)
+    settings.writeExtShortCutToFlash(i, packedCards[i]);
+
+  // power fail while the shortcuts are moved
+  const int addressShortcutFormat = 151;
+  EEPROM.eeprom_mem[addressShortcutFormat] = 0x5d;
+  settings.loadSettingsFromFlash();
+  folderSettings r_card{};
+  for (uint8_t i = 0; i <= lastSortCut; ++i) {
+    settings.readExtShortCutFromFlash(i, r_card);
+    EXPECT_TRUE(same(r_card, { 0, pmode_t::none, 0, 0 })) << "shortcut " << static_cast<int>(i);
+  }
+
+  EXPECT_TRUE(settings.writeExtShortCutToFlash(2, packedCards[2]));
+  settings.loadSettingsFromFlash();
+  settings.readExtShortCutFromFlash(2, r_card);
+  EXPECT_TRUE(same(r_card, packedCards[2]));
+}
+#endif // PACKED_SHORTCUTS
+
+#ifdef KEYMAP
+TEST_F(settings_test_fixture, keymap_cleared_without_format) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  // data of a firmware without KEYMAP
+  Settings::writeKeymapEntryToFlash(0, { 1, 0, 2 });
+  settings.loadSettingsFromFlash();
+  Settings::keymap_entry_t entry;
+  Settings::readKeymapEntryFromFlash(0, entry);
+  EXPECT_EQ(entry.raw, 0);
+
+  Settings::writeKeymapEntryToFlash(0, { 1, 0, 2 });
+  settings.loadSettingsFromFlash();
+  Settings::readKeymapEntryFromFlash(0, entry);
+  EXPECT_EQ(entry.raw  , 1);
+  EXPECT_EQ(entry.state, 0);
+  EXPECT_EQ(entry.cmd  , 2);
+}
+#endif // KEYMAP
+
+#ifdef MEMORY_UID_MATCH
+TEST_F(settings_test_fixture, memory_uids_stored_removed_and_full) {
+  init_brand_new();
+  for (uint8_t i = 0; i < memoryUidEntries; ++i)
+    Settings::writeMemoryUidToFlash(0x1000+i, i+1);
+  for (uint8_t i = 0; i < memoryUidEntries; ++i)
+    EXPECT_EQ(Settings::readMemoryUidFromFlash(0x1000+i), i+1);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x2000), 0);
+
+  // a card with other content is removed, a new card takes the free entry
+  Settings::writeMemoryUidToFlash(0x1001, 0);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x1001), 0);
+  Settings::writeMemoryUidToFlash(0x2000, 7);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x2000), 7);
+
+  // full: the card in the entry of the hash is lost
+  Settings::writeMemoryUidToFlash(0x3000, 9);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x3000), 9);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x1000 + 0x3000 % memoryUidEntries), 0);
+
+  settings.clearEEPROM();
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x3000), 0);
+}
+
+TEST_F(settings_test_fixture, memory_uids_keep_4_byte) {
+  init_brand_new();
+  Settings::clearMemoryUidsInFlash();
+  // the same low 2 byte
+  Settings::writeMemoryUidToFlash(0x11223344, 3);
+  Settings::writeMemoryUidToFlash(0x55663344, 4);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x11223344), 3);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x55663344), 4);
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x00003344), 0);
+}
+
+TEST_F(settings_test_fixture, memory_uids_cleared_without_format) {
+  init_brand_new();
+  init_with_settings(default_settings);
+  // data of a firmware without MEMORY_UID_MATCH or with the 2 byte hash
+  Settings::writeMemoryUidToFlash(0x1000, 5);
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x1000), 0);
+
+  Settings::writeMemoryUidToFlash(0x1000, 5);
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(Settings::readMemoryUidFromFlash(0x1000), 5);
+}
+#endif // MEMORY_UID_MATCH
+
+#ifdef FAST_BOOT
+TEST_F(settings_test_fixture, boot_count_is_persisted) {
+  init_brand_new();
+  const uint32_t first = settings.incrementBootCount();
+  EXPECT_EQ(settings.incrementBootCount(), first+1);
+
+  // not touched by the settings
+  settings.resetSettings();
+  settings.loadSettingsFromFlash();
+  EXPECT_EQ(settings.incrementBootCount(), first+2);
+}
+#endif // FAST_BOOT
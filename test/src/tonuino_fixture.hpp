@@ -33,7 +33,7 @@ public:
   Settings&  getSettings() { return tonuino.getSettings(); }
   Chip_card& getChipCard() { return tonuino.getChipCard(); }
   MFRC522&   getMFRC522 () { return getChipCard().mfrc522; }
-  Modifier&  getModifier() { return tonuino.getActiveModifier(); }
+  Modifiers& getModifier() { return tonuino.getActiveModifier(); }
 
   uint8_t    getVolume  () { return *getMp3().volume; }
 
@@ -393,6 +393,11 @@ public:
     getMp3().set_folder_track_count(folder, track_count);
     getMFRC522().card_in(cookie, version, folder, mode, special, special2);
     execute_cycle();
+#ifdef ADAPTIVE_CARD_POLL
+    // after a long time without activity the reader is polled only every cardPollSlowTime
+    for (unsigned long t = cycleTime; t < cardPollSlowTime && getChipCard().isCardRemoved(); t += cycleTime)
+      execute_cycle();
+#endif
   }
 
   void card_in(const folderSettings& card, uint16_t track_count = 99) {
@@ -405,6 +410,10 @@ public:
     execute_cycle();
     execute_cycle();
     execute_cycle();
+#ifdef ADAPTIVE_CARD_POLL
+    for (unsigned long t = 3*cycleTime; t < cardPollSlowTime + 3*cycleTime && not getChipCard().isCardRemoved(); t += cycleTime)
+      execute_cycle();
+#endif
   }
   folderSettings card_decode() {
     folderSettings card;
@@ -5,6 +5,16 @@
 #include <state_machine.hpp>
 #include <chip_card.hpp>
 #include <commands.hpp>
+#include <serial_remote.hpp>
+#include <watchdog.hpp>
+#include <energy_monitor.hpp>
+#include <memory_monitor.hpp>
+#include <loop_profiler.hpp>
+#include <telemetry.hpp>
+#include <latency_trace.hpp>
+
+#include <algorithm>
+#include <vector>
 
 #include "tonuino_fixture.hpp"
 
@@ -250,7 +260,527 @@ TEST_F(tonuino_test_fixture, shutdown_in_pause) {
 //  EXPECT_TRUE(false) << "log: " << Print::get_output();
 }
 
+#ifdef LIGHT_SLEEP
+// =================== light sleep (idle, pause)
+TEST_F(tonuino_test_fixture, light_sleep_wake_on_card) {
+
+  goto_idle();
+  getSettings().standbyTimer = 1;
+  tonuino.setStandbyTimer();
+  Print::clear_output();
+
+  pin_value[shutdownPin]            = HIGH;
+  getMp3()    .called_sleep         = false;
+  getMFRC522().called_AntennaOff    = false;
+  getMFRC522().called_SoftPowerDown = false;
+
+  // standby timer expires in the cycle the card is put on
+  current_time += 60 * 1000ul;
+  const unsigned long start = current_time;
+  card_in({ 5, pmode_t::album, 0, 0 });
+
+  EXPECT_TRUE(getMFRC522().called_AntennaOff   );
+  EXPECT_TRUE(getMFRC522().called_SoftPowerDown);
+  EXPECT_TRUE(getMFRC522().called_SoftPowerUp  );
+  EXPECT_FALSE(getMp3().called_sleep);
+  EXPECT_EQ(pin_value[shutdownPin], HIGH);
+  EXPECT_LT(current_time - start, 1000ul);
+  EXPECT_TRUE(SM_tonuino::is_in_state<StartPlay>());
+
+  leave_start_play();
+  card_out();
+  getSettings().standbyTimer = 0;
+  goto_idle();
+//  EXPECT_TRUE(false) << "log: " << Print::get_output();
+}
+
+TEST_F(tonuino_test_fixture, light_sleep_wake_on_button_in_pause) {
+
+  getSettings().standbyTimer = 1;
+  goto_pause({ 2, pmode_t::album, 0, 0 });
+  Print::clear_output();
+
+  pin_value[shutdownPin] = HIGH;
+
+  current_time += 60 * 1000ul;
+  press_button(buttonPausePin);
+  execute_cycle();
+  EXPECT_EQ(pin_value[shutdownPin], HIGH);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Pause>());
+  release_button(buttonPausePin);
+  execute_cycle(); // debounce, the press was read at the end of the sleep
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+
+  getSettings().standbyTimer = 0;
+  goto_idle();
+//  EXPECT_TRUE(false) << "log: " << Print::get_output();
+}
+
+TEST_F(tonuino_test_fixture, light_sleep_card_on_box_does_not_wake) {
+
+  goto_idle();
+  getSettings().standbyTimer = 1;
+  tonuino.setStandbyTimer();
+  Print::clear_output();
+
+  pin_value[shutdownPin]    = HIGH;
+  getMp3().called_sleep     = false;
+
+  // a modifier card stays on the box
+  card_in({ 0, pmode_t::sleep_timer, 0, 0 });
+  tonuino.resetActiveModifier();
+  current_time += 60 * 1000ul;
+  const unsigned long start = current_time;
+  execute_cycle();
+
+  EXPECT_GE(current_time - start, lightSleepTime);
+  EXPECT_TRUE(getMp3().called_sleep);
+  EXPECT_EQ(pin_value[shutdownPin], LOW);
+
+  card_out();
+  pin_value[shutdownPin]     = HIGH;
+  getSettings().standbyTimer = 0;
+//  EXPECT_TRUE(false) << "log: " << Print::get_output();
+}
+#endif // LIGHT_SLEEP
+
+#ifdef RESUME_SNAPSHOT
+// =================== resume snapshot
+TEST_F(tonuino_test_fixture, resume_snapshot_party_after_power_on) {
+
+  goto_play({ 5, pmode_t::party, 0, 0 }, 20);
+  Print::clear_output();
+
+  getMp3().increaseVolume();
+  const uint8_t volume = getVolume();
+  button_for_command(command::next, state_for_command::play);
+  button_for_command(command::next, state_for_command::play);
+  const uint16_t pos   = getMp3().getQueuePos();
+  const uint8_t  track = getMp3().df_folder_track;
+  button_for_command(command::next, state_for_command::play);
+  const uint8_t  next  = getMp3().df_folder_track;
+  button_for_command(command::previous, state_for_command::play);
+  EXPECT_EQ(getMp3().df_folder_track, track);
+
+  // button pause --> pause, snapshot saved
+  button_for_command(command::pause, state_for_command::play);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Pause>());
+
+  // power on again with another random seed
+  tonuino.setup();
+  randomSeed(4711);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+  EXPECT_EQ(getVolume(), volume);
+
+  // button play --> continue with the snapshot
+  button_for_command(command::pause, state_for_command::idle_pause);
+  EXPECT_TRUE(SM_tonuino::is_in_state<StartPlay>());
+  leave_start_play();
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder, 5);
+  EXPECT_EQ(getMp3().df_folder_track, track);
+  EXPECT_EQ(getMp3().getQueuePos(), pos);
+
+  button_for_command(command::next, state_for_command::play);
+  EXPECT_EQ(getMp3().df_folder_track, next);
+
+  goto_idle();
+//  EXPECT_TRUE(false) << "log: " << Print::get_output();
+}
+
+TEST_F(tonuino_test_fixture, resume_snapshot_removed_at_end_of_queue) {
+
+  goto_play({ 6, pmode_t::album, 0, 0 }, 5);
+  button_for_command(command::next, state_for_command::play);
+  button_for_command(command::next, state_for_command::play);
+  EXPECT_EQ(getMp3().df_folder_track, 3);
+  button_for_command(command::pause, state_for_command::play);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Pause>());
+
+  tonuino.setup();
+  button_for_command(command::pause, state_for_command::idle_pause);
+  leave_start_play();
+  EXPECT_EQ(getMp3().df_folder, 6);
+  EXPECT_EQ(getMp3().df_folder_track, 3);
+
+  // play to the end --> Idle, the snapshot is removed
+  goto_idle();
+
+  tonuino.setup();
+  button_for_command(command::pause, state_for_command::idle_pause);
+  leave_start_play();
+  EXPECT_EQ(getMp3().df_folder, 6);
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+
+  goto_idle();
+}
+#endif // RESUME_SNAPSHOT
+
 // =================== shortcutx (idle, pause)
+#ifdef DFPLAYER_BUSY_IRQ
+
+TEST_F(tonuino_test_fixture, busy_end_starts_next_track) {
+  goto_play({ 5, pmode_t::album, 0, 0 }, 3);
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts);
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+  Print::clear_output();
+
+  // the busy signal ends before OnPlayFinished --> next track in the next cycle
+  getMp3().df_playing = false;
+  execute_cycle();
+  execute_cycle();
+  EXPECT_EQ(getMp3().df_folder_track, 2);
+  EXPECT_NE(Print::get_output().find("busy end"), std::string::npos);
+
+  // the late OnPlayFinished of the first track is ignored
+  Mp3Notify::OnPlayFinished(getMp3(), DfMp3_PlaySources_Sd, 5*255+1);
+  execute_cycle();
+  EXPECT_EQ(getMp3().df_folder_track, 2);
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_NE(Print::get_output().find("track gap: "), std::string::npos);
+
+  // the usual way (OnPlayFinished first) still works, no double skip
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts);
+  Print::clear_output();
+  getMp3().end_track();
+  execute_cycle_for_ms(time_check_play);
+  EXPECT_EQ(getMp3().df_folder_track, 3);
+  EXPECT_EQ(Print::get_output().find("busy end"), std::string::npos);
+
+  goto_idle();
+}
+
+TEST_F(tonuino_test_fixture, busy_end_in_pause_does_not_start_next_track) {
+  goto_play({ 5, pmode_t::album, 0, 0 }, 3);
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts);
+
+  button_for_command(command::pause, state_for_command::play);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Pause>());
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts);
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+
+  button_for_command(command::pause, state_for_command::idle_pause);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+  EXPECT_EQ(Print::get_output().find("track gap: "), std::string::npos);
+
+  goto_idle();
+}
+#endif // DFPLAYER_BUSY_IRQ
+
+#ifdef TRACK_PRE_ARM
+
+TEST_F(tonuino_test_fixture, pre_arm_next_track_hoerbuch) {
+  const uint8_t folder = 5;
+  folderSettings card = { folder, pmode_t::hoerbuch, 0, 0 };
+  getSettings().writeFolderSettingToFlash(folder, 1);
+  goto_play(card, 3);
+  EXPECT_EQ(getMp3().df_folder_track, 1);
+  Print::clear_output();
+
+  // the next track is started in OnPlayFinished before the progress is saved
+  getMp3().end_track();
+  execute_cycle();
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder_track, 2);
+  EXPECT_EQ(getSettings().readFolderSettingFromFlash(folder), 2);
+  const std::string log = Print::get_output();
+  EXPECT_NE(log.find("pre-armed: 5-2"), std::string::npos);
+  EXPECT_LT(log.find("pre-armed: 5-2"), log.find("play 5-2"));
+
+  // nothing to pre-arm after the last track
+  getMp3().end_track();
+  execute_cycle();
+  EXPECT_EQ(getMp3().df_folder_track, 3);
+  Print::clear_output();
+  getMp3().end_track();
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_stopped());
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+  EXPECT_EQ(Print::get_output().find("pre-armed"), std::string::npos);
+  EXPECT_EQ(getSettings().readFolderSettingFromFlash(folder), 1);
+
+  card_out();
+}
+
+TEST_F(tonuino_test_fixture, pre_arm_not_in_party) {
+  goto_play({ 5, pmode_t::party, 0, 0 }, 3);
+  Print::clear_output();
+
+  getMp3().end_track();
+  execute_cycle();
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(Print::get_output().find("pre-armed"), std::string::npos);
+
+  goto_idle();
+}
+#endif // TRACK_PRE_ARM
+
+#ifdef SHUFFLE_NO_REPEAT
+
+TEST_F(tonuino_test_fixture, random_episode_no_repeat) {
+  constexpr uint8_t folder      = 7;
+  constexpr uint8_t track_count = 5;
+  std::vector<uint8_t> played;
+  for (uint8_t i = 0; i < 2*track_count; ++i) {
+    goto_play({ folder, pmode_t::hoerspiel, 0, 0 }, track_count);
+    played.push_back(getMp3().df_folder_track);
+    goto_idle();
+    card_out();
+  }
+  // every track once per round and not twice in a row between the rounds
+  for (uint8_t r = 0; r < 2; ++r) {
+    std::vector<uint8_t> round(played.begin()+r*track_count, played.begin()+(r+1)*track_count);
+    std::sort(round.begin(), round.end());
+    for (uint8_t t = 0; t < track_count; ++t)
+      EXPECT_EQ(round[t], t+1);
+  }
+  EXPECT_NE(played[track_count-1], played[track_count]);
+}
+
+#ifdef LARGE_FOLDERS
+TEST_F(tonuino_test_fixture, random_episode_no_repeat_large_folder) {
+  constexpr uint8_t  folder      = 3;
+  constexpr uint16_t track_count = 300;
+  std::vector<uint16_t> played;
+  for (uint16_t i = 0; i < track_count; ++i) {
+    goto_play({ folder, pmode_t::hoerspiel, 0, 0 }, track_count);
+    played.push_back(getMp3().df_folder_track);
+    goto_idle();
+    card_out();
+  }
+  // the tracks above 255 have their own bit
+  std::sort(played.begin(), played.end());
+  for (uint16_t t = 0; t < track_count; ++t)
+    EXPECT_EQ(played[t], t+1);
+}
+#endif // LARGE_FOLDERS
+#endif // SHUFFLE_NO_REPEAT
+
+#ifdef WATCHDOG
+
+TEST_F(tonuino_test_fixture, watchdog_stall_reported) {
+  goto_idle();
+  execute_cycle(); // all subsystems checked in
+  {
+    Watchdog::Heartbeat heartbeat{Watchdog::card};
+    Watchdog::onTimeout(0x1234);
+  }
+  Print::clear_output();
+  tonuino.setup();
+  EXPECT_TRUE(Watchdog::recovered());
+  EXPECT_NE(Print::get_output().find("watchdog reset, stalled: card, missing: 0, pc: 4660"), std::string::npos)
+      << Print::get_output();
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+
+  // reported once
+  Print::clear_output();
+  tonuino.setup();
+  EXPECT_FALSE(Watchdog::recovered());
+  EXPECT_EQ(Print::get_output().find("watchdog reset"), std::string::npos);
+}
+#endif // WATCHDOG
+
+#ifdef ENERGY_MONITOR
+
+TEST_F(tonuino_test_fixture, energy_monitor_accounts_play_and_estimates_runtime) {
+  goto_idle();
+  execute_cycle();
+  EnergyMonitor::clear();
+  EnergyMonitor::voltage(3800);
+
+  goto_play({ 2, pmode_t::album, 0, 0 });
+  execute_cycle_for_ms(60000);
+  EXPECT_EQ(EnergyMonitor::remainingMinutes(), -1); // no voltage drop yet
+
+  for (uint8_t i = 0; i < 100; ++i)
+    EnergyMonitor::voltage(3700);
+
+  const unsigned long played = EnergyMonitor::seconds(EnergyMonitor::play_low )
+                             + EnergyMonitor::seconds(EnergyMonitor::play_mid )
+                             + EnergyMonitor::seconds(EnergyMonitor::play_high);
+  EXPECT_GE(played, 60ul);
+  EXPECT_LT(EnergyMonitor::seconds(EnergyMonitor::idle), 5ul);
+  EXPECT_GE(EnergyMonitor::averageCurrent(), energyCurrentPlay[0]);
+  EXPECT_LE(EnergyMonitor::averageCurrent(), energyCurrentPlay[2]);
+
+  // the voltage falls 100 mV with the used charge, 800 mV are left until batVoltageEmpty
+  const long expected = 8l * EnergyMonitor::usedCharge() / EnergyMonitor::averageCurrent() / 60;
+  EXPECT_NEAR(EnergyMonitor::remainingMinutes(), expected, 1);
+  EXPECT_GT(EnergyMonitor::remainingMinutes(), 0);
+}
+#endif // ENERGY_MONITOR
+
+#ifdef LOOP_PROFILER
+
+TEST(loop_profiler_test, histogram_buckets_and_overruns) {
+  constexpr unsigned long first = 1ul << loopProfilerFirstBucket;
+  constexpr LoopProfiler::section s = LoopProfiler::send_mp3;
+  LoopProfiler::clear();
+
+  LoopProfiler::add(s, 0);
+  LoopProfiler::add(s, first-1);
+  LoopProfiler::add(s, first);
+  LoopProfiler::add(s, 2*first-1);
+  LoopProfiler::add(s, 2*first);
+  LoopProfiler::add(s, 0xffffffff);
+  EXPECT_EQ(LoopProfiler::count(s, 0), 2);
+  EXPECT_EQ(LoopProfiler::count(s, 1), 2);
+  EXPECT_EQ(LoopProfiler::count(s, 2), 1);
+  EXPECT_EQ(LoopProfiler::count(s, loopProfilerBuckets-1), 1);
+  EXPECT_EQ(LoopProfiler::overruns(s), 1);
+
+  // an overrun is longer than cycleTime
+  LoopProfiler::add(s, cycleTime * 1000ul);
+  EXPECT_EQ(LoopProfiler::overruns(s), 1);
+  LoopProfiler::add(s, cycleTime * 1000ul + 1);
+  EXPECT_EQ(LoopProfiler::overruns(s), 2);
+
+  // the other sections are not touched, clear() resets all
+  EXPECT_EQ(LoopProfiler::count(LoopProfiler::card, 0), 0);
+  LoopProfiler::clear();
+  EXPECT_EQ(LoopProfiler::count(s, 0), 0);
+  EXPECT_EQ(LoopProfiler::overruns(s), 0);
+}
+#endif // LOOP_PROFILER
+
+#ifdef LATENCY_TRACE
+
+TEST_F(tonuino_test_fixture, latency_trace_summary) {
+  goto_play({ 2, pmode_t::album, 0, 0 });
+  execute_cycle();
+  card_out();
+
+  Print::clear_output();
+  LatencyTrace::printSummary();
+  const std::string summary = Print::get_output();
+  EXPECT_NE(summary.find(" plays"), std::string::npos) << summary;
+  // the stages up to the start of the pling have min/avg/max
+  for (const char* stage: { "card read: ", "dispatched: ", "play current: ", "busy active: " }) {
+    const size_t pos = summary.find(stage);
+    ASSERT_NE(pos, std::string::npos) << stage << " in: " << summary;
+    const std::string values = summary.substr(pos + strlen(stage), summary.find('\n', pos) - pos - strlen(stage));
+    EXPECT_EQ(std::count(values.begin(), values.end(), '/'), 2) << stage << values;
+  }
+}
+#endif // LATENCY_TRACE
+
+#ifdef MEMORY_MONITOR
+
+TEST_F(tonuino_test_fixture, memory_monitor_painted_ram_and_report) {
+  // the stack has overwritten the pattern from the 5th byte on
+  uint8_t ram[16];
+  std::fill(std::begin(ram), std::end(ram), MemoryMonitor::paintPattern);
+  ram[4] = 0x00;
+  ram[9] = 0x00;
+  EXPECT_EQ(MemoryMonitor::painted(ram, ram+16), 4);
+  EXPECT_EQ(MemoryMonitor::painted(ram, ram+ 3), 3);
+  EXPECT_EQ(MemoryMonitor::painted(ram+5, ram+16), 4);
+  ram[0] = MemoryMonitor::paintPattern + 1;
+  EXPECT_EQ(MemoryMonitor::painted(ram, ram+16), 0);
+
+#if not defined(BINARY_LOGGER) and not defined(BUFFERED_LOG)
+  // the values are 0 on the host, the report has all of them
+  Print::clear_output();
+  MemoryMonitor::printReport();
+  const std::string report = Print::get_output();
+  for (const char* item: { "RAM data: 0", " bss: 0", " free: 0", " stack max: 0", " never used: 0" })
+    EXPECT_NE(report.find(item), std::string::npos) << item << " in: " << report;
+
+  // only on request (memoryMonitorLogInterval == 0)
+  Print::clear_output();
+  execute_cycle_for_ms(10000);
+  EXPECT_EQ(Print::get_output().find("RAM data"), std::string::npos);
+#endif
+}
+#endif // MEMORY_MONITOR
+
+#ifdef TELEMETRY
+
+TEST_F(tonuino_test_fixture, telemetry_counts_and_survives_power_off) {
+  goto_idle();
+  const uint32_t boots = Telemetry::get(Telemetry::boots);
+  const uint32_t reads = Telemetry::get(Telemetry::card_reads);
+  EXPECT_GE(boots, 1);
+
+  goto_play({ 2, pmode_t::album, 0, 0 });
+  EXPECT_GT(Telemetry::get(Telemetry::card_reads), reads);
+  EXPECT_EQ(Telemetry::get(static_cast<Telemetry::counter>(Telemetry::plays_mode   + 1)), 1); // album
+  EXPECT_EQ(Telemetry::get(static_cast<Telemetry::counter>(Telemetry::plays_folder + 1)), 1); // folder 2
+  card_out();
+
+  Telemetry::mp3Error(5);
+  Telemetry::mp3Error(0x81);
+  EXPECT_EQ(Telemetry::get(static_cast<Telemetry::counter>(Telemetry::mp3_errors + 4)), 1);
+  EXPECT_EQ(Telemetry::get(static_cast<Telemetry::counter>(Telemetry::mp3_errors + 7)), 1);
+
+  // power off and on
+  Telemetry::flush();
+  Telemetry::clear();
+  Telemetry::begin();
+  EXPECT_EQ(Telemetry::get(Telemetry::boots), boots+1);
+  EXPECT_EQ(Telemetry::get(static_cast<Telemetry::counter>(Telemetry::plays_folder + 1)), 1);
+  EXPECT_EQ(Telemetry::get(static_cast<Telemetry::counter>(Telemetry::mp3_errors + 7)), 1);
+  EXPECT_GT(Telemetry::get(Telemetry::eeprom_writes), 0);
+}
+
+TEST_F(tonuino_test_fixture, telemetry_card_reads_have_32_bit) {
+  goto_idle();
+  const uint32_t reads = Telemetry::get(Telemetry::card_reads);
+  for (uint32_t i = 0; i < 0x10000; ++i)
+    Telemetry::count(Telemetry::card_reads);
+  EXPECT_EQ(Telemetry::get(Telemetry::card_reads), reads + 0x10000);
+
+  // power off and on
+  Telemetry::flush();
+  Telemetry::clear();
+  Telemetry::begin();
+  EXPECT_EQ(Telemetry::get(Telemetry::card_reads), reads + 0x10000);
+}
+#endif // TELEMETRY
+
+#ifdef QUIZ_GAME
+
+TEST_F(tonuino_test_fixture, quiz_questions_no_repeat) {
+  constexpr uint8_t folder       = 5;
+  constexpr uint8_t numAnswer    = 2;
+  constexpr uint8_t numQuestions = 4;
+  goto_idle();
+  card_in({ folder, pmode_t::quiz_game, numAnswer, 0 }, numQuestions*(numAnswer+1));
+  EXPECT_TRUE(SM_tonuino::is_in_state<Quiz>());
+  execute_cycle();
+  EXPECT_EQ(getMp3().df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_500_quiz_game_intro));
+  getMp3().end_track();
+  execute_cycle();
+
+  // every question once per round
+  for (uint8_t r = 0; r < 2; ++r) {
+    std::vector<uint8_t> round;
+    for (uint8_t q = 0; q < numQuestions; ++q) {
+      button_for_command(command::pause, state_for_command::play); // question
+      execute_cycle();
+      EXPECT_TRUE(getMp3().is_playing_folder());
+      round.push_back(getMp3().df_folder_track);
+      getMp3().end_track();
+      execute_cycle();
+      button_for_command(command::pause, state_for_command::play); // answer (none)
+      execute_cycle();
+      EXPECT_EQ(getMp3().df_mp3_track, static_cast<uint16_t>(mp3Tracks::t_502_quiz_game_bad));
+      getMp3().end_track();
+      execute_cycle();
+    }
+    std::sort(round.begin(), round.end());
+    for (uint8_t q = 0; q < numQuestions; ++q)
+      EXPECT_EQ(round[q], q*(numAnswer+1)+1);
+  }
+  EXPECT_TRUE(SM_tonuino::is_in_state<Quiz>());
+  card_out();
+}
+#endif // QUIZ_GAME
+
 TEST_F(tonuino_test_fixture, shortcutx_in_idle) {
 
   folderSettings folder_settings = { 10, pmode_t::einzel, 3, 0 };
@@ -1229,3 +1759,297 @@ TEST_F(tonuino_test_fixture, end_play_after_2_track_hoerbuch_1) {
   card_out();
 }
 
+
+#ifdef LARGE_FOLDERS
+// =================== folder with more than 255 tracks
+TEST_F(tonuino_test_fixture, large_folder_hoerbuch) {
+  const uint8_t   folder        = 5;
+  const uint16_t  track_count   = 400;
+  uint16_t        current_track = 300;
+  folderSettings card = { folder, pmode_t::hoerbuch, 0, 0 };
+  getSettings().writeFolderSettingToFlash(folder, current_track);
+  goto_play(card, track_count);
+  EXPECT_TRUE(getMp3().called_playFolderTrack16);
+  EXPECT_EQ(getMp3().df_folder_track, current_track);
+  EXPECT_EQ(tonuino.getNumTracksInFolder(), track_count);
+
+  button_for_command(command::next, state_for_command::play);
+  execute_cycle_for_ms(time_check_play);
+  EXPECT_TRUE(getMp3().is_playing_folder());
+  EXPECT_EQ(getMp3().df_folder, card.folder);
+  EXPECT_EQ(getMp3().df_folder_track, ++current_track);
+  EXPECT_EQ(getSettings().readFolderSettingFromFlash(folder), current_track);
+  getSettings().flushToFlash();
+  EXPECT_EQ(getSettings().readFolderSettingFromFlash(folder), current_track);
+}
+
+TEST_F(tonuino_test_fixture, large_folder_only_up_to_largeFolderLast) {
+  const uint8_t folder = largeFolderLast+1;
+  folderSettings card = { folder, pmode_t::album, 0, 0 };
+  goto_play(card, 400);
+  EXPECT_FALSE(getMp3().called_playFolderTrack16);
+  EXPECT_EQ(tonuino.getNumTracksInFolder(), 255);
+}
+#endif // LARGE_FOLDERS
+
+#ifdef CARD_PIPELINED_START
+// =================== track count fetched while the pling is playing
+TEST_F(tonuino_test_fixture, pipelined_start_track_count_during_pling) {
+  const folderSettings card = { 7, pmode_t::album, 0, 0 };
+  goto_idle();
+  getMp3().set_folder_track_count(7, 20);
+  getMp3().clearTrackCountCache();
+  getMp3().called_getFolderTrackCount = 0;
+  card_in(card, 20);
+  EXPECT_TRUE(SM_tonuino::is_in_state<StartPlay>());
+  execute_cycle();
+  execute_cycle();
+  EXPECT_TRUE(getMp3().is_playing_mp3());
+  // already asked while the pling is playing
+  EXPECT_EQ(getMp3().called_getFolderTrackCount, 1);
+  getMp3().end_track();
+  execute_cycle();
+  EXPECT_EQ(tonuino.getNumTracksInFolder(), 20);
+  EXPECT_EQ(getMp3().called_getFolderTrackCount, 1);
+  card_out();
+}
+#endif // CARD_PIPELINED_START
+
+#ifdef MEMORY_UID_MATCH
+// =================== memory game cards known by the UID
+TEST_F(tonuino_test_fixture, memory_uid_match_without_read) {
+  goto_idle();
+  card_in({ 5, pmode_t::memory_game, 0, 0 });
+  EXPECT_TRUE(SM_tonuino::is_in_state<Memory>());
+  card_out();
+
+  // first read: the pairs are learned
+  getMFRC522().mifare_reads = 0;
+  card_in({ 0, pmode_t::memory_game, 3, 0 });
+  card_out();
+  card_in({ 0, pmode_t::memory_game, 4, 0 });
+  card_out();
+  EXPECT_GT(getMFRC522().mifare_reads, 0);
+  button_for_command(command::pause, state_for_command::play);
+
+  // known cards: only the UID
+  getMFRC522().mifare_reads = 0;
+  card_in({ 0, pmode_t::memory_game, 3, 0 });
+  execute_cycle();
+  EXPECT_EQ(getMp3().df_folder_track, 3);
+  card_out();
+  card_in({ 0, pmode_t::memory_game, 4, 0 });
+  execute_cycle();
+  EXPECT_EQ(getMp3().df_folder_track, 4);
+  card_out();
+  EXPECT_EQ(getMFRC522().mifare_reads, 0);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Memory>());
+}
+#endif // MEMORY_UID_MATCH
+
+#ifdef SERIAL_REMOTE
+// =================== binary remote control via the serial input
+namespace {
+void send_remote_frame(uint8_t seq, const std::vector<uint8_t>& payload, uint8_t checksum_error = 0) {
+  uint8_t sum = seq + payload.size();
+  Serial.input.push_back(SerialRemote::frameStart);
+  Serial.input.push_back(seq);
+  Serial.input.push_back(payload.size());
+  for (uint8_t b: payload) {
+    Serial.input.push_back(b);
+    sum += b;
+  }
+  Serial.input.push_back(sum + checksum_error);
+}
+bool output_contains(const std::vector<uint8_t>& bytes) {
+  return Print::get_output().find(std::string(bytes.begin(), bytes.end())) != std::string::npos;
+}
+}
+
+TEST_F(tonuino_test_fixture, remote_card_in_and_status) {
+  goto_idle();
+  getMp3().set_folder_track_count(5, 20);
+  Print::clear_output();
+  send_remote_frame(7, { SerialRemote::c_card_in, 5, static_cast<uint8_t>(pmode_t::album), 0, 0,
+                         SerialRemote::c_status });
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<StartPlay>());
+  EXPECT_TRUE(Serial.input.empty());
+  EXPECT_TRUE(output_contains({ SerialRemote::statusStart, 7, SerialRemote::st_startPlay, 5, static_cast<uint8_t>(pmode_t::album) }));
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 7, SerialRemote::ack_ok }));
+
+  send_remote_frame(8, { SerialRemote::c_card_out });
+  execute_cycle();
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 8, SerialRemote::ack_ok }));
+}
+
+TEST_F(tonuino_test_fixture, remote_batch_of_commands) {
+  folderSettings card = { 6, pmode_t::album, 0, 0 };
+  goto_play(card);
+  Print::clear_output();
+  // pause and play again, status after each command
+  send_remote_frame(1, { SerialRemote::c_command, static_cast<uint8_t>(commandRaw::pause), SerialRemote::c_status,
+                         SerialRemote::c_command, static_cast<uint8_t>(commandRaw::pause), SerialRemote::c_status });
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+  EXPECT_TRUE(output_contains({ SerialRemote::statusStart, 1, SerialRemote::st_pause, 6 }));
+  EXPECT_TRUE(output_contains({ SerialRemote::statusStart, 1, SerialRemote::st_play , 6 }));
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 1, SerialRemote::ack_ok }));
+}
+
+TEST_F(tonuino_test_fixture, remote_invalid_frames_are_not_executed) {
+  goto_idle();
+  getMp3().set_folder_track_count(5, 20);
+  Print::clear_output();
+
+  send_remote_frame(2, { SerialRemote::c_card_in, 5, static_cast<uint8_t>(pmode_t::album), 0, 0 }, 1);
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 2, SerialRemote::ack_checksum }));
+
+  // unknown command at the end: the card is not inserted
+  send_remote_frame(3, { SerialRemote::c_card_in, 5, static_cast<uint8_t>(pmode_t::album), 0, 0, 0x77 });
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 3, SerialRemote::ack_command }));
+
+  // argument missing
+  send_remote_frame(4, { SerialRemote::c_command });
+  execute_cycle();
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 4, SerialRemote::ack_command }));
+}
+TEST_F(tonuino_test_fixture, remote_frame_spread_over_cycles) {
+  goto_idle();
+  getMp3().set_folder_track_count(5, 20);
+  Print::clear_output();
+
+  send_remote_frame(12, { SerialRemote::c_card_in, 5, static_cast<uint8_t>(pmode_t::album), 0, 0 });
+  std::deque<uint8_t> rest{};
+  while (Serial.input.size() > 4) {
+    rest.push_front(Serial.input.back());
+    Serial.input.pop_back();
+  }
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+  EXPECT_FALSE(output_contains({ SerialRemote::ackStart, 12 }));
+
+  Serial.input = rest;
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<StartPlay>());
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 12, SerialRemote::ack_ok }));
+}
+
+TEST_F(tonuino_test_fixture, remote_incomplete_frame_is_dropped) {
+  goto_idle();
+  getMp3().set_folder_track_count(5, 20);
+  Print::clear_output();
+
+  send_remote_frame(13, { SerialRemote::c_card_in, 5, static_cast<uint8_t>(pmode_t::album), 0, 0 });
+  Serial.input.resize(5);
+  execute_cycle_for_ms(serialRemoteByteTimeout + 2*cycleTime);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Idle>());
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 13, SerialRemote::ack_length }));
+
+  // the next frame is received again
+  send_remote_frame(14, { SerialRemote::c_status });
+  execute_cycle();
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 14, SerialRemote::ack_ok }));
+}
+
+TEST_F(tonuino_test_fixture, remote_card_not_read_again) {
+  goto_idle();
+  getMp3().set_folder_track_count(5, 20);
+  getMp3().set_folder_track_count(6, 20);
+  getMp3().set_folder_track_count(7, 20);
+
+  send_remote_frame(15, { SerialRemote::c_card_in, 5, static_cast<uint8_t>(pmode_t::album), 0, 0 });
+  execute_cycle();
+  EXPECT_TRUE(SM_tonuino::is_in_state<StartPlay>());
+  // StartPlay does not read the card
+  send_remote_frame(16, { SerialRemote::c_card_in, 6, static_cast<uint8_t>(pmode_t::album), 0, 0 });
+  execute_cycle();
+  getMp3().end_track();
+  execute_cycle_for_ms(dfPlayer_timeUntilStarts + time_check_play);
+  EXPECT_TRUE(SM_tonuino::is_in_state<Play>());
+  EXPECT_EQ(tonuino.getFolder(), 5);
+
+  // the physical card is read
+  card_in({ 7, pmode_t::album, 0, 0 });
+  EXPECT_TRUE(SM_tonuino::is_in_state<StartPlay>());
+  EXPECT_EQ(tonuino.getFolder(), 7);
+}
+#ifdef TRACK_COUNT_CACHE
+TEST_F(tonuino_test_fixture, remote_track_counts_provisioned) {
+  goto_idle();
+  Print::clear_output();
+  // the DfPlayer would answer 0 for these folders
+  send_remote_frame(5, { SerialRemote::c_track_count, 7, 12, 0,
+                         SerialRemote::c_track_count, 8, 0x2c, 0x01 });
+  execute_cycle();
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 5, SerialRemote::ack_ok }));
+  EXPECT_EQ(getMp3().getFolderTrackCount(7), 12);
+  EXPECT_EQ(getMp3().getFolderTrackCount(8), 300);
+#ifdef TRACK_COUNT_CACHE_EEPROM
+  EXPECT_EQ(getSettings().readTrackCountFromFlash(7), 12);
+#endif
+
+  // folder 0 is not valid: nothing is stored
+  send_remote_frame(6, { SerialRemote::c_track_count, 9, 5, 0,
+                         SerialRemote::c_track_count, 0, 5, 0 });
+  execute_cycle();
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 6, SerialRemote::ack_command }));
+  EXPECT_EQ(getMp3().getFolderTrackCount(9), 0);
+}
+#endif // TRACK_COUNT_CACHE
+#ifdef KEYMAP
+TEST_F(tonuino_test_fixture, remote_keymap_stored_and_reloaded) {
+  goto_idle();
+  Commands &commands = tonuino.getCommands();
+  const uint8_t up   = static_cast<uint8_t>(commandRaw::up);
+  const uint8_t idle = static_cast<uint8_t>(state_for_command::idle_pause);
+  Print::clear_output();
+  send_remote_frame(9, { SerialRemote::c_keymap, up, idle, static_cast<uint8_t>(command::shortcut1) });
+  execute_cycle();
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 9, SerialRemote::ack_ok }));
+  EXPECT_EQ(commands.getCommand(commandRaw::up, state_for_command::idle_pause), command::shortcut1);
+  EXPECT_EQ(commands.getCommand(commandRaw::up, state_for_command::admin     ), command::next     );
+
+  // kept in the EEPROM
+  commands.loadKeymap();
+  EXPECT_EQ(commands.getCommand(commandRaw::up, state_for_command::idle_pause), command::shortcut1);
+
+  // command out of range: nothing is changed
+  send_remote_frame(10, { SerialRemote::c_keymap, up, idle, static_cast<uint8_t>(command::adm_end) });
+  execute_cycle();
+  EXPECT_TRUE(output_contains({ SerialRemote::ackStart, 10, SerialRemote::ack_command }));
+  EXPECT_EQ(commands.getCommand(commandRaw::up, state_for_command::idle_pause), command::shortcut1);
+
+  // the default removes the custom mapping
+  send_remote_frame(11, { SerialRemote::c_keymap, up, idle, static_cast<uint8_t>(command::bright_up) });
+  execute_cycle();
+  commands.loadKeymap();
+  EXPECT_EQ(commands.getCommand(commandRaw::up, state_for_command::idle_pause), command::bright_up);
+  Settings::keymap_entry_t entry;
+  Settings::readKeymapEntryFromFlash(0, entry);
+  EXPECT_EQ(entry.raw, 0);
+}
+
+TEST_F(tonuino_test_fixture, keymap_full) {
+  Commands &commands = tonuino.getCommands();
+  // every entry with a different state and raw command (bright_down is not the default of start ... pauseLong)
+  static_assert(keymapEntries <= 4 * 4, "test needs more raw commands");
+  uint8_t n = 0;
+  for (uint8_t raw = 1; raw <= static_cast<uint8_t>(commandRaw::pauseLong) && n < keymapEntries; ++raw)
+    for (uint8_t s = 0; s < 4 && n < keymapEntries; ++s, ++n)
+      EXPECT_TRUE(commands.setKeymap(static_cast<commandRaw>(raw), static_cast<state_for_command>(s), command::bright_down));
+  EXPECT_FALSE(commands.setKeymap(commandRaw::updownLong, state_for_command::play_invert, command::bright_down));
+  // replacing an entry still works
+  EXPECT_TRUE(commands.setKeymap(commandRaw::start, state_for_command::admin, command::select));
+  EXPECT_EQ(commands.getCommand(commandRaw::start, state_for_command::admin), command::select);
+
+  Settings::clearKeymapInFlash();
+  commands.loadKeymap();
+  EXPECT_EQ(commands.getCommand(commandRaw::start, state_for_command::admin), command::none);
+}
+#endif // KEYMAP
+#endif // SERIAL_REMOTE
@@ -2,9 +2,11 @@
 
 # Adds a lead-in message to each mp3 file of a directory storing the result in another directory.
 # So - when played e.g. on a TonUINO - you first will hear the title of the track, then the track itself.
+# The manifest `.lead-in-manifest.json` in the output directory remembers the hash of the source and the lead-in of
+# every output file, so a further run only processes new or changed files.
 
 
-import argparse, base64, json, os, re, subprocess, sys, text_to_speech
+import argparse, base64, hashlib, json, multiprocessing, os, re, subprocess, sys, text_to_speech
 
 
 argFormatter = lambda prog: argparse.RawDescriptionHelpFormatter(prog, max_help_position=27, width=100)
@@ -22,6 +24,7 @@ argparser.add_argument('--file-regex', type=str, default=None, help="The regular
 argparser.add_argument('--title-pattern', type=str, default=None, help="The pattern to use as track title. May contain groups of `--file-regex`, e.g. '\\1'")
 argparser.add_argument('--add-numbering', action='store_true', help='Whether to add a three-digit number to the mp3 files (suitable for DFPlayer Mini)')
 argparser.add_argument('--dry-run', action='store_true', help='Dry run: Only prints what the script would do, without actually creating files')
+argparser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(), help='The number of files processed in parallel (default: number of CPUs)')
 args = argparser.parse_args()
 
 text_to_speech.checkArgs(argparser, args)
@@ -29,7 +32,7 @@ text_to_speech.checkArgs(argparser, args)
 fileRegex = re.compile(args.file_regex if args.file_regex is not None else '\\d*(.*)')
 titlePattern = args.title_pattern if args.title_pattern is not None else '\\1'
 
-mp3FileIndex = 0
+manifestFileName = '.lead-in-manifest.json'
 
 
 def fail(msg):
@@ -37,9 +40,8 @@ def fail(msg):
     sys.exit(1)
 
 
-def addLeadInMessage(inputPath, outputPath):
-    global mp3FileIndex
-
+# collects the mp3 files to process as (input path, output path, text), the numbering follows the sorted file names
+def collectFiles(inputPath, outputPath, files):
     if not os.path.exists(inputPath):
         fail('Input does not exist: ' + os.path.abspath(inputPath))
 
@@ -52,8 +54,12 @@ def addLeadInMessage(inputPath, outputPath):
 
         mp3FileIndex = 0
         for child in sorted(os.listdir(inputPath)):
-            addLeadInMessage(os.path.join(inputPath, child), os.path.join(outputPath, child))
-
+            childInput = os.path.join(inputPath, child)
+            childOutput = os.path.join(outputPath, child)
+            if os.path.isfile(childInput) and os.path.splitext(child)[1].lower() == '.mp3' and args.add_numbering:
+                mp3FileIndex += 1
+                childOutput = os.path.join(outputPath, '{:0>3}_{}'.format(mp3FileIndex, child))
+            collectFiles(childInput, childOutput, files)
         return
 
     inputFileNameSplit = os.path.splitext(os.path.basename(inputPath))
@@ -64,43 +70,60 @@ def addLeadInMessage(inputPath, outputPath):
         print('Ignoring {} (no mp3 file)'.format(os.path.abspath(inputPath)))
         return
 
-    if args.add_numbering:
-        outputPathSplit = os.path.split(outputPath)
-        outputPath = os.path.join(outputPathSplit[0], '{:0>3}_{}'.format(mp3FileIndex + 1, outputPathSplit[1]))
-        mp3FileIndex += 1
-
-    if os.path.isfile(outputPath):
-        print('Skipping {} (file already exists)'.format(os.path.abspath(outputPath)))
-        return
-
     text = re.sub(fileRegex, titlePattern, inputFileName).replace('_', ' ').strip()
     if text == '':
         print('File {} does not have a title. Skipping.'.format(outputPath))
         return
+    files.append((inputPath, outputPath, text))
+
+
+# the hash of the source file, unchanged size and modification time reuse the hash of the manifest
+def sourceHash(inputPath, entry):
+    stat = os.stat(inputPath)
+    if entry is not None and entry.get('size') == stat.st_size and entry.get('mtime') == stat.st_mtime:
+        return entry['sha256'], stat
+    sha256 = hashlib.sha256()
+    with open(inputPath, 'rb') as f:
+        for block in iter(lambda: f.read(1 << 20), b''):
+            sha256.update(block)
+    return sha256.hexdigest(), stat
+
+
+# everything of the settings that changes the lead-in
+def leadInKey(text):
+    engine, voice = text_to_speech.engineAndVoiceUsingArgs(args)
+    return [ text, args.lang, engine, voice ]
+
+
+def addLeadInMessage(job):
+    inputPath, outputPath, text = job
     print('Adding lead-in "{}" to {}'.format(text, os.path.abspath(outputPath)))
+    if args.dry_run:
+        return
 
-    if not args.dry_run:
-        tempLeadInFile = 'temp-lead-in.mp3'
-        tempLeadInFileAdjusted = 'temp-lead-in_adjusted.mp3'
-        text_to_speech.textToSpeechUsingArgs(text=text, targetFile=tempLeadInFile, args=args)
-
-        # Adjust sample rate and mono/stereo
-        print('Detecting sample rate and channels')
-        detectionInfo = detectAudioData(inputPath)
-        if detectionInfo is None:
-            # We can't adjust
-            print('Detecting sample rate and channels failed -> Skipping adjustment')
-            tempLeadInFileAdjusted = tempLeadInFile
-        else:
-            print('Adjust sample rate to {} and channels to {}'.format(detectionInfo['sampleRate'], detectionInfo['channels']))
-            subprocess.call([ 'ffmpeg', '-i', tempLeadInFile, '-vn', '-ar', detectionInfo['sampleRate'], '-ac', detectionInfo['channels'], tempLeadInFileAdjusted ])
-
-        print('Concat')
-        subprocess.call([ 'ffmpeg', '-i', 'concat:{}|{}'.format(tempLeadInFileAdjusted, inputPath), '-acodec', 'copy', outputPath, '-map_metadata', '0:1' ])
-
-        os.remove(tempLeadInFile)
+    outputDir = os.path.dirname(os.path.abspath(outputPath))
+    tempLeadInFile = text_to_speech.createTempFile('.mp3')
+    tempLeadInFileAdjusted = text_to_speech.createTempFile('_adjusted.mp3')
+    text_to_speech.textToSpeechUsingArgs(text=text, targetFile=tempLeadInFile, args=args)
+
+    # Adjust sample rate and mono/stereo
+    detectionInfo = detectAudioData(inputPath)
+    if detectionInfo is None:
+        # We can't adjust
+        print('Detecting sample rate and channels of {} failed -> Skipping adjustment'.format(inputPath))
+        os.remove(tempLeadInFileAdjusted)
+        tempLeadInFileAdjusted = tempLeadInFile
+    else:
+        subprocess.call([ 'ffmpeg', '-y', '-loglevel', 'error', '-i', tempLeadInFile, '-vn', '-ar', detectionInfo['sampleRate'], '-ac', detectionInfo['channels'], tempLeadInFileAdjusted ])
+
+    # the concat protocol with codec copy streams the frames, the track is not decoded
+    tempOutputFile = os.path.join(outputDir, '.part_' + os.path.basename(outputPath))
+    subprocess.call([ 'ffmpeg', '-y', '-loglevel', 'error', '-i', 'concat:{}|{}'.format(tempLeadInFileAdjusted, inputPath), '-acodec', 'copy', '-f', 'mp3', tempOutputFile, '-map_metadata', '0:1' ])
+    os.replace(tempOutputFile, outputPath)
+
+    os.remove(tempLeadInFile)
+    if tempLeadInFileAdjusted != tempLeadInFile:
         os.remove(tempLeadInFileAdjusted)
-        print('\n')
 
 
 def detectAudioData(mp3File):
@@ -119,9 +142,55 @@ def detectAudioData(mp3File):
         return None
 
 
-if not os.path.exists(args.output) and not args.dry_run:
-    outputParent = os.path.dirname(os.path.abspath(args.output))
-    if not os.path.isdir(outputParent):
-        fail('Parent of output is no directory: ' + os.path.abspath(outputParent))
-
-addLeadInMessage(args.input, args.output)
+def loadManifest(manifestFile):
+    if os.path.isfile(manifestFile):
+        with open(manifestFile) as f:
+            return json.load(f)
+    return {}
+
+
+def saveManifest(manifestFile, manifest):
+    with open(manifestFile + '.part', 'w') as f:
+        json.dump(manifest, f, indent=1)
+    os.replace(manifestFile + '.part', manifestFile)
+
+
+if __name__ == '__main__':
+    if not os.path.exists(args.output) and not args.dry_run:
+        outputParent = os.path.dirname(os.path.abspath(args.output))
+        if not os.path.isdir(outputParent):
+            fail('Parent of output is no directory: ' + os.path.abspath(outputParent))
+
+    files = []
+    collectFiles(args.input, args.output, files)
+
+    manifestDir = args.output if os.path.isdir(args.input) else os.path.dirname(os.path.abspath(args.output))
+    manifestFile = os.path.join(manifestDir, manifestFileName)
+    manifest = loadManifest(manifestFile)
+
+    # only new files and files with a changed source or lead-in are processed
+    jobs = []
+    for inputPath, outputPath, text in files:
+        name = os.path.relpath(outputPath, manifestDir)
+        entry = manifest.get(name)
+        sha256, stat = sourceHash(inputPath, entry)
+        newEntry = { 'sha256': sha256, 'size': stat.st_size, 'mtime': stat.st_mtime, 'lead_in': leadInKey(text) }
+        if os.path.isfile(outputPath):
+            if entry is None:
+                print('Skipping {} (file already exists)'.format(os.path.abspath(outputPath)))
+                continue
+            if entry['sha256'] == sha256 and entry['lead_in'] == newEntry['lead_in']:
+                manifest[name] = newEntry
+                continue
+        jobs.append(((inputPath, outputPath, text), name, newEntry))
+
+    print('{} of {} files to process'.format(len(jobs), len(files)))
+    with multiprocessing.Pool(args.jobs) as pool:
+        done = 0
+        for (job, name, newEntry), _ in zip(jobs, pool.imap(addLeadInMessage, [ job for job, _, _ in jobs ])):
+            manifest[name] = newEntry
+            done += 1
+            if not args.dry_run and done % 20 == 0:
+                saveManifest(manifestFile, manifest)
+    if not args.dry_run and os.path.isdir(manifestDir):
+        saveManifest(manifestFile, manifest)
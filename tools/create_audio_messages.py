@@ -3,7 +3,38 @@
 # Creates the audio messages needed by TonUINO.
 
 
-import argparse, os, re, shutil, sys, text_to_speech
+import argparse, concurrent.futures, hashlib, json, os, re, shutil, sys, text_to_speech
+
+
+# the cache file of a message: the hash of everything that changes the audio
+def cacheFile(cacheDir, text, args):
+    engine, voice = text_to_speech.engineAndVoiceUsingArgs(args)
+    key = json.dumps([ text, args.lang, voice, engine ], ensure_ascii=False)
+    return os.path.join(cacheDir, hashlib.sha256(key.encode('utf-8')).hexdigest() + '.mp3')
+
+
+# creates one message and copies it to all its target files
+def createMessage(text, targetFiles, args):
+    if args.no_cache:
+        text_to_speech.textToSpeechUsingArgs(text=text, targetFile=targetFiles[0], args=args)
+        sourceFile = targetFiles[0]
+    else:
+        sourceFile = cacheFile(args.cache, text, args)
+        if not os.path.isfile(sourceFile):
+            # write to a temp file first, so an aborted run leaves no broken file in the cache
+            # (it keeps the .mp3 extension, ffmpeg chooses the output format by it)
+            tempFile = os.path.join(os.path.dirname(sourceFile), '.part_' + os.path.basename(sourceFile))
+            try:
+                text_to_speech.textToSpeechUsingArgs(text=text, targetFile=tempFile, args=args)
+                if not os.path.isfile(tempFile) or os.path.getsize(tempFile) == 0:
+                    raise RuntimeError('Converting "{}" created no audio file'.format(text))
+                os.replace(tempFile, sourceFile)
+            finally:
+                if os.path.isfile(tempFile):
+                    os.remove(tempFile)
+    for targetFile in targetFiles:
+        if targetFile != sourceFile:
+            shutil.copy(sourceFile, targetFile)
 
 
 if __name__ == '__main__':
@@ -19,6 +50,9 @@ if __name__ == '__main__':
     text_to_speech.addArgumentsToArgparser(argparser)
     argparser.add_argument('--skip-numbers', action='store_true', help='If set, no number messages will be generated (`0001.mp3` - `0255.mp3`)')
     argparser.add_argument('--only-new', action='store_true', help='If set, only new messages will be created.')
+    argparser.add_argument('-j', '--jobs', type=int, default=4, help='The number of messages converted in parallel. (default: 4)')
+    argparser.add_argument('--cache', type=str, default='.tts-cache', help='The directory of the converted messages, only changed texts are converted again. (default: `.tts-cache`)')
+    argparser.add_argument('--no-cache', action='store_true', help='If set, every message is converted again and the cache is not used.')
     args = argparser.parse_args()
 
 
@@ -32,26 +66,31 @@ if __name__ == '__main__':
     targetDir = args.output
     if os.path.isdir(targetDir):
         print("Directory `" + targetDir + "` already exists.")
-    else:
-        os.mkdir(targetDir)
-        os.mkdir(targetDir + '/advert')
-        os.mkdir(targetDir + '/mp3')
+    os.makedirs(targetDir + '/advert', exist_ok=True)
+    os.makedirs(targetDir + '/mp3', exist_ok=True)
+    if not args.no_cache:
+        os.makedirs(args.cache, exist_ok=True)
 
+    # text -> target files, the same text is only converted once
+    messages = {}
+    def addMessage(text, targetFile):
+        if args.only_new and os.path.isfile(targetFile):
+            return
+        messages.setdefault(text, []).append(targetFile)
 
     if not args.skip_numbers:
         for i in range(1,256):
-            targetFile1 = '{}/mp3/{:0>4}.mp3'.format(targetDir, i)
-            targetFile2 = '{}/advert/{:0>4}.mp3'.format(targetDir, i)
-            text_to_speech.textToSpeechUsingArgs(text='{}'.format(i), targetFile=targetFile1, args=args)
-            shutil.copy(targetFile1, targetFile2)
+            addMessage('{}'.format(i), '{}/mp3/{:0>4}.mp3'.format(targetDir, i))
+            addMessage('{}'.format(i), '{}/advert/{:0>4}.mp3'.format(targetDir, i))
 
     with open(audioMessagesFile) as f:
         lineRe = re.compile('^([^|]+)\\|(.*)$')
         for line in f:
             match = lineRe.match(line.strip())
             if match:
-                fileName = match.group(1)
-                if args.only_new and os.path.isfile(targetDir + "/" + fileName):
-                    continue
-                text = match.group(2)
-                text_to_speech.textToSpeechUsingArgs(text=text, targetFile=targetDir + "/" + fileName, args=args)
+                addMessage(match.group(2), targetDir + "/" + match.group(1))
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as executor:
+        futures = [ executor.submit(createMessage, text, targetFiles, args) for text, targetFiles in messages.items() ]
+        for future in concurrent.futures.as_completed(futures):
+            future.result()
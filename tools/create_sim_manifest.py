@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+
+# Creates the SD card manifest for the host simulator (test/sim/simulator.cpp): the duration of every track
+# in the numbered folders of the SD card. The duration is read with mutagen if it is installed, otherwise it is
+# estimated from the file size.
+
+
+import argparse, json, os, re, sys
+
+
+argFormatter = lambda prog: argparse.RawDescriptionHelpFormatter(prog, max_help_position=27, width=100)
+argparser = argparse.ArgumentParser(
+    description=
+        'Creates the SD card manifest (track durations per folder) for the host simulator.\n' +
+        'Run the simulator with: sim_tonuino_classic_three --manifest sd.json --days 7',
+    usage='%(prog)s -s /media/SDCARD -o sd.json [optional arguments...]',
+    formatter_class=argFormatter)
+argparser.add_argument('-s', '--sdcard', type=str, required=True, help='The root directory of the SD card')
+argparser.add_argument('-o', '--output', type=str, required=True, help='The manifest file to write')
+argparser.add_argument('--bitrate', type=int, default=128, help='The bit rate in kbit/s to estimate the duration without mutagen. Default: 128')
+argparser.add_argument('--message-duration', type=float, default=2.0, help='The duration of the mp3/advert messages in s. Default: 2.0')
+args = argparser.parse_args()
+
+try:
+    from mutagen.mp3 import MP3
+except ImportError:
+    MP3 = None
+
+
+def fail(msg):
+    print('ERROR: ' + msg)
+    sys.exit(1)
+
+
+def trackDuration(path):
+    if MP3 is not None:
+        try:
+            return round(MP3(path).info.length, 1)
+        except Exception:
+            pass
+    return round(os.path.getsize(path) * 8 / (args.bitrate * 1000), 1)
+
+
+if not os.path.isdir(args.sdcard):
+    fail('"%s" is no directory' % args.sdcard)
+
+folders = {}
+for folder in sorted(os.listdir(args.sdcard)):
+    folderPath = os.path.join(args.sdcard, folder)
+    if not re.fullmatch(r'\d\d', folder) or not os.path.isdir(folderPath):
+        continue
+    tracks = {}
+    for fileName in os.listdir(folderPath):
+        match = re.match(r'(\d{3,4})', fileName)
+        if match and fileName.lower().endswith('.mp3'):
+            tracks[int(match.group(1))] = trackDuration(os.path.join(folderPath, fileName))
+    if not tracks:
+        continue
+    # the DfPlayer plays the tracks by number, a gap is played as a short track
+    folders[folder] = [ tracks.get(n, 1.0) for n in range(1, max(tracks) + 1) ]
+    print('folder %s: %d tracks, %.0f min' % (folder, len(folders[folder]), sum(folders[folder]) / 60))
+
+if not folders:
+    fail('no numbered folders with tracks found in "%s"' % args.sdcard)
+
+with open(args.output, 'w') as f:
+    json.dump({ 'message_duration': args.message_duration, 'folders': folders }, f, indent=1)
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+
+# Decodes the binary log of a TonUINO built with BINARY_LOGGER back to text.
+# The strings are read from the firmware (elf file) using the token, i.e. the address of the string in flash.
+
+
+import argparse, subprocess, struct, sys, tempfile, os
+
+
+argFormatter = lambda prog: argparse.RawDescriptionHelpFormatter(prog, max_help_position=27, width=100)
+argparser = argparse.ArgumentParser(
+    description=
+        'Decodes the binary log of a TonUINO built with BINARY_LOGGER back to text.\n' +
+        'The log is read from a serial port (needs pyserial) or from a file with the raw bytes.',
+    usage='%(prog)s -e firmware.elf (-p /dev/ttyUSB0 | -i log.bin) [optional arguments...]',
+    formatter_class=argFormatter)
+argparser.add_argument('-e', '--elf', type=str, required=True, help='The firmware the log was written by (e.g. .pio/build/classic/firmware.elf)')
+argparser.add_argument('-p', '--port', type=str, default=None, help='The serial port to read the log from')
+argparser.add_argument('-b', '--baud', type=int, default=115200, help='The baud rate of the serial port. Default: 115200')
+argparser.add_argument('-i', '--input', type=str, default=None, help='The file to read the raw log from')
+argparser.add_argument('--objcopy', type=str, default='avr-objcopy', help='The objcopy to use for extracting the flash image. Default: avr-objcopy')
+argparser.add_argument('--flash-offset', type=lambda x: int(x, 0), default=0, help='The address the flash is mapped to (0x4000 for the TonUINO Every). Default: 0')
+argparser.add_argument('--prefix', action='store_true', help='Prefix each line with the severity and the logger name')
+args = argparser.parse_args()
+
+recordStart = 0xa5
+severities  = [ 'D', 'I', 'W', 'E', '?' ]
+
+
+def fail(msg):
+    print('ERROR: ' + msg)
+    sys.exit(1)
+
+
+def readFlashImage():
+    with tempfile.TemporaryDirectory() as tmpDir:
+        binFile = os.path.join(tmpDir, 'flash.bin')
+        try:
+            subprocess.run([ args.objcopy, '-O', 'binary', args.elf, binFile ], check=True)
+        except (OSError, subprocess.CalledProcessError) as e:
+            fail('Could not extract the flash image with {}: {}'.format(args.objcopy, e))
+        with open(binFile, 'rb') as f:
+            return f.read()
+
+
+def openInput():
+    if args.input is not None:
+        return open(args.input, 'rb')
+    try:
+        import serial
+    except ImportError:
+        fail('Reading from a serial port needs pyserial (pip install pyserial)')
+    return serial.Serial(args.port, args.baud)
+
+
+class Decoder:
+    def __init__(self, flash, stream):
+        self.flash  = flash
+        self.stream = stream
+
+    def byte(self):
+        b = self.stream.read(1)
+        if len(b) == 0:
+            raise EOFError()
+        return b[0]
+
+    def bytes(self, size):
+        return bytes(self.byte() for _ in range(size))
+
+    def string(self, token):
+        address = token - args.flash_offset
+        if address < 0 or address >= len(self.flash):
+            return '<{:#06x}>'.format(token)
+        end = self.flash.find(b'\0', address)
+        return self.flash[address:end].decode('latin-1')
+
+    def token(self):
+        return struct.unpack('<H', self.bytes(2))[0]
+
+    def record(self):
+        while self.byte() != recordStart:
+            pass
+        severity = self.byte()
+        name     = self.string(self.token())
+        text     = ''
+        while True:
+            tag = self.byte()
+            if   tag == 0x01: text += self.string(self.token())
+            elif tag == 0x02:
+                s = bytearray()
+                while (c := self.byte()) != 0:
+                    s.append(c)
+                text += s.decode('latin-1')
+            elif tag == 0x03: text += chr(self.byte())
+            elif tag == 0x04: text += '{:.2f}'.format(struct.unpack('<f', self.bytes(4))[0])
+            elif tag & 0xf0 in (0x10, 0x20) and tag & 0x0f in (1, 2, 4, 8):
+                text += str(int.from_bytes(self.bytes(tag & 0x0f), 'little', signed=(tag & 0xf0 == 0x20)))
+            elif tag == 0x7e: return (severity, name, text, False)
+            elif tag == 0x7f: return (severity, name, text, True)
+            else:
+                # out of sync, wait for next record
+                return (severity, name, text + ' <?>', True)
+
+
+flash   = readFlashImage()
+decoder = Decoder(flash, openInput())
+lineStart = True
+try:
+    while True:
+        severity, name, text, lf = decoder.record()
+        if args.prefix and lineStart:
+            text = '{}-{}: {}'.format(severities[min(severity, len(severities)-1)], name, text)
+        print(text, end='\n' if lf else '', flush=True)
+        lineStart = lf
+except (EOFError, KeyboardInterrupt):
+    pass
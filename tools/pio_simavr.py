@@ -0,0 +1,18 @@
+# PlatformIO extra script: adds the target `simavr` that runs the firmware in the cycle accurate AVR simulator
+# simavr (package platformio/tool-simavr). The output of the UART is printed to the console.
+#   pio run -e bench_avr_classic -t simavr
+
+import os
+
+Import('env')
+
+simavr = os.path.join(env.PioPlatform().get_package_dir('tool-simavr') or '', 'bin', 'simavr')
+mcu    = env.BoardConfig().get('build.mcu')
+f_cpu  = env.BoardConfig().get('build.f_cpu').rstrip('L')
+
+env.AddCustomTarget(
+    name='simavr',
+    dependencies='$BUILD_DIR/${PROGNAME}.elf',
+    actions=[ '"%s" -m %s -f %s $BUILD_DIR/${PROGNAME}.elf' % (simavr, mcu, f_cpu) ],
+    title='simavr',
+    description='Runs the firmware in the AVR simulator simavr')
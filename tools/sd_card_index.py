@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+
+# Creates the folder index of the SD card (number of tracks per numbered folder, optionally the duration of every
+# track) and uploads the track counts to the box via the serial remote control (needs SERIAL_REMOTE and
+# TRACK_COUNT_CACHE, with TRACK_COUNT_CACHE_EEPROM the counts are kept over power off). Then a freshly flashed box
+# does not have to ask the DfPlayer for the track count of a folder.
+# The duration is read with mutagen if it is installed, otherwise it is estimated from the file size. The upload
+# needs pyserial.
+
+
+import argparse, json, os, re, sys, time
+
+
+argFormatter = lambda prog: argparse.RawDescriptionHelpFormatter(prog, max_help_position=27, width=100)
+argparser = argparse.ArgumentParser(
+    description=
+        'Creates the folder index (track counts) of the SD card and uploads it to the box.\n' +
+        'Enter the admin menu after changing the SD card, that clears the counts on the box.',
+    usage='%(prog)s -s /media/SDCARD [-o index.json] [-p /dev/ttyUSB0] [optional arguments...]',
+    formatter_class=argFormatter)
+argparser.add_argument('-s', '--sdcard', type=str, required=True, help='The root directory of the SD card (or of the extracted image)')
+argparser.add_argument('-o', '--output', type=str, default=None, help='The index file to write')
+argparser.add_argument('-p', '--port', type=str, default=None, help='The serial port of the box to upload the track counts to')
+argparser.add_argument('--baud', type=int, default=115200, help='The baud rate of the serial port. Default: 115200')
+argparser.add_argument('--durations', action='store_true', help='Add the duration of every track in s to the index')
+argparser.add_argument('--bitrate', type=int, default=128, help='The bit rate in kbit/s to estimate the duration without mutagen. Default: 128')
+args = argparser.parse_args()
+
+# see src/serial_remote.hpp
+frameStart     = 0x5a
+ackStart       = 0xa6
+c_track_count  = 0x05
+maxPayload     = 32  # serialRemoteMaxPayload
+countsPerFrame = maxPayload // 4 # command, folder, count (2 byte)
+ackNames       = [ 'ok', 'checksum', 'length', 'command' ]
+
+
+def fail(msg):
+    print('ERROR: ' + msg)
+    sys.exit(1)
+
+
+def trackDuration(path):
+    try:
+        from mutagen.mp3 import MP3
+        return round(MP3(path).info.length, 1)
+    except Exception:
+        return round(os.path.getsize(path) * 8 / (args.bitrate * 1000), 1)
+
+
+def scanSdCard(sdcard):
+    folders = {}
+    for folder in sorted(os.listdir(sdcard)):
+        folderPath = os.path.join(sdcard, folder)
+        if not re.fullmatch(r'\d\d', folder) or not os.path.isdir(folderPath) or not 1 <= int(folder) <= 99:
+            continue
+        # the DfPlayer counts the audio files in the folder
+        tracks = sorted(fileName for fileName in os.listdir(folderPath)
+                        if re.match(r'\d{3,4}', fileName) and fileName.lower().endswith(('.mp3', '.wav')))
+        if not tracks:
+            continue
+        entry = { 'tracks': len(tracks) }
+        if args.durations:
+            entry['durations'] = [ trackDuration(os.path.join(folderPath, t)) for t in tracks ]
+        folders[folder] = entry
+    return folders
+
+
+def sendFrame(port, seq, payload):
+    checksum = (seq + len(payload) + sum(payload)) & 0xff
+    port.write(bytes([ frameStart, seq, len(payload) ] + payload + [ checksum ]))
+    # skip the log output until the ack of this frame
+    deadline = time.time() + 2
+    received = b''
+    while time.time() < deadline:
+        received += port.read(port.in_waiting or 1)
+        pos = received.find(bytes([ ackStart, seq ]))
+        if pos >= 0 and len(received) > pos + 2:
+            return received[pos + 2]
+    return None
+
+
+def upload(folders):
+    try:
+        import serial
+    except ImportError:
+        fail('the upload needs pyserial (pip install pyserial)')
+    records = [ (int(folder), entry['tracks']) for folder, entry in folders.items() ]
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        time.sleep(2) # the box restarts when the port is opened
+        port.reset_input_buffer()
+        for n in range(0, len(records), countsPerFrame):
+            payload = []
+            for folder, count in records[n:n + countsPerFrame]:
+                payload += [ c_track_count, folder, count & 0xff, count >> 8 ]
+            seq = (n // countsPerFrame) & 0xff
+            for _ in range(3):
+                ack = sendFrame(port, seq, payload)
+                if ack == 0:
+                    break
+                print('frame %d: %s, retry' % (seq, 'no ack' if ack is None else ackNames[ack] if ack < len(ackNames) else ack))
+            else:
+                fail('upload of frame %d failed' % seq)
+    print('uploaded track counts of %d folders' % len(records))
+
+
+if not os.path.isdir(args.sdcard):
+    fail('"%s" is no directory' % args.sdcard)
+
+folders = scanSdCard(args.sdcard)
+if not folders:
+    fail('no numbered folders with tracks found in "%s"' % args.sdcard)
+for folder, entry in folders.items():
+    print('folder %s: %d tracks' % (folder, entry['tracks']))
+
+if args.output:
+    with open(args.output, 'w') as f:
+        json.dump({ 'folders': folders }, f, indent=1)
+
+if args.port:
+    upload(folders)
@@ -3,7 +3,7 @@
 # Converts text into spoken language saved to an mp3 file.
 
 
-import argparse, base64, json, os, subprocess, sys
+import argparse, base64, json, os, subprocess, sys, tempfile
 try:
     import urllib.request
 except ImportError:
@@ -90,6 +90,21 @@ def checkLanguage(dictionary, lang, argparser):
         sys.exit(2)
 
 
+def engineAndVoice(lang, useAmazon=False, useGoogleKey=None, useCoqui=False):
+    if useAmazon:
+        return 'amazon', amazonVoiceByLang[lang]
+    elif useGoogleKey:
+        return 'google', googleVoiceByLang[lang]['name']
+    elif useCoqui:
+        return 'coqui', coquiVoiceByLang[lang]
+    else:
+        return 'say', sayVoiceByLang[lang]
+
+
+def engineAndVoiceUsingArgs(args):
+    return engineAndVoice(args.lang, useAmazon=args.use_amazon, useGoogleKey=args.use_google_key, useCoqui=args.use_coqui)
+
+
 def textToSpeechUsingArgs(text, targetFile, args):
     textToSpeech(text, targetFile, lang=args.lang, useAmazon=args.use_amazon, useGoogleKey=args.use_google_key, useCoqui=args.use_coqui)
 
@@ -124,15 +139,30 @@ def textToSpeech(text, targetFile, lang='de', useAmazon=False, useGoogleKey=None
             f.write(mp3Data)
             
     elif useCoqui:
-        subprocess.call([ 'tts', '--model_name', coquiVoiceByLang[lang], '--out_path', 'temp.wav', '--text',text ])
-        subprocess.call([ 'ffmpeg', '-y', '-i', 'temp.wav', '-acodec', 'libmp3lame', '-ab', '128k', '-ac', '1', targetFile ])
-        os.remove('temp.wav')
+        tempFile = createTempFile('.wav')
+        try:
+            # check_call raises on an error, so that no broken message is used
+            subprocess.check_call([ 'tts', '--model_name', coquiVoiceByLang[lang], '--out_path', tempFile, '--text',text ])
+            subprocess.check_call([ 'ffmpeg', '-y', '-loglevel', 'error', '-i', tempFile, '-acodec', 'libmp3lame', '-ab', '128k', '-ac', '1', targetFile ])
+        finally:
+            os.remove(tempFile)
         # From version 0.10.0 there is also a python based API (https://www.youtube.com/watch?v=MYRgWwis1Jk)
 
     else:
-        subprocess.call([ 'say', '-v', sayVoiceByLang[lang], '-o', 'temp.aiff', text ])
-        subprocess.call([ 'ffmpeg', '-y', '-i', 'temp.aiff', '-acodec', 'libmp3lame', '-ab', '128k', '-ac', '1', targetFile ])
-        os.remove('temp.aiff')
+        tempFile = createTempFile('.aiff')
+        try:
+            # check_call raises on an error, so that no broken message is used
+            subprocess.check_call([ 'say', '-v', sayVoiceByLang[lang], '-o', tempFile, text ])
+            subprocess.check_call([ 'ffmpeg', '-y', '-loglevel', 'error', '-i', tempFile, '-acodec', 'libmp3lame', '-ab', '128k', '-ac', '1', targetFile ])
+        finally:
+            os.remove(tempFile)
+
+
+# a unique temp file, so that several conversions can run in parallel
+def createTempFile(suffix):
+    fd, tempFile = tempfile.mkstemp(suffix=suffix)
+    os.close(fd)
+    return tempFile
 
 
 def postJson(url, postBody, headers = None):